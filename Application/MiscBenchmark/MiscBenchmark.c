@@ -0,0 +1,1138 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiDxe.h>
+
+#include <Guid/FileInfo.h>
+#include <Guid/GlobalVariable.h>
+
+#include <Protocol/LoadedImage.h>
+#include <Protocol/SimpleFileSystem.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/EfiBootServicesLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/MiscDevicePathLib.h>
+#include <Library/MiscEventLib.h>
+#include <Library/MiscFileLib.h>
+#include <Library/MiscFvLib.h>
+#include <Library/MiscMemoryLib.h>
+#include <Library/MiscVariableLib.h>
+#include <Library/PrintLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+
+// MISC_BENCHMARK_DEFAULT_ITERATIONS
+#define MISC_BENCHMARK_DEFAULT_ITERATIONS  1000
+
+// MISC_BENCHMARK_DEFAULT_THRESHOLD
+/// The percentage by which the mean of a case may exceed its baseline.
+#define MISC_BENCHMARK_DEFAULT_THRESHOLD  10
+
+// MISC_BENCHMARK_MAX_LINE
+#define MISC_BENCHMARK_MAX_LINE  128
+
+// MISC_BENCHMARK_CONTEXT
+typedef struct {
+  EFI_FILE_HANDLE          Root;           ///< The volume of the image.
+  EFI_FILE_HANDLE          Directory;      ///< The directory of the image.
+  CHAR16                   *FileName;      ///< The path of the image.
+  EFI_DEVICE_PATH_PROTOCOL *FilePath;      ///< The file path of the image.
+} MISC_BENCHMARK_CONTEXT;
+
+// MISC_BENCHMARK_FUNCTION
+/** Performs a single iteration of a benchmark case.
+
+  @param[in] Context  The benchmark context.
+
+  @retval EFI_SUCCESS  The iteration has been performed.
+  @retval other        The iteration failed and the case is aborted.
+**/
+typedef
+EFI_STATUS
+(*MISC_BENCHMARK_FUNCTION)(
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  );
+
+// MISC_BENCHMARK_CASE
+typedef struct {
+  CONST CHAR8             *Name;      ///< The stable name of the case.
+  MISC_BENCHMARK_FUNCTION Function;   ///< The function to measure.
+  UINT32                  Divisor;    ///< Divides the number of iterations for
+                                      ///< cases that touch the media.
+} MISC_BENCHMARK_CASE;
+
+// MISC_BENCHMARK_RESULT
+typedef struct {
+  UINT32 Iterations;  ///< The number of iterations performed.
+  UINT64 Minimum;     ///< The fastest iteration, in nanoseconds.
+  UINT64 Mean;        ///< The mean of all iterations, in nanoseconds.
+  UINT64 Maximum;     ///< The slowest iteration, in nanoseconds.
+} MISC_BENCHMARK_RESULT;
+
+// mCounterCountsDown
+STATIC BOOLEAN mCounterCountsDown = FALSE;
+
+// mExtension
+STATIC CHAR16 mExtension[] = L"efi";
+
+// mBootOrderName
+STATIC CHAR16 mBootOrderName[] = EFI_BOOT_ORDER_VARIABLE_NAME;
+
+// mScratchName
+/// The name of a variable that does not exist, for the deletion case.
+STATIC CHAR16 mScratchName[] = L"MiscBenchmarkScratch";
+
+// mVariableData
+STATIC UINT8 mVariableData[256];
+
+// MISC_BENCHMARK_SUM_SIZE
+#define MISC_BENCHMARK_SUM_SIZE  SIZE_4KB
+
+// mSumBuffer
+/// Leaves room to start the sums at every misalignment of a native word.
+STATIC UINT8 mSumBuffer[MISC_BENCHMARK_SUM_SIZE + sizeof (UINTN)];
+
+// mSumVerified
+STATIC BOOLEAN mSumVerified = FALSE;
+
+// InternalElapsedNs
+STATIC
+UINT64
+InternalElapsedNs (
+  IN UINT64  Start,
+  IN UINT64  End
+  )
+{
+  UINT64 Counter;
+
+  if (mCounterCountsDown) {
+    Counter = (Start - End);
+  } else {
+    Counter = (End - Start);
+  }
+
+  return GetTimeInNanoSecond (Counter);
+}
+
+// InternalBenchmarkNotify
+STATIC
+VOID
+EFIAPI
+InternalBenchmarkNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  return;
+}
+
+// InternalBenchmarkLoadFile
+STATIC
+EFI_STATUS
+InternalBenchmarkLoadFile (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  EFI_STATUS Status;
+
+  UINTN      BufferSize;
+  VOID       *Buffer;
+
+  Status = LoadFile (Context->Root, Context->FileName, &BufferSize, &Buffer);
+
+  if (!EFI_ERROR (Status)) {
+    FreePool (Buffer);
+  }
+
+  return Status;
+}
+
+// InternalBenchmarkFindFileByExtension
+STATIC
+EFI_STATUS
+InternalBenchmarkFindFileByExtension (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  EFI_STATUS    Status;
+
+  EFI_FILE_INFO *FileInfo;
+
+  // The buffer is freed by the file functions once the end of the directory
+  // has been reached.
+
+  Status = FindFirstFileByExtension (
+             Context->Directory,
+             &FileInfo,
+             mExtension,
+             FALSE
+             );
+
+  while (!EFI_ERROR (Status)) {
+    Status = FindNextFileByExtension (
+               Context->Directory,
+               FileInfo,
+               mExtension,
+               FALSE
+               );
+  }
+
+  if (Status == EFI_NOT_FOUND) {
+    Status = EFI_SUCCESS;
+  }
+
+  return Status;
+}
+
+// InternalBenchmarkGetMemoryMapBuffer
+STATIC
+EFI_STATUS
+InternalBenchmarkGetMemoryMapBuffer (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  EFI_MEMORY_DESCRIPTOR *MemoryMap;
+  UINTN                 MemoryMapSize;
+  UINTN                 MapKey;
+  UINTN                 DescriptorSize;
+  UINT32                DescriptorVersion;
+
+  MemoryMap = GetMemoryMapBuffer (
+                gBS->GetMemoryMap,
+                &MemoryMapSize,
+                &MapKey,
+                &DescriptorSize,
+                &DescriptorVersion
+                );
+
+  if (MemoryMap == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  FreePool ((VOID *)MemoryMap);
+
+  return EFI_SUCCESS;
+}
+
+// InternalBenchmarkAllocatePagesFromTop
+STATIC
+EFI_STATUS
+InternalBenchmarkAllocatePagesFromTop (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  VOID *Buffer;
+
+  Buffer = AllocatePagesFromTop (EfiBootServicesData, 1, BASE_4GB);
+
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  return EfiFreePages ((EFI_PHYSICAL_ADDRESS)(UINTN)Buffer, 1);
+}
+
+// InternalBenchmarkFileDevicePathToText
+STATIC
+EFI_STATUS
+InternalBenchmarkFileDevicePathToText (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  CHAR16 *Text;
+
+  Text = MiscFileDevicePathToText (Context->FilePath, NULL);
+
+  if (Text == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  FreePool ((VOID *)Text);
+
+  return EFI_SUCCESS;
+}
+
+// InternalBenchmarkGetEfiGlobalVariable
+STATIC
+EFI_STATUS
+InternalBenchmarkGetEfiGlobalVariable (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  EFI_STATUS Status;
+
+  UINTN      DataSize;
+
+  DataSize = sizeof (mVariableData);
+  Status   = GetEfiGlobalVariable (
+               mBootOrderName,
+               NULL,
+               &DataSize,
+               (VOID *)&mVariableData[0]
+               );
+
+  // Only the lookup is measured, hence its outcome does not matter.
+
+  if ((Status == EFI_NOT_FOUND) || (Status == EFI_BUFFER_TOO_SMALL)) {
+    Status = EFI_SUCCESS;
+  }
+
+  return Status;
+}
+
+// InternalBenchmarkVariableExists
+STATIC
+EFI_STATUS
+InternalBenchmarkVariableExists (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  VariableExists (mBootOrderName, &gEfiGlobalVariableGuid);
+
+  return EFI_SUCCESS;
+}
+
+// InternalBenchmarkDeleteVariable
+STATIC
+EFI_STATUS
+InternalBenchmarkDeleteVariable (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  EFI_STATUS Status;
+
+  // The variable does not exist so that the case never writes to the flash.
+
+  Status = DeleteVariable (mScratchName, &gEfiCallerIdGuid);
+
+  if (Status == EFI_NOT_FOUND) {
+    Status = EFI_SUCCESS;
+  }
+
+  return Status;
+}
+
+// InternalBenchmarkSignalEvent
+STATIC
+EFI_STATUS
+InternalBenchmarkSignalEvent (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  EFI_EVENT Event;
+
+  Event = MiscCreateNotifySignalEvent (InternalBenchmarkNotify, NULL);
+
+  if (Event == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  EfiSignalEvent (Event);
+
+  return EfiCloseEvent (Event);
+}
+
+// InternalBenchmarkTimerEvent
+STATIC
+EFI_STATUS
+InternalBenchmarkTimerEvent (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  EFI_EVENT Event;
+
+  Event = MiscCreateTimerEvent (
+            InternalBenchmarkNotify,
+            NULL,
+            EFI_TIMER_PERIOD_SECONDS (1),
+            FALSE,
+            TPL_CALLBACK
+            );
+
+  if (Event == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  MiscCancelTimerEvent (Event);
+
+  return EFI_SUCCESS;
+}
+
+// InternalReferenceSum8
+STATIC
+UINT8
+InternalReferenceSum8 (
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  UINT8 Sum;
+  UINTN Index;
+
+  Sum = 0;
+
+  for (Index = 0; Index < Length; ++Index) {
+    Sum = (UINT8)(Sum + Buffer[Index]);
+  }
+
+  return Sum;
+}
+
+// InternalVerifySum8
+/** Compares MiscFvCalculateSum8() against a byte-by-byte sum for every start
+    misalignment and for lengths around the folding interval of the lanes.
+
+  @param[in] Fill  The value of all bytes, or 0 for a varying pattern.
+
+  @retval EFI_SUCCESS           All sums have matched.
+  @retval EFI_VOLUME_CORRUPTED  A sum has not matched.
+**/
+STATIC
+EFI_STATUS
+InternalVerifySum8 (
+  IN UINT8  Fill
+  )
+{
+  STATIC CONST UINTN Lengths[] = {
+    0, 1, 7, 8, 9, 255, 1023, 1024, 1025, 2049, MISC_BENCHMARK_SUM_SIZE
+  };
+
+  UINTN Index;
+  UINTN Offset;
+  UINTN LengthIndex;
+
+  for (Index = 0; Index < sizeof (mSumBuffer); ++Index) {
+    mSumBuffer[Index] = ((Fill != 0) ? Fill : (UINT8)((Index * 167) + 13));
+  }
+
+  for (Offset = 0; Offset < sizeof (UINTN); ++Offset) {
+    for (
+      LengthIndex = 0;
+      LengthIndex < (sizeof (Lengths) / sizeof (Lengths[0]));
+      ++LengthIndex
+      ) {
+      if (MiscFvCalculateSum8 (&mSumBuffer[Offset], Lengths[LengthIndex])
+       != InternalReferenceSum8 (&mSumBuffer[Offset], Lengths[LengthIndex])) {
+        return EFI_VOLUME_CORRUPTED;
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+// InternalBenchmarkCalculateSum8
+/** Measures MiscFvCalculateSum8() over a misaligned buffer.
+
+  The untimed first iteration verifies the result against a byte-by-byte sum,
+  including all-0xFF input, which fills the lanes of the accumulator the most.
+**/
+STATIC
+EFI_STATUS
+InternalBenchmarkCalculateSum8 (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  EFI_STATUS Status;
+
+  if (!mSumVerified) {
+    Status = InternalVerifySum8 (0xFF);
+
+    if (!EFI_ERROR (Status)) {
+      Status = InternalVerifySum8 (0);
+    }
+
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    mSumVerified = TRUE;
+  }
+
+  MiscFvCalculateSum8 (&mSumBuffer[1], MISC_BENCHMARK_SUM_SIZE - 1);
+
+  return EFI_SUCCESS;
+}
+
+// InternalBenchmarkLocateProtocol
+STATIC
+EFI_STATUS
+InternalBenchmarkLocateProtocol (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  VOID *Interface;
+
+  return EfiLocateProtocol (
+           &gEfiSimpleFileSystemProtocolGuid,
+           NULL,
+           &Interface
+           );
+}
+
+// InternalBenchmarkAllocatePool
+STATIC
+EFI_STATUS
+InternalBenchmarkAllocatePool (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  EFI_STATUS Status;
+
+  VOID       *Buffer;
+
+  Status = EfiAllocatePool (EfiBootServicesData, 64, &Buffer);
+
+  if (!EFI_ERROR (Status)) {
+    Status = EfiFreePool (Buffer);
+  }
+
+  return Status;
+}
+
+// InternalBenchmarkRaiseTpl
+STATIC
+EFI_STATUS
+InternalBenchmarkRaiseTpl (
+  IN MISC_BENCHMARK_CONTEXT  *Context
+  )
+{
+  EFI_TPL OldTpl;
+
+  OldTpl = EfiRaiseTPL (TPL_NOTIFY);
+  EfiRestoreTPL (OldTpl);
+
+  return EFI_SUCCESS;
+}
+
+// mCases
+/// The names are part of the output format and must not be changed, as they
+/// key the stored baselines.
+STATIC CONST MISC_BENCHMARK_CASE mCases[] = {
+  {
+    "MiscFileLib.LoadFile",
+    InternalBenchmarkLoadFile,
+    10
+  },
+  {
+    "MiscFileLib.FindFileByExtension",
+    InternalBenchmarkFindFileByExtension,
+    10
+  },
+  {
+    "MiscMemoryLib.GetMemoryMapBuffer",
+    InternalBenchmarkGetMemoryMapBuffer,
+    1
+  },
+  {
+    "MiscMemoryLib.AllocatePagesFromTop",
+    InternalBenchmarkAllocatePagesFromTop,
+    1
+  },
+  {
+    "MiscDevicePathLib.FileDevicePathToText",
+    InternalBenchmarkFileDevicePathToText,
+    1
+  },
+  {
+    "MiscVariableLib.GetEfiGlobalVariable",
+    InternalBenchmarkGetEfiGlobalVariable,
+    1
+  },
+  {
+    "MiscVariableLib.VariableExists",
+    InternalBenchmarkVariableExists,
+    1
+  },
+  {
+    "MiscVariableLib.DeleteVariable",
+    InternalBenchmarkDeleteVariable,
+    1
+  },
+  {
+    "MiscEventLib.SignalEvent",
+    InternalBenchmarkSignalEvent,
+    1
+  },
+  {
+    "MiscEventLib.TimerEvent",
+    InternalBenchmarkTimerEvent,
+    1
+  },
+  {
+    "MiscFvLib.CalculateSum8",
+    InternalBenchmarkCalculateSum8,
+    1
+  },
+  {
+    "EfiBootServicesLib.LocateProtocol",
+    InternalBenchmarkLocateProtocol,
+    1
+  },
+  {
+    "EfiBootServicesLib.AllocatePool",
+    InternalBenchmarkAllocatePool,
+    1
+  },
+  {
+    "EfiBootServicesLib.RaiseTpl",
+    InternalBenchmarkRaiseTpl,
+    1
+  }
+};
+
+// InternalRunCase
+/** Measures a benchmark case.
+
+  One untimed iteration is performed first so that caches and lazily
+  allocated firmware structures do not distort the results.
+**/
+STATIC
+EFI_STATUS
+InternalRunCase (
+  IN  CONST MISC_BENCHMARK_CASE  *Case,
+  IN  MISC_BENCHMARK_CONTEXT     *Context,
+  IN  UINT32                     Iterations,
+  OUT MISC_BENCHMARK_RESULT      *Result
+  )
+{
+  EFI_STATUS Status;
+
+  UINT32     Index;
+  UINT64     Start;
+  UINT64     End;
+  UINT64     Elapsed;
+  UINT64     Total;
+
+  ASSERT (Case != NULL);
+  ASSERT (Context != NULL);
+  ASSERT (Iterations > 0);
+  ASSERT (Result != NULL);
+
+  Result->Iterations = Iterations;
+  Result->Minimum    = MAX_UINT64;
+  Result->Mean       = 0;
+  Result->Maximum    = 0;
+
+  Status = Case->Function (Context);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Total = 0;
+
+  for (Index = 0; Index < Iterations; ++Index) {
+    Start  = GetPerformanceCounter ();
+    Status = Case->Function (Context);
+    End    = GetPerformanceCounter ();
+
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Elapsed = InternalElapsedNs (Start, End);
+    Total  += Elapsed;
+
+    if (Elapsed < Result->Minimum) {
+      Result->Minimum = Elapsed;
+    }
+
+    if (Elapsed > Result->Maximum) {
+      Result->Maximum = Elapsed;
+    }
+  }
+
+  Result->Mean = DivU64x32 (Total, Iterations);
+
+  return EFI_SUCCESS;
+}
+
+// InternalGetBaseline
+/** Retrieves the mean of a case from a baseline.
+
+  The baseline is a previous output of this application.  The mean is the
+  fourth column of the line starting with the case name.
+
+  @param[in]  Baseline      The contents of the baseline file.
+  @param[in]  BaselineSize  The size, in bytes, of Baseline.
+  @param[in]  Name          The name of the case to look up.
+  @param[out] Mean          On output, the mean of the case, in nanoseconds.
+
+  @retval TRUE   The case has been found.
+  @retval FALSE  The baseline does not contain the case.
+**/
+STATIC
+BOOLEAN
+InternalGetBaseline (
+  IN  CONST CHAR8  *Baseline,
+  IN  UINTN        BaselineSize,
+  IN  CONST CHAR8  *Name,
+  OUT UINT64       *Mean
+  )
+{
+  CONST CHAR8 *Line;
+  CONST CHAR8 *End;
+  UINTN       NameLength;
+  UINTN       Column;
+
+  ASSERT (Baseline != NULL);
+  ASSERT (Name != NULL);
+  ASSERT (Mean != NULL);
+
+  NameLength = AsciiStrLen (Name);
+  End        = (Baseline + BaselineSize);
+
+  for (Line = Baseline; Line < End; ++Line) {
+    if (((UINTN)(End - Line) > NameLength)
+     && (CompareMem ((VOID *)Line, (VOID *)Name, NameLength) == 0)
+     && (Line[NameLength] == ',')) {
+      Line  += (NameLength + 1);
+      Column = 1;
+
+      while ((Line < End) && (Column < 3)) {
+        if (*Line == ',') {
+          ++Column;
+        } else if ((*Line == '\r') || (*Line == '\n')) {
+          break;
+        }
+
+        ++Line;
+      }
+
+      if ((Column < 3) || (Line == End) || (*Line < '0') || (*Line > '9')) {
+        return FALSE;
+      }
+
+      *Mean = 0;
+
+      while ((Line < End) && (*Line >= '0') && (*Line <= '9')) {
+        *Mean = (MultU64x32 (*Mean, 10) + (*Line - '0'));
+        ++Line;
+      }
+
+      return TRUE;
+    }
+
+    // Skip to the start of the next line.
+
+    while ((Line < End) && (*Line != '\n')) {
+      ++Line;
+    }
+  }
+
+  return FALSE;
+}
+
+// InternalOutput
+STATIC
+VOID
+InternalOutput (
+  IN EFI_FILE_HANDLE  File, OPTIONAL
+  IN CONST CHAR8      *Line
+  )
+{
+  UINTN Size;
+
+  ASSERT (Line != NULL);
+
+  Print (L"%a", Line);
+
+  if (File != NULL) {
+    Size = AsciiStrLen (Line);
+    File->Write (File, &Size, (VOID *)Line);
+  }
+}
+
+// InternalCreateOutputFile
+STATIC
+EFI_STATUS
+InternalCreateOutputFile (
+  IN  EFI_FILE_HANDLE  Root,
+  IN  CHAR16           *FileName,
+  OUT EFI_FILE_HANDLE  *File
+  )
+{
+  EFI_STATUS      Status;
+
+  EFI_FILE_HANDLE OldFile;
+
+  ASSERT (Root != NULL);
+  ASSERT (FileName != NULL);
+  ASSERT (File != NULL);
+
+  // Delete a previous output, as the file would not be truncated otherwise.
+
+  Status = Root->Open (
+                   Root,
+                   &OldFile,
+                   FileName,
+                   (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE),
+                   0
+                   );
+
+  if (!EFI_ERROR (Status)) {
+    OldFile->Delete (OldFile);
+  }
+
+  return Root->Open (
+                 Root,
+                 File,
+                 FileName,
+                 (EFI_FILE_MODE_READ
+                   | EFI_FILE_MODE_WRITE
+                   | EFI_FILE_MODE_CREATE),
+                 0
+                 );
+}
+
+// InternalOpenImageDirectory
+/** Opens the volume and the directory the image has been loaded from.
+**/
+STATIC
+EFI_STATUS
+InternalOpenImageDirectory (
+  IN  EFI_LOADED_IMAGE_PROTOCOL  *LoadedImage,
+  OUT MISC_BENCHMARK_CONTEXT     *Context
+  )
+{
+  EFI_STATUS                      Status;
+
+  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *FileSystem;
+  CHAR16                          *DirectoryName;
+  UINTN                           Index;
+
+  ASSERT (LoadedImage != NULL);
+  ASSERT (Context != NULL);
+
+  Status = EfiHandleProtocol (
+             LoadedImage->DeviceHandle,
+             &gEfiSimpleFileSystemProtocolGuid,
+             (VOID **)&FileSystem
+             );
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Context->FilePath = LoadedImage->FilePath;
+  Context->FileName = MiscFileDevicePathToText (LoadedImage->FilePath, NULL);
+
+  if (Context->FileName == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  Status = FileSystem->OpenVolume (FileSystem, &Context->Root);
+
+  if (EFI_ERROR (Status)) {
+    FreePool ((VOID *)Context->FileName);
+
+    return Status;
+  }
+
+  DirectoryName = AllocateCopyPool (
+                    StrSize (Context->FileName),
+                    (VOID *)Context->FileName
+                    );
+
+  Status = EFI_OUT_OF_RESOURCES;
+
+  if (DirectoryName != NULL) {
+    for (Index = StrLen (DirectoryName); Index > 0; --Index) {
+      if (DirectoryName[Index - 1] == L'\\') {
+        break;
+      }
+    }
+
+    // Keep the root directory separator.
+
+    DirectoryName[MAX (Index, 1) - 1] = L'\0';
+
+    if (DirectoryName[0] == L'\0') {
+      DirectoryName[0] = L'\\';
+      DirectoryName[1] = L'\0';
+    }
+
+    Status = Context->Root->Open (
+                              Context->Root,
+                              &Context->Directory,
+                              DirectoryName,
+                              EFI_FILE_MODE_READ,
+                              0
+                              );
+
+    FreePool ((VOID *)DirectoryName);
+  }
+
+  if (EFI_ERROR (Status)) {
+    Context->Root->Close (Context->Root);
+    FreePool ((VOID *)Context->FileName);
+  }
+
+  return Status;
+}
+
+// MiscBenchmarkMain
+/** Runs all benchmark cases and prints one comma-separated line per case.
+
+  Usage: MiscBenchmark [-n Iterations] [-t Percent] [-b Baseline] [-o Output]
+
+  The output of a run may be stored with -o and passed as the baseline of
+  later runs.  A case regresses when its mean exceeds the baseline mean by
+  more than the threshold percentage.
+
+  @param[in] ImageHandle  The firmware allocated handle for the EFI image.
+  @param[in] SystemTable  A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS  All cases have passed.
+  @retval EFI_ABORTED  A case has failed or regressed.
+  @retval other        The benchmark could not be set up.
+**/
+EFI_STATUS
+EFIAPI
+MiscBenchmarkMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                Status;
+
+  EFI_LOADED_IMAGE_PROTOCOL *LoadedImage;
+  MISC_BENCHMARK_CONTEXT    Context;
+  MISC_BENCHMARK_RESULT     Result;
+  CHAR16                    *Arguments;
+  CHAR16                    *Argument;
+  CHAR16                    *BaselineName;
+  CHAR16                    *OutputName;
+  CHAR8                     *Baseline;
+  UINTN                     BaselineSize;
+  EFI_FILE_HANDLE           OutputFile;
+  UINT32                    Iterations;
+  UINT32                    Threshold;
+  UINT64                    BaselineMean;
+  UINT64                    CounterStart;
+  UINT64                    CounterEnd;
+  BOOLEAN                   Regressed;
+  CONST CHAR8               *Verdict;
+  CHAR8                     Line[MISC_BENCHMARK_MAX_LINE];
+  UINTN                     Index;
+  UINTN                     Length;
+
+  Status = EfiHandleProtocol (
+             ImageHandle,
+             &gEfiLoadedImageProtocolGuid,
+             (VOID **)&LoadedImage
+             );
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  // Parse the arguments.  The load options may or may not start with the
+  // image name, which is skipped like any other unknown token.
+
+  Iterations   = MISC_BENCHMARK_DEFAULT_ITERATIONS;
+  Threshold    = MISC_BENCHMARK_DEFAULT_THRESHOLD;
+  BaselineName = NULL;
+  OutputName   = NULL;
+  Length       = (LoadedImage->LoadOptionsSize / sizeof (*Arguments));
+  Arguments    = AllocateZeroPool ((Length + 1) * sizeof (*Arguments));
+
+  if (Arguments == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Length > 0) {
+    CopyMem (
+      (VOID *)Arguments,
+      LoadedImage->LoadOptions,
+      (Length * sizeof (*Arguments))
+      );
+  }
+
+  for (Index = 0; Index < Length; ++Index) {
+    if (Arguments[Index] == L' ') {
+      Arguments[Index] = L'\0';
+    }
+  }
+
+  for (Index = 0; Index < Length; Index += (StrLen (Argument) + 1)) {
+    Argument = &Arguments[Index];
+
+    if ((Argument[0] != L'-')
+     || (Argument[1] == L'\0')
+     || (Argument[2] != L'\0')) {
+      continue;
+    }
+
+    Index += (StrLen (Argument) + 1);
+
+    if (Index >= Length) {
+      break;
+    }
+
+    switch (Argument[1]) {
+      case L'n':
+      {
+        Iterations = (UINT32)StrDecimalToUintn (&Arguments[Index]);
+        break;
+      }
+
+      case L't':
+      {
+        Threshold = (UINT32)StrDecimalToUintn (&Arguments[Index]);
+        break;
+      }
+
+      case L'b':
+      {
+        BaselineName = &Arguments[Index];
+        break;
+      }
+
+      case L'o':
+      {
+        OutputName = &Arguments[Index];
+        break;
+      }
+
+      default:
+      {
+        break;
+      }
+    }
+
+    Argument = &Arguments[Index];
+  }
+
+  if (Iterations == 0) {
+    Iterations = MISC_BENCHMARK_DEFAULT_ITERATIONS;
+  }
+
+  Status = InternalOpenImageDirectory (LoadedImage, &Context);
+
+  if (EFI_ERROR (Status)) {
+    FreePool ((VOID *)Arguments);
+
+    return Status;
+  }
+
+  Baseline     = NULL;
+  BaselineSize = 0;
+
+  if (BaselineName != NULL) {
+    Status = LoadFile (
+               Context.Root,
+               BaselineName,
+               &BaselineSize,
+               (VOID **)&Baseline
+               );
+
+    if (EFI_ERROR (Status)) {
+      Print (L"Baseline %s could not be loaded: %r\n", BaselineName, Status);
+      Baseline = NULL;
+    }
+  }
+
+  OutputFile = NULL;
+
+  if (OutputName != NULL) {
+    Status = InternalCreateOutputFile (Context.Root, OutputName, &OutputFile);
+
+    if (EFI_ERROR (Status)) {
+      Print (L"Output %s could not be created: %r\n", OutputName, Status);
+      OutputFile = NULL;
+    }
+  }
+
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+
+  mCounterCountsDown = (BOOLEAN)(CounterStart > CounterEnd);
+
+  InternalOutput (
+    OutputFile,
+    "name,iterations,min_ns,mean_ns,max_ns,baseline_ns,result\n"
+    );
+
+  Regressed = FALSE;
+
+  for (Index = 0; Index < (sizeof (mCases) / sizeof (mCases[0])); ++Index) {
+    BaselineMean = 0;
+    Status       = InternalRunCase (
+                     &mCases[Index],
+                     &Context,
+                     MAX (Iterations / mCases[Index].Divisor, 1),
+                     &Result
+                     );
+
+    if (EFI_ERROR (Status)) {
+      Regressed = TRUE;
+      Verdict   = "error";
+      ZeroMem ((VOID *)&Result, sizeof (Result));
+    } else if ((Baseline == NULL)
+            || !InternalGetBaseline (
+                  Baseline,
+                  BaselineSize,
+                  mCases[Index].Name,
+                  &BaselineMean
+                  )) {
+      Verdict = "new";
+    } else if (Result.Mean > (BaselineMean
+                                + DivU64x32 (
+                                    MultU64x32 (BaselineMean, Threshold),
+                                    100
+                                    ))) {
+      Regressed = TRUE;
+      Verdict   = "fail";
+    } else {
+      Verdict = "pass";
+    }
+
+    AsciiSPrint (
+      Line,
+      sizeof (Line),
+      "%a,%d,%ld,%ld,%ld,%ld,%a\n",
+      mCases[Index].Name,
+      Result.Iterations,
+      Result.Minimum,
+      Result.Mean,
+      Result.Maximum,
+      BaselineMean,
+      Verdict
+      );
+
+    InternalOutput (OutputFile, Line);
+  }
+
+  if (OutputFile != NULL) {
+    OutputFile->Close (OutputFile);
+  }
+
+  if (Baseline != NULL) {
+    FreePool ((VOID *)Baseline);
+  }
+
+  Context.Directory->Close (Context.Directory);
+  Context.Root->Close (Context.Root);
+  FreePool ((VOID *)Context.FileName);
+  FreePool ((VOID *)Arguments);
+
+  return (Regressed ? EFI_ABORTED : EFI_SUCCESS);
+}
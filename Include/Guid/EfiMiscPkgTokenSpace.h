@@ -0,0 +1,28 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#ifndef EFI_MISC_PKG_TOKEN_SPACE_H_
+#define EFI_MISC_PKG_TOKEN_SPACE_H_
+
+// EFI_MISC_PKG_TOKEN_SPACE_GUID
+#define EFI_MISC_PKG_TOKEN_SPACE_GUID  \
+  { 0x48907039, 0x447A, 0x420F, { 0xAC, 0xAD, 0x84, 0x6A, 0xC0, 0x44, 0xCD, 0x52 } }
+
+// gEfiMiscPkgTokenSpaceGuid
+extern EFI_GUID gEfiMiscPkgTokenSpaceGuid;
+
+#endif // EFI_MISC_PKG_TOKEN_SPACE_H_
@@ -0,0 +1,92 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#ifndef MISC_PERFORMANCE_H_
+#define MISC_PERFORMANCE_H_
+
+// MISC_PERFORMANCE_GUID
+/// The configuration table GUID of the performance record table.
+#define MISC_PERFORMANCE_GUID  \
+  { 0x3F3594A8, 0xEF42, 0x43B3, { 0xBE, 0x03, 0xC0, 0xD0, 0xF6, 0x32, 0x91, 0x3A } }
+
+// MISC_PERFORMANCE_SIGNATURE
+#define MISC_PERFORMANCE_SIGNATURE  SIGNATURE_32 ('M', 'P', 'R', 'F')
+
+// Record Types
+
+#define MISC_PERFORMANCE_RECORD_BEGIN  0x00
+#define MISC_PERFORMANCE_RECORD_END    0x01
+#define MISC_PERFORMANCE_RECORD_POINT  0x02
+
+// Module IDs
+
+#define MISC_PERFORMANCE_MODULE_FILE      0x0001
+#define MISC_PERFORMANCE_MODULE_MEMORY    0x0002
+#define MISC_PERFORMANCE_MODULE_EVENT     0x0003
+#define MISC_PERFORMANCE_MODULE_VARIABLE  0x0004
+#define MISC_PERFORMANCE_MODULE_DISPATCH  0x0005
+
+// MISC_PERFORMANCE_MODULE_PLATFORM
+/// The first module ID available to platform code.
+#define MISC_PERFORMANCE_MODULE_PLATFORM  0x8000
+
+// Record IDs
+
+#define MISC_PERFORMANCE_ID_LOAD_FILE                0x0001
+#define MISC_PERFORMANCE_ID_GET_MEMORY_MAP_BUFFER    0x0001
+#define MISC_PERFORMANCE_ID_ALLOCATE_PAGES_FROM_TOP  0x0002
+#define MISC_PERFORMANCE_ID_GET_VARIABLE             0x0001
+#define MISC_PERFORMANCE_ID_SET_VARIABLE             0x0002
+#define MISC_PERFORMANCE_ID_DXE_DISPATCH             0x0001
+
+// MISC_PERFORMANCE_RECORD
+/// Records of MISC_PERFORMANCE_MODULE_EVENT are identified by the lower 32
+/// bits of the address of the notification function.
+typedef struct {
+  UINT64 Ticks;     ///< The value of the performance counter.
+  UINT16 ModuleId;  ///< The module ID of the record.
+  UINT8  Type;      ///< The record type.
+  UINT8  Reserved;  ///< Reserved.
+  UINT32 Id;        ///< The module-specific record ID.
+} MISC_PERFORMANCE_RECORD;
+
+// MISC_PERFORMANCE_TABLE
+/// The table is allocated as reserved memory, so that it can be retrieved
+/// after boot.  Records are written in the order of their reservation.  Once
+/// NextRecord exceeds NumberOfRecords, further records are dropped.
+///
+/// The time, in nanoseconds, of a record since the creation of the table is
+/// (Ticks - BaseTicks) * 1000000000 / Frequency for an up-counting counter,
+/// CounterStart < CounterEnd, and (BaseTicks - Ticks) * ... otherwise.  The
+/// time since processor reset, as used by FPDT, is relative to CounterStart
+/// instead.
+typedef struct {
+  UINT32 Signature;        ///< MISC_PERFORMANCE_SIGNATURE.
+  UINT32 HeaderSize;       ///< The size, in bytes, of the header.
+  UINT32 NumberOfRecords;  ///< The number of records the table can hold.
+  UINT32 NextRecord;       ///< The number of records reserved so far.
+  UINT64 Frequency;        ///< The frequency, in Hz, of the counter.
+  UINT64 CounterStart;     ///< The first value of the counter.
+  UINT64 CounterEnd;       ///< The last value of the counter.
+  UINT64 BaseTicks;        ///< The counter value at the creation of the table.
+//MISC_PERFORMANCE_RECORD Records[NumberOfRecords];
+} MISC_PERFORMANCE_TABLE;
+
+// gMiscPerformanceGuid
+extern EFI_GUID gMiscPerformanceGuid;
+
+#endif // MISC_PERFORMANCE_H_
@@ -0,0 +1,56 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#ifndef MISC_SMI_PROFILE_H_
+#define MISC_SMI_PROFILE_H_
+
+// MISC_SMI_PROFILE_GUID
+/// The handler type of the SMI handler returning a snapshot of the profile
+/// collected by MiscSmiProfileLib.
+#define MISC_SMI_PROFILE_GUID  \
+  { 0xB2C57C89, 0xF295, 0x4194, { 0xB4, 0xEA, 0x3F, 0x25, 0xFA, 0x50, 0xF7, 0x1D } }
+
+// MISC_SMI_PROFILE_NUMBER_OF_BUCKETS
+#define MISC_SMI_PROFILE_NUMBER_OF_BUCKETS  32
+
+// MISC_SMI_PROFILE_RECORD
+/// The profile of a single SMI handler.  Histogram[Index] counts the calls
+/// that took 2^Index to 2^(Index + 1) - 1 cycles.  The first bucket includes
+/// calls that took no cycle and the last bucket includes all longer calls.
+typedef struct {
+  EFI_GUID HandlerType;    ///< The handler type, or zero for root handlers.
+  UINT64   Handler;        ///< The address of the handler.
+  UINT64   NumberOfCalls;  ///< The number of times the handler was called.
+  UINT64   TotalCycles;    ///< The TSC cycles spent in all calls.
+  UINT64   MaximumCycles;  ///< The TSC cycles spent in the longest call.
+  UINT32   Histogram[MISC_SMI_PROFILE_NUMBER_OF_BUCKETS];
+} MISC_SMI_PROFILE_RECORD;
+
+// MISC_SMI_PROFILE_SNAPSHOT
+/// The communication buffer of the snapshot handler.  The caller initializes
+/// both counts to zero and sizes the buffer for the records it can hold.
+/// Each SMM driver appends the records of its handlers that fit.
+typedef struct {
+  UINT32 NumberOfRecords;       ///< The number of records returned.
+  UINT32 TotalNumberOfRecords;  ///< The number of records present.
+//MISC_SMI_PROFILE_RECORD Records[NumberOfRecords];
+} MISC_SMI_PROFILE_SNAPSHOT;
+
+// gMiscSmiProfileGuid
+extern EFI_GUID gMiscSmiProfileGuid;
+
+#endif // MISC_SMI_PROFILE_H_
@@ -0,0 +1,74 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#ifndef MISC_SMM_COMM_RING_H_
+#define MISC_SMM_COMM_RING_H_
+
+// MISC_SMM_COMM_RING_GUID
+/// The handler type of the SMI handler draining the communication ring.
+#define MISC_SMM_COMM_RING_GUID  \
+  { 0x75FCAFE8, 0x69C5, 0x4027, { 0xB6, 0x44, 0x54, 0x11, 0x3D, 0x62, 0x5E, 0x14 } }
+
+// MISC_SMM_COMM_RING_SIGNATURE
+#define MISC_SMM_COMM_RING_SIGNATURE  SIGNATURE_32 ('M', 'S', 'C', 'R')
+
+// MISC_SMM_COMM_RING_COMMAND
+enum {
+  MiscSmmCommRingCommandRegister,  ///< Registers the ring of the message.
+  MiscSmmCommRingCommandDrain      ///< Processes all entries of the ring.
+};
+
+// MISC_SMM_COMM_RING_MESSAGE
+/// The communication buffer data of the ring SMI handler.  Only this message
+/// is passed through the communication buffer, the requests stay in the ring.
+typedef struct {
+  UINT64 Command;      ///< A MISC_SMM_COMM_RING_COMMAND value.
+  UINT64 Status;       ///< On output, the status of the command.
+  UINT64 RingAddress;  ///< The address of the ring to register.
+  UINT64 RingSize;     ///< The size, in bytes, of the ring to register.
+} MISC_SMM_COMM_RING_MESSAGE;
+
+// MISC_SMM_COMM_RING_HEADER
+/// The ring is located outside of SMRAM and registered once.  Entries are
+/// appended from the end of the header up to Tail.
+typedef struct {
+  UINT32 Signature;        ///< MISC_SMM_COMM_RING_SIGNATURE.
+  UINT32 Tail;             ///< The offset of the end of the entries.
+  UINT32 NumberOfEntries;  ///< The number of entries.
+  UINT32 Reserved;         ///< Must be zero.
+} MISC_SMM_COMM_RING_HEADER;
+
+// MISC_SMM_COMM_RING_ENTRY
+/// A request to an SMI handler.  The request data follows the entry and is
+/// processed in place by the handler of HandlerType, as if it had been passed
+/// as the communication buffer.  The response replaces the request.
+typedef struct {
+  EFI_GUID HandlerType;  ///< The type of the handler to process the entry.
+  UINT32   EntrySize;    ///< The size, in bytes, of the entry and its data
+                         ///< buffer.  A multiple of 8.
+  UINT32   DataSize;     ///< The size, in bytes, of the request, and on
+                         ///< output of the response.
+  UINT64   Status;       ///< On output, the status returned by SmiManage().
+} MISC_SMM_COMM_RING_ENTRY;
+
+// MISC_SMM_COMM_RING_ENTRY_DATA
+#define MISC_SMM_COMM_RING_ENTRY_DATA(Entry)  ((VOID *)((Entry) + 1))
+
+// gMiscSmmCommRingGuid
+extern EFI_GUID gMiscSmmCommRingGuid;
+
+#endif // MISC_SMM_COMM_RING_H_
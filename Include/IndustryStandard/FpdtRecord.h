@@ -0,0 +1,75 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @par Specification Reference:
+    - ACPI 5.0, Section 5.2.23 Firmware Performance Data Table (FPDT)
+    - EDK II Extended Firmware Performance Record Formats
+**/
+
+#ifndef FPDT_RECORD_H_
+#define FPDT_RECORD_H_
+
+// FPDT_RECORD_REVISION_1
+#define FPDT_RECORD_REVISION_1  0x01
+
+// FPDT Record Types
+
+#define FPDT_GUID_EVENT_RECORD_TYPE            0x1010
+#define FPDT_DYNAMIC_STRING_EVENT_RECORD_TYPE  0x1011
+
+// FPDT Progress IDs
+
+#define FPDT_MODULE_START_ID            0x01
+#define FPDT_MODULE_END_ID              0x02
+#define FPDT_MODULE_LOADIMAGE_START_ID  0x03
+#define FPDT_MODULE_LOADIMAGE_END_ID    0x04
+
+// FPDT_STRING_EVENT_RECORD_NAME_LENGTH
+/// The maximum length, in bytes, of the name of a string event record,
+/// including the terminating NULL character.
+#define FPDT_STRING_EVENT_RECORD_NAME_LENGTH  24
+
+#pragma pack (1)
+
+// FPDT_RECORD_HEADER
+typedef struct {
+  UINT16 Type;      ///< The record type.
+  UINT8  Length;    ///< The length, in bytes, of the record.
+  UINT8  Revision;  ///< The revision of the record.
+} FPDT_RECORD_HEADER;
+
+// FPDT_GUID_EVENT_RECORD
+typedef struct {
+  FPDT_RECORD_HEADER Header;      ///< Type FPDT_GUID_EVENT_RECORD_TYPE.
+  UINT16             ProgressId;  ///< The progress ID of the event.
+  UINT32             ApicId;      ///< The APIC ID of the processor.
+  UINT64             Timestamp;   ///< The time of the event, in nanoseconds.
+  EFI_GUID           Guid;        ///< The GUID of the module or event.
+} FPDT_GUID_EVENT_RECORD;
+
+// FPDT_DYNAMIC_STRING_EVENT_RECORD
+typedef struct {
+  FPDT_RECORD_HEADER Header;      ///< Type
+                                  ///< FPDT_DYNAMIC_STRING_EVENT_RECORD_TYPE.
+  UINT16             ProgressId;  ///< The progress ID of the event.
+  UINT32             ApicId;      ///< The APIC ID of the processor.
+  UINT64             Timestamp;   ///< The time of the event, in nanoseconds.
+  EFI_GUID           Guid;        ///< The GUID of the module or event.
+  CHAR8              String[FPDT_STRING_EVENT_RECORD_NAME_LENGTH];
+} FPDT_DYNAMIC_STRING_EVENT_RECORD;
+
+#pragma pack ()
+
+#endif // FPDT_RECORD_H_
@@ -566,4 +566,81 @@ enum {
   UsbHidUsageKbKpModifierKeyRightCommand = USB_HID_KB_KP_USAGE (UsbHidUsageIdKbKpModifierKeyRightGui)
 };
 
+// USB HID Report Descriptor
+
+// USB_HID_ITEM_LONG
+#define USB_HID_ITEM_LONG  0xFE
+
+// USB_HID_ITEM_SIZE
+#define USB_HID_ITEM_SIZE(Prefix)  \
+  ((((Prefix) & 0x03U) == 3) ? 4 : ((Prefix) & 0x03U))
+
+// USB_HID_ITEM_TYPE
+#define USB_HID_ITEM_TYPE(Prefix)  (((Prefix) >> 2) & 0x03U)
+
+// USB_HID_ITEM_TAG
+#define USB_HID_ITEM_TAG(Prefix)  (((Prefix) >> 4) & 0x0FU)
+
+// USB_HID_ITEM_TYPES
+enum {
+  UsbHidItemTypeMain   = 0,
+  UsbHidItemTypeGlobal = 1,
+  UsbHidItemTypeLocal  = 2
+};
+
+// USB_HID_MAIN_ITEM_TAGS
+enum {
+  UsbHidMainItemTagInput         = 0x08,
+  UsbHidMainItemTagOutput        = 0x09,
+  UsbHidMainItemTagCollection    = 0x0A,
+  UsbHidMainItemTagFeature       = 0x0B,
+  UsbHidMainItemTagEndCollection = 0x0C
+};
+
+// USB_HID_GLOBAL_ITEM_TAGS
+enum {
+  UsbHidGlobalItemTagUsagePage       = 0x00,
+  UsbHidGlobalItemTagLogicalMinimum  = 0x01,
+  UsbHidGlobalItemTagLogicalMaximum  = 0x02,
+  UsbHidGlobalItemTagPhysicalMinimum = 0x03,
+  UsbHidGlobalItemTagPhysicalMaximum = 0x04,
+  UsbHidGlobalItemTagUnitExponent    = 0x05,
+  UsbHidGlobalItemTagUnit            = 0x06,
+  UsbHidGlobalItemTagReportSize      = 0x07,
+  UsbHidGlobalItemTagReportId        = 0x08,
+  UsbHidGlobalItemTagReportCount     = 0x09,
+  UsbHidGlobalItemTagPush            = 0x0A,
+  UsbHidGlobalItemTagPop             = 0x0B
+};
+
+// USB_HID_LOCAL_ITEM_TAGS
+enum {
+  UsbHidLocalItemTagUsage        = 0x00,
+  UsbHidLocalItemTagUsageMinimum = 0x01,
+  UsbHidLocalItemTagUsageMaximum = 0x02
+};
+
+// USB HID Main Item Data
+
+#define USB_HID_MAIN_ITEM_CONSTANT  BIT0
+#define USB_HID_MAIN_ITEM_VARIABLE  BIT1
+#define USB_HID_MAIN_ITEM_RELATIVE  BIT2
+
+// USB HID Boot Keyboard Report
+
+// USB_HID_KB_BOOT_REPORT_NUMBER_OF_KEYS
+#define USB_HID_KB_BOOT_REPORT_NUMBER_OF_KEYS  6
+
+#pragma pack (1)
+
+// USB_HID_KB_BOOT_REPORT
+/// The input report of the keyboard boot protocol.
+typedef struct {
+  USB_HID_KB_MODIFIER_MAP Modifiers;  ///< The pressed modifier keys.
+  UINT8                   Reserved;   ///< Reserved for OEM use.
+  UINT8                   KeyCodes[USB_HID_KB_BOOT_REPORT_NUMBER_OF_KEYS];
+} USB_HID_KB_BOOT_REPORT;
+
+#pragma pack ()
+
 #endif // USB_HID_H_
@@ -538,4 +538,41 @@ DxeProcessFirmwareVolume (
   OUT EFI_HANDLE  *FirmwareVolumeHandle
   );
 
+// DxeProcessFirmwareVolumeOnce
+/** Validates a firmware volume that is present in system memory and creates a
+    firmware volume handle for it, unless a volume with the same contents has
+    already been processed by this function.
+
+  The header and its checksum are validated once and a hash of the contents is
+  looked up in a registry of processed volumes, so that a volume reported
+  multiple times does not reach the DXE Core again.  A volume matching the
+  hash is only skipped if it is at the same address or has the same contents
+  as the registered one.  If requested, the
+  checksums of all files are verified beforehand, in parallel on all enabled
+  processors if the MP Services Protocol is available.
+
+  @param[in]  FirmwareVolumeHeader  A pointer to the header of the firmware
+                                    volume.
+  @param[in]  Size                  The size, in bytes, of the firmware volume.
+  @param[in]  VerifyFiles           Whether to verify the file checksums.
+  @param[out] FirmwareVolumeHandle  On output, a pointer to the created or
+                                    previously created handle.
+
+  @retval EFI_SUCCESS           The firmware volume handle was created.
+  @retval EFI_ALREADY_STARTED   The firmware volume has already been processed.
+                                FirmwareVolumeHandle holds the handle created
+                                at that time.
+  @retval EFI_VOLUME_CORRUPTED  The firmware volume header or one of its files
+                                is corrupted.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough system resources available
+                                to process the firmware volume.
+**/
+EFI_STATUS
+DxeProcessFirmwareVolumeOnce (
+  IN  CONST VOID  *FirmwareVolumeHeader,
+  IN  UINTN       Size,
+  IN  BOOLEAN     VerifyFiles,
+  OUT EFI_HANDLE  *FirmwareVolumeHandle
+  );
+
 #endif // DXE_SERVICES_LIB_H_
\ No newline at end of file
@@ -0,0 +1,95 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#ifndef MISC_DISPATCH_PROFILE_LIB_H_
+#define MISC_DISPATCH_PROFILE_LIB_H_
+
+// MISC_DISPATCH_PROFILE_RECORD
+/// Timestamps are in nanoseconds since processor reset, as in FPDT records.
+/// The load time of a driver is LoadEnd - LoadStart, its entry-point time is
+/// EntryEnd - LoadEnd.
+typedef struct {
+  EFI_HANDLE ImageHandle;  ///< The handle of the loaded image.
+  EFI_GUID   FileName;     ///< The FFS file name of the image, if any.
+  UINT32     Round;        ///< The profiled dispatch round, starting at 1.
+  UINT64     LoadStart;    ///< The time the image started loading.
+  UINT64     LoadEnd;      ///< The time the image was loaded.
+  UINT64     EntryEnd;     ///< The time the entry point returned.
+} MISC_DISPATCH_PROFILE_RECORD;
+
+// MiscProfileDxeDispatch
+/** Calls DxeDispatch() and records the drivers loaded and started in this
+    dispatch round.
+
+  The start of an image load is observed through the Security Architectural
+  Protocols, the end of it through the notification of the Loaded Image
+  Protocol.  As the dispatcher starts each driver right after loading it, the
+  entry point of a driver is considered returned when the next image starts
+  loading or the dispatch round ends.  Images loaded by a driver's entry point
+  are therefore recorded separately and end that driver's measurement.
+
+  Drivers enabled via DxeSchedule() or DxeTrust() are recorded in the next
+  profiled round that dispatches them.
+
+  @return  The status returned by DxeDispatch().
+**/
+EFI_STATUS
+MiscProfileDxeDispatch (
+  VOID
+  );
+
+// MiscGetDispatchProfile
+/** Returns the records collected by MiscProfileDxeDispatch().
+
+  @param[out] Records          On output, a pointer to the records.  The buffer
+                               is owned by the library.
+  @param[out] NumberOfRecords  On output, the number of records.
+**/
+VOID
+MiscGetDispatchProfile (
+  OUT CONST MISC_DISPATCH_PROFILE_RECORD  **Records,
+  OUT UINTN                               *NumberOfRecords
+  );
+
+// MiscDumpDispatchProfile
+/** Prints the collected records as a table to the debug output.
+**/
+VOID
+MiscDumpDispatchProfile (
+  VOID
+  );
+
+// MiscGetDispatchProfileFpdtRecords
+/** Exports the collected records as an FPDT GUID event record stream.
+
+  Each driver is described by a LOADIMAGE_START, LOADIMAGE_END, MODULE_START
+  and MODULE_END record, identified by its FFS file name.
+
+  @param[out] Buffer      On output, a pointer to the record stream.  The
+                          caller is responsible for freeing it.
+  @param[out] BufferSize  On output, the size, in bytes, of Buffer.
+
+  @retval EFI_SUCCESS           The records were exported.
+  @retval EFI_NOT_FOUND         No records have been collected.
+  @retval EFI_OUT_OF_RESOURCES  The record stream could not be allocated.
+**/
+EFI_STATUS
+MiscGetDispatchProfileFpdtRecords (
+  OUT VOID   **Buffer,
+  OUT UINTN  *BufferSize
+  );
+
+#endif // MISC_DISPATCH_PROFILE_LIB_H_
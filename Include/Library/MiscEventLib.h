@@ -63,6 +63,15 @@ MiscCreateSignalEventEx (
   IN CONST EFI_GUID    *EventGroup OPTIONAL
   );
 
+// MiscCloseEvent
+/** Closes an event.  Events created by MiscCreateSignalEventEx() and the
+    group event functions must be closed with this function.
+**/
+EFI_STATUS
+MiscCloseEvent (
+  IN EFI_EVENT  Event
+  );
+
 // CreateEfiVirtualAddressChangeEvent
 EFI_EVENT
 CreateEfiVirtualAddressChangeEvent (
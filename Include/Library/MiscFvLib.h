@@ -0,0 +1,210 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#ifndef MISC_FV_LIB_H_
+#define MISC_FV_LIB_H_
+
+// MiscFvValidateHeader
+/** Validates the header of a memory-mapped firmware volume.
+
+  @param[in] FvHeader  A pointer to the header of the firmware volume.
+  @param[in] Size      The size, in bytes, of the buffer holding the firmware
+                       volume.
+
+  @retval EFI_SUCCESS           The header is valid.
+  @retval EFI_VOLUME_CORRUPTED  The signature, revision, lengths or checksum of
+                                the header are invalid.
+**/
+EFI_STATUS
+MiscFvValidateHeader (
+  IN CONST EFI_FIRMWARE_VOLUME_HEADER  *FvHeader,
+  IN UINTN                             Size
+  );
+
+// MiscFvCalculateHash
+/** Calculates a fast, non-cryptographic 64-bit hash of the contents of a
+    firmware volume.
+
+  The hash identifies a volume across copies in different memory locations.
+  It must not be used to establish trust in the volume.
+
+  @param[in] FvHeader  A pointer to the header of a validated firmware volume.
+
+  @return  The hash of the FvLength bytes of the firmware volume.
+**/
+UINT64
+MiscFvCalculateHash (
+  IN CONST EFI_FIRMWARE_VOLUME_HEADER  *FvHeader
+  );
+
+// MiscFfsGetFileSize
+/** Returns the size of an FFS file, including its header.
+
+  @param[in] FileHeader  A pointer to the header of the file.
+
+  @return  The size, in bytes, of the file.
+**/
+UINT64
+MiscFfsGetFileSize (
+  IN CONST EFI_FFS_FILE_HEADER  *FileHeader
+  );
+
+// MiscFfsGetHeaderSize
+/** Returns the size of the header of an FFS file.
+
+  @param[in] FileHeader  A pointer to the header of the file.
+
+  @return  The size, in bytes, of the EFI_FFS_FILE_HEADER or
+           EFI_FFS_FILE_HEADER2.
+**/
+UINTN
+MiscFfsGetHeaderSize (
+  IN CONST EFI_FFS_FILE_HEADER  *FileHeader
+  );
+
+// MiscFvFindNextFile
+/** Finds the next valid file in a memory-mapped firmware volume.
+
+  Files that are deleted, marked invalid or under construction are skipped.
+  The search ends at the first free space or inconsistent file header.
+
+  @param[in]      FvHeader    A pointer to the header of a validated firmware
+                              volume.
+  @param[in, out] FileHeader  On input, the file to continue the search after,
+                              or NULL to start at the first file.  On output,
+                              the next file.
+
+  @retval EFI_SUCCESS    The next file was returned.
+  @retval EFI_NOT_FOUND  There are no more files.
+**/
+EFI_STATUS
+MiscFvFindNextFile (
+  IN     CONST EFI_FIRMWARE_VOLUME_HEADER  *FvHeader,
+  IN OUT EFI_FFS_FILE_HEADER               **FileHeader
+  );
+
+// MiscFvCalculateSum8
+/** Calculates the 8-bit sum of a buffer, a native word at a time.
+
+  @param[in] Buffer  The buffer to sum.
+  @param[in] Length  The length, in bytes, of Buffer.
+
+  @return  The 8-bit sum of all bytes of Buffer.
+**/
+UINT8
+MiscFvCalculateSum8 (
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length
+  );
+
+// MiscFfsVerifyFile
+/** Verifies the header and data checksums of an FFS file.
+
+  @param[in] FileHeader  A pointer to the header of the file.
+
+  @retval TRUE   The checksums are valid.
+  @retval FALSE  At least one checksum is invalid.
+**/
+BOOLEAN
+MiscFfsVerifyFile (
+  IN CONST EFI_FFS_FILE_HEADER  *FileHeader
+  );
+
+// MISC_FV_FILE_INDEX_ENTRY
+typedef struct {
+  EFI_GUID        Name;    ///< The name of the file.
+  EFI_FV_FILETYPE Type;    ///< The type of the file.
+  UINT32          Offset;  ///< The offset of the file header within the
+                           ///< firmware volume.
+  UINT64          Size;    ///< The size, in bytes, of the file, including its
+                           ///< header.
+} MISC_FV_FILE_INDEX_ENTRY;
+
+// MiscFvScanFiles
+/** Describes all valid files of a firmware volume, in volume order.
+
+  The volume is walked once.  If Files is too small, the walk continues to
+  count the files, and the caller has to walk the volume again to describe
+  them.  With VerifyHeaders, the checksum of every file header is computed,
+  also for files that are only counted.
+
+  Pad files are not described.
+
+  @param[in]      FvHeader         A pointer to the header of a validated
+                                   firmware volume.
+  @param[in]      VerifyHeaders    Whether to skip files with an invalid header
+                                   checksum.
+  @param[out]     Files            The buffer to describe the files in.
+  @param[in, out] NumberOfFiles    On input, the number of entries Files can
+                                   hold.  On output, the number of files
+                                   described or present.
+
+  @retval EFI_SUCCESS           The files were described.
+  @retval EFI_BUFFER_TOO_SMALL  Files is too small.  NumberOfFiles holds the
+                                number of files present.
+**/
+EFI_STATUS
+MiscFvScanFiles (
+  IN     CONST EFI_FIRMWARE_VOLUME_HEADER  *FvHeader,
+  IN     BOOLEAN                           VerifyHeaders,
+  OUT    MISC_FV_FILE_INDEX_ENTRY          *Files, OPTIONAL
+  IN OUT UINTN                             *NumberOfFiles
+  );
+
+// MiscFvBuildFileIndex
+/** Records all valid files of a firmware volume, sorted by name.
+
+  The volume is walked once.  If Entries is too small, the walk continues to
+  count the files, and the caller has to call again with a larger buffer.
+
+  Pad files are not recorded.  Of multiple files with the same name, the first
+  one is recorded.
+
+  @param[in]      FvHeader         A pointer to the header of a validated
+                                   firmware volume.
+  @param[out]     Entries          The buffer to record the files in.
+  @param[in, out] NumberOfEntries  On input, the number of entries Entries can
+                                   hold.  On output, the number of entries
+                                   recorded or required.
+
+  @retval EFI_SUCCESS           The files were recorded.
+  @retval EFI_BUFFER_TOO_SMALL  Entries is too small.  NumberOfEntries holds
+                                the number of entries required.
+**/
+EFI_STATUS
+MiscFvBuildFileIndex (
+  IN     CONST EFI_FIRMWARE_VOLUME_HEADER  *FvHeader,
+  OUT    MISC_FV_FILE_INDEX_ENTRY          *Entries, OPTIONAL
+  IN OUT UINTN                             *NumberOfEntries
+  );
+
+// MiscFvFindIndexedFile
+/** Finds a file by name in an index built by MiscFvBuildFileIndex().
+
+  @param[in] Entries          The entries of the index.
+  @param[in] NumberOfEntries  The number of entries in Entries.
+  @param[in] FileName         The name of the file to find.
+
+  @return  The entry of the file, or NULL if it has not been found.
+**/
+CONST MISC_FV_FILE_INDEX_ENTRY *
+MiscFvFindIndexedFile (
+  IN CONST MISC_FV_FILE_INDEX_ENTRY  *Entries,
+  IN UINTN                           NumberOfEntries,
+  IN CONST EFI_GUID                  *FileName
+  );
+
+#endif // MISC_FV_LIB_H_
@@ -0,0 +1,187 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#ifndef MISC_GCD_LIB_H_
+#define MISC_GCD_LIB_H_
+
+// MISC_GCD_SPACE
+typedef enum {
+  MiscGcdMemorySpace,
+  MiscGcdIoSpace
+} MISC_GCD_SPACE;
+
+// MISC_GCD_RESOURCE_MAP
+typedef struct MISC_GCD_RESOURCE_MAP MISC_GCD_RESOURCE_MAP;
+
+// MISC_GCD_RESOURCE_REQUEST
+typedef struct {
+  UINT64               Length;       ///< The size, in bytes, of the resource.
+  UINTN                Alignment;    ///< The log base 2 of the alignment.
+  EFI_PHYSICAL_ADDRESS BaseAddress;  ///< On output, the assigned address.
+} MISC_GCD_RESOURCE_REQUEST;
+
+// MiscGcdCreateResourceMap
+/** Creates a cached copy of the free ranges of a GCD space.
+
+  The cached map is consulted by the allocation functions of this library, so
+  that a search for a suitable range does not require another GetMemorySpaceMap
+  or GetIoSpaceMap call.  The map is refreshed automatically when the core
+  rejects a placement because the GCD changed behind the cache's back.
+
+  @param[in]  Space  The GCD space to cache.
+  @param[out] Map    On output, a pointer to the created map.
+
+  @retval EFI_SUCCESS           The map was created.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources to allocate the
+                                map.
+  @return                       The status of GetMemorySpaceMap() or
+                                GetIoSpaceMap().
+**/
+EFI_STATUS
+MiscGcdCreateResourceMap (
+  IN  MISC_GCD_SPACE         Space,
+  OUT MISC_GCD_RESOURCE_MAP  **Map
+  );
+
+// MiscGcdRefreshResourceMap
+/** Rebuilds a cached map from the current state of the GCD.
+
+  @param[in, out] Map  The map to refresh.
+
+  @retval EFI_SUCCESS           The map was refreshed.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources to refresh the
+                                map.
+**/
+EFI_STATUS
+MiscGcdRefreshResourceMap (
+  IN OUT MISC_GCD_RESOURCE_MAP  *Map
+  );
+
+// MiscGcdFreeResourceMap
+/** Frees a map created by MiscGcdCreateResourceMap().
+
+  @param[in] Map  The map to free.
+**/
+VOID
+MiscGcdFreeResourceMap (
+  IN MISC_GCD_RESOURCE_MAP  *Map
+  );
+
+// MiscGcdAllocateResource
+/** Allocates a resource range using a best-fit search over a cached map.
+
+  Of all free ranges of GcdType, the smallest range that can hold an aligned
+  block of Length bytes within [Minimum, Maximum] is chosen.  Within that
+  range, the block is placed at the end that leaves the remainder contiguous.
+  The placement is claimed with a single EfiGcdAllocateAddress call.
+
+  @param[in]  Map           The cached map to allocate from.
+  @param[in]  GcdType       The EFI_GCD_MEMORY_TYPE or EFI_GCD_IO_TYPE of the
+                            resource, depending on the space of Map.
+  @param[in]  Alignment     The log base 2 of the boundary that BaseAddress
+                            must be aligned on.
+  @param[in]  Length        The size, in bytes, of the resource.
+  @param[in]  Minimum       The lowest address the resource may start at.
+  @param[in]  Maximum       The highest address the resource may end at.
+  @param[in]  ImageHandle   The image handle of the agent that is allocating
+                            the resource.
+  @param[in]  DeviceHandle  The device handle for which the resource is being
+                            allocated.
+  @param[out] BaseAddress   On output, the base address of the resource.
+
+  @retval EFI_SUCCESS           The resource was allocated.
+  @retval EFI_NOT_FOUND         No free range satisfies the request.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources to update the
+                                map.
+**/
+EFI_STATUS
+MiscGcdAllocateResource (
+  IN  MISC_GCD_RESOURCE_MAP  *Map,
+  IN  UINTN                  GcdType,
+  IN  UINTN                  Alignment,
+  IN  UINT64                 Length,
+  IN  EFI_PHYSICAL_ADDRESS   Minimum,
+  IN  EFI_PHYSICAL_ADDRESS   Maximum,
+  IN  EFI_HANDLE             ImageHandle,
+  IN  EFI_HANDLE             DeviceHandle, OPTIONAL
+  OUT EFI_PHYSICAL_ADDRESS   *BaseAddress
+  );
+
+// MiscGcdAllocateResources
+/** Places a set of resources, e.g. the BARs behind one bridge, in a single
+    aperture.
+
+  The requests are laid out in one planning pass, sorted by descending
+  alignment and length, so that naturally aligned requests pack without
+  padding.  The resulting aperture is allocated with one best-fit call to
+  MiscGcdAllocateResource() and the BaseAddress of every request is filled in
+  from its planned offset.
+
+  @param[in]      Map                The cached map to allocate from.
+  @param[in]      GcdType            The EFI_GCD_MEMORY_TYPE or EFI_GCD_IO_TYPE
+                                     of the resources.
+  @param[in]      ApertureAlignment  The log base 2 of the minimum alignment
+                                     and granularity of the aperture.
+  @param[in]      Minimum            The lowest address the aperture may start
+                                     at.
+  @param[in]      Maximum            The highest address the aperture may end
+                                     at.
+  @param[in]      ImageHandle        The image handle of the agent that is
+                                     allocating the resources.
+  @param[in]      DeviceHandle       The device handle for which the resources
+                                     are being allocated.
+  @param[in]      NumberOfRequests   The number of entries in Requests.
+  @param[in, out] Requests           The resources to place.
+  @param[out]     ApertureBase       On output, the base of the aperture.
+  @param[out]     ApertureLength     On output, the length of the aperture.
+
+  @retval EFI_SUCCESS           The resources were allocated.
+  @retval EFI_NOT_FOUND         No free range can hold the aperture.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources to plan the
+                                placement.
+**/
+EFI_STATUS
+MiscGcdAllocateResources (
+  IN     MISC_GCD_RESOURCE_MAP      *Map,
+  IN     UINTN                      GcdType,
+  IN     UINTN                      ApertureAlignment,
+  IN     EFI_PHYSICAL_ADDRESS       Minimum,
+  IN     EFI_PHYSICAL_ADDRESS       Maximum,
+  IN     EFI_HANDLE                 ImageHandle,
+  IN     EFI_HANDLE                 DeviceHandle, OPTIONAL
+  IN     UINTN                      NumberOfRequests,
+  IN OUT MISC_GCD_RESOURCE_REQUEST  *Requests,
+  OUT    EFI_PHYSICAL_ADDRESS       *ApertureBase,
+  OUT    UINT64                     *ApertureLength
+  );
+
+// MiscGcdFreeResource
+/** Frees a resource allocated from a cached map.
+
+  @param[in] Map          The cached map the resource was allocated from.
+  @param[in] BaseAddress  The base address of the resource.
+  @param[in] Length       The size, in bytes, of the resource.
+
+  @return  The status of FreeMemorySpace() or FreeIoSpace().
+**/
+EFI_STATUS
+MiscGcdFreeResource (
+  IN MISC_GCD_RESOURCE_MAP  *Map,
+  IN EFI_PHYSICAL_ADDRESS   BaseAddress,
+  IN UINT64                 Length
+  );
+
+#endif // MISC_GCD_LIB_H_
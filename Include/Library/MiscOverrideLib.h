@@ -0,0 +1,155 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#ifndef MISC_OVERRIDE_LIB_H_
+#define MISC_OVERRIDE_LIB_H_
+
+// MISC_OVERRIDE
+typedef struct MISC_OVERRIDE MISC_OVERRIDE;
+
+// MISC_OVERRIDE_BOOT_SERVICE
+/// The offset of a service within the Boot Services Table.
+#define MISC_OVERRIDE_BOOT_SERVICE(Service)  \
+  OFFSET_OF (EFI_BOOT_SERVICES, Service)
+
+// MISC_OVERRIDE_RUNTIME_SERVICE
+/// The offset of a service within the Runtime Services Table.
+#define MISC_OVERRIDE_RUNTIME_SERVICE(Service)  \
+  OFFSET_OF (EFI_RUNTIME_SERVICES, Service)
+
+// MiscOverrideBeginBatch
+/** Starts a batch of hook and unhook operations.
+
+  The CRC32 of the modified tables is updated once by the matching
+  MiscOverrideEndBatch() call rather than by every operation.  Batches may be
+  nested.
+**/
+VOID
+MiscOverrideBeginBatch (
+  VOID
+  );
+
+// MiscOverrideEndBatch
+/** Ends a batch of hook and unhook operations and updates the CRC32 of the
+    tables modified during it.
+**/
+VOID
+MiscOverrideEndBatch (
+  VOID
+  );
+
+// MiscOverrideHook
+/** Replaces a service of an EFI table with a hook.
+
+  The hook calls through Original to reach the next hook in the chain, or the
+  original service.  Original must stay valid until the hook has been
+  removed, as it is updated when a hook installed earlier is removed.
+
+  @param[in]  Table     The header of the table to modify, e.g. &gBS->Hdr.
+  @param[in]  Offset    The offset of the service within the table, e.g.
+                        MISC_OVERRIDE_BOOT_SERVICE (AllocatePool).
+  @param[in]  Hook      The function to install.
+  @param[out] Original  The location receiving the function replaced.
+  @param[out] Override  On output, the handle to pass to MiscOverrideUnhook().
+
+  @retval EFI_SUCCESS           The hook has been installed.
+  @retval EFI_OUT_OF_RESOURCES  The hook could not be tracked.
+**/
+EFI_STATUS
+MiscOverrideHook (
+  IN  EFI_TABLE_HEADER  *Table,
+  IN  UINTN             Offset,
+  IN  VOID              *Hook,
+  OUT VOID              **Original,
+  OUT MISC_OVERRIDE     **Override
+  );
+
+// MiscOverrideBootService
+/** Replaces a service of the Boot Services Table with a hook.
+
+  @param[in]  Offset    The offset of the service within the table, e.g.
+                        MISC_OVERRIDE_BOOT_SERVICE (AllocatePool).
+  @param[in]  Hook      The function to install.
+  @param[out] Original  The location receiving the function replaced.
+  @param[out] Override  On output, the handle to pass to MiscOverrideUnhook().
+
+  @retval EFI_SUCCESS           The hook has been installed.
+  @retval EFI_OUT_OF_RESOURCES  The hook could not be tracked.
+**/
+EFI_STATUS
+MiscOverrideBootService (
+  IN  UINTN          Offset,
+  IN  VOID           *Hook,
+  OUT VOID           **Original,
+  OUT MISC_OVERRIDE  **Override
+  );
+
+// MiscOverrideRuntimeService
+/** Replaces a service of the Runtime Services Table with a hook.
+
+  The hook and Original are not converted when the virtual address map is
+  set.  Hooks that stay installed at runtime must convert both themselves.
+
+  @param[in]  Offset    The offset of the service within the table, e.g.
+                        MISC_OVERRIDE_RUNTIME_SERVICE (GetVariable).
+  @param[in]  Hook      The function to install.
+  @param[out] Original  The location receiving the function replaced.
+  @param[out] Override  On output, the handle to pass to MiscOverrideUnhook().
+
+  @retval EFI_SUCCESS           The hook has been installed.
+  @retval EFI_OUT_OF_RESOURCES  The hook could not be tracked.
+**/
+EFI_STATUS
+MiscOverrideRuntimeService (
+  IN  UINTN          Offset,
+  IN  VOID           *Hook,
+  OUT VOID           **Original,
+  OUT MISC_OVERRIDE  **Override
+  );
+
+// MiscOverrideUnhook
+/** Removes a hook installed by MiscOverrideHook().
+
+  Hooks may be removed in any order.  When a hook installed later by this
+  library sits above the removed one, its Original is redirected to the
+  function the removed hook replaced.
+
+  @param[in] Override  The handle returned by MiscOverrideHook().
+
+  @retval EFI_SUCCESS        The hook has been removed.
+  @retval EFI_ACCESS_DENIED  A hook not installed by this library has replaced
+                             the hook, which hence cannot be removed safely.
+**/
+EFI_STATUS
+MiscOverrideUnhook (
+  IN MISC_OVERRIDE  *Override
+  );
+
+// MiscOverrideUnhookAll
+/** Removes all hooks installed by this library instance in the reverse order
+    of their installation, within a single batch.
+
+  @retval EFI_SUCCESS        All hooks have been removed.
+  @retval EFI_ACCESS_DENIED  A hook could not be removed safely.  The hooks
+                             installed before it are left in place.
+**/
+EFI_STATUS
+MiscOverrideUnhookAll (
+  VOID
+  );
+
+#endif // MISC_OVERRIDE_LIB_H_
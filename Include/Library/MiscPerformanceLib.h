@@ -0,0 +1,125 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#ifndef MISC_PERFORMANCE_LIB_H_
+#define MISC_PERFORMANCE_LIB_H_
+
+#include <Guid/MiscPerformance.h>
+
+#include <Library/PcdLib.h>
+
+// MISC_PERFORMANCE_BEGIN
+/// The hooks are compiled out unless PcdMiscPerformanceEnable is set.  Each
+/// module using them must list the PCD in the [FeaturePcd] section of its INF.
+#define MISC_PERFORMANCE_BEGIN(ModuleId, Id)  \
+  MISC_PERFORMANCE_HOOK ((ModuleId), MISC_PERFORMANCE_RECORD_BEGIN, (Id))
+
+// MISC_PERFORMANCE_END
+#define MISC_PERFORMANCE_END(ModuleId, Id)  \
+  MISC_PERFORMANCE_HOOK ((ModuleId), MISC_PERFORMANCE_RECORD_END, (Id))
+
+// MISC_PERFORMANCE_POINT
+#define MISC_PERFORMANCE_POINT(ModuleId, Id)  \
+  MISC_PERFORMANCE_HOOK ((ModuleId), MISC_PERFORMANCE_RECORD_POINT, (Id))
+
+// MISC_PERFORMANCE_HOOK
+#define MISC_PERFORMANCE_HOOK(ModuleId, Type, Id)        \
+  do {                                                   \
+    if (FeaturePcdGet (PcdMiscPerformanceEnable)) {      \
+      MiscPerformanceRecord ((ModuleId), (Type), (Id));  \
+    }                                                    \
+  } while (FALSE)
+
+// MiscPerformanceCreateTable
+/** Creates the performance record table and installs it as a configuration
+    table, so that the library instances of all modules record into it.
+
+  The table should be created by an early DXE driver.  Records are dropped
+  while no table exists.
+
+  @param[in] NumberOfRecords  The number of records the table can hold.
+
+  @retval EFI_SUCCESS           The table has been created.
+  @retval EFI_ALREADY_STARTED   A table has been created before.
+  @retval EFI_OUT_OF_RESOURCES  The table could not be allocated.
+**/
+EFI_STATUS
+MiscPerformanceCreateTable (
+  IN UINTN  NumberOfRecords
+  );
+
+// MiscPerformanceRecord
+/** Adds a record to the performance record table.
+
+  The record is dropped when no table has been created, the table is full, or
+  ExitBootServices() has been called.  The function may be called at any TPL
+  and on any processor.
+
+  @param[in] ModuleId  The module ID of the record.
+  @param[in] Type      The record type.
+  @param[in] Id        The module-specific record ID.
+**/
+VOID
+MiscPerformanceRecord (
+  IN UINT16  ModuleId,
+  IN UINT8   Type,
+  IN UINT32  Id
+  );
+
+// MiscPerformanceGetTable
+/** Returns the performance record table as a raw binary for host-side
+    analysis.
+
+  @param[out] Table      On output, a pointer to the table.  The table is
+                         owned by the library and keeps growing.
+  @param[out] TableSize  On output, the size, in bytes, of the header and the
+                         records written so far.
+
+  @retval EFI_SUCCESS    The table has been returned.
+  @retval EFI_NOT_FOUND  No table has been created.
+**/
+EFI_STATUS
+MiscPerformanceGetTable (
+  OUT CONST MISC_PERFORMANCE_TABLE  **Table,
+  OUT UINTN                         *TableSize
+  );
+
+// MiscPerformanceGetFpdtRecords
+/** Exports the performance records as an FPDT dynamic string event record
+    stream.
+
+  Begin and end records are exported with the MODULE_START and MODULE_END
+  progress IDs, point records with a progress ID of zero.  The GUID of all
+  records is gMiscPerformanceGuid, the string holds the module and record ID.
+  Like all FPDT timestamps, the timestamps count from processor reset rather
+  than from BaseTicks.
+
+  @param[out] Buffer      On output, a pointer to the record stream.  The
+                          caller is responsible for freeing it.
+  @param[out] BufferSize  On output, the size, in bytes, of Buffer.
+
+  @retval EFI_SUCCESS           The records were exported.
+  @retval EFI_NOT_FOUND         No records have been collected.
+  @retval EFI_OUT_OF_RESOURCES  The record stream could not be allocated.
+**/
+EFI_STATUS
+MiscPerformanceGetFpdtRecords (
+  OUT VOID   **Buffer,
+  OUT UINTN  *BufferSize
+  );
+
+#endif // MISC_PERFORMANCE_LIB_H_
@@ -0,0 +1,151 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#ifndef MISC_SMI_DISPATCH_LIB_H_
+#define MISC_SMI_DISPATCH_LIB_H_
+
+// MISC_SMI_DISPATCH_TABLE
+/// Routes the SMIs of one handler type to sub-handlers by the command number
+/// in the first UINTN of the communication buffer.
+typedef struct MISC_SMI_DISPATCH_TABLE MISC_SMI_DISPATCH_TABLE;
+
+// MISC_SMI_DISPATCH_STATISTICS
+/// Cycle counts are measured by the time-stamp counter.
+typedef struct {
+  UINT64 NumberOfCalls;  ///< The number of times the handler was called.
+  UINT64 TotalCycles;    ///< The cycles spent in all calls.
+  UINT64 MaximumCycles;  ///< The cycles spent in the longest call.
+} MISC_SMI_DISPATCH_STATISTICS;
+
+// MiscSmiDispatchCreateTable
+/** Creates a dispatch table and registers it as the SMI handler for a handler
+    type.
+
+  @param[in]  HandlerType       The handler type to dispatch.
+  @param[in]  NumberOfCommands  The number of commands.  Valid command numbers
+                                are 0 to NumberOfCommands - 1.
+  @param[out] Table             On output, a pointer to the table.
+
+  @retval EFI_SUCCESS           The table was created.
+  @retval EFI_ALREADY_STARTED   A table for HandlerType already exists.
+  @retval EFI_OUT_OF_RESOURCES  The table could not be allocated.
+**/
+EFI_STATUS
+MiscSmiDispatchCreateTable (
+  IN  CONST EFI_GUID           *HandlerType,
+  IN  UINTN                    NumberOfCommands,
+  OUT MISC_SMI_DISPATCH_TABLE  **Table
+  );
+
+// MiscSmiDispatchDestroyTable
+/** Unregisters and frees a dispatch table.
+
+  @param[in] Table  The table returned by MiscSmiDispatchCreateTable().
+**/
+VOID
+MiscSmiDispatchDestroyTable (
+  IN MISC_SMI_DISPATCH_TABLE  *Table
+  );
+
+// MiscSmiDispatchRegister
+/** Registers the handler of a command.
+
+  The handler is passed the whole communication buffer, including the command
+  number.
+
+  @param[in] Table    The table returned by MiscSmiDispatchCreateTable().
+  @param[in] Command  The command number to handle.
+  @param[in] Handler  The handler of the command.
+
+  @retval EFI_SUCCESS            The handler was registered.
+  @retval EFI_INVALID_PARAMETER  Command is out of range.
+  @retval EFI_ALREADY_STARTED    A handler for Command is already registered.
+**/
+EFI_STATUS
+MiscSmiDispatchRegister (
+  IN MISC_SMI_DISPATCH_TABLE       *Table,
+  IN UINTN                         Command,
+  IN EFI_SMM_HANDLER_ENTRY_POINT2  Handler
+  );
+
+// MiscSmiDispatchUnregister
+/** Unregisters the handler of a command and resets its statistics.
+
+  @param[in] Table    The table returned by MiscSmiDispatchCreateTable().
+  @param[in] Command  The command number to unregister the handler of.
+
+  @retval EFI_SUCCESS    The handler was unregistered.
+  @retval EFI_NOT_FOUND  No handler is registered for Command.
+**/
+EFI_STATUS
+MiscSmiDispatchUnregister (
+  IN MISC_SMI_DISPATCH_TABLE  *Table,
+  IN UINTN                    Command
+  );
+
+// MiscSmiDispatchManage
+/** Dispatches an SMI of a handler type like SmiManage(), routing it through
+    the dispatch table of the type if one exists.
+
+  The table is found by a hash of HandlerType and the command by indexing,
+  without walking the SMI handlers registered with the SMST.
+
+  @param[in]     HandlerType     The handler type.
+  @param[in]     Context         Points to an optional context buffer.
+  @param[in,out] CommBuffer      Points to the optional communication buffer.
+  @param[in,out] CommBufferSize  Points to the size of the optional
+                                 communication buffer.
+
+  @return  The status returned by the command handler, by SmiManage() if there
+           is no table for HandlerType, or EFI_NOT_FOUND if the command is not
+           handled, as SmiManage() returns when the SMI handler of the table
+           reports EFI_WARN_INTERRUPT_SOURCE_PENDING for such commands.
+**/
+EFI_STATUS
+MiscSmiDispatchManage (
+  IN     CONST EFI_GUID  *HandlerType,
+  IN     CONST VOID      *Context, OPTIONAL
+  IN OUT VOID            *CommBuffer, OPTIONAL
+  IN OUT UINTN           *CommBufferSize OPTIONAL
+  );
+
+// MiscSmiDispatchGetStatistics
+/** Returns the statistics of a command handler.
+
+  @param[in]  Table       The table returned by MiscSmiDispatchCreateTable().
+  @param[in]  Command     The command number.
+  @param[out] Statistics  On output, the statistics of the command handler.
+**/
+VOID
+MiscSmiDispatchGetStatistics (
+  IN  CONST MISC_SMI_DISPATCH_TABLE  *Table,
+  IN  UINTN                          Command,
+  OUT MISC_SMI_DISPATCH_STATISTICS   *Statistics
+  );
+
+// MiscSmiDispatchDumpStatistics
+/** Prints the statistics of all registered command handlers to the debug
+    output.
+
+  @param[in] Table  The table returned by MiscSmiDispatchCreateTable().
+**/
+VOID
+MiscSmiDispatchDumpStatistics (
+  IN CONST MISC_SMI_DISPATCH_TABLE  *Table
+  );
+
+#endif // MISC_SMI_DISPATCH_LIB_H_
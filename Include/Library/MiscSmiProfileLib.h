@@ -0,0 +1,61 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#ifndef MISC_SMI_PROFILE_LIB_H_
+#define MISC_SMI_PROFILE_LIB_H_
+
+// MiscSmiProfileHandlerRegister
+/** Registers an SMI handler like SmiHandlerRegister() and profiles its calls.
+
+  The duration of each call is measured with the TSC and recorded in a
+  log-scale histogram in SMRAM.  The first registration also registers the
+  handler of gMiscSmiProfileGuid, which returns a snapshot of the profiles of
+  all handlers registered by this driver.
+
+  @param[in]  Handler         The handler to register.
+  @param[in]  HandlerType     Points to the handler type or NULL for root SMI
+                              handlers.
+  @param[out] DispatchHandle  On return, contains a unique handle which can be
+                              used to later unregister the handler function.
+
+  @retval EFI_SUCCESS           The handler was registered.
+  @retval EFI_OUT_OF_RESOURCES  The profile could not be allocated.
+**/
+EFI_STATUS
+MiscSmiProfileHandlerRegister (
+  IN  EFI_SMM_HANDLER_ENTRY_POINT2  Handler,
+  IN  CONST EFI_GUID                *HandlerType, OPTIONAL
+  OUT EFI_HANDLE                    *DispatchHandle
+  );
+
+// MiscSmiProfileHandlerUnRegister
+/** Unregisters a handler registered by MiscSmiProfileHandlerRegister() and
+    discards its profile.
+
+  @param[in] DispatchHandle  The handle returned by
+                             MiscSmiProfileHandlerRegister().
+
+  @retval EFI_SUCCESS            The handler was unregistered.
+  @retval EFI_INVALID_PARAMETER  DispatchHandle does not refer to a profiled
+                                 handler.
+**/
+EFI_STATUS
+MiscSmiProfileHandlerUnRegister (
+  IN EFI_HANDLE  DispatchHandle
+  );
+
+#endif // MISC_SMI_PROFILE_LIB_H_
@@ -0,0 +1,103 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#ifndef MISC_SMM_COMM_RING_LIB_H_
+#define MISC_SMM_COMM_RING_LIB_H_
+
+#include <Guid/MiscSmmCommRing.h>
+
+// MISC_SMM_COMM_RING
+typedef struct MISC_SMM_COMM_RING MISC_SMM_COMM_RING;
+
+// MiscSmmCommRingCreate
+/** Allocates a communication ring and registers it with the SMI handler
+    installed by SmmInstallCommRing().
+
+  The ring is allocated as runtime memory and stays registered until the
+  system is reset, hence it is never freed.
+
+  @param[in]  Size  The size, in bytes, of the ring data.
+  @param[out] Ring  On output, a pointer to the ring.
+
+  @retval EFI_SUCCESS           The ring was created.
+  @retval EFI_NOT_FOUND         The SMM Communication Protocol is not
+                                installed.
+  @retval EFI_OUT_OF_RESOURCES  The ring could not be allocated.
+  @retval EFI_ACCESS_DENIED     A ring has already been registered.
+  @retval other                 The ring could not be registered.
+**/
+EFI_STATUS
+MiscSmmCommRingCreate (
+  IN  UINTN               Size,
+  OUT MISC_SMM_COMM_RING  **Ring
+  );
+
+// MiscSmmCommRingEnqueue
+/** Appends a request to a ring.
+
+  The request data is written by the caller to the data buffer of the entry.
+  After MiscSmmCommRingSubmit() has returned, the entry holds the response and
+  the status of the handler.
+
+  @param[in]  Ring         The ring returned by MiscSmmCommRingCreate().
+  @param[in]  HandlerType  The type of the SMI handler to process the request.
+  @param[in]  RequestSize  The size, in bytes, of the request.
+  @param[in]  BufferSize   The size, in bytes, of the data buffer to reserve.
+                           Must be at least RequestSize.
+  @param[out] Entry        On output, a pointer to the entry.
+
+  @retval EFI_SUCCESS           The entry was appended.
+  @retval EFI_OUT_OF_RESOURCES  The ring is full.
+**/
+EFI_STATUS
+MiscSmmCommRingEnqueue (
+  IN  MISC_SMM_COMM_RING        *Ring,
+  IN  CONST EFI_GUID            *HandlerType,
+  IN  UINTN                     RequestSize,
+  IN  UINTN                     BufferSize,
+  OUT MISC_SMM_COMM_RING_ENTRY  **Entry
+  );
+
+// MiscSmmCommRingSubmit
+/** Processes all entries of a ring with a single SMI.
+
+  @param[in] Ring  The ring returned by MiscSmmCommRingCreate().
+
+  @retval EFI_SUCCESS            All entries were processed.  The status of
+                                 each entry is returned in the entry.
+  @retval EFI_INVALID_PARAMETER  The ring has been rejected as malformed.
+  @retval other                  The SMI could not be triggered.
+**/
+EFI_STATUS
+MiscSmmCommRingSubmit (
+  IN MISC_SMM_COMM_RING  *Ring
+  );
+
+// MiscSmmCommRingReset
+/** Removes all entries from a ring.
+
+  The entries returned by MiscSmmCommRingEnqueue() must not be used
+  afterwards.
+
+  @param[in] Ring  The ring returned by MiscSmmCommRingCreate().
+**/
+VOID
+MiscSmmCommRingReset (
+  IN MISC_SMM_COMM_RING  *Ring
+  );
+
+#endif // MISC_SMM_COMM_RING_LIB_H_
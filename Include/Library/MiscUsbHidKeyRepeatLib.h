@@ -0,0 +1,120 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#ifndef MISC_USB_HID_KEY_REPEAT_LIB_H_
+#define MISC_USB_HID_KEY_REPEAT_LIB_H_
+
+#include <Library/MiscUsbHidLib.h>
+
+// MISC_USB_HID_KEY_REPEAT
+typedef struct MISC_USB_HID_KEY_REPEAT MISC_USB_HID_KEY_REPEAT;
+
+// MISC_USB_HID_KEY_REPEAT_NOTIFY
+/** Receives the key events of a key repeat engine.
+
+  The function is called at TPL_NOTIFY.
+
+  @param[in] Event    The key event.
+  @param[in] Repeat   Whether the event is a repeated key press.
+  @param[in] Context  The context passed to MiscUsbHidCreateKeyRepeat().
+**/
+typedef
+VOID
+(EFIAPI *MISC_USB_HID_KEY_REPEAT_NOTIFY)(
+  IN MISC_USB_HID_KEY_EVENT  Event,
+  IN BOOLEAN                 Repeat,
+  IN VOID                    *Context
+  );
+
+// MiscUsbHidCreateKeyRepeat
+/** Creates a key repeat engine.
+
+  The engine tracks the held keys and repeats the most recently pressed
+  non-modifier key.  All repeats and delayed releases are driven by a single
+  timer event, which is only armed while there is a deadline pending.
+
+  @param[in]  Delay         The time, in 100 ns units, before a held key is
+                            repeated.
+  @param[in]  Rate          The time, in 100 ns units, between two repeats.
+  @param[in]  DebounceTime  The time, in 100 ns units, releases are delayed
+                            by.  A release followed by a press of the same
+                            key within this time is dropped along with the
+                            press.  0 disables debouncing.
+  @param[in]  Notify        The function to receive the key events.
+  @param[in]  Context       The context to pass to Notify.
+  @param[out] KeyRepeat     On output, a pointer to the engine.
+
+  @retval EFI_SUCCESS           The engine was created.
+  @retval EFI_OUT_OF_RESOURCES  The engine could not be allocated.
+**/
+EFI_STATUS
+MiscUsbHidCreateKeyRepeat (
+  IN  UINT64                          Delay,
+  IN  UINT64                          Rate,
+  IN  UINT64                          DebounceTime,
+  IN  MISC_USB_HID_KEY_REPEAT_NOTIFY  Notify,
+  IN  VOID                            *Context, OPTIONAL
+  OUT MISC_USB_HID_KEY_REPEAT         **KeyRepeat
+  );
+
+// MiscUsbHidDestroyKeyRepeat
+/** Destroys a key repeat engine.  Pending releases are discarded.
+
+  @param[in] KeyRepeat  The engine returned by MiscUsbHidCreateKeyRepeat().
+**/
+VOID
+MiscUsbHidDestroyKeyRepeat (
+  IN MISC_USB_HID_KEY_REPEAT  *KeyRepeat
+  );
+
+// MiscUsbHidKeyRepeatSetTiming
+/** Changes the repeat timing of a key repeat engine.
+
+  The new timing applies from the next key press.  A key already being
+  repeated keeps the rate it started with.
+
+  @param[in] KeyRepeat  The engine returned by MiscUsbHidCreateKeyRepeat().
+  @param[in] Delay      The time, in 100 ns units, before a held key is
+                        repeated.
+  @param[in] Rate       The time, in 100 ns units, between two repeats.
+**/
+VOID
+MiscUsbHidKeyRepeatSetTiming (
+  IN MISC_USB_HID_KEY_REPEAT  *KeyRepeat,
+  IN UINT64                   Delay,
+  IN UINT64                   Rate
+  );
+
+// MiscUsbHidKeyRepeatProcessEvents
+/** Passes key events, such as the ones returned by
+    MiscUsbHidDiffBootReport(), to a key repeat engine.
+
+  Presses are forwarded right away.  Releases are forwarded once the debounce
+  time has passed.
+
+  @param[in] KeyRepeat       The engine returned by
+                             MiscUsbHidCreateKeyRepeat().
+  @param[in] Events          The key events to process.
+  @param[in] NumberOfEvents  The number of entries of Events.
+**/
+VOID
+MiscUsbHidKeyRepeatProcessEvents (
+  IN MISC_USB_HID_KEY_REPEAT       *KeyRepeat,
+  IN CONST MISC_USB_HID_KEY_EVENT  *Events,
+  IN UINTN                         NumberOfEvents
+  );
+
+#endif // MISC_USB_HID_KEY_REPEAT_LIB_H_
@@ -17,12 +17,294 @@
 #ifndef MISC_USB_HID_LIB_H_
 #define MISC_USB_HID_LIB_H_
 
+#include <Uefi/UefiInternalFormRepresentation.h>
+
 #include <IndustryStandard/UsbHid.h>
 
+// MISC_USB_HID_NO_EFI_KEY
+/// The value of gUsbKeyCodeToEfiKeyConvertionTable entries of USB Keycodes
+/// that have no corresponding EFI_KEY.
+#define MISC_USB_HID_NO_EFI_KEY  0xFF
+
+// MISC_USB_HID_NUMBER_OF_KEY_CODES
+#define MISC_USB_HID_NUMBER_OF_KEY_CODES  \
+  (UsbHidUsageIdKbKpModifierKeyRightGui + 1)
+
+// MISC_USB_HID_KEY_CODE_TO_EFI_KEY
+/** Returns the EFI_KEY of a USB Keycode, or MISC_USB_HID_NO_EFI_KEY.
+**/
+#define MISC_USB_HID_KEY_CODE_TO_EFI_KEY(KeyCode)                          \
+  (((KeyCode) < MISC_USB_HID_NUMBER_OF_KEY_CODES)                          \
+    ? gUsbKeyCodeToEfiKeyConvertionTable[(KeyCode)]                        \
+    : MISC_USB_HID_NO_EFI_KEY)
+
+// MISC_USB_HID_KEY_SET
+/// A set of USB Keycodes.  The modifier bits are stored as the keycodes of the
+/// modifier keys, 0xE0 to 0xE7.
+typedef struct {
+  UINT64 Bits[4];  ///< Bit N is set if keycode N is in the set.
+} MISC_USB_HID_KEY_SET;
+
+// MISC_USB_HID_KEYMAP_SIGNATURE
+#define MISC_USB_HID_KEYMAP_SIGNATURE  SIGNATURE_32 ('M', 'K', 'M', 'P')
+
+// MISC_USB_HID_KEYMAP_STATE
+/// The modifier states of a keymap.  The values index the Characters tables.
+enum {
+  MiscUsbHidKeymapStateNormal,
+  MiscUsbHidKeymapStateShift,
+  MiscUsbHidKeymapStateAltGr,
+  MiscUsbHidKeymapStateShiftAltGr,
+  MiscUsbHidKeymapNumberOfStates
+};
+
+// MISC_USB_HID_LOCK_CAPS
+#define MISC_USB_HID_LOCK_CAPS  BIT0
+
+// MISC_USB_HID_LOCK_NUM
+#define MISC_USB_HID_LOCK_NUM  BIT1
+
+// MISC_USB_HID_KEYMAP
+/// A keyboard layout compiled by Scripts/KeymapCompiler.py.  Each modifier
+/// state has a dense table indexed by USB Keycode, so translating a key is a
+/// single table load.  Layouts are switched by switching the pointer.
+typedef struct {
+  UINT32               Signature;     ///< MISC_USB_HID_KEYMAP_SIGNATURE.
+  UINT32               Reserved;      ///< Must be zero.
+  MISC_USB_HID_KEY_SET CapsLockKeys;  ///< The keys CapsLock acts on as Shift.
+  MISC_USB_HID_KEY_SET NumLockKeys;   ///< The keys that only produce a
+                                      ///< character with NumLock on.
+  CHAR16               Characters[MiscUsbHidKeymapNumberOfStates]
+                                 [MISC_USB_HID_NUMBER_OF_KEY_CODES];
+} MISC_USB_HID_KEYMAP;
+
+// MISC_USB_HID_KB_STATE
+/// The state of a keyboard between two reports.
+typedef struct {
+  MISC_USB_HID_KEY_SET Keys;      ///< The keys pressed.
+  BOOLEAN              RollOver;  ///< Whether the last report was an error
+                                  ///< report, such as ErrorRollOver.
+} MISC_USB_HID_KB_STATE;
+
+// MISC_USB_HID_KEY_EVENT
+/// A key press or release.  The low byte is the USB Keycode.
+typedef UINT16 MISC_USB_HID_KEY_EVENT;
+
+// MISC_USB_HID_KEY_EVENT_PRESSED
+#define MISC_USB_HID_KEY_EVENT_PRESSED  BIT8
+
+// MISC_USB_HID_KEY_EVENT_KEY_CODE
+#define MISC_USB_HID_KEY_EVENT_KEY_CODE(Event)  ((UINT8)(Event))
+
+// MISC_USB_HID_MAX_KEY_EVENTS
+/// The maximum number of events returned by MiscUsbHidDiffBootReport().
+#define MISC_USB_HID_MAX_KEY_EVENTS  \
+  (2 * (USB_HID_KB_KP_NUMBER_OF_MODIFIERS  \
+          + USB_HID_KB_BOOT_REPORT_NUMBER_OF_KEYS))
+
+// MISC_USB_HID_FIELD_ARRAY
+/// The field is an array field.  Its value is an index into the usage range
+/// from Usage to UsageMaximum, rather than the value of Usage.
+#define MISC_USB_HID_FIELD_ARRAY  BIT0
+
+// MISC_USB_HID_FIELD_RELATIVE
+/// The value of the field is relative to the previous report.
+#define MISC_USB_HID_FIELD_RELATIVE  BIT1
+
+// MISC_USB_HID_FIELD_SIGNED
+/// The value of the field is sign-extended.
+#define MISC_USB_HID_FIELD_SIGNED  BIT2
+
+// MISC_USB_HID_FIELD
+/// An entry of the extraction program compiled from a report descriptor.
+typedef struct {
+  UINT16        BitOffset;       ///< The offset, in bits, of the field from
+                                 ///< the end of the report ID.
+  UINT8         BitSize;         ///< The size, in bits, of the field.
+  UINT8         ReportId;        ///< The report ID, or 0 if the device does
+                                 ///< not use report IDs.
+  UINT32        Flags;           ///< MISC_USB_HID_FIELD_* flags.
+  USB_HID_USAGE Usage;           ///< The usage, or the minimum usage of
+                                 ///< array fields.
+  USB_HID_USAGE UsageMaximum;    ///< The maximum usage of array fields.
+  INT32         LogicalMinimum;  ///< The minimum value of the field.
+  INT32         LogicalMaximum;  ///< The maximum value of the field.
+} MISC_USB_HID_FIELD;
+
+// MISC_USB_HID_ARRAY_USAGE
+/** Returns the usage selected by the value of an array field, or 0 if the
+    value is out of range.
+**/
+#define MISC_USB_HID_ARRAY_USAGE(Field, Value)                          \
+  ((((Value) < (Field)->LogicalMinimum)                                 \
+    || ((Value) > (Field)->LogicalMaximum)                              \
+    || (((UINT32)((Value) - (Field)->LogicalMinimum))                   \
+          > ((Field)->UsageMaximum - (Field)->Usage)))                  \
+    ? 0                                                                 \
+    : ((Field)->Usage + (UINT32)((Value) - (Field)->LogicalMinimum)))
+
 // gEfiKeyToUsbKeyCodeConvertionTable
 /// EFI_KEY to USB Keycode conversion table
 /// EFI_KEY is defined in UEFI spec.
 /// USB Keycode is defined in USB HID Firmware spec.
 extern USB_HID_USAGE_ID gEfiKeyToUsbKeyCodeConvertionTable[];
 
+// gUsbKeyCodeToEfiKeyConvertionTable
+/// USB Keycode to EFI_KEY conversion table, the inverse of
+/// gEfiKeyToUsbKeyCodeConvertionTable.  It has
+/// MISC_USB_HID_NUMBER_OF_KEY_CODES entries.  Both Enter keys map to
+/// EfiKeyEnter.
+extern CONST UINT8 gUsbKeyCodeToEfiKeyConvertionTable[];
+
+// gUsbModifierToEfiKeyConvertionTable
+/// USB modifier bit index to EFI_KEY conversion table.
+extern CONST UINT8 gUsbModifierToEfiKeyConvertionTable[];
+
+// gMiscUsbHidKeymapUs
+/// The US keyboard layout.
+extern CONST MISC_USB_HID_KEYMAP gMiscUsbHidKeymapUs;
+
+// MiscUsbHidBootReportToEfiKeys
+/** Translates a keyboard boot report into the EFI_KEYs of the pressed keys.
+
+  The modifier keys are returned first, followed by the keys of the report in
+  report order.  Keycodes without an EFI_KEY and the error codes are skipped.
+
+  @param[in]  Report  The report to translate.
+  @param[out] Keys    On output, the pressed keys.  Must have room for
+                      USB_HID_KB_KP_NUMBER_OF_MODIFIERS
+                      + USB_HID_KB_BOOT_REPORT_NUMBER_OF_KEYS entries.
+
+  @return  The number of keys returned in Keys.
+**/
+UINTN
+MiscUsbHidBootReportToEfiKeys (
+  IN  CONST USB_HID_KB_BOOT_REPORT  *Report,
+  OUT EFI_KEY                       *Keys
+  );
+
+// MiscUsbHidInitializeKbState
+/** Initializes the state of a keyboard to no keys being pressed.
+
+  @param[out] State  The state to initialize.
+**/
+VOID
+MiscUsbHidInitializeKbState (
+  OUT MISC_USB_HID_KB_STATE  *State
+  );
+
+// MiscUsbHidDiffBootReport
+/** Derives the key events from a keyboard boot report.
+
+  The pressed keys of the report and of the previous report are compared as
+  bitmaps, so the cost does not depend on the order of the keycodes.  The
+  release events are returned first, each group in ascending keycode order.
+  Modifier changes are returned as events of the modifier keycodes.
+
+  When the report is an error report, such as ErrorRollOver, the keys are
+  considered unchanged and only the modifier changes are returned.
+
+  @param[in, out] State   The state of the keyboard.  On output, the state
+                          after the report.
+  @param[in]      Report  The report to process.
+  @param[out]     Events  On output, the key events.  Must have room for
+                          MISC_USB_HID_MAX_KEY_EVENTS entries.
+
+  @return  The number of events returned in Events.
+**/
+UINTN
+MiscUsbHidDiffBootReport (
+  IN OUT MISC_USB_HID_KB_STATE         *State,
+  IN     CONST USB_HID_KB_BOOT_REPORT  *Report,
+  OUT    MISC_USB_HID_KEY_EVENT        *Events
+  );
+
+// MiscUsbHidCompileReportDescriptor
+/** Compiles the Input items of a report descriptor into an extraction
+    program for MiscUsbHidExtractFields().
+
+  Every element of a variable Input item results in a field with its own
+  usage.  Every element of an array Input item results in a field with the
+  usage range of the item.  Array items declaring a usage list rather than a
+  range are described by their first and last usage.  Constant Input items
+  only advance the bit offset.  Output and Feature items are skipped.
+
+  @param[in]      Descriptor      The report descriptor to compile.
+  @param[in]      DescriptorSize  The size, in bytes, of Descriptor.
+  @param[out]     Fields          The buffer to return the fields in.
+  @param[in, out] NumberOfFields  On input, the number of entries of Fields.
+                                  On output, the number of fields of the
+                                  descriptor.
+
+  @retval EFI_SUCCESS            The descriptor was compiled.
+  @retval EFI_BUFFER_TOO_SMALL   Fields is too small.  NumberOfFields has been
+                                 updated with the required number.
+  @retval EFI_INVALID_PARAMETER  The descriptor is malformed or uses a field
+                                 larger than 32 bits.
+**/
+EFI_STATUS
+MiscUsbHidCompileReportDescriptor (
+  IN     CONST UINT8         *Descriptor,
+  IN     UINTN               DescriptorSize,
+  OUT    MISC_USB_HID_FIELD  *Fields, OPTIONAL
+  IN OUT UINTN               *NumberOfFields
+  );
+
+// MiscUsbHidExtractFields
+/** Extracts the values of the fields of a report.
+
+  @param[in]  Fields          The program returned by
+                              MiscUsbHidCompileReportDescriptor().
+  @param[in]  NumberOfFields  The number of entries of Fields.
+  @param[in]  Report          The report to extract the values of.
+  @param[in]  ReportSize      The size, in bytes, of Report.
+  @param[out] Values          On output, the value of each field of the
+                              report.  The entries of fields of other
+                              reports, or exceeding ReportSize, are not
+                              changed.
+
+  @return  The number of values extracted.
+**/
+UINTN
+MiscUsbHidExtractFields (
+  IN  CONST MISC_USB_HID_FIELD  *Fields,
+  IN  UINTN                     NumberOfFields,
+  IN  CONST UINT8               *Report,
+  IN  UINTN                     ReportSize,
+  OUT INT32                     *Values
+  );
+
+// MiscUsbHidKeymapIsValid
+/** Returns whether a buffer holds a valid keymap, such as a keymap loaded
+    from a file written by Scripts/KeymapCompiler.py.
+
+  @param[in] Keymap  The keymap to validate.
+  @param[in] Size    The size, in bytes, of the buffer of Keymap.
+
+  @return  Whether Keymap is a valid keymap.
+**/
+BOOLEAN
+MiscUsbHidKeymapIsValid (
+  IN CONST MISC_USB_HID_KEYMAP  *Keymap,
+  IN UINTN                      Size
+  );
+
+// MiscUsbHidKeymapTranslate
+/** Translates a USB Keycode into a character.
+
+  @param[in] Keymap     The keymap to translate with.
+  @param[in] KeyCode    The USB Keycode to translate.
+  @param[in] Modifiers  The pressed modifier keys.
+  @param[in] Locks      The active MISC_USB_HID_LOCK_* locks.
+
+  @return  The character of the key, or 0 if it does not produce one.
+**/
+CHAR16
+MiscUsbHidKeymapTranslate (
+  IN CONST MISC_USB_HID_KEYMAP  *Keymap,
+  IN UINT8                      KeyCode,
+  IN USB_HID_KB_MODIFIER_MAP    Modifiers,
+  IN UINT8                      Locks
+  );
+
 #endif // MISC_USB_HID_LIB_H_
@@ -17,6 +17,8 @@
 #ifndef PEI_SERVICES_LIB_H_
 #define PEI_SERVICES_LIB_H_
 
+#include <Library/MiscFvLib.h>
+
 // PPI Functions
 
 // PeiInstallPpi
@@ -580,4 +582,517 @@ PeiResetSystem2 (
   IN VOID            *ResetData OPTIONAL
   );
 
+// PPI Cache Functions
+
+// PEI_PPI_CACHE
+/// A cache of located PPIs, owned by the caller.  Entries are invalidated when
+/// a PPI with their GUID is installed or reinstalled and when permanent memory
+/// is installed.
+typedef struct PEI_PPI_CACHE PEI_PPI_CACHE;
+
+// PeiCreatePpiCache
+/** Creates a cache for PeiCachedLocatePpi().
+
+  The cache is allocated from the PEI heap and migrated along with it.  Each
+  entry registers one notification that cannot be unregistered, hence the
+  cache is meant to be created once per module and sized accordingly.
+
+  @param[in]  NumberOfEntries  The maximum number of PPIs to cache.
+  @param[out] Cache            On output, a pointer to the cache.
+
+  @retval EFI_SUCCESS           The cache was created.
+  @retval EFI_OUT_OF_RESOURCES  The cache could not be allocated.
+**/
+EFI_STATUS
+PeiCreatePpiCache (
+  IN  UINTN          NumberOfEntries,
+  OUT PEI_PPI_CACHE  **Cache
+  );
+
+// PeiCachedLocatePpi
+/** Locates an interface in the PEI PPI database by GUID, serving repeated
+    lookups from a cache.
+
+  Once the cache is full, lookups of uncached PPIs are passed through.
+
+  @param[in]      Cache          The cache returned by PeiCreatePpiCache().
+  @param[in]      Guid           A pointer to the GUID whose corresponding
+                                 interface needs to be found.
+  @param[in]      Instance       The N-th instance of the interface that is
+                                 required.
+  @param[in, out] PpiDescriptor  A pointer to instance of the
+                                 EFI_PEI_PPI_DESCRIPTOR.
+  @param[in, out] Ppi            A pointer to the instance of the interface.
+
+  @retval EFI_SUCCESS    The interface was successfully returned.
+  @retval EFI_NOT_FOUND  The PPI descriptor is not found in the database.
+**/
+EFI_STATUS
+PeiCachedLocatePpi (
+  IN     PEI_PPI_CACHE           *Cache,
+  IN     CONST EFI_GUID          *Guid,
+  IN     UINTN                   Instance,
+  IN OUT EFI_PEI_PPI_DESCRIPTOR  **PpiDescriptor, OPTIONAL
+  IN OUT VOID                    **Ppi
+  );
+
+// PeiReportPpiCache
+/** Prints the hit statistics of a cache to the debug output.
+
+  @param[in] Cache  The cache returned by PeiCreatePpiCache().
+**/
+VOID
+PeiReportPpiCache (
+  IN CONST PEI_PPI_CACHE  *Cache
+  );
+
+// Firmware Volume Index Functions
+
+// PEI_FV_FILE_INDEX
+/// An index of the files of a firmware volume by name.
+typedef struct PEI_FV_FILE_INDEX PEI_FV_FILE_INDEX;
+
+// PeiFfsBuildFileIndex
+/** Indexes the files of a memory-mapped firmware volume by name.
+
+  The volume is walked twice, as PEI pool cannot be freed or shrunk: once to
+  count the files, following only the file headers, and once to record them.
+
+  Subsequent lookups by PeiFfsFindIndexedFileByName() are binary searches
+  instead of a scan of every file header as done by FfsFindFileByName().
+
+  @param[in]  VolumeHandle  The firmware volume to index.
+  @param[out] FileIndex     On output, a pointer to the index.
+
+  @retval EFI_SUCCESS           The index was built.
+  @retval EFI_VOLUME_CORRUPTED  The firmware volume header is corrupted.
+  @retval EFI_OUT_OF_RESOURCES  The index could not be allocated.
+**/
+EFI_STATUS
+PeiFfsBuildFileIndex (
+  IN  EFI_PEI_FV_HANDLE  VolumeHandle,
+  OUT PEI_FV_FILE_INDEX  **FileIndex
+  );
+
+// PeiFfsFindIndexedFileByName
+/** Finds a file within an indexed firmware volume by its name.
+
+  @param[in]  FileIndex   The index returned by PeiFfsBuildFileIndex().
+  @param[in]  FileName    A pointer to the name of the file to find.
+  @param[out] FileHandle  On output, the handle of the found file.
+
+  @retval EFI_SUCCESS    The file was found.
+  @retval EFI_NOT_FOUND  The file was not found.
+**/
+EFI_STATUS
+PeiFfsFindIndexedFileByName (
+  IN  CONST PEI_FV_FILE_INDEX  *FileIndex,
+  IN  CONST EFI_GUID           *FileName,
+  OUT EFI_PEI_FILE_HANDLE      *FileHandle
+  );
+
+// PeiFfsScanFiles
+/** Describes the files of a memory-mapped firmware volume, in volume order.
+
+  Unlike repeated calls to PeiFfsFindNextFile(), the files are returned as a
+  contiguous array by one call.  The volume is walked twice, as PEI pool cannot
+  be freed or shrunk: once to count the files, following only the file headers,
+  and once to describe them.  Each header checksum is computed at most once.
+  Pad files are not described.
+
+  @param[in]  VolumeHandle   The firmware volume to scan.
+  @param[in]  VerifyHeaders  Whether to skip files with an invalid header
+                             checksum.
+  @param[out] Files          On output, a pointer to the pool-allocated file
+                             descriptors.  NULL if there are no files.
+  @param[out] NumberOfFiles  On output, the number of entries in Files.
+
+  @retval EFI_SUCCESS           The files were described.
+  @retval EFI_VOLUME_CORRUPTED  The firmware volume header is corrupted.
+  @retval EFI_OUT_OF_RESOURCES  The descriptors could not be allocated.
+**/
+EFI_STATUS
+PeiFfsScanFiles (
+  IN  EFI_PEI_FV_HANDLE         VolumeHandle,
+  IN  BOOLEAN                   VerifyHeaders,
+  OUT MISC_FV_FILE_INDEX_ENTRY  **Files,
+  OUT UINTN                     *NumberOfFiles
+  );
+
+// Section Map Functions
+
+// PEI_SECTION_MAP
+/// The leaf sections of a file, including those within encapsulations.
+typedef struct PEI_SECTION_MAP PEI_SECTION_MAP;
+
+// PeiFfsBuildSectionMap
+/** Walks the sections of a file once and records all leaf sections, including
+    those within encapsulation sections.
+
+  Compressed and GUID-defined encapsulations that require processing are
+  decompressed or extracted once, via the Decompress PPI or the matching
+  Guided Section Extraction PPI, and their output is kept for the lifetime of
+  the map.  To keep the output out of temporary RAM, this is only done once
+  permanent memory has been installed.  Before that, and when the required PPI
+  is not installed, such encapsulations are recorded as leaves.
+  GUID-defined encapsulations that do not require processing are extracted
+  too if a matching PPI is installed, as by the PEI Core, so that a platform
+  can verify signed sections.  Otherwise, their data is mapped in place.
+
+  @param[in]  FileHandle  The handle of the file.
+  @param[out] SectionMap  On output, a pointer to the map.
+
+  @retval EFI_SUCCESS           The map was built.
+  @retval EFI_UNSUPPORTED       The file type does not contain sections.
+  @retval EFI_VOLUME_CORRUPTED  A section header is corrupted.
+  @retval EFI_OUT_OF_RESOURCES  The map could not be allocated.
+**/
+EFI_STATUS
+PeiFfsBuildSectionMap (
+  IN  EFI_PEI_FILE_HANDLE  FileHandle,
+  OUT PEI_SECTION_MAP      **SectionMap
+  );
+
+// PeiSectionMapFindSection
+/** Finds a section recorded by PeiFfsBuildSectionMap().
+
+  @param[in]  SectionMap            The map returned by
+                                    PeiFfsBuildSectionMap().
+  @param[in]  SectionType           The type of the section to find, or
+                                    EFI_SECTION_ALL to iterate all sections.
+  @param[in]  SectionInstance       The zero-based instance of the section.
+  @param[out] SectionData           On output, a pointer to the section data.
+  @param[out] SectionDataSize       On output, the size, in bytes, of the
+                                    section data.
+  @param[out] AuthenticationStatus  On output, the authentication status of
+                                    the section.
+
+  @retval EFI_SUCCESS    The section was found.
+  @retval EFI_NOT_FOUND  The section was not found.
+**/
+EFI_STATUS
+PeiSectionMapFindSection (
+  IN  CONST PEI_SECTION_MAP  *SectionMap,
+  IN  EFI_SECTION_TYPE       SectionType,
+  IN  UINTN                  SectionInstance,
+  OUT VOID                   **SectionData,
+  OUT UINT32                 *SectionDataSize OPTIONAL,
+  OUT UINT32                 *AuthenticationStatus OPTIONAL
+  );
+
+// Arena Functions
+
+// PEI_ARENA
+/// A bump allocator serving allocations from a single PEI heap block.  This
+/// avoids a HOB per allocation and keeps temporary RAM unfragmented.
+typedef struct PEI_ARENA PEI_ARENA;
+
+// PEI_ARENA_RELOCATE
+/** Called when an arena has been migrated to permanent memory.
+
+  Buffers allocated from the arena have moved by Delta bytes and pointers to
+  them, within or outside of the arena, need to be adjusted.  Context is not
+  adjusted.
+
+  @param[in] Arena    The arena at its new location.
+  @param[in] Delta    The distance, in bytes, the arena has moved.
+  @param[in] Context  The context passed to PeiArenaRegisterRelocation().
+**/
+typedef
+VOID
+(EFIAPI *PEI_ARENA_RELOCATE)(
+  IN PEI_ARENA  *Arena,
+  IN INTN       Delta,
+  IN VOID       *Context
+  );
+
+// PeiCreateArena
+/** Creates an arena to serve small allocations from a single block.
+
+  The block is allocated from pool, or from pages if it exceeds the maximum
+  pool allocation.  Created before permanent memory is installed, the arena
+  is migrated along with the PEI heap.
+
+  @param[in]  Size   The size, in bytes, of the arena.
+  @param[out] Arena  On output, a pointer to the arena.
+
+  @retval EFI_SUCCESS           The arena was created.
+  @retval EFI_OUT_OF_RESOURCES  The arena could not be allocated.
+**/
+EFI_STATUS
+PeiCreateArena (
+  IN  UINTN      Size,
+  OUT PEI_ARENA  **Arena
+  );
+
+// PeiArenaAllocate
+/** Allocates a buffer from an arena.
+
+  The alignment is relative to the current location of the arena.  Migration
+  only preserves the alignment the PEI Foundation guarantees for the heap.
+
+  @param[in] Arena      The arena returned by PeiCreateArena().
+  @param[in] Size       The size, in bytes, of the buffer.
+  @param[in] Alignment  The alignment of the buffer.  Must be a power of two.
+
+  @return  A pointer to the buffer, or NULL if the arena is exhausted.
+**/
+VOID *
+PeiArenaAllocate (
+  IN PEI_ARENA  *Arena,
+  IN UINTN      Size,
+  IN UINTN      Alignment
+  );
+
+// PeiArenaGetMark
+/** Returns the current allocation position of an arena.
+
+  @param[in] Arena  The arena returned by PeiCreateArena().
+
+  @return  A mark to pass to PeiArenaReleaseToMark().
+**/
+UINTN
+PeiArenaGetMark (
+  IN CONST PEI_ARENA  *Arena
+  );
+
+// PeiArenaReleaseToMark
+/** Frees all buffers allocated from an arena since a mark was taken.
+
+  @param[in] Arena  The arena returned by PeiCreateArena().
+  @param[in] Mark   The mark returned by PeiArenaGetMark(), or 0 to free all
+                    buffers.
+**/
+VOID
+PeiArenaReleaseToMark (
+  IN PEI_ARENA  *Arena,
+  IN UINTN      Mark
+  );
+
+// PeiArenaGetUsage
+/** Returns the usage of an arena.
+
+  @param[in]  Arena          The arena returned by PeiCreateArena().
+  @param[out] Size           On output, the size, in bytes, of the arena.
+  @param[out] Used           On output, the number of bytes in use.
+  @param[out] HighWaterMark  On output, the maximum number of bytes that have
+                             been in use.
+**/
+VOID
+PeiArenaGetUsage (
+  IN  CONST PEI_ARENA  *Arena,
+  OUT UINTN            *Size, OPTIONAL
+  OUT UINTN            *Used, OPTIONAL
+  OUT UINTN            *HighWaterMark OPTIONAL
+  );
+
+// PeiArenaRegisterRelocation
+/** Registers a function to be called when an arena has been migrated to
+    permanent memory.
+
+  @param[in] Arena     The arena returned by PeiCreateArena().
+  @param[in] Relocate  The function to call.
+  @param[in] Context   The context to pass to Relocate.
+
+  @retval EFI_SUCCESS           The function was registered.
+  @retval EFI_OUT_OF_RESOURCES  No more functions can be registered.
+**/
+EFI_STATUS
+PeiArenaRegisterRelocation (
+  IN PEI_ARENA           *Arena,
+  IN PEI_ARENA_RELOCATE  Relocate,
+  IN VOID                *Context OPTIONAL
+  );
+
+// HOB Builder Functions
+
+// PEI_HOB_BUILDER_MAX_LENGTH
+/// The maximum number of bytes a single reservation can hold.  The length of a
+/// HOB is 16-bit and 8-byte aligned.
+#define PEI_HOB_BUILDER_MAX_LENGTH  0xFFF8
+
+// PEI_HOB_BUILDER
+/// Builds multiple HOBs within a single reservation of the HOB list.  The
+/// reservation is an unused HOB that is split in place, so the HOB list stays
+/// well-formed at all times.  A builder must not be used across the
+/// installation of permanent memory.
+typedef struct {
+  EFI_HOB_GENERIC_HEADER *Free;       ///< The unused remainder of the
+                                      ///< reservation, or NULL.
+  UINTN                  FreeLength;  ///< The length, in bytes, of Free.
+} PEI_HOB_BUILDER;
+
+// PeiHobBuilderReserve
+/** Reserves space for multiple HOBs with a single call to the PEI Foundation.
+
+  @param[in]  Length   The total length, in bytes, of the HOBs to build.  The
+                       length of every HOB is rounded up to 8 bytes.
+  @param[out] Builder  The builder to initialize.
+
+  @retval EFI_SUCCESS            The space was reserved.
+  @retval EFI_INVALID_PARAMETER  Length is greater than
+                                 PEI_HOB_BUILDER_MAX_LENGTH.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough space for the
+                                 reservation.
+**/
+EFI_STATUS
+PeiHobBuilderReserve (
+  IN  UINTN            Length,
+  OUT PEI_HOB_BUILDER  *Builder
+  );
+
+// PeiHobBuilderCreateHob
+/** Creates a HOB within the reservation of a builder.
+
+  Only the HOB header is initialized.
+
+  @param[in, out] Builder  The builder initialized by PeiHobBuilderReserve().
+  @param[in]      Type     The type of the HOB.  Must not be
+                           EFI_HOB_TYPE_UNUSED or EFI_HOB_TYPE_END_OF_HOB_LIST.
+  @param[in]      Length   The length, in bytes, of the HOB.
+  @param[out]     Hob      On output, a pointer to the HOB.
+
+  @retval EFI_SUCCESS           The HOB was created.
+  @retval EFI_OUT_OF_RESOURCES  The remainder of the reservation is too small.
+**/
+EFI_STATUS
+PeiHobBuilderCreateHob (
+  IN OUT PEI_HOB_BUILDER  *Builder,
+  IN     UINT16           Type,
+  IN     UINT16           Length,
+  OUT    VOID             **Hob
+  );
+
+// PeiHobBuilderBuildGuidHob
+/** Creates a GUID extension HOB within the reservation of a builder.
+
+  @param[in, out] Builder     The builder initialized by PeiHobBuilderReserve().
+  @param[in]      Guid        The GUID of the HOB.
+  @param[in]      DataLength  The length, in bytes, of the HOB data.
+
+  @return  A pointer to the uninitialized HOB data, or NULL if the remainder
+           of the reservation is too small.
+**/
+VOID *
+PeiHobBuilderBuildGuidHob (
+  IN OUT PEI_HOB_BUILDER  *Builder,
+  IN     CONST EFI_GUID   *Guid,
+  IN     UINTN            DataLength
+  );
+
+// PeiHobBuilderBuildResourceDescriptorHob
+/** Creates a resource descriptor HOB within the reservation of a builder.
+
+  @param[in, out] Builder            The builder initialized by
+                                     PeiHobBuilderReserve().
+  @param[in]      ResourceType       The type of the resource.
+  @param[in]      ResourceAttribute  The attributes of the resource.
+  @param[in]      PhysicalStart      The base address of the resource.
+  @param[in]      NumberOfBytes      The length, in bytes, of the resource.
+
+  @retval EFI_SUCCESS           The HOB was created.
+  @retval EFI_OUT_OF_RESOURCES  The remainder of the reservation is too small.
+**/
+EFI_STATUS
+PeiHobBuilderBuildResourceDescriptorHob (
+  IN OUT PEI_HOB_BUILDER              *Builder,
+  IN     EFI_RESOURCE_TYPE            ResourceType,
+  IN     EFI_RESOURCE_ATTRIBUTE_TYPE  ResourceAttribute,
+  IN     EFI_PHYSICAL_ADDRESS         PhysicalStart,
+  IN     UINT64                       NumberOfBytes
+  );
+
+// PeiBuildResourceDescriptorHobs
+/** Publishes a memory map as resource descriptor HOBs, reserving the space
+    for as many HOBs as possible at once.
+
+  The Header and Owner fields of the descriptors are ignored.  The Owner of
+  the created HOBs is zeroed.
+
+  @param[in] Descriptors          The resource descriptors to publish.
+  @param[in] NumberOfDescriptors  The number of entries in Descriptors.
+
+  @retval EFI_SUCCESS           The HOBs were created.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough space for the HOBs.
+**/
+EFI_STATUS
+PeiBuildResourceDescriptorHobs (
+  IN CONST EFI_HOB_RESOURCE_DESCRIPTOR  *Descriptors,
+  IN UINTN                              NumberOfDescriptors
+  );
+
+// HOB Index Functions
+
+// PEI_HOB_INDEX
+/// An index over the HOB list, by HOB type and by GUID for GUID extension
+/// HOBs.  The index is extended with the HOBs created since the last lookup on
+/// each lookup, and rebuilt when the HOB list has been migrated or an unused
+/// HOB has been reused in place.
+typedef struct PEI_HOB_INDEX PEI_HOB_INDEX;
+
+// PeiGetHobIndex
+/** Returns the index over the HOB list, creating it on first use.
+
+  The index is shared among all PEIMs through a PPI.
+
+  @param[out] HobIndex  On output, a pointer to the index.
+
+  @retval EFI_SUCCESS            The index was returned.
+  @retval EFI_NOT_AVAILABLE_YET  The HOB list is not yet published.
+  @retval EFI_OUT_OF_RESOURCES   The index could not be allocated.
+**/
+EFI_STATUS
+PeiGetHobIndex (
+  OUT PEI_HOB_INDEX  **HobIndex
+  );
+
+// PeiHobIndexFindGuidHobs
+/** Finds a GUID extension HOB by GUID.
+
+  @param[in]  HobIndex      The index returned by PeiGetHobIndex().
+  @param[in]  Guid          The GUID of the HOB to find.
+  @param[in]  Instance      The zero-based instance of the HOB, in order of
+                            creation.
+  @param[out] Hob           On output, a pointer to the HOB.
+  @param[out] NumberOfHobs  On output, the number of HOBs with the GUID.
+
+  @retval EFI_SUCCESS           The HOB was returned.
+  @retval EFI_NOT_FOUND         There are not more than Instance HOBs with the
+                                GUID.
+  @retval EFI_OUT_OF_RESOURCES  The index could not be updated.
+**/
+EFI_STATUS
+PeiHobIndexFindGuidHobs (
+  IN  PEI_HOB_INDEX   *HobIndex,
+  IN  CONST EFI_GUID  *Guid,
+  IN  UINTN           Instance,
+  OUT VOID            **Hob,
+  OUT UINTN           *NumberOfHobs OPTIONAL
+  );
+
+// PeiHobIndexFindTypeHobs
+/** Finds a HOB by type.
+
+  @param[in]  HobIndex      The index returned by PeiGetHobIndex().
+  @param[in]  Type          The type of the HOB to find.  Must not be
+                            EFI_HOB_TYPE_GUID_EXTENSION.
+  @param[in]  Instance      The zero-based instance of the HOB, in order of
+                            creation.
+  @param[out] Hob           On output, a pointer to the HOB.
+  @param[out] NumberOfHobs  On output, the number of HOBs of the type.
+
+  @retval EFI_SUCCESS           The HOB was returned.
+  @retval EFI_NOT_FOUND         There are not more than Instance HOBs of the
+                                type.
+  @retval EFI_OUT_OF_RESOURCES  The index could not be updated.
+**/
+EFI_STATUS
+PeiHobIndexFindTypeHobs (
+  IN  PEI_HOB_INDEX  *HobIndex,
+  IN  UINT16         Type,
+  IN  UINTN          Instance,
+  OUT VOID           **Hob,
+  OUT UINTN          *NumberOfHobs OPTIONAL
+  );
+
 #endif // PEI_SERVICES_LIB_H_
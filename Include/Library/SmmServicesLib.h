@@ -218,6 +218,67 @@ SmmStartupThisAp (
   IN OUT VOID              *ProcArguments OPTIONAL
   );
 
+// SMM_MP_PROCEDURE
+/** A procedure run on multiple CPUs by SmmStartupAllCpus().
+
+  @param[in]      CpuNumber  The number of the executing CPU.
+  @param[in, out] Context    The context passed to SmmStartupAllCpus().
+
+  @return  The status reported for the executing CPU.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *SMM_MP_PROCEDURE)(
+  IN     UINTN  CpuNumber,
+  IN OUT VOID   *Context
+  );
+
+// SmmStartupAllCpus
+/** Runs a procedure on all or a subset of the CPUs in SMM, including the
+    calling one, and waits for the APs to finish.
+
+  The APs are started with SmmStartupThisAp().  With the PiSmmCpuDxeSmm
+  PcdCpuSmmBlockStartupThisAp set to FALSE, the default, it does not wait for
+  the AP, hence all CPUs run Procedure concurrently.  The calling CPU runs
+  Procedure once all APs have been started.  Each CPU signals its completion in
+  a separate cache line.
+
+  With PcdCpuSmmBlockStartupThisAp set to TRUE, SmmStartupThisAp() returns only
+  once the AP has finished, hence the APs run Procedure one after another, and
+  the timeout is not enforced: an AP that does not finish blocks the call.
+
+  @param[in]      Procedure              The procedure to run.
+  @param[in]      CpuMask                An array of gSmst->NumberOfCpus
+                                         entries, which are TRUE for each CPU
+                                         to run Procedure on.  If NULL,
+                                         Procedure is run on all CPUs.
+  @param[in]      TimeoutInMicroSeconds  The time to wait for the APs to
+                                         finish, or 0 to wait indefinitely.
+                                         Only enforced when startup does not
+                                         block.
+  @param[in, out] Context                The context to pass to Procedure.
+  @param[out]     CpuStatus              An array of gSmst->NumberOfCpus
+                                         entries which, on output, holds the
+                                         status returned by Procedure on each
+                                         CPU.  CPUs not selected hold
+                                         EFI_NOT_STARTED, those which did not
+                                         finish in time EFI_TIMEOUT.
+
+  @retval EFI_SUCCESS           Procedure returned EFI_SUCCESS on all CPUs.
+  @retval EFI_TIMEOUT           Not all APs finished in time.
+  @retval EFI_OUT_OF_RESOURCES  The per-CPU state could not be allocated.
+  @retval other                 The first error returned by Procedure or
+                                SmmStartupThisAp(), in order of CPU number.
+**/
+EFI_STATUS
+SmmStartupAllCpus (
+  IN     SMM_MP_PROCEDURE  Procedure,
+  IN     CONST BOOLEAN     *CpuMask, OPTIONAL
+  IN     UINTN             TimeoutInMicroSeconds,
+  IN OUT VOID              *Context, OPTIONAL
+  OUT    EFI_STATUS        *CpuStatus OPTIONAL
+  );
+
 // SmmInstallProtocolInterface
 /** Installs a protocol interface on a device handle.  If the handle does not
     exist, it is created and added to the list of handles in the system.
@@ -383,6 +444,51 @@ SmmLocateProtocol (
   OUT VOID      **Interface
   );
 
+// SmmCachedLocateProtocol
+/** Returns the first protocol instance that matches the given protocol,
+    serving repeated lookups from a per-module cache.
+
+  An entry is invalidated when a protocol with its GUID is installed or
+  reinstalled, and when it is uninstalled via
+  SmmUninstallProtocolInterface().  The SMM Foundation does not notify about
+  uninstallations, hence protocols uninstalled by other modules must be
+  invalidated with SmmInvalidateProtocolCache(), or not be looked up with
+  this function.
+
+  @param[in]  Protocol   Provides the protocol to search for.
+  @param[out] Interface  On return, a pointer to the first interface that
+                         matches Protocol.
+
+  @retval EFI_SUCCESS    A protocol instance matching Protocol was found and
+                         returned in Interface.
+  @retval EFI_NOT_FOUND  No protocol instances were found that match
+                         Protocol.
+**/
+EFI_STATUS
+SmmCachedLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  OUT VOID      **Interface
+  );
+
+// SmmInvalidateProtocolCache
+/** Invalidates cached results of SmmCachedLocateProtocol().
+
+  @param[in] Protocol  The protocol to invalidate the entry of, or NULL to
+                       invalidate all entries.
+**/
+VOID
+SmmInvalidateProtocolCache (
+  IN CONST EFI_GUID  *Protocol OPTIONAL
+  );
+
+// SmmReportProtocolCache
+/** Prints the hit statistics of the protocol cache to the debug output.
+**/
+VOID
+SmmReportProtocolCache (
+  VOID
+  );
+
 // SmiManage
 /** Manage SMI of a particular type.
 
@@ -445,4 +551,105 @@ SmiHandlerUnRegister (
   IN EFI_HANDLE  DispatchHandle
   );
 
+// SMM_SLAB_NUMBER_OF_CLASSES
+#define SMM_SLAB_NUMBER_OF_CLASSES  8
+
+// SMM_SLAB_CLASS_SIZE
+/// The block size of a size class, from 16 to 2048 bytes.
+#define SMM_SLAB_CLASS_SIZE(Class)  ((UINTN)16 << (Class))
+
+// SMM_SLAB_POOL
+/// A pool serving small allocations in fixed size classes from SMRAM pages
+/// reserved up front.
+typedef struct SMM_SLAB_POOL SMM_SLAB_POOL;
+
+// SMM_SLAB_USAGE
+typedef struct {
+  UINTN NumberOfPages;                          ///< The reserved pages.
+  UINTN NumberOfFreePages;                      ///< The pages not assigned to
+                                                ///< a size class.
+  UINTN InUse[SMM_SLAB_NUMBER_OF_CLASSES];      ///< The allocated blocks.
+  UINTN Free[SMM_SLAB_NUMBER_OF_CLASSES];       ///< The free blocks.
+  UINTN PeakInUse[SMM_SLAB_NUMBER_OF_CLASSES];  ///< The maximum of InUse.
+  UINTN NumberOfFallbacks;                      ///< The allocations served
+                                                ///< by SmmAllocatePool().
+} SMM_SLAB_USAGE;
+
+// SmmCreateSlabPool
+/** Reserves SMRAM pages to serve small allocations from.
+
+  The pages are assigned to the size classes on demand and stay assigned, so
+  that fragmentation is bounded by the number of classes.
+
+  @param[in]  NumberOfPages  The number of pages to reserve for allocations.
+  @param[out] Pool           On output, a pointer to the pool.
+
+  @retval EFI_SUCCESS           The pool was created.
+  @retval EFI_OUT_OF_RESOURCES  The pages could not be allocated.
+**/
+EFI_STATUS
+SmmCreateSlabPool (
+  IN  UINTN          NumberOfPages,
+  OUT SMM_SLAB_POOL  **Pool
+  );
+
+// SmmSlabAllocate
+/** Allocates a buffer from a slab pool.
+
+  Requests larger than the largest size class, and requests of a class that
+  has no free block while no page is left, are served by SmmAllocatePool().
+
+  @param[in] Pool  The pool returned by SmmCreateSlabPool().
+  @param[in] Size  The size, in bytes, of the buffer.
+
+  @return  A pointer to the buffer, or NULL if it could not be allocated.
+           Buffers served from pages are aligned to their size class.
+**/
+VOID *
+SmmSlabAllocate (
+  IN SMM_SLAB_POOL  *Pool,
+  IN UINTN          Size
+  );
+
+// SmmSlabFree
+/** Returns a buffer allocated by SmmSlabAllocate() to its pool.
+
+  @param[in] Pool    The pool returned by SmmCreateSlabPool().
+  @param[in] Buffer  The buffer to free.
+**/
+VOID
+SmmSlabFree (
+  IN SMM_SLAB_POOL  *Pool,
+  IN VOID           *Buffer
+  );
+
+// SmmSlabGetUsage
+/** Returns the usage counters of a slab pool.
+
+  @param[in]  Pool   The pool returned by SmmCreateSlabPool().
+  @param[out] Usage  On output, the usage counters of Pool.
+**/
+VOID
+SmmSlabGetUsage (
+  IN  CONST SMM_SLAB_POOL  *Pool,
+  OUT SMM_SLAB_USAGE       *Usage
+  );
+
+// SmmInstallCommRing
+/** Registers the SMI handler draining the communication ring.
+
+  The ring lets callers outside of SMM queue requests to multiple SMI handlers
+  and process all of them with a single SMI.  Each request is passed to
+  SmiManage() in place, without copying it through the communication buffer.
+  The ring itself is allocated and registered by MiscSmmCommRingCreate().  A
+  single driver of the platform installs the handler.
+
+  @retval EFI_SUCCESS          The handler was registered.
+  @retval EFI_ALREADY_STARTED  The handler is already registered.
+**/
+EFI_STATUS
+SmmInstallCommRing (
+  VOID
+  );
+
 #endif // SMM_SERVICES_LIB_H_
@@ -16,10 +16,46 @@
 
 #include <PiDxe.h>
 
+#include <Protocol/MpService.h>
+
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/DxeServicesLib.h>
 #include <Library/DxeServicesTableLib.h>
+#include <Library/EfiBootServicesLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/MiscFvLib.h>
 #include <Library/MiscRuntimeLib.h>
+#include <Library/SynchronizationLib.h>
+
+// DXE_FV_REGISTRY_ENTRY
+typedef struct {
+  UINT64     Hash;    ///< The hash of the contents of the firmware volume.
+  UINT64     Length;  ///< The length, in bytes, of the firmware volume.
+  CONST VOID *Base;   ///< The firmware volume, which stays mapped as long as
+                      ///< its handle exists.
+  EFI_HANDLE Handle;  ///< The handle created for the firmware volume.
+} DXE_FV_REGISTRY_ENTRY;
+
+// DXE_FV_VERIFY_CONTEXT
+typedef struct {
+  EFI_FFS_FILE_HEADER **Files;          ///< The files to verify.
+  UINT32              NumberOfFiles;    ///< The number of entries in Files.
+  volatile UINT32     NextFile;         ///< The number of files taken.
+  volatile BOOLEAN    Corrupted;        ///< Whether a file failed to verify.
+} DXE_FV_VERIFY_CONTEXT;
+
+// DXE_FV_REGISTRY_GROWTH
+#define DXE_FV_REGISTRY_GROWTH  8
+
+// mFvRegistry
+STATIC DXE_FV_REGISTRY_ENTRY *mFvRegistry = NULL;
+
+// mFvRegistryCount
+STATIC UINTN mFvRegistryCount = 0;
+
+// mFvRegistryCapacity
+STATIC UINTN mFvRegistryCapacity = 0;
 
 // DxeAddMemorySpace
 /** Adds reserved memory, system memory, or memory-mapped I/O resources to the
@@ -866,3 +902,259 @@ DxeProcessFirmwareVolume (
 
   return Status;
 }
+
+// InternalVerifyFilesWorker
+/** Verifies files of a firmware volume until none are left.
+
+  Runs on the BSP and the APs concurrently, each file is taken exactly once.
+
+  @param[in, out] Buffer  A pointer to the DXE_FV_VERIFY_CONTEXT.
+**/
+STATIC
+VOID
+EFIAPI
+InternalVerifyFilesWorker (
+  IN OUT VOID  *Buffer
+  )
+{
+  DXE_FV_VERIFY_CONTEXT *Context;
+  UINT32                Index;
+
+  Context = (DXE_FV_VERIFY_CONTEXT *)Buffer;
+
+  while (!Context->Corrupted) {
+    Index = (InterlockedIncrement (&Context->NextFile) - 1);
+
+    if (Index >= Context->NumberOfFiles) {
+      break;
+    }
+
+    if (!MiscFfsVerifyFile (Context->Files[Index])) {
+      Context->Corrupted = TRUE;
+    }
+  }
+}
+
+// InternalVerifyFiles
+/** Verifies the checksums of all files of a firmware volume.
+
+  @param[in] FvHeader  A pointer to the header of a validated firmware volume.
+
+  @retval EFI_SUCCESS           All files have been verified.
+  @retval EFI_VOLUME_CORRUPTED  At least one file is corrupted.
+  @retval EFI_OUT_OF_RESOURCES  The file list could not be allocated.
+**/
+STATIC
+EFI_STATUS
+InternalVerifyFiles (
+  IN CONST EFI_FIRMWARE_VOLUME_HEADER  *FvHeader
+  )
+{
+  EFI_STATUS               Status;
+
+  DXE_FV_VERIFY_CONTEXT    Context;
+  EFI_FFS_FILE_HEADER      *File;
+  EFI_MP_SERVICES_PROTOCOL *MpServices;
+  UINTN                    NumberOfProcessors;
+  UINTN                    NumberOfEnabledProcessors;
+
+  ASSERT (FvHeader != NULL);
+
+  // Collect the files upfront so that the processors can take them by index.
+
+  Context.NumberOfFiles = 0;
+  File                  = NULL;
+
+  while (!EFI_ERROR (MiscFvFindNextFile (FvHeader, &File))) {
+    ++Context.NumberOfFiles;
+  }
+
+  if (Context.NumberOfFiles == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Context.Files = AllocatePool (
+                    (Context.NumberOfFiles * sizeof (*Context.Files))
+                    );
+
+  if (Context.Files == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Context.NumberOfFiles = 0;
+  Context.NextFile      = 0;
+  Context.Corrupted     = FALSE;
+  File                  = NULL;
+
+  while (!EFI_ERROR (MiscFvFindNextFile (FvHeader, &File))) {
+    Context.Files[Context.NumberOfFiles] = File;
+    ++Context.NumberOfFiles;
+  }
+
+  Status = EfiLocateProtocol (
+             &gEfiMpServiceProtocolGuid,
+             NULL,
+             (VOID **)&MpServices
+             );
+
+  if (!EFI_ERROR (Status)) {
+    Status = MpServices->GetNumberOfProcessors (
+                           MpServices,
+                           &NumberOfProcessors,
+                           &NumberOfEnabledProcessors
+                           );
+
+    if (!EFI_ERROR (Status) && (NumberOfEnabledProcessors > 1)) {
+      // Blocking mode returns once all APs have finished.  Whatever the APs
+      // did not take, e.g. due to a failed startup, is verified by the BSP
+      // below.
+      MpServices->StartupAllAPs (
+                    MpServices,
+                    InternalVerifyFilesWorker,
+                    FALSE,
+                    NULL,
+                    0,
+                    (VOID *)&Context,
+                    NULL
+                    );
+    }
+  }
+
+  InternalVerifyFilesWorker ((VOID *)&Context);
+
+  FreePool ((VOID *)Context.Files);
+
+  return (Context.Corrupted ? EFI_VOLUME_CORRUPTED : EFI_SUCCESS);
+}
+
+// InternalRegisterFirmwareVolume
+STATIC
+EFI_STATUS
+InternalRegisterFirmwareVolume (
+  IN UINT64      Hash,
+  IN UINT64      Length,
+  IN CONST VOID  *Base,
+  IN EFI_HANDLE  Handle
+  )
+{
+  DXE_FV_REGISTRY_ENTRY *Registry;
+
+  if (mFvRegistryCount == mFvRegistryCapacity) {
+    Registry = ReallocatePool (
+                 (mFvRegistryCapacity * sizeof (*mFvRegistry)),
+                 ((mFvRegistryCapacity + DXE_FV_REGISTRY_GROWTH)
+                   * sizeof (*mFvRegistry)),
+                 (VOID *)mFvRegistry
+                 );
+
+    if (Registry == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    mFvRegistry          = Registry;
+    mFvRegistryCapacity += DXE_FV_REGISTRY_GROWTH;
+  }
+
+  mFvRegistry[mFvRegistryCount].Hash   = Hash;
+  mFvRegistry[mFvRegistryCount].Length = Length;
+  mFvRegistry[mFvRegistryCount].Base   = Base;
+  mFvRegistry[mFvRegistryCount].Handle = Handle;
+
+  ++mFvRegistryCount;
+
+  return EFI_SUCCESS;
+}
+
+// DxeProcessFirmwareVolumeOnce
+/** Validates a firmware volume that is present in system memory and creates a
+    firmware volume handle for it, unless a volume with the same contents has
+    already been processed by this function.
+
+  @param[in]  FirmwareVolumeHeader  A pointer to the header of the firmware
+                                    volume.
+  @param[in]  Size                  The size, in bytes, of the firmware volume.
+  @param[in]  VerifyFiles           Whether to verify the file checksums.
+  @param[out] FirmwareVolumeHandle  On output, a pointer to the created or
+                                    previously created handle.
+
+  @retval EFI_SUCCESS           The firmware volume handle was created.
+  @retval EFI_ALREADY_STARTED   The firmware volume has already been processed.
+                                FirmwareVolumeHandle holds the handle created
+                                at that time.
+  @retval EFI_VOLUME_CORRUPTED  The firmware volume header or one of its files
+                                is corrupted.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough system resources available
+                                to process the firmware volume.
+**/
+EFI_STATUS
+DxeProcessFirmwareVolumeOnce (
+  IN  CONST VOID  *FirmwareVolumeHeader,
+  IN  UINTN       Size,
+  IN  BOOLEAN     VerifyFiles,
+  OUT EFI_HANDLE  *FirmwareVolumeHandle
+  )
+{
+  EFI_STATUS                       Status;
+
+  CONST EFI_FIRMWARE_VOLUME_HEADER *FvHeader;
+  UINT64                           Hash;
+  UINTN                            Index;
+
+  ASSERT (FirmwareVolumeHeader != NULL);
+  ASSERT (Size > 0);
+  ASSERT (FirmwareVolumeHandle != NULL);
+  ASSERT (!EfiAtRuntime ());
+
+  FvHeader = (CONST EFI_FIRMWARE_VOLUME_HEADER *)FirmwareVolumeHeader;
+  Status   = MiscFvValidateHeader (FvHeader, Size);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Hash = MiscFvCalculateHash (FvHeader);
+
+  // The hash is not collision-resistant, hence a match is only accepted for
+  // the same volume or after comparing the contents.
+
+  for (Index = 0; Index < mFvRegistryCount; ++Index) {
+    if ((mFvRegistry[Index].Hash == Hash)
+     && (mFvRegistry[Index].Length == FvHeader->FvLength)
+     && ((mFvRegistry[Index].Base == FirmwareVolumeHeader)
+      || (CompareMem (
+            mFvRegistry[Index].Base,
+            FirmwareVolumeHeader,
+            (UINTN)FvHeader->FvLength
+            ) == 0))) {
+      *FirmwareVolumeHandle = mFvRegistry[Index].Handle;
+
+      return EFI_ALREADY_STARTED;
+    }
+  }
+
+  if (VerifyFiles) {
+    Status = InternalVerifyFiles (FvHeader);
+
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  Status = DxeProcessFirmwareVolume (
+             FirmwareVolumeHeader,
+             (UINTN)FvHeader->FvLength,
+             FirmwareVolumeHandle
+             );
+
+  if (!EFI_ERROR (Status)) {
+    // Failing to register only costs a redundant core call later on.
+    InternalRegisterFirmwareVolume (
+      Hash,
+      FvHeader->FvLength,
+      FirmwareVolumeHeader,
+      *FirmwareVolumeHandle
+      );
+  }
+
+  return Status;
+}
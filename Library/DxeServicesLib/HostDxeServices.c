@@ -0,0 +1,1176 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiDxe.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DxeServicesTableLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+// HOST_GCD_OPERATION
+typedef enum {
+  HostGcdAdd,
+  HostGcdRemove,
+  HostGcdAllocate,
+  HostGcdFree,
+  HostGcdSetAttributes,
+  HostGcdSetCapabilities
+} HOST_GCD_OPERATION;
+
+// HOST_GCD_ENTRY
+/// A range of the memory or I/O space.  The type is the EFI_GCD_MEMORY_TYPE
+/// or the EFI_GCD_IO_TYPE of the range.  I/O ranges have neither capabilities
+/// nor attributes.
+typedef struct {
+  LIST_ENTRY Link;          ///< Links the entries in ascending order.
+  UINT64     BaseAddress;   ///< The first address of the range.
+  UINT64     Length;        ///< The size, in bytes, of the range.
+  UINT64     Capabilities;  ///< The capabilities of the range.
+  UINT64     Attributes;    ///< The attributes of the range.
+  UINT32     Type;          ///< The GCD type of the range.
+  EFI_HANDLE ImageHandle;   ///< The allocating image, NULL if free.
+  EFI_HANDLE DeviceHandle;  ///< The device the range is allocated for.
+} HOST_GCD_ENTRY;
+
+// GCD_ENTRY_FROM_LINK
+#define GCD_ENTRY_FROM_LINK(Entry)  BASE_CR ((Entry), HOST_GCD_ENTRY, Link)
+
+// GCD_ENTRY_END
+#define GCD_ENTRY_END(Entry)  ((Entry)->BaseAddress + (Entry)->Length)
+
+// HOST_GCD_MAP
+/// The entries of a GCD map cover the address space without gaps.
+typedef struct {
+  LIST_ENTRY Entries;  ///< The entries of the map.
+  UINT64     Limit;    ///< The size, in bytes, of the address space.
+} HOST_GCD_MAP;
+
+// mMemorySpace
+STATIC HOST_GCD_MAP mMemorySpace = {
+  INITIALIZE_LIST_HEAD_VARIABLE (mMemorySpace.Entries),
+  BASE_256TB
+};
+
+// mIoSpace
+STATIC HOST_GCD_MAP mIoSpace = {
+  INITIALIZE_LIST_HEAD_VARIABLE (mIoSpace.Entries),
+  BASE_64KB
+};
+
+// GCD Maps
+
+// InternalGcdInitialize
+/** Creates the non-existent range covering the address space of Map, unless
+    the map has already been initialized.
+**/
+STATIC
+EFI_STATUS
+InternalGcdInitialize (
+  IN OUT HOST_GCD_MAP  *Map
+  )
+{
+  HOST_GCD_ENTRY *Entry;
+
+  if (!IsListEmpty (&Map->Entries)) {
+    return EFI_SUCCESS;
+  }
+
+  Entry = AllocateZeroPool (sizeof (*Entry));
+
+  if (Entry == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Entry->Length = Map->Limit;
+
+  InsertTailList (&Map->Entries, &Entry->Link);
+
+  return EFI_SUCCESS;
+}
+
+// InternalGcdFindEntry
+STATIC
+HOST_GCD_ENTRY *
+InternalGcdFindEntry (
+  IN HOST_GCD_MAP  *Map,
+  IN UINT64        Address
+  )
+{
+  HOST_GCD_ENTRY *Entry;
+  LIST_ENTRY     *Link;
+
+  for (
+    Link = GetFirstNode (&Map->Entries);
+    !IsNull (&Map->Entries, Link);
+    Link = GetNextNode (&Map->Entries, Link)
+    ) {
+    Entry = GCD_ENTRY_FROM_LINK (Link);
+
+    if ((Address >= Entry->BaseAddress) && (Address < GCD_ENTRY_END (Entry))) {
+      return Entry;
+    }
+  }
+
+  return NULL;
+}
+
+// InternalGcdSplit
+/** Splits the entry containing Address, so that an entry starts at Address.
+**/
+STATIC
+EFI_STATUS
+InternalGcdSplit (
+  IN OUT HOST_GCD_MAP  *Map,
+  IN     UINT64        Address
+  )
+{
+  HOST_GCD_ENTRY *Entry;
+  HOST_GCD_ENTRY *NewEntry;
+
+  Entry = InternalGcdFindEntry (Map, Address);
+
+  if ((Entry == NULL) || (Entry->BaseAddress == Address)) {
+    return EFI_SUCCESS;
+  }
+
+  NewEntry = AllocateCopyPool (sizeof (*NewEntry), (VOID *)Entry);
+
+  if (NewEntry == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NewEntry->BaseAddress = Address;
+  NewEntry->Length      = (GCD_ENTRY_END (Entry) - Address);
+  Entry->Length         = (Address - Entry->BaseAddress);
+
+  InsertHeadList (&Entry->Link, &NewEntry->Link);
+
+  return EFI_SUCCESS;
+}
+
+// InternalGcdCoalesce
+/** Merges the adjacent entries of Map that describe equal ranges.
+**/
+STATIC
+VOID
+InternalGcdCoalesce (
+  IN OUT HOST_GCD_MAP  *Map
+  )
+{
+  HOST_GCD_ENTRY *Entry;
+  HOST_GCD_ENTRY *NextEntry;
+  LIST_ENTRY     *Link;
+
+  Link = GetFirstNode (&Map->Entries);
+
+  while (!IsNodeAtEnd (&Map->Entries, Link)) {
+    Entry     = GCD_ENTRY_FROM_LINK (Link);
+    NextEntry = GCD_ENTRY_FROM_LINK (GetNextNode (&Map->Entries, Link));
+
+    if ((Entry->Type == NextEntry->Type)
+     && (Entry->Capabilities == NextEntry->Capabilities)
+     && (Entry->Attributes == NextEntry->Attributes)
+     && (Entry->ImageHandle == NextEntry->ImageHandle)
+     && (Entry->DeviceHandle == NextEntry->DeviceHandle)) {
+      Entry->Length += NextEntry->Length;
+
+      RemoveEntryList (&NextEntry->Link);
+      FreePool ((VOID *)NextEntry);
+    } else {
+      Link = GetNextNode (&Map->Entries, Link);
+    }
+  }
+}
+
+// InternalGcdVerifyEntry
+/** Returns whether Operation may be applied to Entry.
+**/
+STATIC
+EFI_STATUS
+InternalGcdVerifyEntry (
+  IN CONST HOST_GCD_ENTRY  *Entry,
+  IN HOST_GCD_OPERATION    Operation,
+  IN UINT32                Type,
+  IN UINT64                Value
+  )
+{
+  switch (Operation) {
+    case HostGcdAdd:
+    {
+      if (Entry->Type != 0) {
+        return EFI_ACCESS_DENIED;
+      }
+
+      break;
+  }
+
+  case HostGcdRemove:
+  {
+    if (Entry->Type == 0) {
+      return EFI_NOT_FOUND;
+    }
+
+    if (Entry->ImageHandle != NULL) {
+      return EFI_ACCESS_DENIED;
+    }
+
+    break;
+  }
+
+  case HostGcdAllocate:
+  {
+    if ((Entry->Type != Type) || (Entry->ImageHandle != NULL)) {
+      return EFI_NOT_FOUND;
+    }
+
+    break;
+  }
+
+  case HostGcdFree:
+  {
+    if (Entry->ImageHandle == NULL) {
+      return EFI_NOT_FOUND;
+    }
+
+    break;
+  }
+
+  case HostGcdSetAttributes:
+  {
+    if (Entry->Type == 0) {
+      return EFI_NOT_FOUND;
+    }
+
+    if ((Value & ~Entry->Capabilities) != 0) {
+      return EFI_UNSUPPORTED;
+    }
+
+    break;
+  }
+
+  case HostGcdSetCapabilities:
+  {
+    if (Entry->Type == 0) {
+      return EFI_NOT_FOUND;
+    }
+
+    if ((Entry->Attributes & ~Value) != 0) {
+      return EFI_UNSUPPORTED;
+    }
+
+    break;
+  }
+
+  default:
+  {
+    ASSERT (FALSE);
+
+    return EFI_UNSUPPORTED;
+  }
+  }
+
+  return EFI_SUCCESS;
+}
+
+// InternalGcdVerifyRange
+STATIC
+EFI_STATUS
+InternalGcdVerifyRange (
+  IN HOST_GCD_MAP        *Map,
+  IN HOST_GCD_OPERATION  Operation,
+  IN UINT64              BaseAddress,
+  IN UINT64              Length,
+  IN UINT32              Type,
+  IN UINT64              Value
+  )
+{
+  EFI_STATUS     Status;
+
+  HOST_GCD_ENTRY *Entry;
+  LIST_ENTRY     *Link;
+
+  if (Length == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((BaseAddress >= Map->Limit) || (Length > (Map->Limit - BaseAddress))) {
+    return EFI_UNSUPPORTED;
+  }
+
+  for (
+    Link = GetFirstNode (&Map->Entries);
+    !IsNull (&Map->Entries, Link);
+    Link = GetNextNode (&Map->Entries, Link)
+    ) {
+    Entry = GCD_ENTRY_FROM_LINK (Link);
+
+    if ((Entry->BaseAddress < (BaseAddress + Length))
+     && (GCD_ENTRY_END (Entry) > BaseAddress)) {
+      Status = InternalGcdVerifyEntry (Entry, Operation, Type, Value);
+
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+// InternalGcdConvert
+/** Applies Operation to the range, which is verified beforehand so that the
+    map is left untouched on failure.
+**/
+STATIC
+EFI_STATUS
+InternalGcdConvert (
+  IN OUT HOST_GCD_MAP        *Map,
+  IN     HOST_GCD_OPERATION  Operation,
+  IN     UINT64              BaseAddress,
+  IN     UINT64              Length,
+  IN     UINT32              Type,
+  IN     UINT64              Value,
+  IN     EFI_HANDLE          ImageHandle,
+  IN     EFI_HANDLE          DeviceHandle
+  )
+{
+  EFI_STATUS     Status;
+
+  HOST_GCD_ENTRY *Entry;
+  LIST_ENTRY     *Link;
+
+  Status = InternalGcdInitialize (Map);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = InternalGcdVerifyRange (
+             Map,
+             Operation,
+             BaseAddress,
+             Length,
+             Type,
+             Value
+             );
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = InternalGcdSplit (Map, BaseAddress);
+
+  if (!EFI_ERROR (Status)) {
+    Status = InternalGcdSplit (Map, (BaseAddress + Length));
+  }
+
+  if (EFI_ERROR (Status)) {
+    InternalGcdCoalesce (Map);
+
+    return Status;
+  }
+
+  for (
+    Link = GetFirstNode (&Map->Entries);
+    !IsNull (&Map->Entries, Link);
+    Link = GetNextNode (&Map->Entries, Link)
+    ) {
+    Entry = GCD_ENTRY_FROM_LINK (Link);
+
+    if ((Entry->BaseAddress < BaseAddress)
+     || (Entry->BaseAddress >= (BaseAddress + Length))) {
+      continue;
+    }
+
+    switch (Operation) {
+      case HostGcdAdd:
+      {
+        Entry->Type         = Type;
+        Entry->Capabilities = Value;
+        Entry->Attributes   = 0;
+
+        break;
+    }
+
+    case HostGcdRemove:
+    {
+      Entry->Type         = 0;
+      Entry->Capabilities = 0;
+      Entry->Attributes   = 0;
+
+      break;
+    }
+
+    case HostGcdAllocate:
+    {
+      Entry->ImageHandle  = ImageHandle;
+      Entry->DeviceHandle = DeviceHandle;
+
+      break;
+    }
+
+    case HostGcdFree:
+    {
+      Entry->ImageHandle  = NULL;
+      Entry->DeviceHandle = NULL;
+
+      break;
+    }
+
+    case HostGcdSetAttributes:
+    {
+      Entry->Attributes = Value;
+
+      break;
+    }
+
+    case HostGcdSetCapabilities:
+    {
+      Entry->Capabilities = Value;
+
+      break;
+    }
+
+    default:
+    {
+      ASSERT (FALSE);
+
+      break;
+    }
+    }
+  }
+
+  InternalGcdCoalesce (Map);
+
+  return EFI_SUCCESS;
+}
+
+// InternalGcdFindCandidate
+/** Returns the lowest or the highest aligned address of Entry a range of
+    Length bytes ending at or below MaxAddress can be allocated at.
+**/
+STATIC
+BOOLEAN
+InternalGcdFindCandidate (
+  IN  CONST HOST_GCD_ENTRY  *Entry,
+  IN  UINT64                AlignmentMask,
+  IN  UINT64                Length,
+  IN  UINT64                MaxAddress,
+  IN  BOOLEAN               TopDown,
+  OUT UINT64                *Candidate
+  )
+{
+  UINT64 Start;
+  UINT64 End;
+
+  Start = ((Entry->BaseAddress + AlignmentMask) & ~AlignmentMask);
+  End   = GCD_ENTRY_END (Entry);
+
+  if (MaxAddress < End) {
+    End = (MaxAddress + 1);
+  }
+
+  if ((Start < Entry->BaseAddress) || (Start >= End)) {
+    return FALSE;
+  }
+
+  if ((End - Start) < Length) {
+    return FALSE;
+  }
+
+  *Candidate = Start;
+
+  if (TopDown) {
+    *Candidate = ((End - Length) & ~AlignmentMask);
+  }
+
+  return TRUE;
+}
+
+// InternalGcdAllocate
+STATIC
+EFI_STATUS
+InternalGcdAllocate (
+  IN OUT HOST_GCD_MAP           *Map,
+  IN     EFI_GCD_ALLOCATE_TYPE  GcdAllocateType,
+  IN     UINT32                 Type,
+  IN     UINTN                  Alignment,
+  IN     UINT64                 Length,
+  IN OUT EFI_PHYSICAL_ADDRESS   *BaseAddress,
+  IN     EFI_HANDLE             ImageHandle,
+  IN     EFI_HANDLE             DeviceHandle OPTIONAL
+  )
+{
+  EFI_STATUS     Status;
+
+  HOST_GCD_ENTRY *Entry;
+  LIST_ENTRY     *Link;
+  UINT64         AlignmentMask;
+  UINT64         MaxAddress;
+  UINT64         Candidate;
+  BOOLEAN        TopDown;
+  BOOLEAN        Found;
+
+  if ((GcdAllocateType >= EfiGcdMaxAllocateType)
+   || (Alignment >= 64)
+   || (Length == 0)
+   || (BaseAddress == NULL)
+   || (ImageHandle == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = InternalGcdInitialize (Map);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  AlignmentMask = (LShiftU64 (1, Alignment) - 1);
+
+  if (GcdAllocateType == EfiGcdAllocateAddress) {
+    if ((*BaseAddress & AlignmentMask) != 0) {
+      return EFI_NOT_FOUND;
+    }
+
+    return InternalGcdConvert (
+             Map,
+             HostGcdAllocate,
+             *BaseAddress,
+             Length,
+             Type,
+             0,
+             ImageHandle,
+             DeviceHandle
+             );
+  }
+
+  MaxAddress = MAX_UINT64;
+
+  if ((GcdAllocateType == EfiGcdAllocateMaxAddressSearchBottomUp)
+   || (GcdAllocateType == EfiGcdAllocateMaxAddressSearchTopDown)) {
+    MaxAddress = *BaseAddress;
+  }
+
+  TopDown = (BOOLEAN)(
+              (GcdAllocateType == EfiGcdAllocateAnySearchTopDown)
+           || (GcdAllocateType == EfiGcdAllocateMaxAddressSearchTopDown)
+              );
+
+  Found = FALSE;
+  Link  = (TopDown ? GetPreviousNode (&Map->Entries, &Map->Entries)
+                   : GetFirstNode (&Map->Entries));
+
+  while (!IsNull (&Map->Entries, Link)) {
+    Entry = GCD_ENTRY_FROM_LINK (Link);
+
+    if ((Entry->Type == Type) && (Entry->ImageHandle == NULL)) {
+      Found = InternalGcdFindCandidate (
+                Entry,
+                AlignmentMask,
+                Length,
+                MaxAddress,
+                TopDown,
+                &Candidate
+                );
+
+      if (Found) {
+        break;
+      }
+    }
+
+    Link = (TopDown ? GetPreviousNode (&Map->Entries, Link)
+                    : GetNextNode (&Map->Entries, Link));
+  }
+
+  if (!Found) {
+    return EFI_NOT_FOUND;
+  }
+
+  Status = InternalGcdConvert (
+             Map,
+             HostGcdAllocate,
+             Candidate,
+             Length,
+             Type,
+             0,
+             ImageHandle,
+             DeviceHandle
+             );
+
+  if (!EFI_ERROR (Status)) {
+    *BaseAddress = Candidate;
+  }
+
+  return Status;
+}
+
+// InternalGcdGetEntry
+STATIC
+EFI_STATUS
+InternalGcdGetEntry (
+  IN  HOST_GCD_MAP    *Map,
+  IN  UINT64          BaseAddress,
+  OUT HOST_GCD_ENTRY  **Entry
+  )
+{
+  EFI_STATUS Status;
+
+  Status = InternalGcdInitialize (Map);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  *Entry = InternalGcdFindEntry (Map, BaseAddress);
+
+  if (*Entry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  return EFI_SUCCESS;
+}
+
+// InternalGcdGetEntryCount
+STATIC
+UINTN
+InternalGcdGetEntryCount (
+  IN HOST_GCD_MAP  *Map
+  )
+{
+  UINTN      NumberOfEntries;
+  LIST_ENTRY *Link;
+
+  NumberOfEntries = 0;
+
+  for (
+    Link = GetFirstNode (&Map->Entries);
+    !IsNull (&Map->Entries, Link);
+    Link = GetNextNode (&Map->Entries, Link)
+    ) {
+    ++NumberOfEntries;
+  }
+
+  return NumberOfEntries;
+}
+
+// Memory Space Services
+
+// InternalAddMemorySpace
+STATIC
+EFI_STATUS
+EFIAPI
+InternalAddMemorySpace (
+  IN EFI_GCD_MEMORY_TYPE   GcdMemoryType,
+  IN EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN UINT64                Length,
+  IN UINT64                Capabilities
+  )
+{
+  if ((GcdMemoryType == EfiGcdMemoryTypeNonExistent)
+   || (GcdMemoryType >= EfiGcdMemoryTypeMaximum)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return InternalGcdConvert (
+           &mMemorySpace,
+           HostGcdAdd,
+           BaseAddress,
+           Length,
+           (UINT32)GcdMemoryType,
+           Capabilities,
+           NULL,
+           NULL
+           );
+}
+
+// InternalAllocateMemorySpace
+STATIC
+EFI_STATUS
+EFIAPI
+InternalAllocateMemorySpace (
+  IN     EFI_GCD_ALLOCATE_TYPE  GcdAllocateType,
+  IN     EFI_GCD_MEMORY_TYPE    GcdMemoryType,
+  IN     UINTN                  Alignment,
+  IN     UINT64                 Length,
+  IN OUT EFI_PHYSICAL_ADDRESS   *BaseAddress,
+  IN     EFI_HANDLE             ImageHandle,
+  IN     EFI_HANDLE             DeviceHandle OPTIONAL
+  )
+{
+  if ((GcdMemoryType == EfiGcdMemoryTypeNonExistent)
+   || (GcdMemoryType >= EfiGcdMemoryTypeMaximum)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return InternalGcdAllocate (
+           &mMemorySpace,
+           GcdAllocateType,
+           (UINT32)GcdMemoryType,
+           Alignment,
+           Length,
+           BaseAddress,
+           ImageHandle,
+           DeviceHandle
+           );
+}
+
+// InternalFreeMemorySpace
+STATIC
+EFI_STATUS
+EFIAPI
+InternalFreeMemorySpace (
+  IN EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN UINT64                Length
+  )
+{
+  return InternalGcdConvert (
+           &mMemorySpace,
+           HostGcdFree,
+           BaseAddress,
+           Length,
+           0,
+           0,
+           NULL,
+           NULL
+           );
+}
+
+// InternalRemoveMemorySpace
+STATIC
+EFI_STATUS
+EFIAPI
+InternalRemoveMemorySpace (
+  IN EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN UINT64                Length
+  )
+{
+  return InternalGcdConvert (
+           &mMemorySpace,
+           HostGcdRemove,
+           BaseAddress,
+           Length,
+           0,
+           0,
+           NULL,
+           NULL
+           );
+}
+
+// InternalGetMemorySpaceDescriptor
+STATIC
+EFI_STATUS
+EFIAPI
+InternalGetMemorySpaceDescriptor (
+  IN  EFI_PHYSICAL_ADDRESS             BaseAddress,
+  OUT EFI_GCD_MEMORY_SPACE_DESCRIPTOR  *Descriptor
+  )
+{
+  EFI_STATUS     Status;
+
+  HOST_GCD_ENTRY *Entry;
+
+  if (Descriptor == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = InternalGcdGetEntry (&mMemorySpace, BaseAddress, &Entry);
+
+  if (!EFI_ERROR (Status)) {
+    Descriptor->BaseAddress   = Entry->BaseAddress;
+    Descriptor->Length        = Entry->Length;
+    Descriptor->Capabilities  = Entry->Capabilities;
+    Descriptor->Attributes    = Entry->Attributes;
+    Descriptor->GcdMemoryType = (EFI_GCD_MEMORY_TYPE)Entry->Type;
+    Descriptor->ImageHandle   = Entry->ImageHandle;
+    Descriptor->DeviceHandle  = Entry->DeviceHandle;
+  }
+
+  return Status;
+}
+
+// InternalSetMemorySpaceAttributes
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSetMemorySpaceAttributes (
+  IN EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN UINT64                Length,
+  IN UINT64                Attributes
+  )
+{
+  return InternalGcdConvert (
+           &mMemorySpace,
+           HostGcdSetAttributes,
+           BaseAddress,
+           Length,
+           0,
+           Attributes,
+           NULL,
+           NULL
+           );
+}
+
+// InternalSetMemorySpaceCapabilities
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSetMemorySpaceCapabilities (
+  IN EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN UINT64                Length,
+  IN UINT64                Capabilities
+  )
+{
+  return InternalGcdConvert (
+           &mMemorySpace,
+           HostGcdSetCapabilities,
+           BaseAddress,
+           Length,
+           0,
+           Capabilities,
+           NULL,
+           NULL
+           );
+}
+
+// InternalGetMemorySpaceMap
+STATIC
+EFI_STATUS
+EFIAPI
+InternalGetMemorySpaceMap (
+  OUT UINTN                            *NumberOfDescriptors,
+  OUT EFI_GCD_MEMORY_SPACE_DESCRIPTOR  **MemorySpaceMap
+  )
+{
+  EFI_STATUS                      Status;
+
+  EFI_GCD_MEMORY_SPACE_DESCRIPTOR *Descriptor;
+  HOST_GCD_ENTRY                  *Entry;
+  LIST_ENTRY                      *Link;
+
+  if ((NumberOfDescriptors == NULL) || (MemorySpaceMap == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = InternalGcdInitialize (&mMemorySpace);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  *NumberOfDescriptors = InternalGcdGetEntryCount (&mMemorySpace);
+  *MemorySpaceMap      = AllocatePool (
+                           *NumberOfDescriptors * sizeof (**MemorySpaceMap)
+                           );
+
+  if (*MemorySpaceMap == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Descriptor = *MemorySpaceMap;
+
+  for (
+    Link = GetFirstNode (&mMemorySpace.Entries);
+    !IsNull (&mMemorySpace.Entries, Link);
+    Link = GetNextNode (&mMemorySpace.Entries, Link)
+    ) {
+    Entry = GCD_ENTRY_FROM_LINK (Link);
+
+    Descriptor->BaseAddress   = Entry->BaseAddress;
+    Descriptor->Length        = Entry->Length;
+    Descriptor->Capabilities  = Entry->Capabilities;
+    Descriptor->Attributes    = Entry->Attributes;
+    Descriptor->GcdMemoryType = (EFI_GCD_MEMORY_TYPE)Entry->Type;
+    Descriptor->ImageHandle   = Entry->ImageHandle;
+    Descriptor->DeviceHandle  = Entry->DeviceHandle;
+
+    ++Descriptor;
+  }
+
+  return EFI_SUCCESS;
+}
+
+// I/O Space Services
+
+// InternalAddIoSpace
+STATIC
+EFI_STATUS
+EFIAPI
+InternalAddIoSpace (
+  IN EFI_GCD_IO_TYPE       GcdIoType,
+  IN EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN UINT64                Length
+  )
+{
+  if ((GcdIoType == EfiGcdIoTypeNonExistent)
+   || (GcdIoType >= EfiGcdIoTypeMaximum)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return InternalGcdConvert (
+           &mIoSpace,
+           HostGcdAdd,
+           BaseAddress,
+           Length,
+           (UINT32)GcdIoType,
+           0,
+           NULL,
+           NULL
+           );
+}
+
+// InternalAllocateIoSpace
+STATIC
+EFI_STATUS
+EFIAPI
+InternalAllocateIoSpace (
+  IN     EFI_GCD_ALLOCATE_TYPE  GcdAllocateType,
+  IN     EFI_GCD_IO_TYPE        GcdIoType,
+  IN     UINTN                  Alignment,
+  IN     UINT64                 Length,
+  IN OUT EFI_PHYSICAL_ADDRESS   *BaseAddress,
+  IN     EFI_HANDLE             ImageHandle,
+  IN     EFI_HANDLE             DeviceHandle OPTIONAL
+  )
+{
+  if ((GcdIoType == EfiGcdIoTypeNonExistent)
+   || (GcdIoType >= EfiGcdIoTypeMaximum)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return InternalGcdAllocate (
+           &mIoSpace,
+           GcdAllocateType,
+           (UINT32)GcdIoType,
+           Alignment,
+           Length,
+           BaseAddress,
+           ImageHandle,
+           DeviceHandle
+           );
+}
+
+// InternalFreeIoSpace
+STATIC
+EFI_STATUS
+EFIAPI
+InternalFreeIoSpace (
+  IN EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN UINT64                Length
+  )
+{
+  return InternalGcdConvert (
+           &mIoSpace,
+           HostGcdFree,
+           BaseAddress,
+           Length,
+           0,
+           0,
+           NULL,
+           NULL
+           );
+}
+
+// InternalRemoveIoSpace
+STATIC
+EFI_STATUS
+EFIAPI
+InternalRemoveIoSpace (
+  IN EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN UINT64                Length
+  )
+{
+  return InternalGcdConvert (
+           &mIoSpace,
+           HostGcdRemove,
+           BaseAddress,
+           Length,
+           0,
+           0,
+           NULL,
+           NULL
+           );
+}
+
+// InternalGetIoSpaceDescriptor
+STATIC
+EFI_STATUS
+EFIAPI
+InternalGetIoSpaceDescriptor (
+  IN  EFI_PHYSICAL_ADDRESS         BaseAddress,
+  OUT EFI_GCD_IO_SPACE_DESCRIPTOR  *Descriptor
+  )
+{
+  EFI_STATUS     Status;
+
+  HOST_GCD_ENTRY *Entry;
+
+  if (Descriptor == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = InternalGcdGetEntry (&mIoSpace, BaseAddress, &Entry);
+
+  if (!EFI_ERROR (Status)) {
+    Descriptor->BaseAddress  = Entry->BaseAddress;
+    Descriptor->Length       = Entry->Length;
+    Descriptor->GcdIoType    = (EFI_GCD_IO_TYPE)Entry->Type;
+    Descriptor->ImageHandle  = Entry->ImageHandle;
+    Descriptor->DeviceHandle = Entry->DeviceHandle;
+  }
+
+  return Status;
+}
+
+// InternalGetIoSpaceMap
+STATIC
+EFI_STATUS
+EFIAPI
+InternalGetIoSpaceMap (
+  OUT UINTN                        *NumberOfDescriptors,
+  OUT EFI_GCD_IO_SPACE_DESCRIPTOR  **IoSpaceMap
+  )
+{
+  EFI_STATUS                  Status;
+
+  EFI_GCD_IO_SPACE_DESCRIPTOR *Descriptor;
+  HOST_GCD_ENTRY              *Entry;
+  LIST_ENTRY                  *Link;
+
+  if ((NumberOfDescriptors == NULL) || (IoSpaceMap == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = InternalGcdInitialize (&mIoSpace);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  *NumberOfDescriptors = InternalGcdGetEntryCount (&mIoSpace);
+  *IoSpaceMap          = AllocatePool (
+                           *NumberOfDescriptors * sizeof (**IoSpaceMap)
+                           );
+
+  if (*IoSpaceMap == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Descriptor = *IoSpaceMap;
+
+  for (
+    Link = GetFirstNode (&mIoSpace.Entries);
+    !IsNull (&mIoSpace.Entries, Link);
+    Link = GetNextNode (&mIoSpace.Entries, Link)
+    ) {
+    Entry = GCD_ENTRY_FROM_LINK (Link);
+
+    Descriptor->BaseAddress  = Entry->BaseAddress;
+    Descriptor->Length       = Entry->Length;
+    Descriptor->GcdIoType    = (EFI_GCD_IO_TYPE)Entry->Type;
+    Descriptor->ImageHandle  = Entry->ImageHandle;
+    Descriptor->DeviceHandle = Entry->DeviceHandle;
+
+    ++Descriptor;
+  }
+
+  return EFI_SUCCESS;
+}
+
+// Dispatcher Services
+
+// InternalDispatch
+/** There are no firmware volumes, hence there is nothing to dispatch.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalDispatch (
+  VOID
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+// InternalSchedule
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSchedule (
+  IN EFI_HANDLE      FirmwareVolumeHandle,
+  IN CONST EFI_GUID  *FileName
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+// InternalTrust
+STATIC
+EFI_STATUS
+EFIAPI
+InternalTrust (
+  IN EFI_HANDLE      FirmwareVolumeHandle,
+  IN CONST EFI_GUID  *FileName
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+// InternalProcessFirmwareVolume
+STATIC
+EFI_STATUS
+EFIAPI
+InternalProcessFirmwareVolume (
+  IN  CONST VOID  *FirmwareVolumeHeader,
+  IN  UINTN       Size,
+  OUT EFI_HANDLE  *FirmwareVolumeHandle
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+// mHostDxeServices
+STATIC DXE_SERVICES mHostDxeServices = {
+  {
+    DXE_SERVICES_SIGNATURE,
+    DXE_SERVICES_REVISION,
+    sizeof (DXE_SERVICES),
+    0,
+    0
+  },
+  InternalAddMemorySpace,
+  InternalAllocateMemorySpace,
+  InternalFreeMemorySpace,
+  InternalRemoveMemorySpace,
+  InternalGetMemorySpaceDescriptor,
+  InternalSetMemorySpaceAttributes,
+  InternalGetMemorySpaceMap,
+  InternalAddIoSpace,
+  InternalAllocateIoSpace,
+  InternalFreeIoSpace,
+  InternalRemoveIoSpace,
+  InternalGetIoSpaceDescriptor,
+  InternalGetIoSpaceMap,
+  InternalDispatch,
+  InternalSchedule,
+  InternalTrust,
+  InternalProcessFirmwareVolume,
+  InternalSetMemorySpaceCapabilities
+};
+
+// gDS
+DXE_SERVICES *gDS = &mHostDxeServices;
@@ -0,0 +1,2114 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <Uefi.h>
+
+#include <Guid/EventGroup.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+
+// HOST_EVENT_SIGNATURE
+#define HOST_EVENT_SIGNATURE  SIGNATURE_32 ('h', 'e', 'v', 't')
+
+// HOST_HANDLE_SIGNATURE
+#define HOST_HANDLE_SIGNATURE  SIGNATURE_32 ('h', 'h', 'n', 'd')
+
+// HOST_NOTIFY_SIGNATURE
+#define HOST_NOTIFY_SIGNATURE  SIGNATURE_32 ('h', 'n', 't', 'f')
+
+// HOST_EVENT
+typedef struct {
+  UINT32           Signature;       ///< HOST_EVENT_SIGNATURE.
+  LIST_ENTRY       Link;            ///< Links all events.
+  LIST_ENTRY       NotifyLink;      ///< Links the queued notifications.
+  UINT32           Type;            ///< The type of the event.
+  EFI_TPL          NotifyTpl;       ///< The TPL to notify at.
+  EFI_EVENT_NOTIFY NotifyFunction;  ///< The notification function.
+  VOID             *NotifyContext;  ///< Passed to NotifyFunction.
+  EFI_GUID         EventGroup;      ///< The group of the event.
+  BOOLEAN          HasEventGroup;   ///< Whether EventGroup is valid.
+  BOOLEAN          Signaled;        ///< Whether the event is signaled.
+  BOOLEAN          NotifyQueued;    ///< Whether NotifyLink is linked.
+  BOOLEAN          TimerArmed;      ///< Whether the timer is set.
+  UINT64           TriggerTime;     ///< The time the timer expires at.
+  UINT64           Period;          ///< The period of a periodic timer.
+  BOOLEAN          Periodic;        ///< Whether the timer is periodic.
+} HOST_EVENT;
+
+// EVENT_FROM_LINK
+#define EVENT_FROM_LINK(Entry)  BASE_CR ((Entry), HOST_EVENT, Link)
+
+// EVENT_FROM_NOTIFY_LINK
+#define EVENT_FROM_NOTIFY_LINK(Entry)  BASE_CR ((Entry), HOST_EVENT, NotifyLink)
+
+// HOST_HANDLE
+typedef struct {
+  UINT32     Signature;  ///< HOST_HANDLE_SIGNATURE.
+  LIST_ENTRY Link;       ///< Links all handles carrying a protocol.
+  LIST_ENTRY Protocols;  ///< The protocols installed on the handle.
+} HOST_HANDLE;
+
+// HANDLE_FROM_LINK
+#define HANDLE_FROM_LINK(Entry)  BASE_CR ((Entry), HOST_HANDLE, Link)
+
+// HOST_PROTOCOL_INTERFACE
+typedef struct {
+  LIST_ENTRY Link;        ///< Links the protocols of the handle.
+  EFI_GUID   Protocol;    ///< The GUID of the protocol.
+  VOID       *Interface;  ///< The installed interface.
+  UINT64     Key;         ///< The order the interface was installed in.
+} HOST_PROTOCOL_INTERFACE;
+
+// PROTOCOL_FROM_LINK
+#define PROTOCOL_FROM_LINK(Entry)  \
+  BASE_CR ((Entry), HOST_PROTOCOL_INTERFACE, Link)
+
+// HOST_PROTOCOL_NOTIFY
+typedef struct {
+  UINT32     Signature;  ///< HOST_NOTIFY_SIGNATURE.
+  LIST_ENTRY Link;       ///< Links all registrations.
+  EFI_GUID   Protocol;   ///< The GUID of the protocol.
+  HOST_EVENT *Event;     ///< The event signaled on installation.
+  UINT64     Key;        ///< The key of the last interface returned.
+} HOST_PROTOCOL_NOTIFY;
+
+// NOTIFY_FROM_LINK
+#define NOTIFY_FROM_LINK(Entry)  BASE_CR ((Entry), HOST_PROTOCOL_NOTIFY, Link)
+
+// mEvents
+STATIC LIST_ENTRY mEvents = INITIALIZE_LIST_HEAD_VARIABLE (mEvents);
+
+// mNotifyQueue
+STATIC LIST_ENTRY mNotifyQueue = INITIALIZE_LIST_HEAD_VARIABLE (mNotifyQueue);
+
+// mHandles
+STATIC LIST_ENTRY mHandles = INITIALIZE_LIST_HEAD_VARIABLE (mHandles);
+
+// mProtocolNotifies
+STATIC LIST_ENTRY mProtocolNotifies =
+  INITIALIZE_LIST_HEAD_VARIABLE (mProtocolNotifies);
+
+// mImageHandle
+/// The handle of the image, which exists without any protocol.
+STATIC HOST_HANDLE mImageHandle = {
+  HOST_HANDLE_SIGNATURE,
+  { NULL, NULL },
+  INITIALIZE_LIST_HEAD_VARIABLE (mImageHandle.Protocols)
+};
+
+// mCurrentTpl
+STATIC EFI_TPL mCurrentTpl = TPL_APPLICATION;
+
+// mCurrentTime
+/// The virtual time, in 100 ns units.  It only advances by Stall() and by
+/// WaitForEvent().
+STATIC UINT64 mCurrentTime = 0;
+
+// mMonotonicCount
+STATIC UINT64 mMonotonicCount = 0;
+
+// mInterfaceKey
+STATIC UINT64 mInterfaceKey = 0;
+
+// mMapKey
+STATIC UINTN mMapKey = 1;
+
+// Task Priority Services
+
+// InternalGetNextNotify
+/** Returns the queued notification with the highest TPL above Tpl.
+**/
+STATIC
+HOST_EVENT *
+InternalGetNextNotify (
+  IN EFI_TPL  Tpl
+  )
+{
+  HOST_EVENT *Next;
+  HOST_EVENT *Event;
+  LIST_ENTRY *Link;
+
+  Next = NULL;
+
+  for (
+    Link = GetFirstNode (&mNotifyQueue);
+    !IsNull (&mNotifyQueue, Link);
+    Link = GetNextNode (&mNotifyQueue, Link)
+    ) {
+    Event = EVENT_FROM_NOTIFY_LINK (Link);
+
+    if ((Event->NotifyTpl > Tpl)
+     && ((Next == NULL) || (Event->NotifyTpl > Next->NotifyTpl))) {
+      Next = Event;
+    }
+  }
+
+  return Next;
+}
+
+// InternalRaiseTpl
+STATIC
+EFI_TPL
+EFIAPI
+InternalRaiseTpl (
+  IN EFI_TPL  NewTpl
+  )
+{
+  EFI_TPL OldTpl;
+
+  ASSERT (NewTpl >= mCurrentTpl);
+  ASSERT (NewTpl <= TPL_HIGH_LEVEL);
+
+  OldTpl      = mCurrentTpl;
+  mCurrentTpl = NewTpl;
+
+  return OldTpl;
+}
+
+// InternalRestoreTpl
+/** Lowers the TPL, running the queued notifications above OldTpl first, the
+    highest TPL first.
+**/
+STATIC
+VOID
+EFIAPI
+InternalRestoreTpl (
+  IN EFI_TPL  OldTpl
+  )
+{
+  HOST_EVENT *Event;
+
+  ASSERT (OldTpl <= mCurrentTpl);
+
+  for (
+    Event = InternalGetNextNotify (OldTpl);
+    Event != NULL;
+    Event = InternalGetNextNotify (OldTpl)
+    ) {
+    RemoveEntryList (&Event->NotifyLink);
+
+    Event->NotifyQueued = FALSE;
+
+    if ((Event->Type & EVT_NOTIFY_SIGNAL) != 0) {
+      Event->Signaled = FALSE;
+    }
+
+    mCurrentTpl = Event->NotifyTpl;
+
+    Event->NotifyFunction ((EFI_EVENT)Event, Event->NotifyContext);
+  }
+
+  mCurrentTpl = OldTpl;
+}
+
+// Event and Timer Services
+
+// InternalGetEvent
+STATIC
+HOST_EVENT *
+InternalGetEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  HOST_EVENT *HostEvent;
+  LIST_ENTRY *Link;
+
+  for (
+    Link = GetFirstNode (&mEvents);
+    !IsNull (&mEvents, Link);
+    Link = GetNextNode (&mEvents, Link)
+    ) {
+    HostEvent = EVENT_FROM_LINK (Link);
+
+    if ((EFI_EVENT)HostEvent == Event) {
+      ASSERT (HostEvent->Signature == HOST_EVENT_SIGNATURE);
+      return HostEvent;
+    }
+  }
+
+  return NULL;
+}
+
+// InternalQueueNotify
+STATIC
+VOID
+InternalQueueNotify (
+  IN HOST_EVENT  *Event
+  )
+{
+  if (!Event->NotifyQueued) {
+    InsertTailList (&mNotifyQueue, &Event->NotifyLink);
+
+    Event->NotifyQueued = TRUE;
+  }
+}
+
+// InternalSignalOne
+STATIC
+VOID
+InternalSignalOne (
+  IN HOST_EVENT  *Event
+  )
+{
+  if (!Event->Signaled) {
+    Event->Signaled = TRUE;
+
+    if ((Event->Type & EVT_NOTIFY_SIGNAL) != 0) {
+      InternalQueueNotify (Event);
+    }
+  }
+}
+
+// InternalSignalEventGroup
+/** Signals all events of EventGroup.  The caller runs at TPL_HIGH_LEVEL.
+**/
+STATIC
+VOID
+InternalSignalEventGroup (
+  IN CONST EFI_GUID  *EventGroup
+  )
+{
+  HOST_EVENT *Event;
+  LIST_ENTRY *Link;
+
+  for (
+    Link = GetFirstNode (&mEvents);
+    !IsNull (&mEvents, Link);
+    Link = GetNextNode (&mEvents, Link)
+    ) {
+    Event = EVENT_FROM_LINK (Link);
+
+    if (Event->HasEventGroup && CompareGuid (&Event->EventGroup, EventGroup)) {
+      InternalSignalOne (Event);
+    }
+  }
+}
+
+// InternalCreateEventEx
+STATIC
+EFI_STATUS
+EFIAPI
+InternalCreateEventEx (
+  IN  UINT32            Type,
+  IN  EFI_TPL           NotifyTpl,
+  IN  EFI_EVENT_NOTIFY  NotifyFunction, OPTIONAL
+  IN  CONST VOID        *NotifyContext, OPTIONAL
+  IN  CONST EFI_GUID    *EventGroup, OPTIONAL
+  OUT EFI_EVENT         *Event
+  )
+{
+  HOST_EVENT *HostEvent;
+
+  if (Event == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (EventGroup != NULL) {
+    if ((Type == EVT_SIGNAL_EXIT_BOOT_SERVICES)
+     || (Type == EVT_SIGNAL_VIRTUAL_ADDRESS_CHANGE)) {
+      return EFI_INVALID_PARAMETER;
+    }
+  } else if (Type == EVT_SIGNAL_EXIT_BOOT_SERVICES) {
+    EventGroup = &gEfiEventExitBootServicesGuid;
+  } else if (Type == EVT_SIGNAL_VIRTUAL_ADDRESS_CHANGE) {
+    EventGroup = &gEfiEventVirtualAddressChangeGuid;
+  }
+
+  if ((Type & (EVT_NOTIFY_SIGNAL | EVT_NOTIFY_WAIT)) != 0) {
+    if (((Type & EVT_NOTIFY_SIGNAL) != 0) && ((Type & EVT_NOTIFY_WAIT) != 0)) {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    if ((NotifyFunction == NULL)
+     || (NotifyTpl <= TPL_APPLICATION)
+     || (NotifyTpl >= TPL_HIGH_LEVEL)) {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  HostEvent = AllocateZeroPool (sizeof (*HostEvent));
+
+  if (HostEvent == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  HostEvent->Signature      = HOST_EVENT_SIGNATURE;
+  HostEvent->Type           = Type;
+  HostEvent->NotifyTpl      = NotifyTpl;
+  HostEvent->NotifyFunction = NotifyFunction;
+  HostEvent->NotifyContext  = (VOID *)NotifyContext;
+
+  if (EventGroup != NULL) {
+    CopyGuid (&HostEvent->EventGroup, EventGroup);
+
+    HostEvent->HasEventGroup = TRUE;
+  }
+
+  InsertTailList (&mEvents, &HostEvent->Link);
+
+  *Event = (EFI_EVENT)HostEvent;
+
+  return EFI_SUCCESS;
+}
+
+// InternalCreateEvent
+STATIC
+EFI_STATUS
+EFIAPI
+InternalCreateEvent (
+  IN  UINT32            Type,
+  IN  EFI_TPL           NotifyTpl,
+  IN  EFI_EVENT_NOTIFY  NotifyFunction, OPTIONAL
+  IN  VOID              *NotifyContext, OPTIONAL
+  OUT EFI_EVENT         *Event
+  )
+{
+  return InternalCreateEventEx (
+           Type,
+           NotifyTpl,
+           NotifyFunction,
+           NotifyContext,
+           NULL,
+           Event
+           );
+}
+
+// InternalSignalEvent
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSignalEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  HOST_EVENT *HostEvent;
+  EFI_TPL    OldTpl;
+
+  HostEvent = InternalGetEvent (Event);
+
+  if (HostEvent == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OldTpl = InternalRaiseTpl (TPL_HIGH_LEVEL);
+
+  if (HostEvent->HasEventGroup) {
+    InternalSignalEventGroup (&HostEvent->EventGroup);
+  } else {
+    InternalSignalOne (HostEvent);
+  }
+
+  InternalRestoreTpl (OldTpl);
+
+  return EFI_SUCCESS;
+}
+
+// InternalCheckEvent
+STATIC
+EFI_STATUS
+EFIAPI
+InternalCheckEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  EFI_STATUS Status;
+
+  HOST_EVENT *HostEvent;
+  EFI_TPL    OldTpl;
+
+  HostEvent = InternalGetEvent (Event);
+
+  if ((HostEvent == NULL) || ((HostEvent->Type & EVT_NOTIFY_SIGNAL) != 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (!HostEvent->Signaled && ((HostEvent->Type & EVT_NOTIFY_WAIT) != 0)) {
+    OldTpl = InternalRaiseTpl (TPL_HIGH_LEVEL);
+
+    InternalQueueNotify (HostEvent);
+    InternalRestoreTpl (OldTpl);
+  }
+
+  Status = EFI_NOT_READY;
+
+  if (HostEvent->Signaled) {
+    HostEvent->Signaled = FALSE;
+    Status              = EFI_SUCCESS;
+  }
+
+  return Status;
+}
+
+// InternalCloseEvent
+STATIC
+EFI_STATUS
+EFIAPI
+InternalCloseEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  HOST_EVENT           *HostEvent;
+  HOST_PROTOCOL_NOTIFY *Notify;
+  LIST_ENTRY           *Link;
+
+  HostEvent = InternalGetEvent (Event);
+
+  if (HostEvent == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (HostEvent->NotifyQueued) {
+    RemoveEntryList (&HostEvent->NotifyLink);
+  }
+
+  // Closing an event cancels its protocol notifications.
+
+  Link = GetFirstNode (&mProtocolNotifies);
+
+  while (!IsNull (&mProtocolNotifies, Link)) {
+    Notify = NOTIFY_FROM_LINK (Link);
+    Link   = GetNextNode (&mProtocolNotifies, Link);
+
+    if (Notify->Event == HostEvent) {
+      RemoveEntryList (&Notify->Link);
+      FreePool ((VOID *)Notify);
+    }
+  }
+
+  RemoveEntryList (&HostEvent->Link);
+  FreePool ((VOID *)HostEvent);
+
+  return EFI_SUCCESS;
+}
+
+// InternalSetTimer
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSetTimer (
+  IN EFI_EVENT        Event,
+  IN EFI_TIMER_DELAY  Type,
+  IN UINT64           TriggerTime
+  )
+{
+  HOST_EVENT *HostEvent;
+
+  HostEvent = InternalGetEvent (Event);
+
+  if ((HostEvent == NULL)
+   || ((HostEvent->Type & EVT_TIMER) == 0)
+   || ((Type != TimerCancel)
+    && (Type != TimerPeriodic)
+    && (Type != TimerRelative))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  HostEvent->TimerArmed  = (BOOLEAN)(Type != TimerCancel);
+  HostEvent->Periodic    = (BOOLEAN)(Type == TimerPeriodic);
+  HostEvent->Period      = TriggerTime;
+  HostEvent->TriggerTime = (mCurrentTime + TriggerTime);
+
+  return EFI_SUCCESS;
+}
+
+// InternalGetNextTimer
+/** Returns the armed timer expiring first, not later than Time.
+**/
+STATIC
+HOST_EVENT *
+InternalGetNextTimer (
+  IN UINT64  Time
+  )
+{
+  HOST_EVENT *Next;
+  HOST_EVENT *Event;
+  LIST_ENTRY *Link;
+
+  Next = NULL;
+
+  for (
+    Link = GetFirstNode (&mEvents);
+    !IsNull (&mEvents, Link);
+    Link = GetNextNode (&mEvents, Link)
+    ) {
+    Event = EVENT_FROM_LINK (Link);
+
+    if (Event->TimerArmed
+     && (Event->TriggerTime <= Time)
+     && ((Next == NULL) || (Event->TriggerTime < Next->TriggerTime))) {
+      Next = Event;
+    }
+  }
+
+  return Next;
+}
+
+// InternalAdvanceTime
+/** Advances the virtual time and signals the expiring timers in the order
+    they expire in.
+
+  A timer expiring now is signaled even if Delta is 0, so a timer set to 0
+  expires with the next advance of the time.  A periodic timer with a period
+  of 0 is signaled once per advance.  Like with a timer interrupt, the
+  notifications are dispatched after every expiry, so a periodic timer
+  expiring repeatedly is notified every time.
+**/
+STATIC
+VOID
+InternalAdvanceTime (
+  IN UINT64  Delta
+  )
+{
+  HOST_EVENT *Event;
+  UINT64     EndTime;
+  EFI_TPL    OldTpl;
+
+  EndTime = (mCurrentTime + Delta);
+
+  do {
+    OldTpl = InternalRaiseTpl (TPL_HIGH_LEVEL);
+    Event  = InternalGetNextTimer (EndTime);
+
+    if (Event != NULL) {
+      if (Event->TriggerTime > mCurrentTime) {
+        mCurrentTime = Event->TriggerTime;
+      }
+
+      if (!Event->Periodic) {
+        Event->TimerArmed = FALSE;
+      } else if (Event->Period == 0) {
+        Event->TriggerTime = (EndTime + 1);
+      } else {
+        Event->TriggerTime += Event->Period;
+      }
+
+      InternalSignalOne (Event);
+    }
+
+    InternalRestoreTpl (OldTpl);
+  } while (Event != NULL);
+
+  // A notification may have advanced the time beyond EndTime already.
+
+  if (mCurrentTime < EndTime) {
+    mCurrentTime = EndTime;
+  }
+}
+
+// InternalWaitForEvent
+/** Waits for one of the events to be signaled, advancing the virtual time to
+    the expiry of the next timer while none is.
+
+  As nothing but a timer can signal an event while waiting, EFI_NOT_READY is
+  returned instead of waiting forever when no timer is armed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalWaitForEvent (
+  IN  UINTN      NumberOfEvents,
+  IN  EFI_EVENT  *Event,
+  OUT UINTN      *Index
+  )
+{
+  EFI_STATUS Status;
+
+  HOST_EVENT *Timer;
+  UINTN      EventIndex;
+
+  if ((NumberOfEvents == 0) || (Event == NULL) || (Index == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mCurrentTpl != TPL_APPLICATION) {
+    return EFI_UNSUPPORTED;
+  }
+
+  do {
+    for (EventIndex = 0; EventIndex < NumberOfEvents; ++EventIndex) {
+      Status = InternalCheckEvent (Event[EventIndex]);
+
+      if (Status != EFI_NOT_READY) {
+        *Index = EventIndex;
+        return Status;
+      }
+    }
+
+    Timer = InternalGetNextTimer (MAX_UINT64);
+
+    if (Timer == NULL) {
+      return EFI_NOT_READY;
+    }
+
+    InternalAdvanceTime (
+      ((Timer->TriggerTime > mCurrentTime)
+        ? (Timer->TriggerTime - mCurrentTime)
+        : 0)
+      );
+  } while (TRUE);
+}
+
+// Memory Services
+
+// InternalAllocatePages
+/** Allocates pages from the host heap.  Pages at a fixed address cannot be
+    allocated.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalAllocatePages (
+  IN     EFI_ALLOCATE_TYPE     Type,
+  IN     EFI_MEMORY_TYPE       MemoryType,
+  IN     UINTN                 Pages,
+  IN OUT EFI_PHYSICAL_ADDRESS  *Memory
+  )
+{
+  VOID *Buffer;
+
+  if ((Memory == NULL) || (Type >= MaxAllocateType)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Type == AllocateAddress) {
+    return EFI_NOT_FOUND;
+  }
+
+  Buffer = AllocatePages (Pages);
+
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if ((Type == AllocateMaxAddress)
+   && (((UINTN)Buffer + EFI_PAGES_TO_SIZE (Pages) - 1) > *Memory)) {
+    FreePages (Buffer, Pages);
+    return EFI_NOT_FOUND;
+  }
+
+  *Memory = (EFI_PHYSICAL_ADDRESS)(UINTN)Buffer;
+
+  ++mMapKey;
+
+  return EFI_SUCCESS;
+}
+
+// InternalFreePages
+STATIC
+EFI_STATUS
+EFIAPI
+InternalFreePages (
+  IN EFI_PHYSICAL_ADDRESS  Memory,
+  IN UINTN                 Pages
+  )
+{
+  if ((Memory & EFI_PAGE_MASK) != 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  FreePages ((VOID *)(UINTN)Memory, Pages);
+
+  ++mMapKey;
+
+  return EFI_SUCCESS;
+}
+
+// InternalGetMemoryMap
+/** Returns an empty memory map, as the host memory is not described.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalGetMemoryMap (
+  IN OUT UINTN                  *MemoryMapSize,
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  OUT    UINTN                  *MapKey,
+  OUT    UINTN                  *DescriptorSize,
+  OUT    UINT32                 *DescriptorVersion
+  )
+{
+  if (MemoryMapSize == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *MemoryMapSize = 0;
+
+  if (MapKey != NULL) {
+    *MapKey = mMapKey;
+  }
+
+  if (DescriptorSize != NULL) {
+    *DescriptorSize = sizeof (EFI_MEMORY_DESCRIPTOR);
+  }
+
+  if (DescriptorVersion != NULL) {
+    *DescriptorVersion = EFI_MEMORY_DESCRIPTOR_VERSION;
+  }
+
+  return EFI_SUCCESS;
+}
+
+// InternalAllocatePool
+STATIC
+EFI_STATUS
+EFIAPI
+InternalAllocatePool (
+  IN  EFI_MEMORY_TYPE  PoolType,
+  IN  UINTN            Size,
+  OUT VOID             **Buffer
+  )
+{
+  if (Buffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *Buffer = AllocatePool (Size);
+
+  if (*Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ++mMapKey;
+
+  return EFI_SUCCESS;
+}
+
+// InternalFreePool
+STATIC
+EFI_STATUS
+EFIAPI
+InternalFreePool (
+  IN VOID  *Buffer
+  )
+{
+  if (Buffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  FreePool (Buffer);
+
+  ++mMapKey;
+
+  return EFI_SUCCESS;
+}
+
+// Protocol Handler Services
+
+// InternalGetHandle
+STATIC
+HOST_HANDLE *
+InternalGetHandle (
+  IN EFI_HANDLE  Handle
+  )
+{
+  HOST_HANDLE *HostHandle;
+  LIST_ENTRY  *Link;
+
+  if (Handle == (EFI_HANDLE)&mImageHandle) {
+    return &mImageHandle;
+  }
+
+  for (
+    Link = GetFirstNode (&mHandles);
+    !IsNull (&mHandles, Link);
+    Link = GetNextNode (&mHandles, Link)
+    ) {
+    HostHandle = HANDLE_FROM_LINK (Link);
+
+    if ((EFI_HANDLE)HostHandle == Handle) {
+      ASSERT (HostHandle->Signature == HOST_HANDLE_SIGNATURE);
+      return HostHandle;
+    }
+  }
+
+  return NULL;
+}
+
+// InternalFindProtocol
+STATIC
+HOST_PROTOCOL_INTERFACE *
+InternalFindProtocol (
+  IN CONST HOST_HANDLE  *Handle,
+  IN CONST EFI_GUID     *Protocol
+  )
+{
+  HOST_PROTOCOL_INTERFACE *Interface;
+  LIST_ENTRY              *Link;
+
+  for (
+    Link = GetFirstNode (&Handle->Protocols);
+    !IsNull (&Handle->Protocols, Link);
+    Link = GetNextNode (&Handle->Protocols, Link)
+    ) {
+    Interface = PROTOCOL_FROM_LINK (Link);
+
+    if (CompareGuid (&Interface->Protocol, Protocol)) {
+      return Interface;
+    }
+  }
+
+  return NULL;
+}
+
+// InternalNotifyProtocol
+/** Signals the events registered for the installation of Protocol.
+**/
+STATIC
+VOID
+InternalNotifyProtocol (
+  IN CONST EFI_GUID  *Protocol
+  )
+{
+  HOST_PROTOCOL_NOTIFY *Notify;
+  LIST_ENTRY           *Link;
+
+  for (
+    Link = GetFirstNode (&mProtocolNotifies);
+    !IsNull (&mProtocolNotifies, Link);
+    Link = GetNextNode (&mProtocolNotifies, Link)
+    ) {
+    Notify = NOTIFY_FROM_LINK (Link);
+
+    if (CompareGuid (&Notify->Protocol, Protocol)) {
+      InternalSignalEvent ((EFI_EVENT)Notify->Event);
+    }
+  }
+}
+
+// InternalInstallProtocolInterface
+STATIC
+EFI_STATUS
+EFIAPI
+InternalInstallProtocolInterface (
+  IN OUT EFI_HANDLE          *Handle,
+  IN     EFI_GUID            *Protocol,
+  IN     EFI_INTERFACE_TYPE  InterfaceType,
+  IN     VOID                *Interface
+  )
+{
+  HOST_HANDLE             *HostHandle;
+  HOST_PROTOCOL_INTERFACE *HostInterface;
+
+  if ((Handle == NULL)
+   || (Protocol == NULL)
+   || (InterfaceType != EFI_NATIVE_INTERFACE)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (*Handle != NULL) {
+    HostHandle = InternalGetHandle (*Handle);
+
+    if (HostHandle == NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    if (InternalFindProtocol (HostHandle, Protocol) != NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+  } else {
+    HostHandle = AllocateZeroPool (sizeof (*HostHandle));
+
+    if (HostHandle == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    HostHandle->Signature = HOST_HANDLE_SIGNATURE;
+
+    InitializeListHead (&HostHandle->Protocols);
+  }
+
+  HostInterface = AllocatePool (sizeof (*HostInterface));
+
+  if (HostInterface == NULL) {
+    if (*Handle == NULL) {
+      FreePool ((VOID *)HostHandle);
+    }
+
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  CopyGuid (&HostInterface->Protocol, Protocol);
+
+  HostInterface->Interface = Interface;
+  HostInterface->Key       = ++mInterfaceKey;
+
+  // Only handles carrying a protocol are enumerated.
+
+  if (IsListEmpty (&HostHandle->Protocols)) {
+    InsertTailList (&mHandles, &HostHandle->Link);
+  }
+
+  InsertTailList (&HostHandle->Protocols, &HostInterface->Link);
+
+  *Handle = (EFI_HANDLE)HostHandle;
+
+  InternalNotifyProtocol (Protocol);
+
+  return EFI_SUCCESS;
+}
+
+// InternalUninstallProtocolInterface
+STATIC
+EFI_STATUS
+EFIAPI
+InternalUninstallProtocolInterface (
+  IN EFI_HANDLE  Handle,
+  IN EFI_GUID    *Protocol,
+  IN VOID        *Interface
+  )
+{
+  HOST_HANDLE             *HostHandle;
+  HOST_PROTOCOL_INTERFACE *HostInterface;
+
+  if ((Handle == NULL) || (Protocol == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  HostHandle = InternalGetHandle (Handle);
+
+  if (HostHandle == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  HostInterface = InternalFindProtocol (HostHandle, Protocol);
+
+  if ((HostInterface == NULL) || (HostInterface->Interface != Interface)) {
+    return EFI_NOT_FOUND;
+  }
+
+  RemoveEntryList (&HostInterface->Link);
+  FreePool ((VOID *)HostInterface);
+
+  if (IsListEmpty (&HostHandle->Protocols)) {
+    RemoveEntryList (&HostHandle->Link);
+
+    if (HostHandle != &mImageHandle) {
+      FreePool ((VOID *)HostHandle);
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+// InternalReinstallProtocolInterface
+STATIC
+EFI_STATUS
+EFIAPI
+InternalReinstallProtocolInterface (
+  IN EFI_HANDLE  Handle,
+  IN EFI_GUID    *Protocol,
+  IN VOID        *OldInterface,
+  IN VOID        *NewInterface
+  )
+{
+  HOST_HANDLE             *HostHandle;
+  HOST_PROTOCOL_INTERFACE *HostInterface;
+
+  if ((Handle == NULL) || (Protocol == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  HostHandle = InternalGetHandle (Handle);
+
+  if (HostHandle == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  HostInterface = InternalFindProtocol (HostHandle, Protocol);
+
+  if ((HostInterface == NULL) || (HostInterface->Interface != OldInterface)) {
+    return EFI_NOT_FOUND;
+  }
+
+  HostInterface->Interface = NewInterface;
+  HostInterface->Key       = ++mInterfaceKey;
+
+  InternalNotifyProtocol (Protocol);
+
+  return EFI_SUCCESS;
+}
+
+// InternalOpenProtocol
+/** Returns the interface of a protocol of a handle.  The agents opening a
+    protocol are not tracked, hence no attribute is enforced.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalOpenProtocol (
+  IN  EFI_HANDLE  Handle,
+  IN  EFI_GUID    *Protocol,
+  OUT VOID        **Interface, OPTIONAL
+  IN  EFI_HANDLE  AgentHandle,
+  IN  EFI_HANDLE  ControllerHandle,
+  IN  UINT32      Attributes
+  )
+{
+  HOST_HANDLE             *HostHandle;
+  HOST_PROTOCOL_INTERFACE *HostInterface;
+
+  if ((Protocol == NULL)
+   || ((Interface == NULL)
+    && (Attributes != EFI_OPEN_PROTOCOL_TEST_PROTOCOL))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  HostHandle = InternalGetHandle (Handle);
+
+  if (HostHandle == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  HostInterface = InternalFindProtocol (HostHandle, Protocol);
+
+  if (HostInterface == NULL) {
+    if (Interface != NULL) {
+      *Interface = NULL;
+    }
+
+    return EFI_UNSUPPORTED;
+  }
+
+  if ((Interface != NULL)
+   && (Attributes != EFI_OPEN_PROTOCOL_TEST_PROTOCOL)) {
+    *Interface = HostInterface->Interface;
+  }
+
+  return EFI_SUCCESS;
+}
+
+// InternalCloseProtocol
+STATIC
+EFI_STATUS
+EFIAPI
+InternalCloseProtocol (
+  IN EFI_HANDLE  Handle,
+  IN EFI_GUID    *Protocol,
+  IN EFI_HANDLE  AgentHandle,
+  IN EFI_HANDLE  ControllerHandle
+  )
+{
+  HOST_HANDLE *HostHandle;
+
+  HostHandle = InternalGetHandle (Handle);
+
+  if ((HostHandle == NULL) || (Protocol == NULL) || (AgentHandle == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (InternalFindProtocol (HostHandle, Protocol) == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  return EFI_SUCCESS;
+}
+
+// InternalOpenProtocolInformation
+/** Returns no entries, as the agents opening a protocol are not tracked.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalOpenProtocolInformation (
+  IN  EFI_HANDLE                           Handle,
+  IN  EFI_GUID                             *Protocol,
+  OUT EFI_OPEN_PROTOCOL_INFORMATION_ENTRY  **EntryBuffer,
+  OUT UINTN                                *EntryCount
+  )
+{
+  HOST_HANDLE *HostHandle;
+
+  HostHandle = InternalGetHandle (Handle);
+
+  if ((HostHandle == NULL)
+   || (Protocol == NULL)
+   || (InternalFindProtocol (HostHandle, Protocol) == NULL)) {
+    return EFI_NOT_FOUND;
+  }
+
+  // Allocate one entry so the caller can free the buffer.
+  *EntryBuffer = AllocateZeroPool (sizeof (**EntryBuffer));
+
+  if (*EntryBuffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *EntryCount = 0;
+
+  return EFI_SUCCESS;
+}
+
+// InternalHandleProtocol
+STATIC
+EFI_STATUS
+EFIAPI
+InternalHandleProtocol (
+  IN  EFI_HANDLE  Handle,
+  IN  EFI_GUID    *Protocol,
+  OUT VOID        **Interface
+  )
+{
+  return InternalOpenProtocol (
+           Handle,
+           Protocol,
+           Interface,
+           (EFI_HANDLE)&mImageHandle,
+           NULL,
+           EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL
+           );
+}
+
+// InternalProtocolsPerHandle
+STATIC
+EFI_STATUS
+EFIAPI
+InternalProtocolsPerHandle (
+  IN  EFI_HANDLE  Handle,
+  OUT EFI_GUID    ***ProtocolBuffer,
+  OUT UINTN       *ProtocolBufferCount
+  )
+{
+  HOST_HANDLE *HostHandle;
+  LIST_ENTRY  *Link;
+  UINTN       Count;
+
+  HostHandle = InternalGetHandle (Handle);
+
+  if ((HostHandle == NULL)
+   || (ProtocolBuffer == NULL)
+   || (ProtocolBufferCount == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Count = 0;
+
+  for (
+    Link = GetFirstNode (&HostHandle->Protocols);
+    !IsNull (&HostHandle->Protocols, Link);
+    Link = GetNextNode (&HostHandle->Protocols, Link)
+    ) {
+    ++Count;
+  }
+
+  *ProtocolBuffer = AllocatePool (MAX (Count, 1) * sizeof (**ProtocolBuffer));
+
+  if (*ProtocolBuffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Count = 0;
+
+  for (
+    Link = GetFirstNode (&HostHandle->Protocols);
+    !IsNull (&HostHandle->Protocols, Link);
+    Link = GetNextNode (&HostHandle->Protocols, Link)
+    ) {
+    (*ProtocolBuffer)[Count] = &PROTOCOL_FROM_LINK (Link)->Protocol;
+    ++Count;
+  }
+
+  *ProtocolBufferCount = Count;
+
+  return EFI_SUCCESS;
+}
+
+// InternalRegisterProtocolNotify
+STATIC
+EFI_STATUS
+EFIAPI
+InternalRegisterProtocolNotify (
+  IN  EFI_GUID   *Protocol,
+  IN  EFI_EVENT  Event,
+  OUT VOID       **Registration
+  )
+{
+  HOST_PROTOCOL_NOTIFY *Notify;
+  HOST_EVENT           *HostEvent;
+
+  HostEvent = InternalGetEvent (Event);
+
+  if ((Protocol == NULL) || (HostEvent == NULL) || (Registration == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Notify = AllocatePool (sizeof (*Notify));
+
+  if (Notify == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  CopyGuid (&Notify->Protocol, Protocol);
+
+  // Only interfaces installed after the registration are reported.
+  Notify->Signature = HOST_NOTIFY_SIGNATURE;
+  Notify->Event     = HostEvent;
+  Notify->Key       = mInterfaceKey;
+
+  InsertTailList (&mProtocolNotifies, &Notify->Link);
+
+  *Registration = (VOID *)Notify;
+
+  return EFI_SUCCESS;
+}
+
+// InternalGetNotify
+STATIC
+HOST_PROTOCOL_NOTIFY *
+InternalGetNotify (
+  IN VOID  *Registration
+  )
+{
+  HOST_PROTOCOL_NOTIFY *Notify;
+  LIST_ENTRY           *Link;
+
+  for (
+    Link = GetFirstNode (&mProtocolNotifies);
+    !IsNull (&mProtocolNotifies, Link);
+    Link = GetNextNode (&mProtocolNotifies, Link)
+    ) {
+    Notify = NOTIFY_FROM_LINK (Link);
+
+    if ((VOID *)Notify == Registration) {
+      ASSERT (Notify->Signature == HOST_NOTIFY_SIGNATURE);
+      return Notify;
+    }
+  }
+
+  return NULL;
+}
+
+// InternalGetNextNotifiedInterface
+/** Returns the interface installed first after the last one returned for a
+    registration, and the handle it is installed on.
+**/
+STATIC
+HOST_PROTOCOL_INTERFACE *
+InternalGetNextNotifiedInterface (
+  IN  CONST HOST_PROTOCOL_NOTIFY  *Notify,
+  OUT HOST_HANDLE                 **Handle
+  )
+{
+  HOST_PROTOCOL_INTERFACE *Next;
+  HOST_PROTOCOL_INTERFACE *Interface;
+  HOST_HANDLE             *HostHandle;
+  LIST_ENTRY              *Link;
+
+  Next = NULL;
+
+  for (
+    Link = GetFirstNode (&mHandles);
+    !IsNull (&mHandles, Link);
+    Link = GetNextNode (&mHandles, Link)
+    ) {
+    HostHandle = HANDLE_FROM_LINK (Link);
+    Interface  = InternalFindProtocol (HostHandle, &Notify->Protocol);
+
+    if ((Interface != NULL)
+     && (Interface->Key > Notify->Key)
+     && ((Next == NULL) || (Interface->Key < Next->Key))) {
+      Next    = Interface;
+      *Handle = HostHandle;
+    }
+  }
+
+  return Next;
+}
+
+// InternalLocateHandle
+STATIC
+EFI_STATUS
+EFIAPI
+InternalLocateHandle (
+  IN     EFI_LOCATE_SEARCH_TYPE  SearchType,
+  IN     EFI_GUID                *Protocol, OPTIONAL
+  IN     VOID                    *SearchKey, OPTIONAL
+  IN OUT UINTN                   *BufferSize,
+  OUT    EFI_HANDLE              *Buffer
+  )
+{
+  HOST_PROTOCOL_NOTIFY    *Notify;
+  HOST_PROTOCOL_INTERFACE *Interface;
+  HOST_HANDLE             *HostHandle;
+  LIST_ENTRY              *Link;
+  UINTN                   Count;
+
+  if ((BufferSize == NULL) || ((*BufferSize > 0) && (Buffer == NULL))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  switch (SearchType) {
+    case AllHandles:
+    case ByProtocol:
+    {
+      if ((SearchType == ByProtocol) && (Protocol == NULL)) {
+        return EFI_INVALID_PARAMETER;
+      }
+
+      Count = 0;
+
+      for (
+        Link = GetFirstNode (&mHandles);
+        !IsNull (&mHandles, Link);
+        Link = GetNextNode (&mHandles, Link)
+        ) {
+        HostHandle = HANDLE_FROM_LINK (Link);
+
+        if ((SearchType == ByProtocol)
+         && (InternalFindProtocol (HostHandle, Protocol) == NULL)) {
+          continue;
+        }
+
+        if (((Count + 1) * sizeof (*Buffer)) <= *BufferSize) {
+          Buffer[Count] = (EFI_HANDLE)HostHandle;
+        }
+
+        ++Count;
+      }
+
+      break;
+    }
+
+    case ByRegisterNotify:
+    {
+      Notify = InternalGetNotify (SearchKey);
+
+      if (Notify == NULL) {
+        return EFI_INVALID_PARAMETER;
+      }
+
+      // One handle is returned per call.
+
+      Count     = 0;
+      Interface = InternalGetNextNotifiedInterface (Notify, &HostHandle);
+
+      if (Interface != NULL) {
+        Count = 1;
+
+        if (*BufferSize >= sizeof (*Buffer)) {
+          Buffer[0]   = (EFI_HANDLE)HostHandle;
+          Notify->Key = Interface->Key;
+        }
+      }
+
+      break;
+    }
+
+    default:
+    {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  if (Count == 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  if ((Count * sizeof (*Buffer)) > *BufferSize) {
+    *BufferSize = (Count * sizeof (*Buffer));
+
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  *BufferSize = (Count * sizeof (*Buffer));
+
+  return EFI_SUCCESS;
+}
+
+// InternalLocateHandleBuffer
+STATIC
+EFI_STATUS
+EFIAPI
+InternalLocateHandleBuffer (
+  IN  EFI_LOCATE_SEARCH_TYPE  SearchType,
+  IN  EFI_GUID                *Protocol, OPTIONAL
+  IN  VOID                    *SearchKey, OPTIONAL
+  OUT UINTN                   *NoHandles,
+  OUT EFI_HANDLE              **Buffer
+  )
+{
+  EFI_STATUS Status;
+
+  UINTN      BufferSize;
+
+  if ((NoHandles == NULL) || (Buffer == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *NoHandles = 0;
+  *Buffer    = NULL;
+  BufferSize = 0;
+  Status     = InternalLocateHandle (
+                 SearchType,
+                 Protocol,
+                 SearchKey,
+                 &BufferSize,
+                 NULL
+                 );
+
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    return Status;
+  }
+
+  *Buffer = AllocatePool (BufferSize);
+
+  if (*Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = InternalLocateHandle (
+             SearchType,
+             Protocol,
+             SearchKey,
+             &BufferSize,
+             *Buffer
+             );
+
+  ASSERT_EFI_ERROR (Status);
+
+  *NoHandles = (BufferSize / sizeof (**Buffer));
+
+  return Status;
+}
+
+// InternalLocateProtocol
+STATIC
+EFI_STATUS
+EFIAPI
+InternalLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration, OPTIONAL
+  OUT VOID      **Interface
+  )
+{
+  HOST_PROTOCOL_NOTIFY    *Notify;
+  HOST_PROTOCOL_INTERFACE *HostInterface;
+  HOST_HANDLE             *HostHandle;
+  LIST_ENTRY              *Link;
+
+  if ((Protocol == NULL) || (Interface == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *Interface = NULL;
+
+  if (Registration != NULL) {
+    Notify = InternalGetNotify (Registration);
+
+    if (Notify == NULL) {
+      return EFI_NOT_FOUND;
+    }
+
+    HostInterface = InternalGetNextNotifiedInterface (Notify, &HostHandle);
+
+    if (HostInterface == NULL) {
+      return EFI_NOT_FOUND;
+    }
+
+    Notify->Key = HostInterface->Key;
+    *Interface  = HostInterface->Interface;
+
+    return EFI_SUCCESS;
+  }
+
+  for (
+    Link = GetFirstNode (&mHandles);
+    !IsNull (&mHandles, Link);
+    Link = GetNextNode (&mHandles, Link)
+    ) {
+    HostInterface = InternalFindProtocol (HANDLE_FROM_LINK (Link), Protocol);
+
+    if (HostInterface != NULL) {
+      *Interface = HostInterface->Interface;
+      return EFI_SUCCESS;
+    }
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+// InternalLocateDevicePath
+/** Device paths are not resolved, hence no handle is found.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalLocateDevicePath (
+  IN     EFI_GUID                  *Protocol,
+  IN OUT EFI_DEVICE_PATH_PROTOCOL  **DevicePath,
+  OUT    EFI_HANDLE                *Device
+  )
+{
+  if ((Protocol == NULL) || (DevicePath == NULL) || (*DevicePath == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+// InternalInstallMultipleProtocolInterfaces
+STATIC
+EFI_STATUS
+EFIAPI
+InternalInstallMultipleProtocolInterfaces (
+  IN OUT EFI_HANDLE  *Handle,
+  ...
+  )
+{
+  EFI_STATUS Status;
+
+  VA_LIST    Args;
+  EFI_HANDLE OldHandle;
+  EFI_GUID   *Protocol;
+  VOID       *Interface;
+  UINTN      Index;
+  UINTN      NumberOfInstalled;
+
+  if (Handle == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OldHandle         = *Handle;
+  NumberOfInstalled = 0;
+  Status            = EFI_SUCCESS;
+
+  VA_START (Args, Handle);
+
+  for (
+    Protocol = VA_ARG (Args, EFI_GUID *);
+    Protocol != NULL;
+    Protocol = VA_ARG (Args, EFI_GUID *)
+    ) {
+    Interface = VA_ARG (Args, VOID *);
+    Status    = InternalInstallProtocolInterface (
+                  Handle,
+                  Protocol,
+                  EFI_NATIVE_INTERFACE,
+                  Interface
+                  );
+
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    ++NumberOfInstalled;
+  }
+
+  VA_END (Args);
+
+  if (EFI_ERROR (Status)) {
+    // Roll back the interfaces installed by this call.
+
+    VA_START (Args, Handle);
+
+    for (Index = 0; Index < NumberOfInstalled; ++Index) {
+      Protocol  = VA_ARG (Args, EFI_GUID *);
+      Interface = VA_ARG (Args, VOID *);
+
+      InternalUninstallProtocolInterface (*Handle, Protocol, Interface);
+    }
+
+    VA_END (Args);
+
+    *Handle = OldHandle;
+  }
+
+  return Status;
+}
+
+// InternalUninstallMultipleProtocolInterfaces
+STATIC
+EFI_STATUS
+EFIAPI
+InternalUninstallMultipleProtocolInterfaces (
+  IN EFI_HANDLE  Handle,
+  ...
+  )
+{
+  EFI_STATUS Status;
+
+  VA_LIST    Args;
+  EFI_GUID   *Protocol;
+  VOID       *Interface;
+  UINTN      Index;
+  UINTN      NumberOfUninstalled;
+
+  NumberOfUninstalled = 0;
+  Status              = EFI_SUCCESS;
+
+  VA_START (Args, Handle);
+
+  for (
+    Protocol = VA_ARG (Args, EFI_GUID *);
+    Protocol != NULL;
+    Protocol = VA_ARG (Args, EFI_GUID *)
+    ) {
+    Interface = VA_ARG (Args, VOID *);
+    Status    = InternalUninstallProtocolInterface (
+                  Handle,
+                  Protocol,
+                  Interface
+                  );
+
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    ++NumberOfUninstalled;
+  }
+
+  VA_END (Args);
+
+  if (EFI_ERROR (Status)) {
+    // Reinstall the interfaces uninstalled by this call.  The handle may
+    // have been freed along with its last protocol, hence a new one is
+    // created in that case.
+
+    VA_START (Args, Handle);
+
+    for (Index = 0; Index < NumberOfUninstalled; ++Index) {
+      Protocol  = VA_ARG (Args, EFI_GUID *);
+      Interface = VA_ARG (Args, VOID *);
+
+      if (InternalGetHandle (Handle) == NULL) {
+        Handle = NULL;
+      }
+
+      InternalInstallProtocolInterface (
+        &Handle,
+        Protocol,
+        EFI_NATIVE_INTERFACE,
+        Interface
+        );
+    }
+
+    VA_END (Args);
+
+    Status = EFI_INVALID_PARAMETER;
+  }
+
+  return Status;
+}
+
+// Image Services
+
+// InternalLoadImage
+STATIC
+EFI_STATUS
+EFIAPI
+InternalLoadImage (
+  IN  BOOLEAN                   BootPolicy,
+  IN  EFI_HANDLE                ParentImageHandle,
+  IN  EFI_DEVICE_PATH_PROTOCOL  *DevicePath,
+  IN  VOID                      *SourceBuffer, OPTIONAL
+  IN  UINTN                     SourceSize,
+  OUT EFI_HANDLE                *ImageHandle
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+// InternalStartImage
+STATIC
+EFI_STATUS
+EFIAPI
+InternalStartImage (
+  IN  EFI_HANDLE  ImageHandle,
+  OUT UINTN       *ExitDataSize,
+  OUT CHAR16      **ExitData OPTIONAL
+  )
+{
+  return EFI_INVALID_PARAMETER;
+}
+
+// InternalExit
+STATIC
+EFI_STATUS
+EFIAPI
+InternalExit (
+  IN EFI_HANDLE  ImageHandle,
+  IN EFI_STATUS  ExitStatus,
+  IN UINTN       ExitDataSize,
+  IN CHAR16      *ExitData OPTIONAL
+  )
+{
+  return EFI_INVALID_PARAMETER;
+}
+
+// InternalUnloadImage
+STATIC
+EFI_STATUS
+EFIAPI
+InternalUnloadImage (
+  IN EFI_HANDLE  ImageHandle
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+// InternalExitBootServices
+/** Signals the EVT_SIGNAL_EXIT_BOOT_SERVICES events.  The boot services stay
+    usable, so the callers can be tested afterwards.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalExitBootServices (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       MapKey
+  )
+{
+  EFI_TPL OldTpl;
+
+  if (MapKey != mMapKey) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OldTpl = InternalRaiseTpl (TPL_HIGH_LEVEL);
+
+  InternalSignalEventGroup (&gEfiEventExitBootServicesGuid);
+  InternalRestoreTpl (OldTpl);
+
+  return EFI_SUCCESS;
+}
+
+// Miscellaneous Services
+
+// InternalGetNextMonotonicCount
+STATIC
+EFI_STATUS
+EFIAPI
+InternalGetNextMonotonicCount (
+  OUT UINT64  *Count
+  )
+{
+  if (Count == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *Count = mMonotonicCount++;
+
+  return EFI_SUCCESS;
+}
+
+// InternalStall
+/** Advances the virtual time instead of waiting.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalStall (
+  IN UINTN  Microseconds
+  )
+{
+  InternalAdvanceTime (MultU64x32 (Microseconds, 10));
+
+  return EFI_SUCCESS;
+}
+
+// InternalSetWatchdogTimer
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSetWatchdogTimer (
+  IN UINTN   Timeout,
+  IN UINT64  WatchdogCode,
+  IN UINTN   DataSize,
+  IN CHAR16  *WatchdogData OPTIONAL
+  )
+{
+  return EFI_SUCCESS;
+}
+
+// InternalInstallConfigurationTable
+STATIC
+EFI_STATUS
+EFIAPI
+InternalInstallConfigurationTable (
+  IN EFI_GUID  *Guid,
+  IN VOID      *Table
+  )
+{
+  EFI_CONFIGURATION_TABLE *Tables;
+  UINTN                   NumberOfTables;
+  UINTN                   Index;
+  EFI_TPL                 OldTpl;
+
+  if (Guid == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Tables         = gST->ConfigurationTable;
+  NumberOfTables = gST->NumberOfTableEntries;
+
+  for (Index = 0; Index < NumberOfTables; ++Index) {
+    if (CompareGuid (&Tables[Index].VendorGuid, Guid)) {
+      break;
+    }
+  }
+
+  if (Index < NumberOfTables) {
+    if (Table != NULL) {
+      Tables[Index].VendorTable = Table;
+    } else {
+      --NumberOfTables;
+
+      CopyMem (
+        (VOID *)&Tables[Index],
+        (VOID *)&Tables[Index + 1],
+        ((NumberOfTables - Index) * sizeof (*Tables))
+        );
+    }
+  } else {
+    if (Table == NULL) {
+      return EFI_NOT_FOUND;
+    }
+
+    Tables = ReallocatePool (
+               (NumberOfTables * sizeof (*Tables)),
+               ((NumberOfTables + 1) * sizeof (*Tables)),
+               (VOID *)Tables
+               );
+
+    if (Tables == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    CopyGuid (&Tables[NumberOfTables].VendorGuid, Guid);
+
+    Tables[NumberOfTables].VendorTable = Table;
+
+    ++NumberOfTables;
+  }
+
+  gST->ConfigurationTable   = Tables;
+  gST->NumberOfTableEntries = NumberOfTables;
+
+  OldTpl = InternalRaiseTpl (TPL_HIGH_LEVEL);
+
+  InternalSignalEventGroup (Guid);
+  InternalRestoreTpl (OldTpl);
+
+  return EFI_SUCCESS;
+}
+
+// InternalCalculateCrc32
+STATIC
+EFI_STATUS
+EFIAPI
+InternalCalculateCrc32 (
+  IN  VOID    *Data,
+  IN  UINTN   DataSize,
+  OUT UINT32  *Crc32
+  )
+{
+  UINT32 Crc;
+  UINTN  Index;
+  UINTN  Bit;
+
+  if ((Data == NULL) || (DataSize == 0) || (Crc32 == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Crc = MAX_UINT32;
+
+  for (Index = 0; Index < DataSize; ++Index) {
+    Crc ^= ((UINT8 *)Data)[Index];
+
+    for (Bit = 0; Bit < 8; ++Bit) {
+      Crc = ((Crc >> 1) ^ (((Crc & BIT0) != 0) ? 0xEDB88320U : 0));
+    }
+  }
+
+  *Crc32 = ~Crc;
+
+  return EFI_SUCCESS;
+}
+
+// InternalCopyMem
+STATIC
+VOID
+EFIAPI
+InternalCopyMem (
+  IN VOID   *Destination,
+  IN VOID   *Source,
+  IN UINTN  Length
+  )
+{
+  CopyMem (Destination, Source, Length);
+}
+
+// InternalSetMem
+STATIC
+VOID
+EFIAPI
+InternalSetMem (
+  IN VOID   *Buffer,
+  IN UINTN  Size,
+  IN UINT8  Value
+  )
+{
+  SetMem (Buffer, Size, Value);
+}
+
+// Driver Support Services
+
+// InternalConnectController
+/** No driver is ever present to connect.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalConnectController (
+  IN EFI_HANDLE                ControllerHandle,
+  IN EFI_HANDLE                *DriverImageHandle, OPTIONAL
+  IN EFI_DEVICE_PATH_PROTOCOL  *RemainingDevicePath, OPTIONAL
+  IN BOOLEAN                   Recursive
+  )
+{
+  if (InternalGetHandle (ControllerHandle) == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+// InternalDisconnectController
+STATIC
+EFI_STATUS
+EFIAPI
+InternalDisconnectController (
+  IN EFI_HANDLE  ControllerHandle,
+  IN EFI_HANDLE  DriverImageHandle, OPTIONAL
+  IN EFI_HANDLE  ChildHandle OPTIONAL
+  )
+{
+  if (InternalGetHandle (ControllerHandle) == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return EFI_SUCCESS;
+}
+
+// mHostBootServices
+STATIC EFI_BOOT_SERVICES mHostBootServices = {
+  {
+    EFI_BOOT_SERVICES_SIGNATURE,
+    EFI_BOOT_SERVICES_REVISION,
+    sizeof (EFI_BOOT_SERVICES),
+    0,
+    0
+  },
+  InternalRaiseTpl,
+  InternalRestoreTpl,
+  InternalAllocatePages,
+  InternalFreePages,
+  InternalGetMemoryMap,
+  InternalAllocatePool,
+  InternalFreePool,
+  InternalCreateEvent,
+  InternalSetTimer,
+  InternalWaitForEvent,
+  InternalSignalEvent,
+  InternalCloseEvent,
+  InternalCheckEvent,
+  InternalInstallProtocolInterface,
+  InternalReinstallProtocolInterface,
+  InternalUninstallProtocolInterface,
+  InternalHandleProtocol,
+  NULL,
+  InternalRegisterProtocolNotify,
+  InternalLocateHandle,
+  InternalLocateDevicePath,
+  InternalInstallConfigurationTable,
+  InternalLoadImage,
+  InternalStartImage,
+  InternalExit,
+  InternalUnloadImage,
+  InternalExitBootServices,
+  InternalGetNextMonotonicCount,
+  InternalStall,
+  InternalSetWatchdogTimer,
+  InternalConnectController,
+  InternalDisconnectController,
+  InternalOpenProtocol,
+  InternalCloseProtocol,
+  InternalOpenProtocolInformation,
+  InternalProtocolsPerHandle,
+  InternalLocateHandleBuffer,
+  InternalLocateProtocol,
+  InternalInstallMultipleProtocolInterfaces,
+  InternalUninstallMultipleProtocolInterfaces,
+  InternalCalculateCrc32,
+  InternalCopyMem,
+  InternalSetMem,
+  InternalCreateEventEx
+};
+
+// mHostSystemTable
+/// The runtime services are provided separately by the host instance of
+/// EfiRuntimeServicesLib, hence RuntimeServices is NULL.
+STATIC EFI_SYSTEM_TABLE mHostSystemTable = {
+  {
+    EFI_SYSTEM_TABLE_SIGNATURE,
+    EFI_SYSTEM_TABLE_REVISION,
+    sizeof (EFI_SYSTEM_TABLE),
+    0,
+    0
+  },
+  NULL,
+  0,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  &mHostBootServices,
+  0,
+  NULL
+};
+
+// gImageHandle
+EFI_HANDLE gImageHandle = (EFI_HANDLE)&mImageHandle;
+
+// gST
+EFI_SYSTEM_TABLE *gST = &mHostSystemTable;
+
+// gBS
+EFI_BOOT_SERVICES *gBS = &mHostBootServices;
+
+// EfiGetCurrentTpl
+/** Returns the current TPL.
+
+  UefiLib does not support host applications, hence the only function of it
+  the seam libraries use is provided here.
+
+  @return  The current TPL.
+**/
+EFI_TPL
+EFIAPI
+EfiGetCurrentTpl (
+  VOID
+  )
+{
+  return mCurrentTpl;
+}
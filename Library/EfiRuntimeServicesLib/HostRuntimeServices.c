@@ -0,0 +1,621 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+// HOST_VARIABLE_STORAGE_SIZE
+/// The size, in bytes, of the emulated variable storage.
+#define HOST_VARIABLE_STORAGE_SIZE  SIZE_64KB
+
+// HOST_MAX_VARIABLE_SIZE
+/// The maximum size, in bytes, of the name and the data of a variable.
+#define HOST_MAX_VARIABLE_SIZE  SIZE_32KB
+
+// HOST_VARIABLE_ATTRIBUTES
+/// The attributes a variable can be stored with.
+#define HOST_VARIABLE_ATTRIBUTES  (EFI_VARIABLE_NON_VOLATILE         \
+                                    | EFI_VARIABLE_BOOTSERVICE_ACCESS \
+                                    | EFI_VARIABLE_RUNTIME_ACCESS     \
+                                    | EFI_VARIABLE_HARDWARE_ERROR_RECORD)
+
+// HOST_VARIABLE
+typedef struct {
+  LIST_ENTRY Link;        ///< Links the variables in creation order.
+  EFI_GUID   VendorGuid;  ///< The vendor GUID of the variable.
+  UINT32     Attributes;  ///< The attributes of the variable.
+  CHAR16     *Name;       ///< The name of the variable.
+  UINTN      NameSize;    ///< The size, in bytes, of Name.
+  VOID       *Data;       ///< The data of the variable.
+  UINTN      DataSize;    ///< The size, in bytes, of Data.
+} HOST_VARIABLE;
+
+// VARIABLE_FROM_LINK
+#define VARIABLE_FROM_LINK(Entry)  BASE_CR ((Entry), HOST_VARIABLE, Link)
+
+// mVariables
+STATIC LIST_ENTRY mVariables = INITIALIZE_LIST_HEAD_VARIABLE (mVariables);
+
+// mVariableStorageUsed
+/// The size, in bytes, of the names and data of all variables.
+STATIC UINTN mVariableStorageUsed = 0;
+
+// mTime
+/// The time reported, which does not advance.
+STATIC EFI_TIME mTime = {
+  2016, 1, 1, 0, 0, 0, 0, 0, EFI_UNSPECIFIED_TIMEZONE, 0, 0
+};
+
+// mWakeupTime
+STATIC EFI_TIME mWakeupTime;
+
+// mWakeupEnabled
+STATIC BOOLEAN mWakeupEnabled = FALSE;
+
+// mHighMonotonicCount
+STATIC UINT32 mHighMonotonicCount = 0;
+
+// Time Services
+
+// InternalIsTimeValid
+STATIC
+BOOLEAN
+InternalIsTimeValid (
+  IN CONST EFI_TIME  *Time
+  )
+{
+  return (BOOLEAN)((Time->Year >= 1900) && (Time->Year <= 9999)
+                && (Time->Month >= 1) && (Time->Month <= 12)
+                && (Time->Day >= 1) && (Time->Day <= 31)
+                && (Time->Hour <= 23)
+                && (Time->Minute <= 59)
+                && (Time->Second <= 59)
+                && (Time->Nanosecond <= 999999999)
+                && ((Time->TimeZone == EFI_UNSPECIFIED_TIMEZONE)
+                 || ((Time->TimeZone >= -1440) && (Time->TimeZone <= 1440))));
+}
+
+// InternalGetTime
+STATIC
+EFI_STATUS
+EFIAPI
+InternalGetTime (
+  OUT EFI_TIME               *Time,
+  OUT EFI_TIME_CAPABILITIES  *Capabilities OPTIONAL
+  )
+{
+  if (Time == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CopyMem ((VOID *)Time, (VOID *)&mTime, sizeof (*Time));
+
+  if (Capabilities != NULL) {
+    Capabilities->Resolution = 1;
+    Capabilities->Accuracy   = 0;
+    Capabilities->SetsToZero = FALSE;
+  }
+
+  return EFI_SUCCESS;
+}
+
+// InternalSetTime
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSetTime (
+  IN EFI_TIME  *Time
+  )
+{
+  if ((Time == NULL) || !InternalIsTimeValid (Time)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CopyMem ((VOID *)&mTime, (VOID *)Time, sizeof (mTime));
+
+  return EFI_SUCCESS;
+}
+
+// InternalGetWakeupTime
+STATIC
+EFI_STATUS
+EFIAPI
+InternalGetWakeupTime (
+  OUT BOOLEAN   *Enabled,
+  OUT BOOLEAN   *Pending,
+  OUT EFI_TIME  *Time
+  )
+{
+  if ((Enabled == NULL) || (Pending == NULL) || (Time == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CopyMem ((VOID *)Time, (VOID *)&mWakeupTime, sizeof (*Time));
+
+  *Enabled = mWakeupEnabled;
+  *Pending = FALSE;
+
+  return EFI_SUCCESS;
+}
+
+// InternalSetWakeupTime
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSetWakeupTime (
+  IN BOOLEAN   Enable,
+  IN EFI_TIME  *Time OPTIONAL
+  )
+{
+  if (Enable) {
+    if ((Time == NULL) || !InternalIsTimeValid (Time)) {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    CopyMem ((VOID *)&mWakeupTime, (VOID *)Time, sizeof (mWakeupTime));
+  }
+
+  mWakeupEnabled = Enable;
+
+  return EFI_SUCCESS;
+}
+
+// Virtual Memory Services
+
+// InternalSetVirtualAddressMap
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSetVirtualAddressMap (
+  IN UINTN                  MemoryMapSize,
+  IN UINTN                  DescriptorSize,
+  IN UINT32                 DescriptorVersion,
+  IN EFI_MEMORY_DESCRIPTOR  *VirtualMap
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+// InternalConvertPointer
+/** Leaves the pointer unchanged, as the virtual address map is never set.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalConvertPointer (
+  IN     UINTN  DebugDisposition,
+  IN OUT VOID   **Address
+  )
+{
+  if (Address == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return EFI_SUCCESS;
+}
+
+// Variable Services
+
+// InternalFindVariable
+STATIC
+HOST_VARIABLE *
+InternalFindVariable (
+  IN CONST CHAR16    *VariableName,
+  IN CONST EFI_GUID  *VendorGuid
+  )
+{
+  HOST_VARIABLE *Variable;
+  LIST_ENTRY    *Link;
+
+  for (
+    Link = GetFirstNode (&mVariables);
+    !IsNull (&mVariables, Link);
+    Link = GetNextNode (&mVariables, Link)
+    ) {
+    Variable = VARIABLE_FROM_LINK (Link);
+
+    if (CompareGuid (&Variable->VendorGuid, VendorGuid)
+     && (StrCmp (Variable->Name, VariableName) == 0)) {
+      return Variable;
+    }
+  }
+
+  return NULL;
+}
+
+// InternalDeleteVariable
+STATIC
+VOID
+InternalDeleteVariable (
+  IN HOST_VARIABLE  *Variable
+  )
+{
+  mVariableStorageUsed -= (Variable->NameSize + Variable->DataSize);
+
+  RemoveEntryList (&Variable->Link);
+
+  if (Variable->Data != NULL) {
+    FreePool (Variable->Data);
+  }
+
+  FreePool ((VOID *)Variable->Name);
+  FreePool ((VOID *)Variable);
+}
+
+// InternalGetVariable
+STATIC
+EFI_STATUS
+EFIAPI
+InternalGetVariable (
+  IN     CHAR16    *VariableName,
+  IN     EFI_GUID  *VendorGuid,
+  OUT    UINT32    *Attributes, OPTIONAL
+  IN OUT UINTN     *DataSize,
+  OUT    VOID      *Data OPTIONAL
+  )
+{
+  HOST_VARIABLE *Variable;
+
+  if ((VariableName == NULL) || (VendorGuid == NULL) || (DataSize == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Variable = InternalFindVariable (VariableName, VendorGuid);
+
+  if (Variable == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (*DataSize < Variable->DataSize) {
+    *DataSize = Variable->DataSize;
+
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  if (Data == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CopyMem (Data, Variable->Data, Variable->DataSize);
+
+  *DataSize = Variable->DataSize;
+
+  if (Attributes != NULL) {
+    *Attributes = Variable->Attributes;
+  }
+
+  return EFI_SUCCESS;
+}
+
+// InternalGetNextVariableName
+STATIC
+EFI_STATUS
+EFIAPI
+InternalGetNextVariableName (
+  IN OUT UINTN     *VariableNameSize,
+  IN OUT CHAR16    *VariableName,
+  IN OUT EFI_GUID  *VendorGuid
+  )
+{
+  HOST_VARIABLE *Variable;
+  LIST_ENTRY    *Link;
+
+  if ((VariableNameSize == NULL)
+   || (VariableName == NULL)
+   || (VendorGuid == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (VariableName[0] == L'\0') {
+    Link = GetFirstNode (&mVariables);
+  } else {
+    Variable = InternalFindVariable (VariableName, VendorGuid);
+
+    if (Variable == NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    Link = GetNextNode (&mVariables, &Variable->Link);
+  }
+
+  if (IsNull (&mVariables, Link)) {
+    return EFI_NOT_FOUND;
+  }
+
+  Variable = VARIABLE_FROM_LINK (Link);
+
+  if (*VariableNameSize < Variable->NameSize) {
+    *VariableNameSize = Variable->NameSize;
+
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  CopyMem ((VOID *)VariableName, (VOID *)Variable->Name, Variable->NameSize);
+  CopyGuid (VendorGuid, &Variable->VendorGuid);
+
+  *VariableNameSize = Variable->NameSize;
+
+  return EFI_SUCCESS;
+}
+
+// InternalSetVariable
+/** Sets a variable of the emulated storage.  Variables are kept in memory
+    regardless of EFI_VARIABLE_NON_VOLATILE.  Authenticated variables are not
+    supported.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSetVariable (
+  IN CHAR16    *VariableName,
+  IN EFI_GUID  *VendorGuid,
+  IN UINT32    Attributes,
+  IN UINTN     DataSize,
+  IN VOID      *Data
+  )
+{
+  HOST_VARIABLE *Variable;
+  VOID          *NewData;
+  UINTN         NameSize;
+  UINTN         NewDataSize;
+  UINTN         OldDataSize;
+  BOOLEAN       Append;
+
+  if ((VariableName == NULL)
+   || (VariableName[0] == L'\0')
+   || (VendorGuid == NULL)
+   || ((DataSize > 0) && (Data == NULL))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((Attributes & (EFI_VARIABLE_AUTHENTICATED_WRITE_ACCESS
+                   | EFI_VARIABLE_TIME_BASED_AUTHENTICATED_WRITE_ACCESS))
+       != 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Append      = (BOOLEAN)((Attributes & EFI_VARIABLE_APPEND_WRITE) != 0);
+  Attributes &= ~(UINT32)EFI_VARIABLE_APPEND_WRITE;
+
+  if (((Attributes & ~(UINT32)HOST_VARIABLE_ATTRIBUTES) != 0)
+   || (((Attributes & EFI_VARIABLE_RUNTIME_ACCESS) != 0)
+    && ((Attributes & EFI_VARIABLE_BOOTSERVICE_ACCESS) == 0))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  NameSize = StrSize (VariableName);
+  Variable = InternalFindVariable (VariableName, VendorGuid);
+
+  // Deletion.
+
+  if ((Attributes == 0) || ((DataSize == 0) && !Append)) {
+    if (Variable == NULL) {
+      return EFI_NOT_FOUND;
+    }
+
+    InternalDeleteVariable (Variable);
+
+    return EFI_SUCCESS;
+  }
+
+  if ((Variable != NULL) && (Variable->Attributes != Attributes)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Append && (DataSize == 0)) {
+    return EFI_SUCCESS;
+  }
+
+  OldDataSize = 0;
+  NewDataSize = DataSize;
+
+  if (Variable != NULL) {
+    OldDataSize = Variable->DataSize;
+
+    if (Append) {
+      NewDataSize += OldDataSize;
+    }
+  }
+
+  if ((NameSize + NewDataSize) > HOST_MAX_VARIABLE_SIZE) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (((mVariableStorageUsed - OldDataSize) + NewDataSize
+        + ((Variable == NULL) ? NameSize : 0))
+       > HOST_VARIABLE_STORAGE_SIZE) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NewData = AllocatePool (NewDataSize);
+
+  if (NewData == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Append) {
+    CopyMem (NewData, Variable->Data, OldDataSize);
+    CopyMem ((UINT8 *)NewData + OldDataSize, Data, DataSize);
+  } else {
+    CopyMem (NewData, Data, DataSize);
+  }
+
+  if (Variable == NULL) {
+    Variable = AllocateZeroPool (sizeof (*Variable));
+
+    if (Variable != NULL) {
+      Variable->Name = AllocateCopyPool (NameSize, (VOID *)VariableName);
+
+      if (Variable->Name == NULL) {
+        FreePool ((VOID *)Variable);
+        Variable = NULL;
+      }
+    }
+
+    if (Variable == NULL) {
+      FreePool (NewData);
+
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    CopyGuid (&Variable->VendorGuid, VendorGuid);
+
+    Variable->NameSize   = NameSize;
+    Variable->Attributes = Attributes;
+
+    InsertTailList (&mVariables, &Variable->Link);
+
+    mVariableStorageUsed += NameSize;
+  } else {
+    FreePool (Variable->Data);
+  }
+
+  mVariableStorageUsed -= OldDataSize;
+  mVariableStorageUsed += NewDataSize;
+  Variable->Data        = NewData;
+  Variable->DataSize    = NewDataSize;
+
+  return EFI_SUCCESS;
+}
+
+// InternalQueryVariableInfo
+STATIC
+EFI_STATUS
+EFIAPI
+InternalQueryVariableInfo (
+  IN  UINT32  Attributes,
+  OUT UINT64  *MaximumVariableStorageSize,
+  OUT UINT64  *RemainingVariableStorageSize,
+  OUT UINT64  *MaximumVariableSize
+  )
+{
+  if ((Attributes == 0)
+   || (MaximumVariableStorageSize == NULL)
+   || (RemainingVariableStorageSize == NULL)
+   || (MaximumVariableSize == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *MaximumVariableStorageSize   = HOST_VARIABLE_STORAGE_SIZE;
+  *RemainingVariableStorageSize = (HOST_VARIABLE_STORAGE_SIZE
+                                    - mVariableStorageUsed);
+  *MaximumVariableSize          = HOST_MAX_VARIABLE_SIZE;
+
+  return EFI_SUCCESS;
+}
+
+// Miscellaneous Services
+
+// InternalGetNextHighMonotonicCount
+STATIC
+EFI_STATUS
+EFIAPI
+InternalGetNextHighMonotonicCount (
+  OUT UINT32  *HighCount
+  )
+{
+  if (HighCount == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *HighCount = ++mHighMonotonicCount;
+
+  return EFI_SUCCESS;
+}
+
+// InternalResetSystem
+/** A reset cannot be emulated, hence it asserts, which host tests can expect,
+    and returns.
+**/
+STATIC
+VOID
+EFIAPI
+InternalResetSystem (
+  IN EFI_RESET_TYPE  ResetType,
+  IN EFI_STATUS      ResetStatus,
+  IN UINTN           DataSize,
+  IN VOID            *ResetData OPTIONAL
+  )
+{
+  DEBUG ((
+    DEBUG_ERROR,
+    "ResetSystem: Type %u, Status %r\n",
+    (UINT32)ResetType,
+    ResetStatus
+    ));
+
+  ASSERT (FALSE);
+}
+
+// InternalUpdateCapsule
+STATIC
+EFI_STATUS
+EFIAPI
+InternalUpdateCapsule (
+  IN EFI_CAPSULE_HEADER    **CapsuleHeaderArray,
+  IN UINTN                 CapsuleCount,
+  IN EFI_PHYSICAL_ADDRESS  ScatterGatherList OPTIONAL
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+// InternalQueryCapsuleCapabilities
+STATIC
+EFI_STATUS
+EFIAPI
+InternalQueryCapsuleCapabilities (
+  IN  EFI_CAPSULE_HEADER  **CapsuleHeaderArray,
+  IN  UINTN               CapsuleCount,
+  OUT UINT64              *MaximumCapsuleSize,
+  OUT EFI_RESET_TYPE      *ResetType
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+// mHostRuntimeServices
+STATIC EFI_RUNTIME_SERVICES mHostRuntimeServices = {
+  {
+    EFI_RUNTIME_SERVICES_SIGNATURE,
+    EFI_RUNTIME_SERVICES_REVISION,
+    sizeof (EFI_RUNTIME_SERVICES),
+    0,
+    0
+  },
+  InternalGetTime,
+  InternalSetTime,
+  InternalGetWakeupTime,
+  InternalSetWakeupTime,
+  InternalSetVirtualAddressMap,
+  InternalConvertPointer,
+  InternalGetVariable,
+  InternalGetNextVariableName,
+  InternalSetVariable,
+  InternalGetNextHighMonotonicCount,
+  InternalResetSystem,
+  InternalUpdateCapsule,
+  InternalQueryCapsuleCapabilities,
+  InternalQueryVariableInfo
+};
+
+// gRT
+EFI_RUNTIME_SERVICES *gRT = &mHostRuntimeServices;
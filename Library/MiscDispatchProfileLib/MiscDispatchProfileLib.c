@@ -0,0 +1,570 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiDxe.h>
+
+#include <IndustryStandard/FpdtRecord.h>
+
+#include <Protocol/LoadedImage.h>
+#include <Protocol/Security.h>
+#include <Protocol/Security2.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DxeServicesLib.h>
+#include <Library/EfiBootServicesLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/MiscDispatchProfileLib.h>
+#include <Library/MiscPerformanceLib.h>
+#include <Library/MiscRuntimeLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiLib.h>
+
+// MISC_DISPATCH_PROFILE_GROWTH
+#define MISC_DISPATCH_PROFILE_GROWTH  32
+
+// mRecords
+STATIC MISC_DISPATCH_PROFILE_RECORD *mRecords = NULL;
+
+// mNumberOfRecords
+STATIC UINTN mNumberOfRecords = 0;
+
+// mMaximumRecords
+STATIC UINTN mMaximumRecords = 0;
+
+// mRound
+STATIC UINT32 mRound = 0;
+
+// mProfiling
+STATIC BOOLEAN mProfiling = FALSE;
+
+// mRoundStart
+STATIC UINT64 mRoundStart = 0;
+
+// mLoadStart
+STATIC UINT64 mLoadStart = 0;
+
+// mLoadStartPending
+STATIC BOOLEAN mLoadStartPending = FALSE;
+
+// mCounterStart
+STATIC UINT64 mCounterStart = 0;
+
+// mCounterCountsDown
+STATIC BOOLEAN mCounterCountsDown = FALSE;
+
+// mSecurity
+STATIC EFI_SECURITY_ARCH_PROTOCOL *mSecurity = NULL;
+
+// mSecurityFileAuthenticationState
+STATIC EFI_SECURITY_FILE_AUTHENTICATION_STATE mSecurityFileAuthenticationState = NULL;
+
+// mSecurity2
+STATIC EFI_SECURITY2_ARCH_PROTOCOL *mSecurity2 = NULL;
+
+// mSecurity2FileAuthentication
+STATIC EFI_SECURITY2_FILE_AUTHENTICATION mSecurity2FileAuthentication = NULL;
+
+// mLoadedImageRegistration
+STATIC VOID *mLoadedImageRegistration = NULL;
+
+// InternalGetTimestamp
+STATIC
+UINT64
+InternalGetTimestamp (
+  VOID
+  )
+{
+  UINT64 Counter;
+
+  Counter = GetPerformanceCounter ();
+
+  if (mCounterCountsDown) {
+    Counter = (mCounterStart - Counter);
+  } else {
+    Counter = (Counter - mCounterStart);
+  }
+
+  return GetTimeInNanoSecond (Counter);
+}
+
+// InternalDxeDispatch
+/** Calls DxeDispatch() and records the dispatch round for MiscPerformanceLib.
+**/
+STATIC
+EFI_STATUS
+InternalDxeDispatch (
+  VOID
+  )
+{
+  EFI_STATUS Status;
+
+  MISC_PERFORMANCE_BEGIN (
+    MISC_PERFORMANCE_MODULE_DISPATCH,
+    MISC_PERFORMANCE_ID_DXE_DISPATCH
+    );
+
+  Status = DxeDispatch ();
+
+  MISC_PERFORMANCE_END (
+    MISC_PERFORMANCE_MODULE_DISPATCH,
+    MISC_PERFORMANCE_ID_DXE_DISPATCH
+    );
+
+  return Status;
+}
+
+// InternalEndPreviousEntry
+STATIC
+VOID
+InternalEndPreviousEntry (
+  IN UINT64  Timestamp
+  )
+{
+  MISC_DISPATCH_PROFILE_RECORD *Record;
+
+  if (mNumberOfRecords > 0) {
+    Record = &mRecords[mNumberOfRecords - 1];
+
+    if ((Record->Round == mRound) && (Record->EntryEnd == 0)) {
+      Record->EntryEnd = Timestamp;
+    }
+  }
+}
+
+// InternalMarkLoadStart
+STATIC
+VOID
+InternalMarkLoadStart (
+  VOID
+  )
+{
+  // The core may consult both Security protocols for one image.
+
+  if (!mLoadStartPending) {
+    mLoadStart        = InternalGetTimestamp ();
+    mLoadStartPending = TRUE;
+
+    InternalEndPreviousEntry (mLoadStart);
+  }
+}
+
+// InternalFileAuthenticationState
+STATIC
+EFI_STATUS
+EFIAPI
+InternalFileAuthenticationState (
+  IN CONST EFI_SECURITY_ARCH_PROTOCOL  *This,
+  IN UINT32                            AuthenticationStatus,
+  IN CONST EFI_DEVICE_PATH_PROTOCOL    *File
+  )
+{
+  InternalMarkLoadStart ();
+
+  return mSecurityFileAuthenticationState (This, AuthenticationStatus, File);
+}
+
+// InternalFileAuthentication
+STATIC
+EFI_STATUS
+EFIAPI
+InternalFileAuthentication (
+  IN CONST EFI_SECURITY2_ARCH_PROTOCOL  *This,
+  IN CONST EFI_DEVICE_PATH_PROTOCOL     *File,
+  IN VOID                               *FileBuffer,
+  IN UINTN                              FileSize,
+  IN BOOLEAN                            BootPolicy
+  )
+{
+  InternalMarkLoadStart ();
+
+  return mSecurity2FileAuthentication (
+           This,
+           File,
+           FileBuffer,
+           FileSize,
+           BootPolicy
+           );
+}
+
+// InternalLoadedImageNotify
+STATIC
+VOID
+EFIAPI
+InternalLoadedImageNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  EFI_STATUS                   Status;
+
+  EFI_HANDLE                   ImageHandle;
+  UINTN                        BufferSize;
+  EFI_LOADED_IMAGE_PROTOCOL    *LoadedImage;
+  MISC_DISPATCH_PROFILE_RECORD *Record;
+  MISC_DISPATCH_PROFILE_RECORD *Records;
+  EFI_GUID                     *FileName;
+  UINT64                       Timestamp;
+
+  while (TRUE) {
+    BufferSize = sizeof (ImageHandle);
+    Status     = EfiLocateHandle (
+                   ByRegisterNotify,
+                   NULL,
+                   mLoadedImageRegistration,
+                   &BufferSize,
+                   &ImageHandle
+                   );
+
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    Timestamp = InternalGetTimestamp ();
+
+    if (mNumberOfRecords == mMaximumRecords) {
+      Records = ReallocatePool (
+                  (mMaximumRecords * sizeof (*Records)),
+                  ((mMaximumRecords + MISC_DISPATCH_PROFILE_GROWTH)
+                    * sizeof (*Records)),
+                  (VOID *)mRecords
+                  );
+
+      // The image is not recorded, hence the next image must not inherit its
+      // load start.
+
+      if (Records == NULL) {
+        mLoadStartPending = FALSE;
+        continue;
+      }
+
+      mRecords         = Records;
+      mMaximumRecords += MISC_DISPATCH_PROFILE_GROWTH;
+    }
+
+    // Without a Security protocol hook, the previous driver's entry point is
+    // considered returned only now and this image's load time is unknown.
+
+    if (!mLoadStartPending) {
+      InternalEndPreviousEntry (Timestamp);
+
+      mLoadStart = Timestamp;
+    }
+
+    Record              = &mRecords[mNumberOfRecords];
+    Record->ImageHandle = ImageHandle;
+    Record->Round       = mRound;
+    Record->LoadStart   = mLoadStart;
+    Record->LoadEnd     = Timestamp;
+    Record->EntryEnd    = 0;
+
+    ZeroMem ((VOID *)&Record->FileName, sizeof (Record->FileName));
+
+    Status = EfiHandleProtocol (
+               ImageHandle,
+               &gEfiLoadedImageProtocolGuid,
+               (VOID **)&LoadedImage
+               );
+
+    if (!EFI_ERROR (Status) && (LoadedImage->FilePath != NULL)) {
+      FileName = EfiGetNameGuidFromFwVolDevicePathNode (
+                   (CONST MEDIA_FW_VOL_FILEPATH_DEVICE_PATH *)(
+                     LoadedImage->FilePath
+                     )
+                   );
+
+      if (FileName != NULL) {
+        CopyMem (
+          (VOID *)&Record->FileName,
+          (VOID *)FileName,
+          sizeof (Record->FileName)
+          );
+      }
+    }
+
+    ++mNumberOfRecords;
+
+    mLoadStartPending = FALSE;
+  }
+}
+
+// MiscProfileDxeDispatch
+/** Calls DxeDispatch() and records the drivers loaded and started in this
+    dispatch round.
+
+  @return  The status returned by DxeDispatch().
+**/
+EFI_STATUS
+MiscProfileDxeDispatch (
+  VOID
+  )
+{
+  EFI_STATUS Status;
+
+  EFI_EVENT  Event;
+  UINT64     CounterEnd;
+
+  ASSERT (!EfiAtRuntime ());
+
+  if (mProfiling) {
+    return InternalDxeDispatch ();
+  }
+
+  // Like FPDT timestamps, the timestamps count from processor reset, when the
+  // counter had its start value, so that they line up with the records of the
+  // core.
+
+  if (mRound == 0) {
+    mCounterStart      = GetPerformanceCounterProperties (
+                           NULL,
+                           &CounterEnd
+                           );
+
+    mCounterCountsDown = (BOOLEAN)(mCounterStart > CounterEnd);
+  }
+
+  Event  = NULL;
+  Status = EfiCreateEvent (
+             EVT_NOTIFY_SIGNAL,
+             TPL_CALLBACK,
+             InternalLoadedImageNotify,
+             NULL,
+             &Event
+             );
+
+  if (!EFI_ERROR (Status)) {
+    Status = EfiRegisterProtocolNotify (
+               &gEfiLoadedImageProtocolGuid,
+               Event,
+               &mLoadedImageRegistration
+               );
+
+    if (EFI_ERROR (Status)) {
+      EfiCloseEvent (Event);
+
+      Event = NULL;
+    }
+  }
+
+  if (Event == NULL) {
+    return InternalDxeDispatch ();
+  }
+
+  Status = EfiLocateProtocol (
+             &gEfiSecurity2ArchProtocolGuid,
+             NULL,
+             (VOID **)&mSecurity2
+             );
+
+  if (!EFI_ERROR (Status)) {
+    mSecurity2FileAuthentication   = mSecurity2->FileAuthentication;
+    mSecurity2->FileAuthentication = InternalFileAuthentication;
+  } else {
+    mSecurity2 = NULL;
+  }
+
+  Status = EfiLocateProtocol (
+             &gEfiSecurityArchProtocolGuid,
+             NULL,
+             (VOID **)&mSecurity
+             );
+
+  if (!EFI_ERROR (Status)) {
+    mSecurityFileAuthenticationState   = mSecurity->FileAuthenticationState;
+    mSecurity->FileAuthenticationState = InternalFileAuthenticationState;
+  } else {
+    mSecurity = NULL;
+  }
+
+  ++mRound;
+
+  mProfiling        = TRUE;
+  mLoadStartPending = FALSE;
+  mRoundStart       = InternalGetTimestamp ();
+  mLoadStart        = mRoundStart;
+
+  Status = InternalDxeDispatch ();
+
+  InternalEndPreviousEntry (InternalGetTimestamp ());
+
+  mProfiling = FALSE;
+
+  if (mSecurity2 != NULL) {
+    mSecurity2->FileAuthentication = mSecurity2FileAuthentication;
+  }
+
+  if (mSecurity != NULL) {
+    mSecurity->FileAuthenticationState = mSecurityFileAuthenticationState;
+  }
+
+  EfiCloseEvent (Event);
+
+  mLoadedImageRegistration = NULL;
+
+  return Status;
+}
+
+// MiscGetDispatchProfile
+/** Returns the records collected by MiscProfileDxeDispatch().
+
+  @param[out] Records          On output, a pointer to the records.  The buffer
+                               is owned by the library.
+  @param[out] NumberOfRecords  On output, the number of records.
+**/
+VOID
+MiscGetDispatchProfile (
+  OUT CONST MISC_DISPATCH_PROFILE_RECORD  **Records,
+  OUT UINTN                               *NumberOfRecords
+  )
+{
+  ASSERT (Records != NULL);
+  ASSERT (NumberOfRecords != NULL);
+
+  *Records         = mRecords;
+  *NumberOfRecords = mNumberOfRecords;
+}
+
+// MiscDumpDispatchProfile
+/** Prints the collected records as a table to the debug output.
+**/
+VOID
+MiscDumpDispatchProfile (
+  VOID
+  )
+{
+  MISC_DISPATCH_PROFILE_RECORD *Record;
+  UINTN                        Index;
+  UINT64                       EntryTime;
+
+  DEBUG ((DEBUG_INFO, "Round File                                 Load(us) Entry(us)\n"));
+
+  for (Index = 0; Index < mNumberOfRecords; ++Index) {
+    Record = &mRecords[Index];
+
+    // EntryEnd is 0 while the entry point has not been seen to return.
+
+    EntryTime = 0;
+
+    if (Record->EntryEnd >= Record->LoadEnd) {
+      EntryTime = (Record->EntryEnd - Record->LoadEnd);
+    }
+
+    DEBUG ((
+      DEBUG_INFO,
+      "%5u %g %8lu %9lu\n",
+      Record->Round,
+      &Record->FileName,
+      DivU64x32 ((Record->LoadEnd - Record->LoadStart), 1000),
+      DivU64x32 (EntryTime, 1000)
+      ));
+  }
+}
+
+// InternalSetFpdtRecord
+STATIC
+VOID
+InternalSetFpdtRecord (
+  OUT FPDT_GUID_EVENT_RECORD  *FpdtRecord,
+  IN  UINT16                  ProgressId,
+  IN  UINT64                  Timestamp,
+  IN  EFI_GUID                *Guid
+  )
+{
+  FpdtRecord->Header.Type     = FPDT_GUID_EVENT_RECORD_TYPE;
+  FpdtRecord->Header.Length   = sizeof (*FpdtRecord);
+  FpdtRecord->Header.Revision = FPDT_RECORD_REVISION_1;
+  FpdtRecord->ProgressId      = ProgressId;
+  FpdtRecord->ApicId          = 0;
+  FpdtRecord->Timestamp       = Timestamp;
+
+  CopyMem ((VOID *)&FpdtRecord->Guid, (VOID *)Guid, sizeof (*Guid));
+}
+
+// MiscGetDispatchProfileFpdtRecords
+/** Exports the collected records as an FPDT GUID event record stream.
+
+  @param[out] Buffer      On output, a pointer to the record stream.  The
+                          caller is responsible for freeing it.
+  @param[out] BufferSize  On output, the size, in bytes, of Buffer.
+
+  @retval EFI_SUCCESS           The records were exported.
+  @retval EFI_NOT_FOUND         No records have been collected.
+  @retval EFI_OUT_OF_RESOURCES  The record stream could not be allocated.
+**/
+EFI_STATUS
+MiscGetDispatchProfileFpdtRecords (
+  OUT VOID   **Buffer,
+  OUT UINTN  *BufferSize
+  )
+{
+  FPDT_GUID_EVENT_RECORD       *FpdtRecords;
+  MISC_DISPATCH_PROFILE_RECORD *Record;
+  UINTN                        Index;
+
+  ASSERT (Buffer != NULL);
+  ASSERT (BufferSize != NULL);
+  ASSERT (!EfiAtRuntime ());
+
+  if (mNumberOfRecords == 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  FpdtRecords = AllocatePool (mNumberOfRecords * 4 * sizeof (*FpdtRecords));
+
+  if (FpdtRecords == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *Buffer     = (VOID *)FpdtRecords;
+  *BufferSize = (mNumberOfRecords * 4 * sizeof (*FpdtRecords));
+
+  for (Index = 0; Index < mNumberOfRecords; ++Index) {
+    Record = &mRecords[Index];
+
+    InternalSetFpdtRecord (
+      &FpdtRecords[0],
+      FPDT_MODULE_LOADIMAGE_START_ID,
+      Record->LoadStart,
+      &Record->FileName
+      );
+
+    InternalSetFpdtRecord (
+      &FpdtRecords[1],
+      FPDT_MODULE_LOADIMAGE_END_ID,
+      Record->LoadEnd,
+      &Record->FileName
+      );
+
+    InternalSetFpdtRecord (
+      &FpdtRecords[2],
+      FPDT_MODULE_START_ID,
+      Record->LoadEnd,
+      &Record->FileName
+      );
+
+    InternalSetFpdtRecord (
+      &FpdtRecords[3],
+      FPDT_MODULE_END_ID,
+      Record->EntryEnd,
+      &Record->FileName
+      );
+
+    FpdtRecords += 4;
+  }
+
+  return EFI_SUCCESS;
+}
@@ -18,10 +18,59 @@
 
 #include <Guid/EventGroup.h>
 
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/EfiBootServicesLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/MiscRuntimeLib.h>
 #include <Library/MiscEventLib.h>
+#include <Library/MiscPerformanceLib.h>
+
+// MISC_EVENT_PERFORMANCE_CONTEXT
+typedef struct {
+  LIST_ENTRY       Link;            ///< Links the contexts of all events.
+  EFI_EVENT        Event;           ///< The event the context belongs to.
+  EFI_EVENT_NOTIFY NotifyFunction;  ///< The notification function.
+  VOID             *NotifyContext;  ///< The context of NotifyFunction.
+} MISC_EVENT_PERFORMANCE_CONTEXT;
+
+// PERFORMANCE_CONTEXT_FROM_LINK
+#define PERFORMANCE_CONTEXT_FROM_LINK(Entry)  \
+  BASE_CR ((Entry), MISC_EVENT_PERFORMANCE_CONTEXT, Link)
+
+// mPerformanceContexts
+/// The contexts of the wrapped events, freed by MiscCloseEvent().
+STATIC LIST_ENTRY mPerformanceContexts =
+  INITIALIZE_LIST_HEAD_VARIABLE (mPerformanceContexts);
+
+// InternalPerformanceNotify
+/** Calls the notification function of an event and records the call for
+    MiscPerformanceLib, identified by the function's address.
+**/
+STATIC
+VOID
+EFIAPI
+InternalPerformanceNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  MISC_EVENT_PERFORMANCE_CONTEXT *PerformanceContext;
+  UINT32                         Id;
+
+  PerformanceContext = (MISC_EVENT_PERFORMANCE_CONTEXT *)Context;
+  Id                 = (UINT32)(UINTN)PerformanceContext->NotifyFunction;
+
+  MISC_PERFORMANCE_BEGIN (MISC_PERFORMANCE_MODULE_EVENT, Id);
+
+  PerformanceContext->NotifyFunction (
+                        Event,
+                        PerformanceContext->NotifyContext
+                        );
+
+  MISC_PERFORMANCE_END (MISC_PERFORMANCE_MODULE_EVENT, Id);
+}
 
 // MiscCreateTimerEvent
 EFI_EVENT
@@ -37,12 +86,12 @@ MiscCreateTimerEvent (
 
   EFI_STATUS Status;
 
-  ASSERT (NotifyTpl < TPL_CALLBACK);
+  ASSERT (NotifyTpl <= TPL_NOTIFY);
   ASSERT (!EfiAtRuntime ());
 
   Event = NULL;
 
-  if (NotifyTpl < TPL_CALLBACK) {
+  if (NotifyTpl <= TPL_NOTIFY) {
     Status = EfiCreateEvent (
                ((NotifyFunction != NULL)
                  ? (EVT_TIMER | EVT_NOTIFY_SIGNAL)
@@ -157,13 +206,35 @@ MiscCreateSignalEventEx (
   IN CONST EFI_GUID    *EventGroup OPTIONAL
   )
 {
-  EFI_EVENT  Event;
+  EFI_EVENT                      Event;
 
-  EFI_STATUS Status;
+  EFI_STATUS                     Status;
+  MISC_EVENT_PERFORMANCE_CONTEXT *PerformanceContext;
+  EFI_TPL                        OldTpl;
 
   ASSERT (!EfiAtRuntime ());
 
-  Event = NULL;
+  Event              = NULL;
+  PerformanceContext = NULL;
+
+  // The context lives as long as the event and is freed by MiscCloseEvent().
+  // Virtual address change notifications are not wrapped, as the context is
+  // gone by the time they are signaled.
+
+  if (FeaturePcdGet (PcdMiscPerformanceEnable)
+   && (NotifyFunction != NULL)
+   && ((EventGroup == NULL)
+    || !CompareGuid (EventGroup, &gEfiEventVirtualAddressChangeGuid))) {
+    PerformanceContext = AllocatePool (sizeof (*PerformanceContext));
+
+    if (PerformanceContext != NULL) {
+      PerformanceContext->NotifyFunction = NotifyFunction;
+      PerformanceContext->NotifyContext  = (VOID *)NotifyContext;
+
+      NotifyFunction = InternalPerformanceNotify;
+      NotifyContext  = (VOID *)PerformanceContext;
+    }
+  }
 
   Status = EfiCreateEventEx (
              EVT_NOTIFY_SIGNAL,
@@ -174,6 +245,18 @@ MiscCreateSignalEventEx (
              &Event
              );
 
+  if (PerformanceContext != NULL) {
+    if (EFI_ERROR (Status)) {
+      FreePool ((VOID *)PerformanceContext);
+    } else {
+      PerformanceContext->Event = Event;
+
+      OldTpl = EfiRaiseTPL (TPL_NOTIFY);
+      InsertTailList (&mPerformanceContexts, &PerformanceContext->Link);
+      EfiRestoreTPL (OldTpl);
+    }
+  }
+
   if (EFI_ERROR (Status)) {
     ASSERT (Event == NULL);
   }
@@ -181,6 +264,54 @@ MiscCreateSignalEventEx (
   return Event;
 }
 
+// MiscCloseEvent
+/** Closes an event created by this library and frees the resources the
+    library has allocated for it.
+**/
+EFI_STATUS
+MiscCloseEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  EFI_STATUS                     Status;
+
+  MISC_EVENT_PERFORMANCE_CONTEXT *PerformanceContext;
+  LIST_ENTRY                     *Link;
+  EFI_TPL                        OldTpl;
+
+  ASSERT (!EfiAtRuntime ());
+
+  PerformanceContext = NULL;
+
+  OldTpl = EfiRaiseTPL (TPL_NOTIFY);
+
+  for (
+    Link = GetFirstNode (&mPerformanceContexts);
+    !IsNull (&mPerformanceContexts, Link);
+    Link = GetNextNode (&mPerformanceContexts, Link)
+    ) {
+    if (PERFORMANCE_CONTEXT_FROM_LINK (Link)->Event == Event) {
+      PerformanceContext = PERFORMANCE_CONTEXT_FROM_LINK (Link);
+
+      RemoveEntryList (Link);
+      break;
+    }
+  }
+
+  EfiRestoreTPL (OldTpl);
+
+  // The event is closed first, so that its notification function, which uses
+  // the context, can no longer be queued.
+
+  Status = EfiCloseEvent (Event);
+
+  if (PerformanceContext != NULL) {
+    FreePool ((VOID *)PerformanceContext);
+  }
+
+  return Status;
+}
+
 // MiscCreateExitBootServicesEvent
 EFI_EVENT
 MiscCreateExitBootServicesEvent (
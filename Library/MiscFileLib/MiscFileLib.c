@@ -25,6 +25,7 @@
 #include <Library/FileHandleLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/MiscFileLib.h>
+#include <Library/MiscPerformanceLib.h>
 #include <Library/MiscRuntimeLib.h>
 
 // FILE_INFO_IS_DIRECTORY
@@ -95,6 +96,11 @@ LoadFile (
   ASSERT (Buffer != NULL);
   ASSERT (!EfiAtRuntime ());
 
+  MISC_PERFORMANCE_BEGIN (
+    MISC_PERFORMANCE_MODULE_FILE,
+    MISC_PERFORMANCE_ID_LOAD_FILE
+    );
+
   Status = Root->Open (Root, &FileHandle, FileName, EFI_FILE_MODE_READ, 0);
 
   if ((Status != EFI_NOT_FOUND)
@@ -133,6 +139,11 @@ LoadFile (
     FileHandleClose (FileHandle);
   }
 
+  MISC_PERFORMANCE_END (
+    MISC_PERFORMANCE_MODULE_FILE,
+    MISC_PERFORMANCE_ID_LOAD_FILE
+    );
+
   return Status;
 }
 
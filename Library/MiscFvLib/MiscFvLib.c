@@ -0,0 +1,692 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiPei.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MiscFvLib.h>
+
+// FNV_64_OFFSET_BASIS
+#define FNV_64_OFFSET_BASIS  0xCBF29CE484222325ULL
+
+// FNV_64_PRIME
+#define FNV_64_PRIME  0x00000100000001B3ULL
+
+// MiscFvValidateHeader
+/** Validates the header of a memory-mapped firmware volume.
+
+  @param[in] FvHeader  A pointer to the header of the firmware volume.
+  @param[in] Size      The size, in bytes, of the buffer holding the firmware
+                       volume.
+
+  @retval EFI_SUCCESS           The header is valid.
+  @retval EFI_VOLUME_CORRUPTED  The signature, revision, lengths or checksum of
+                                the header are invalid.
+**/
+EFI_STATUS
+MiscFvValidateHeader (
+  IN CONST EFI_FIRMWARE_VOLUME_HEADER  *FvHeader,
+  IN UINTN                             Size
+  )
+{
+  CONST EFI_FIRMWARE_VOLUME_EXT_HEADER *ExtHeader;
+
+  ASSERT (FvHeader != NULL);
+
+  if ((Size < sizeof (*FvHeader))
+   || (FvHeader->Signature != EFI_FVH_SIGNATURE)
+   || (FvHeader->Revision < EFI_FVH_REVISION)
+   || (FvHeader->FvLength > Size)
+   || (FvHeader->HeaderLength < sizeof (*FvHeader))
+   || (FvHeader->HeaderLength > FvHeader->FvLength)
+   || ((FvHeader->HeaderLength & 1) != 0)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  if (CalculateSum16 ((CONST UINT16 *)FvHeader, FvHeader->HeaderLength) != 0) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  if (FvHeader->ExtHeaderOffset != 0) {
+    if ((FvHeader->ExtHeaderOffset < FvHeader->HeaderLength)
+     || ((FvHeader->ExtHeaderOffset + sizeof (*ExtHeader))
+           > FvHeader->FvLength)) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+
+    ExtHeader = (CONST EFI_FIRMWARE_VOLUME_EXT_HEADER *)(
+                  (UINTN)FvHeader + FvHeader->ExtHeaderOffset
+                  );
+
+    if ((ExtHeader->ExtHeaderSize < sizeof (*ExtHeader))
+     || ((FvHeader->ExtHeaderOffset + (UINT64)ExtHeader->ExtHeaderSize)
+           > FvHeader->FvLength)) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+// MiscFvCalculateHash
+/** Calculates a fast, non-cryptographic 64-bit hash of the contents of a
+    firmware volume.
+
+  @param[in] FvHeader  A pointer to the header of a validated firmware volume.
+
+  @return  The hash of the FvLength bytes of the firmware volume.
+**/
+UINT64
+MiscFvCalculateHash (
+  IN CONST EFI_FIRMWARE_VOLUME_HEADER  *FvHeader
+  )
+{
+  UINT64      Hash;
+
+  CONST UINT8 *Buffer;
+  UINTN       Length;
+  UINTN       Index;
+
+  ASSERT (FvHeader != NULL);
+
+  // FNV-1a, consuming a whole QWORD per round.  Volumes are 8-byte aligned
+  // and sized, the byte loop only covers malformed lengths.
+
+  Hash   = FNV_64_OFFSET_BASIS;
+  Buffer = (CONST UINT8 *)FvHeader;
+  Length = (UINTN)FvHeader->FvLength;
+
+  for (Index = 0; (Index + sizeof (UINT64)) <= Length; Index += sizeof (UINT64)) {
+    Hash ^= ReadUnaligned64 ((CONST UINT64 *)&Buffer[Index]);
+    Hash  = MultU64x64 (Hash, FNV_64_PRIME);
+  }
+
+  for (; Index < Length; ++Index) {
+    Hash ^= Buffer[Index];
+    Hash  = MultU64x64 (Hash, FNV_64_PRIME);
+  }
+
+  return (Hash ^ RShiftU64 (Hash, 32));
+}
+
+// MiscFfsGetFileSize
+/** Returns the size of an FFS file, including its header.
+
+  @param[in] FileHeader  A pointer to the header of the file.
+
+  @return  The size, in bytes, of the file.
+**/
+UINT64
+MiscFfsGetFileSize (
+  IN CONST EFI_FFS_FILE_HEADER  *FileHeader
+  )
+{
+  ASSERT (FileHeader != NULL);
+
+  if (IS_FFS_FILE2 (FileHeader)) {
+    return ((CONST EFI_FFS_FILE_HEADER2 *)FileHeader)->ExtendedSize;
+  }
+
+  return FFS_FILE_SIZE (FileHeader);
+}
+
+// MiscFfsGetHeaderSize
+/** Returns the size of the header of an FFS file.
+
+  @param[in] FileHeader  A pointer to the header of the file.
+
+  @return  The size, in bytes, of the EFI_FFS_FILE_HEADER or
+           EFI_FFS_FILE_HEADER2.
+**/
+UINTN
+MiscFfsGetHeaderSize (
+  IN CONST EFI_FFS_FILE_HEADER  *FileHeader
+  )
+{
+  ASSERT (FileHeader != NULL);
+
+  return (IS_FFS_FILE2 (FileHeader)
+            ? sizeof (EFI_FFS_FILE_HEADER2)
+            : sizeof (EFI_FFS_FILE_HEADER));
+}
+
+// InternalGetFileState
+STATIC
+EFI_FFS_FILE_STATE
+InternalGetFileState (
+  IN BOOLEAN                    ErasePolarity,
+  IN CONST EFI_FFS_FILE_HEADER  *FileHeader
+  )
+{
+  EFI_FFS_FILE_STATE State;
+  EFI_FFS_FILE_STATE HighestBit;
+
+  State = FileHeader->State;
+
+  if (ErasePolarity) {
+    State = (EFI_FFS_FILE_STATE)~State;
+  }
+
+  // The most significant bit set determines the state of the file.
+
+  for (HighestBit = BIT7; HighestBit != 0; HighestBit >>= 1) {
+    if ((State & HighestBit) != 0) {
+      break;
+    }
+  }
+
+  return HighestBit;
+}
+
+// InternalFindFile
+/** Finds the first valid file at or after an offset within a firmware volume.
+
+  @param[in]      FvHeader       A pointer to the header of a validated
+                                 firmware volume.
+  @param[in]      ErasePolarity  The erase polarity of the firmware volume.
+  @param[in, out] Offset         On input, the offset to start the search at.
+                                 On output, the offset of the found file.
+
+  @return  The found file, or NULL if there are no more files.
+**/
+STATIC
+EFI_FFS_FILE_HEADER *
+InternalFindFile (
+  IN     CONST EFI_FIRMWARE_VOLUME_HEADER  *FvHeader,
+  IN     BOOLEAN                           ErasePolarity,
+  IN OUT UINT64                            *Offset
+  )
+{
+  EFI_FFS_FILE_HEADER *File;
+  EFI_FFS_FILE_STATE  State;
+  UINT64              FileOffset;
+  UINT64              FileSize;
+
+  FileOffset = *Offset;
+
+  while (TRUE) {
+    FileOffset = ALIGN_VALUE (FileOffset, 8);
+
+    if ((FileOffset + sizeof (*File)) > FvHeader->FvLength) {
+      break;
+    }
+
+    File  = (EFI_FFS_FILE_HEADER *)((UINTN)FvHeader + (UINTN)FileOffset);
+    State = InternalGetFileState (ErasePolarity, File);
+
+    if (State == 0) {
+      // The start of the free space.
+      break;
+    }
+
+    if ((State == EFI_FILE_HEADER_CONSTRUCTION)
+     || (State == EFI_FILE_HEADER_INVALID)) {
+      // The file size cannot be trusted, continue after the header.
+      FileOffset += sizeof (*File);
+      continue;
+    }
+
+    if (IS_FFS_FILE2 (File)
+     && ((FileOffset + sizeof (EFI_FFS_FILE_HEADER2)) > FvHeader->FvLength)) {
+      break;
+    }
+
+    FileSize = MiscFfsGetFileSize (File);
+
+    if ((FileSize < MiscFfsGetHeaderSize (File))
+     || (FileSize > (FvHeader->FvLength - FileOffset))) {
+      break;
+    }
+
+    if ((State == EFI_FILE_DATA_VALID)
+     || (State == EFI_FILE_MARKED_FOR_UPDATE)) {
+      *Offset = FileOffset;
+
+      return File;
+    }
+
+    FileOffset += FileSize;
+  }
+
+  return NULL;
+}
+
+// InternalGetFirstFileOffset
+STATIC
+UINT64
+InternalGetFirstFileOffset (
+  IN CONST EFI_FIRMWARE_VOLUME_HEADER  *FvHeader
+  )
+{
+  CONST EFI_FIRMWARE_VOLUME_EXT_HEADER *ExtHeader;
+
+  if (FvHeader->ExtHeaderOffset == 0) {
+    return FvHeader->HeaderLength;
+  }
+
+  ExtHeader = (CONST EFI_FIRMWARE_VOLUME_EXT_HEADER *)(
+                (UINTN)FvHeader + FvHeader->ExtHeaderOffset
+                );
+
+  return (FvHeader->ExtHeaderOffset + ExtHeader->ExtHeaderSize);
+}
+
+// MiscFvFindNextFile
+/** Finds the next valid file in a memory-mapped firmware volume.
+
+  @param[in]      FvHeader    A pointer to the header of a validated firmware
+                              volume.
+  @param[in, out] FileHeader  On input, the file to continue the search after,
+                              or NULL to start at the first file.  On output,
+                              the next file.
+
+  @retval EFI_SUCCESS    The next file was returned.
+  @retval EFI_NOT_FOUND  There are no more files.
+**/
+EFI_STATUS
+MiscFvFindNextFile (
+  IN     CONST EFI_FIRMWARE_VOLUME_HEADER  *FvHeader,
+  IN OUT EFI_FFS_FILE_HEADER               **FileHeader
+  )
+{
+  EFI_FFS_FILE_HEADER *File;
+  UINT64              Offset;
+
+  ASSERT (FvHeader != NULL);
+  ASSERT (FileHeader != NULL);
+
+  if (*FileHeader == NULL) {
+    Offset = InternalGetFirstFileOffset (FvHeader);
+  } else {
+    Offset = ((UINTN)*FileHeader - (UINTN)FvHeader);
+    Offset += MiscFfsGetFileSize (*FileHeader);
+  }
+
+  File = InternalFindFile (
+           FvHeader,
+           (BOOLEAN)((FvHeader->Attributes & EFI_FVB2_ERASE_POLARITY) != 0),
+           &Offset
+           );
+
+  if (File == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  *FileHeader = File;
+
+  return EFI_SUCCESS;
+}
+
+// SWAR_LOW_BYTES
+/// Selects the low byte of each 16-bit lane of a UINTN.
+#define SWAR_LOW_BYTES  ((MAX_UINTN / MAX_UINT16) * MAX_UINT8)
+
+// SWAR_FLUSH_INTERVAL
+/// The number of words after which the 16-bit lanes of the accumulator must be
+/// summed up, as each word adds up to 2 * 0xFF to every lane.
+#define SWAR_FLUSH_INTERVAL  128
+
+// MiscFvCalculateSum8
+/** Calculates the 8-bit sum of a buffer, a native word at a time.
+
+  @param[in] Buffer  The buffer to sum.
+  @param[in] Length  The length, in bytes, of Buffer.
+
+  @return  The 8-bit sum of all bytes of Buffer.
+**/
+UINT8
+MiscFvCalculateSum8 (
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length
+  )
+{
+  UINT8       Sum;
+
+  CONST UINT8 *Bytes;
+  UINTN       Accumulator;
+  UINTN       Word;
+  UINTN       Words;
+  UINTN       Index;
+
+  ASSERT ((Buffer != NULL) || (Length == 0));
+
+  Sum   = 0;
+  Bytes = (CONST UINT8 *)Buffer;
+
+  // Sum the bytes up to word alignment individually.
+
+  while ((Length > 0) && (((UINTN)Bytes & (sizeof (UINTN) - 1)) != 0)) {
+    Sum = (UINT8)(Sum + *Bytes);
+    ++Bytes;
+    --Length;
+  }
+
+  // Add the even and odd bytes of each word into 16-bit lanes.  Only the sum
+  // modulo 256 is needed, hence only the low byte of each lane contributes.
+  // The lanes must not be folded into each other, as their upper bytes would
+  // carry into the low byte.
+
+  while (Length >= sizeof (UINTN)) {
+    Words = (Length / sizeof (UINTN));
+
+    if (Words > SWAR_FLUSH_INTERVAL) {
+      Words = SWAR_FLUSH_INTERVAL;
+    }
+
+    Accumulator = 0;
+
+    for (Index = 0; Index < Words; ++Index) {
+      Word         = ((CONST UINTN *)Bytes)[Index];
+      Accumulator += (Word & SWAR_LOW_BYTES);
+      Accumulator += ((Word >> 8) & SWAR_LOW_BYTES);
+    }
+
+    for (Index = 0; Index < (sizeof (UINTN) * 8); Index += 16) {
+      Sum = (UINT8)(Sum + (UINT8)(Accumulator >> Index));
+    }
+
+    Bytes  += (Words * sizeof (UINTN));
+    Length -= (Words * sizeof (UINTN));
+  }
+
+  while (Length > 0) {
+    Sum = (UINT8)(Sum + *Bytes);
+    ++Bytes;
+    --Length;
+  }
+
+  return Sum;
+}
+
+// InternalVerifyFileHeader
+STATIC
+BOOLEAN
+InternalVerifyFileHeader (
+  IN CONST EFI_FFS_FILE_HEADER  *FileHeader
+  )
+{
+  UINT8 Sum;
+
+  // The header checksum is calculated with State and the file checksum
+  // assumed to be zero.
+
+  Sum = MiscFvCalculateSum8 (
+          (CONST VOID *)FileHeader,
+          MiscFfsGetHeaderSize (FileHeader)
+          );
+
+  Sum = (UINT8)(Sum - FileHeader->State);
+  Sum = (UINT8)(Sum - FileHeader->IntegrityCheck.Checksum.File);
+
+  return (BOOLEAN)(Sum == 0);
+}
+
+// MiscFfsVerifyFile
+/** Verifies the header and data checksums of an FFS file.
+
+  @param[in] FileHeader  A pointer to the header of the file.
+
+  @retval TRUE   The checksums are valid.
+  @retval FALSE  At least one checksum is invalid.
+**/
+BOOLEAN
+MiscFfsVerifyFile (
+  IN CONST EFI_FFS_FILE_HEADER  *FileHeader
+  )
+{
+  UINT8 Sum;
+  UINTN HeaderSize;
+
+  ASSERT (FileHeader != NULL);
+
+  if (!InternalVerifyFileHeader (FileHeader)) {
+    return FALSE;
+  }
+
+  if ((FileHeader->Attributes & FFS_ATTRIB_CHECKSUM) == 0) {
+    return (BOOLEAN)(
+             FileHeader->IntegrityCheck.Checksum.File == FFS_FIXED_CHECKSUM
+             );
+  }
+
+  HeaderSize = MiscFfsGetHeaderSize (FileHeader);
+  Sum        = MiscFvCalculateSum8 (
+                 ((CONST UINT8 *)FileHeader + HeaderSize),
+                 (UINTN)(MiscFfsGetFileSize (FileHeader) - HeaderSize)
+                 );
+
+  return (BOOLEAN)((UINT8)(Sum + FileHeader->IntegrityCheck.Checksum.File) == 0);
+}
+
+// MiscFvScanFiles
+/** Describes all valid files of a firmware volume, in volume order.
+
+  The volume is walked once.  If Files is too small, the walk continues to
+  count the files, and the caller has to walk the volume again to describe
+  them.  With VerifyHeaders, the checksum of every file header is computed,
+  also for files that are only counted.
+
+  @param[in]      FvHeader         A pointer to the header of a validated
+                                   firmware volume.
+  @param[in]      VerifyHeaders    Whether to skip files with an invalid header
+                                   checksum.
+  @param[out]     Files            The buffer to describe the files in.
+  @param[in, out] NumberOfFiles    On input, the number of entries Files can
+                                   hold.  On output, the number of files
+                                   described or present.
+
+  @retval EFI_SUCCESS           The files were described.
+  @retval EFI_BUFFER_TOO_SMALL  Files is too small.  NumberOfFiles holds the
+                                number of files present.
+**/
+EFI_STATUS
+MiscFvScanFiles (
+  IN     CONST EFI_FIRMWARE_VOLUME_HEADER  *FvHeader,
+  IN     BOOLEAN                           VerifyHeaders,
+  OUT    MISC_FV_FILE_INDEX_ENTRY          *Files, OPTIONAL
+  IN OUT UINTN                             *NumberOfFiles
+  )
+{
+  EFI_FFS_FILE_HEADER *File;
+  BOOLEAN             ErasePolarity;
+  UINT64              Offset;
+  UINTN               Count;
+
+  ASSERT (FvHeader != NULL);
+  ASSERT (NumberOfFiles != NULL);
+  ASSERT ((Files != NULL) || (*NumberOfFiles == 0));
+
+  ErasePolarity = (BOOLEAN)(
+                    (FvHeader->Attributes & EFI_FVB2_ERASE_POLARITY) != 0
+                    );
+
+  Count  = 0;
+  Offset = InternalGetFirstFileOffset (FvHeader);
+
+  for (File = InternalFindFile (FvHeader, ErasePolarity, &Offset);
+       File != NULL;
+       File = InternalFindFile (FvHeader, ErasePolarity, &Offset)) {
+    Offset += MiscFfsGetFileSize (File);
+
+    if ((File->Type == EFI_FV_FILETYPE_FFS_PAD)
+     || (VerifyHeaders && !InternalVerifyFileHeader (File))) {
+      continue;
+    }
+
+    if (Count < *NumberOfFiles) {
+      CopyGuid (&Files[Count].Name, &File->Name);
+
+      Files[Count].Type   = File->Type;
+      Files[Count].Offset = (UINT32)((UINTN)File - (UINTN)FvHeader);
+      Files[Count].Size   = MiscFfsGetFileSize (File);
+    }
+
+    ++Count;
+  }
+
+  if (Count > *NumberOfFiles) {
+    *NumberOfFiles = Count;
+
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  *NumberOfFiles = Count;
+
+  return EFI_SUCCESS;
+}
+
+// InternalFindIndexBound
+/** Returns the index of the first entry whose name does not order before
+    FileName.
+**/
+STATIC
+UINTN
+InternalFindIndexBound (
+  IN CONST MISC_FV_FILE_INDEX_ENTRY  *Entries,
+  IN UINTN                           NumberOfEntries,
+  IN CONST EFI_GUID                  *FileName
+  )
+{
+  UINTN Low;
+  UINTN High;
+  UINTN Middle;
+
+  Low  = 0;
+  High = NumberOfEntries;
+
+  while (Low < High) {
+    Middle = (Low + ((High - Low) / 2));
+
+    if (CompareMem (
+          (VOID *)&Entries[Middle].Name,
+          (VOID *)FileName,
+          sizeof (*FileName)
+          ) < 0) {
+      Low = (Middle + 1);
+    } else {
+      High = Middle;
+    }
+  }
+
+  return Low;
+}
+
+// MiscFvBuildFileIndex
+/** Records all valid files of a firmware volume, sorted by name.
+
+  The volume is walked once.  If Entries is too small, the walk continues to
+  count the files, and the caller has to call again with a larger buffer.
+
+  @param[in]      FvHeader         A pointer to the header of a validated
+                                   firmware volume.
+  @param[out]     Entries          The buffer to record the files in.
+  @param[in, out] NumberOfEntries  On input, the number of entries Entries can
+                                   hold.  On output, the number of entries
+                                   recorded or required.
+
+  @retval EFI_SUCCESS           The files were recorded.
+  @retval EFI_BUFFER_TOO_SMALL  Entries is too small.  NumberOfEntries holds
+                                the number of entries required.
+**/
+EFI_STATUS
+MiscFvBuildFileIndex (
+  IN     CONST EFI_FIRMWARE_VOLUME_HEADER  *FvHeader,
+  OUT    MISC_FV_FILE_INDEX_ENTRY          *Entries, OPTIONAL
+  IN OUT UINTN                             *NumberOfEntries
+  )
+{
+  EFI_STATUS               Status;
+
+  MISC_FV_FILE_INDEX_ENTRY Entry;
+  UINTN                    NumberOfFiles;
+  UINTN                    Count;
+  UINTN                    FileIndex;
+  UINTN                    Index;
+
+  ASSERT (FvHeader != NULL);
+  ASSERT (NumberOfEntries != NULL);
+
+  NumberOfFiles = *NumberOfEntries;
+  Status        = MiscFvScanFiles (FvHeader, FALSE, Entries, &NumberOfFiles);
+
+  if (EFI_ERROR (Status)) {
+    *NumberOfEntries = NumberOfFiles;
+
+    return Status;
+  }
+
+  // Sort the entries in place.  Insertion is stable, so of equally named
+  // files the first one in volume order is kept.
+
+  Count = 0;
+
+  for (FileIndex = 0; FileIndex < NumberOfFiles; ++FileIndex) {
+    CopyMem ((VOID *)&Entry, (VOID *)&Entries[FileIndex], sizeof (Entry));
+
+    Index = InternalFindIndexBound (Entries, Count, &Entry.Name);
+
+    if ((Index < Count) && CompareGuid (&Entries[Index].Name, &Entry.Name)) {
+      continue;
+    }
+
+    CopyMem (
+      (VOID *)&Entries[Index + 1],
+      (VOID *)&Entries[Index],
+      ((Count - Index) * sizeof (*Entries))
+      );
+
+    CopyMem ((VOID *)&Entries[Index], (VOID *)&Entry, sizeof (Entry));
+
+    ++Count;
+  }
+
+  *NumberOfEntries = Count;
+
+  return EFI_SUCCESS;
+}
+
+// MiscFvFindIndexedFile
+/** Finds a file by name in an index built by MiscFvBuildFileIndex().
+
+  @param[in] Entries          The entries of the index.
+  @param[in] NumberOfEntries  The number of entries in Entries.
+  @param[in] FileName         The name of the file to find.
+
+  @return  The entry of the file, or NULL if it has not been found.
+**/
+CONST MISC_FV_FILE_INDEX_ENTRY *
+MiscFvFindIndexedFile (
+  IN CONST MISC_FV_FILE_INDEX_ENTRY  *Entries,
+  IN UINTN                           NumberOfEntries,
+  IN CONST EFI_GUID                  *FileName
+  )
+{
+  UINTN Index;
+
+  ASSERT ((Entries != NULL) || (NumberOfEntries == 0));
+  ASSERT (FileName != NULL);
+
+  Index = InternalFindIndexBound (Entries, NumberOfEntries, FileName);
+
+  if ((Index < NumberOfEntries)
+   && CompareGuid (&Entries[Index].Name, FileName)) {
+    return &Entries[Index];
+  }
+
+  return NULL;
+}
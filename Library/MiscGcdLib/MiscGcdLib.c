@@ -0,0 +1,673 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiDxe.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DxeServicesLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/MiscGcdLib.h>
+#include <Library/MiscRuntimeLib.h>
+
+// MISC_GCD_RANGE_SLACK
+/// The number of spare entries allocated with a map, so that carving a range
+/// in two does not require a reallocation in the common case.
+#define MISC_GCD_RANGE_SLACK  8
+
+// MISC_GCD_RANGE
+typedef struct {
+  EFI_PHYSICAL_ADDRESS BaseAddress;
+  UINT64               Length;
+  UINTN                GcdType;
+} MISC_GCD_RANGE;
+
+// MISC_GCD_RESOURCE_MAP
+struct MISC_GCD_RESOURCE_MAP {
+  MISC_GCD_SPACE Space;
+  BOOLEAN        Stale;
+  UINTN          NumberOfRanges;
+  UINTN          MaximumRanges;
+  MISC_GCD_RANGE *Ranges;
+};
+
+// InternalAddRange
+STATIC
+VOID
+InternalAddRange (
+  IN OUT MISC_GCD_RESOURCE_MAP  *Map,
+  IN     EFI_PHYSICAL_ADDRESS   BaseAddress,
+  IN     UINT64                 Length,
+  IN     UINTN                  GcdType
+  )
+{
+  MISC_GCD_RANGE *Range;
+
+  ASSERT (Map->NumberOfRanges < Map->MaximumRanges);
+
+  // GCD descriptors only differ in attributes and capabilities are still
+  // allocatable in one call, so merge them into one range.
+
+  if (Map->NumberOfRanges > 0) {
+    Range = &Map->Ranges[Map->NumberOfRanges - 1];
+
+    if ((Range->GcdType == GcdType)
+     && ((Range->BaseAddress + Range->Length) == BaseAddress)) {
+      Range->Length += Length;
+
+      return;
+    }
+  }
+
+  Range              = &Map->Ranges[Map->NumberOfRanges];
+  Range->BaseAddress = BaseAddress;
+  Range->Length      = Length;
+  Range->GcdType     = GcdType;
+
+  ++Map->NumberOfRanges;
+}
+
+// MiscGcdRefreshResourceMap
+/** Rebuilds a cached map from the current state of the GCD.
+
+  @param[in, out] Map  The map to refresh.
+
+  @retval EFI_SUCCESS           The map was refreshed.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources to refresh the
+                                map.
+**/
+EFI_STATUS
+MiscGcdRefreshResourceMap (
+  IN OUT MISC_GCD_RESOURCE_MAP  *Map
+  )
+{
+  EFI_STATUS                      Status;
+
+  UINTN                           NumberOfDescriptors;
+  EFI_GCD_MEMORY_SPACE_DESCRIPTOR *MemorySpaceMap;
+  EFI_GCD_IO_SPACE_DESCRIPTOR     *IoSpaceMap;
+  MISC_GCD_RANGE                  *Ranges;
+  UINTN                           Index;
+
+  ASSERT (Map != NULL);
+  ASSERT (!EfiAtRuntime ());
+
+  MemorySpaceMap = NULL;
+  IoSpaceMap     = NULL;
+
+  if (Map->Space == MiscGcdMemorySpace) {
+    Status = DxeGetMemorySpaceMap (&NumberOfDescriptors, &MemorySpaceMap);
+  } else {
+    Status = DxeGetIoSpaceMap (&NumberOfDescriptors, &IoSpaceMap);
+  }
+
+  if (!EFI_ERROR (Status)) {
+    if ((NumberOfDescriptors + MISC_GCD_RANGE_SLACK) > Map->MaximumRanges) {
+      Ranges = AllocatePool (
+                 (NumberOfDescriptors + MISC_GCD_RANGE_SLACK)
+                   * sizeof (*Ranges)
+                 );
+
+      if (Ranges == NULL) {
+        Status = EFI_OUT_OF_RESOURCES;
+        goto Done;
+      }
+
+      if (Map->Ranges != NULL) {
+        FreePool ((VOID *)Map->Ranges);
+      }
+
+      Map->Ranges        = Ranges;
+      Map->MaximumRanges = (NumberOfDescriptors + MISC_GCD_RANGE_SLACK);
+    }
+
+    Map->NumberOfRanges = 0;
+
+    for (Index = 0; Index < NumberOfDescriptors; ++Index) {
+      if (MemorySpaceMap != NULL) {
+        if (MemorySpaceMap[Index].ImageHandle == NULL) {
+          InternalAddRange (
+            Map,
+            MemorySpaceMap[Index].BaseAddress,
+            MemorySpaceMap[Index].Length,
+            (UINTN)MemorySpaceMap[Index].GcdMemoryType
+            );
+        }
+      } else if (IoSpaceMap[Index].ImageHandle == NULL) {
+        InternalAddRange (
+          Map,
+          IoSpaceMap[Index].BaseAddress,
+          IoSpaceMap[Index].Length,
+          (UINTN)IoSpaceMap[Index].GcdIoType
+          );
+      }
+    }
+
+    Map->Stale = FALSE;
+
+  Done:
+    if (MemorySpaceMap != NULL) {
+      FreePool ((VOID *)MemorySpaceMap);
+    }
+
+    if (IoSpaceMap != NULL) {
+      FreePool ((VOID *)IoSpaceMap);
+    }
+  }
+
+  return Status;
+}
+
+// MiscGcdCreateResourceMap
+/** Creates a cached copy of the free ranges of a GCD space.
+
+  @param[in]  Space  The GCD space to cache.
+  @param[out] Map    On output, a pointer to the created map.
+
+  @retval EFI_SUCCESS           The map was created.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources to allocate the
+                                map.
+  @return                       The status of GetMemorySpaceMap() or
+                                GetIoSpaceMap().
+**/
+EFI_STATUS
+MiscGcdCreateResourceMap (
+  IN  MISC_GCD_SPACE         Space,
+  OUT MISC_GCD_RESOURCE_MAP  **Map
+  )
+{
+  EFI_STATUS            Status;
+
+  MISC_GCD_RESOURCE_MAP *NewMap;
+
+  ASSERT ((Space == MiscGcdMemorySpace) || (Space == MiscGcdIoSpace));
+  ASSERT (Map != NULL);
+  ASSERT (!EfiAtRuntime ());
+
+  Status = EFI_OUT_OF_RESOURCES;
+  NewMap = AllocateZeroPool (sizeof (*NewMap));
+
+  if (NewMap != NULL) {
+    NewMap->Space = Space;
+    Status        = MiscGcdRefreshResourceMap (NewMap);
+
+    if (!EFI_ERROR (Status)) {
+      *Map = NewMap;
+    } else {
+      MiscGcdFreeResourceMap (NewMap);
+    }
+  }
+
+  return Status;
+}
+
+// MiscGcdFreeResourceMap
+/** Frees a map created by MiscGcdCreateResourceMap().
+
+  @param[in] Map  The map to free.
+**/
+VOID
+MiscGcdFreeResourceMap (
+  IN MISC_GCD_RESOURCE_MAP  *Map
+  )
+{
+  ASSERT (Map != NULL);
+  ASSERT (!EfiAtRuntime ());
+
+  if (Map->Ranges != NULL) {
+    FreePool ((VOID *)Map->Ranges);
+  }
+
+  FreePool ((VOID *)Map);
+}
+
+// InternalFindBestFit
+STATIC
+BOOLEAN
+InternalFindBestFit (
+  IN  MISC_GCD_RESOURCE_MAP  *Map,
+  IN  UINTN                  GcdType,
+  IN  UINTN                  Alignment,
+  IN  UINT64                 Length,
+  IN  EFI_PHYSICAL_ADDRESS   Minimum,
+  IN  EFI_PHYSICAL_ADDRESS   Maximum,
+  OUT UINTN                  *RangeIndex,
+  OUT EFI_PHYSICAL_ADDRESS   *BaseAddress
+  )
+{
+  BOOLEAN              Found;
+
+  UINT64               AlignMask;
+  MISC_GCD_RANGE       *Range;
+  MISC_GCD_RANGE       *BestRange;
+  EFI_PHYSICAL_ADDRESS Low;
+  EFI_PHYSICAL_ADDRESS High;
+  EFI_PHYSICAL_ADDRESS Bottom;
+  EFI_PHYSICAL_ADDRESS Top;
+  UINTN                Index;
+
+  Found     = FALSE;
+  BestRange = NULL;
+  AlignMask = (LShiftU64 (1, Alignment) - 1);
+
+  for (Index = 0; Index < Map->NumberOfRanges; ++Index) {
+    Range = &Map->Ranges[Index];
+
+    if ((Range->GcdType != GcdType) || (Range->Length < Length)) {
+      continue;
+    }
+
+    // A larger range cannot be a better fit than the current best one.
+
+    if ((BestRange != NULL) && (Range->Length >= BestRange->Length)) {
+      continue;
+    }
+
+    Low  = MAX (Range->BaseAddress, Minimum);
+    High = MIN ((Range->BaseAddress + (Range->Length - 1)), Maximum);
+
+    if ((Low > High) || (Low > (MAX_UINT64 - AlignMask))) {
+      continue;
+    }
+
+    Bottom = ((Low + AlignMask) & ~AlignMask);
+
+    if ((Bottom > High) || ((High - Bottom) < (Length - 1))) {
+      continue;
+    }
+
+    // Place the block at the end of the range that keeps the remainder in
+    // one piece, preferring the top as the GCD does for top-down searches.
+
+    Top = ((High - (Length - 1)) & ~AlignMask);
+
+    if ((Bottom == Range->BaseAddress)
+     && ((Top + (Length - 1)) != (Range->BaseAddress + (Range->Length - 1)))) {
+      *BaseAddress = Bottom;
+    } else {
+      *BaseAddress = Top;
+    }
+
+    *RangeIndex = Index;
+    BestRange   = Range;
+    Found       = TRUE;
+  }
+
+  return Found;
+}
+
+// InternalCarveRange
+STATIC
+EFI_STATUS
+InternalCarveRange (
+  IN OUT MISC_GCD_RESOURCE_MAP  *Map,
+  IN     UINTN                  RangeIndex,
+  IN     EFI_PHYSICAL_ADDRESS   BaseAddress,
+  IN     UINT64                 Length
+  )
+{
+  MISC_GCD_RANGE       *Range;
+  MISC_GCD_RANGE       *Ranges;
+  EFI_PHYSICAL_ADDRESS RangeEnd;
+  EFI_PHYSICAL_ADDRESS BlockEnd;
+
+  Range    = &Map->Ranges[RangeIndex];
+  RangeEnd = (Range->BaseAddress + (Range->Length - 1));
+  BlockEnd = (BaseAddress + (Length - 1));
+
+  ASSERT (BaseAddress >= Range->BaseAddress);
+  ASSERT (BlockEnd <= RangeEnd);
+
+  if ((BaseAddress == Range->BaseAddress) && (BlockEnd == RangeEnd)) {
+    --Map->NumberOfRanges;
+
+    CopyMem (
+      (VOID *)Range,
+      (VOID *)(Range + 1),
+      ((Map->NumberOfRanges - RangeIndex) * sizeof (*Range))
+      );
+  } else if (BaseAddress == Range->BaseAddress) {
+    Range->BaseAddress = (BlockEnd + 1);
+    Range->Length      = (RangeEnd - BlockEnd);
+  } else if (BlockEnd == RangeEnd) {
+    Range->Length = (BaseAddress - Range->BaseAddress);
+  } else {
+    if (Map->NumberOfRanges == Map->MaximumRanges) {
+      Ranges = ReallocatePool (
+                 (Map->MaximumRanges * sizeof (*Ranges)),
+                 ((Map->MaximumRanges + MISC_GCD_RANGE_SLACK)
+                   * sizeof (*Ranges)),
+                 (VOID *)Map->Ranges
+                 );
+
+      if (Ranges == NULL) {
+        // The allocation has been claimed already, the cache only has to be
+        // rebuilt before it is used again.
+        Map->Stale = TRUE;
+
+        return EFI_OUT_OF_RESOURCES;
+      }
+
+      Map->Ranges         = Ranges;
+      Map->MaximumRanges += MISC_GCD_RANGE_SLACK;
+      Range               = &Map->Ranges[RangeIndex];
+    }
+
+    CopyMem (
+      (VOID *)(Range + 2),
+      (VOID *)(Range + 1),
+      ((Map->NumberOfRanges - RangeIndex - 1) * sizeof (*Range))
+      );
+
+    ++Map->NumberOfRanges;
+
+    Range[1].BaseAddress = (BlockEnd + 1);
+    Range[1].Length      = (RangeEnd - BlockEnd);
+    Range[1].GcdType     = Range->GcdType;
+    Range->Length        = (BaseAddress - Range->BaseAddress);
+  }
+
+  return EFI_SUCCESS;
+}
+
+// MiscGcdAllocateResource
+/** Allocates a resource range using a best-fit search over a cached map.
+
+  @param[in]  Map           The cached map to allocate from.
+  @param[in]  GcdType       The EFI_GCD_MEMORY_TYPE or EFI_GCD_IO_TYPE of the
+                            resource, depending on the space of Map.
+  @param[in]  Alignment     The log base 2 of the boundary that BaseAddress
+                            must be aligned on.
+  @param[in]  Length        The size, in bytes, of the resource.
+  @param[in]  Minimum       The lowest address the resource may start at.
+  @param[in]  Maximum       The highest address the resource may end at.
+  @param[in]  ImageHandle   The image handle of the agent that is allocating
+                            the resource.
+  @param[in]  DeviceHandle  The device handle for which the resource is being
+                            allocated.
+  @param[out] BaseAddress   On output, the base address of the resource.
+
+  @retval EFI_SUCCESS           The resource was allocated.
+  @retval EFI_NOT_FOUND         No free range satisfies the request.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources to update the
+                                map.
+**/
+EFI_STATUS
+MiscGcdAllocateResource (
+  IN  MISC_GCD_RESOURCE_MAP  *Map,
+  IN  UINTN                  GcdType,
+  IN  UINTN                  Alignment,
+  IN  UINT64                 Length,
+  IN  EFI_PHYSICAL_ADDRESS   Minimum,
+  IN  EFI_PHYSICAL_ADDRESS   Maximum,
+  IN  EFI_HANDLE             ImageHandle,
+  IN  EFI_HANDLE             DeviceHandle, OPTIONAL
+  OUT EFI_PHYSICAL_ADDRESS   *BaseAddress
+  )
+{
+  EFI_STATUS           Status;
+
+  UINTN                RangeIndex;
+  EFI_PHYSICAL_ADDRESS Address;
+  UINTN                Attempt;
+
+  ASSERT (Map != NULL);
+  ASSERT (Alignment < 64);
+  ASSERT (Length > 0);
+  ASSERT (Minimum <= Maximum);
+  ASSERT (ImageHandle != NULL);
+  ASSERT (BaseAddress != NULL);
+  ASSERT (!EfiAtRuntime ());
+
+  Status = EFI_NOT_FOUND;
+
+  // A second attempt is only made when the core rejected a placement found in
+  // the cache, i.e. when somebody else has allocated from the GCD meanwhile.
+
+  for (Attempt = 0; Attempt < 2; ++Attempt) {
+    if (Map->Stale) {
+      Status = MiscGcdRefreshResourceMap (Map);
+
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+    }
+
+    if (!InternalFindBestFit (
+           Map,
+           GcdType,
+           Alignment,
+           Length,
+           Minimum,
+           Maximum,
+           &RangeIndex,
+           &Address
+           )) {
+      Status = EFI_NOT_FOUND;
+
+      if (Attempt == 0) {
+        Map->Stale = TRUE;
+        continue;
+      }
+
+      break;
+    }
+
+    if (Map->Space == MiscGcdMemorySpace) {
+      Status = DxeAllocateMemorySpace (
+                 EfiGcdAllocateAddress,
+                 (EFI_GCD_MEMORY_TYPE)GcdType,
+                 0,
+                 Length,
+                 &Address,
+                 ImageHandle,
+                 DeviceHandle
+                 );
+    } else {
+      Status = DxeAllocateIoSpace (
+                 EfiGcdAllocateAddress,
+                 (EFI_GCD_IO_TYPE)GcdType,
+                 0,
+                 Length,
+                 &Address,
+                 ImageHandle,
+                 DeviceHandle
+                 );
+    }
+
+    if (!EFI_ERROR (Status)) {
+      *BaseAddress = Address;
+      Status       = InternalCarveRange (Map, RangeIndex, Address, Length);
+
+      if (Status == EFI_OUT_OF_RESOURCES) {
+        Status = EFI_SUCCESS;
+      }
+
+      break;
+    }
+
+    Map->Stale = TRUE;
+  }
+
+  return Status;
+}
+
+// MiscGcdAllocateResources
+/** Places a set of resources, e.g. the BARs behind one bridge, in a single
+    aperture.
+
+  @param[in]      Map                The cached map to allocate from.
+  @param[in]      GcdType            The EFI_GCD_MEMORY_TYPE or EFI_GCD_IO_TYPE
+                                     of the resources.
+  @param[in]      ApertureAlignment  The log base 2 of the minimum alignment
+                                     and granularity of the aperture.
+  @param[in]      Minimum            The lowest address the aperture may start
+                                     at.
+  @param[in]      Maximum            The highest address the aperture may end
+                                     at.
+  @param[in]      ImageHandle        The image handle of the agent that is
+                                     allocating the resources.
+  @param[in]      DeviceHandle       The device handle for which the resources
+                                     are being allocated.
+  @param[in]      NumberOfRequests   The number of entries in Requests.
+  @param[in, out] Requests           The resources to place.
+  @param[out]     ApertureBase       On output, the base of the aperture.
+  @param[out]     ApertureLength     On output, the length of the aperture.
+
+  @retval EFI_SUCCESS           The resources were allocated.
+  @retval EFI_NOT_FOUND         No free range can hold the aperture.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources to plan the
+                                placement.
+**/
+EFI_STATUS
+MiscGcdAllocateResources (
+  IN     MISC_GCD_RESOURCE_MAP      *Map,
+  IN     UINTN                      GcdType,
+  IN     UINTN                      ApertureAlignment,
+  IN     EFI_PHYSICAL_ADDRESS       Minimum,
+  IN     EFI_PHYSICAL_ADDRESS       Maximum,
+  IN     EFI_HANDLE                 ImageHandle,
+  IN     EFI_HANDLE                 DeviceHandle, OPTIONAL
+  IN     UINTN                      NumberOfRequests,
+  IN OUT MISC_GCD_RESOURCE_REQUEST  *Requests,
+  OUT    EFI_PHYSICAL_ADDRESS       *ApertureBase,
+  OUT    UINT64                     *ApertureLength
+  )
+{
+  EFI_STATUS                Status;
+
+  MISC_GCD_RESOURCE_REQUEST **Order;
+  MISC_GCD_RESOURCE_REQUEST *Request;
+  UINTN                     Alignment;
+  UINT64                    AlignMask;
+  UINT64                    Offset;
+  UINTN                     Index;
+  UINTN                     Index2;
+
+  ASSERT (Map != NULL);
+  ASSERT (ApertureAlignment < 64);
+  ASSERT (NumberOfRequests > 0);
+  ASSERT (Requests != NULL);
+  ASSERT (ApertureBase != NULL);
+  ASSERT (ApertureLength != NULL);
+  ASSERT (!EfiAtRuntime ());
+
+  Order = AllocatePool (NumberOfRequests * sizeof (*Order));
+
+  if (Order == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  // Sort by descending alignment, then length.  Bridges have few BARs, so an
+  // insertion sort is sufficient.
+
+  for (Index = 0; Index < NumberOfRequests; ++Index) {
+    ASSERT (Requests[Index].Alignment < 64);
+    ASSERT (Requests[Index].Length > 0);
+
+    Request = &Requests[Index];
+
+    for (Index2 = Index; Index2 > 0; --Index2) {
+      if ((Order[Index2 - 1]->Alignment > Request->Alignment)
+       || ((Order[Index2 - 1]->Alignment == Request->Alignment)
+        && (Order[Index2 - 1]->Length >= Request->Length))) {
+        break;
+      }
+
+      Order[Index2] = Order[Index2 - 1];
+    }
+
+    Order[Index2] = Request;
+  }
+
+  // Plan the offsets.  The most strictly aligned request is first and thereby
+  // determines the alignment of the whole aperture.
+
+  Alignment = MAX (Order[0]->Alignment, ApertureAlignment);
+  Offset    = 0;
+
+  for (Index = 0; Index < NumberOfRequests; ++Index) {
+    AlignMask                  = (LShiftU64 (1, Order[Index]->Alignment) - 1);
+    Offset                     = ((Offset + AlignMask) & ~AlignMask);
+    Order[Index]->BaseAddress  = Offset;
+    Offset                    += Order[Index]->Length;
+  }
+
+  FreePool ((VOID *)Order);
+
+  AlignMask = (LShiftU64 (1, ApertureAlignment) - 1);
+  Offset    = ((Offset + AlignMask) & ~AlignMask);
+  Status    = MiscGcdAllocateResource (
+                Map,
+                GcdType,
+                Alignment,
+                Offset,
+                Minimum,
+                Maximum,
+                ImageHandle,
+                DeviceHandle,
+                ApertureBase
+                );
+
+  if (!EFI_ERROR (Status)) {
+    *ApertureLength = Offset;
+
+    for (Index = 0; Index < NumberOfRequests; ++Index) {
+      Requests[Index].BaseAddress += *ApertureBase;
+    }
+  }
+
+  return Status;
+}
+
+// MiscGcdFreeResource
+/** Frees a resource allocated from a cached map.
+
+  @param[in] Map          The cached map the resource was allocated from.
+  @param[in] BaseAddress  The base address of the resource.
+  @param[in] Length       The size, in bytes, of the resource.
+
+  @return  The status of FreeMemorySpace() or FreeIoSpace().
+**/
+EFI_STATUS
+MiscGcdFreeResource (
+  IN MISC_GCD_RESOURCE_MAP  *Map,
+  IN EFI_PHYSICAL_ADDRESS   BaseAddress,
+  IN UINT64                 Length
+  )
+{
+  EFI_STATUS Status;
+
+  ASSERT (Map != NULL);
+  ASSERT (Length > 0);
+  ASSERT (!EfiAtRuntime ());
+
+  if (Map->Space == MiscGcdMemorySpace) {
+    Status = DxeFreeMemorySpace (BaseAddress, Length);
+  } else {
+    Status = DxeFreeIoSpace (BaseAddress, Length);
+  }
+
+  // The freed range may be merged with neighbours of another type by the
+  // core, so rebuild the cache lazily on the next allocation.
+
+  if (!EFI_ERROR (Status)) {
+    Map->Stale = TRUE;
+  }
+
+  return Status;
+}
@@ -22,6 +22,7 @@
 #include <Library/MemoryAllocationLib.h>
 #include <Library/MiscRuntimeLib.h>
 #include <Library/MiscMemoryLib.h>
+#include <Library/MiscPerformanceLib.h>
 #include <Library/UefiLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 
@@ -49,6 +50,11 @@ GetMemoryMapBuffer (
   ASSERT (MemoryMapSize != NULL);
   ASSERT (!EfiAtRuntime ());
 
+  MISC_PERFORMANCE_BEGIN (
+    MISC_PERFORMANCE_MODULE_MEMORY,
+    MISC_PERFORMANCE_ID_GET_MEMORY_MAP_BUFFER
+    );
+
   MemoryMapBuffer = NULL;
   Size            = 0;
   Status          = GetMemoryMap (
@@ -104,6 +110,11 @@ GetMemoryMapBuffer (
 
   *MemoryMapSize = Size;
 
+  MISC_PERFORMANCE_END (
+    MISC_PERFORMANCE_MODULE_MEMORY,
+    MISC_PERFORMANCE_ID_GET_MEMORY_MAP_BUFFER
+    );
+
   return MemoryMapBuffer;
 }
 
@@ -175,6 +186,11 @@ AllocatePagesFromTop (
   ASSERT (MemoryTop > Pages);
   ASSERT (!EfiAtRuntime ());
 
+  MISC_PERFORMANCE_BEGIN (
+    MISC_PERFORMANCE_MODULE_MEMORY,
+    MISC_PERFORMANCE_ID_ALLOCATE_PAGES_FROM_TOP
+    );
+
   MemoryMap = GetMemoryMapBuffer (
                 gBS->GetMemoryMap,
                 &MemoryMapSize,
@@ -212,5 +228,10 @@ AllocatePagesFromTop (
     FreePool ((VOID *)MemoryMap);
   }
 
+  MISC_PERFORMANCE_END (
+    MISC_PERFORMANCE_MODULE_MEMORY,
+    MISC_PERFORMANCE_ID_ALLOCATE_PAGES_FROM_TOP
+    );
+
   return (VOID *)(UINTN)MemoryTop;
 }
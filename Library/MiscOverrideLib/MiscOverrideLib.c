@@ -0,0 +1,373 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/EfiBootServicesLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/MiscOverrideLib.h>
+#include <Library/MiscRuntimeLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+// MISC_OVERRIDE_MAX_DIRTY_TABLES
+#define MISC_OVERRIDE_MAX_DIRTY_TABLES  4
+
+// MISC_OVERRIDE
+struct MISC_OVERRIDE {
+  LIST_ENTRY       Link;       ///< Links the overrides, newest first.
+  EFI_TABLE_HEADER *Table;     ///< The header of the modified table.
+  UINTN            Offset;     ///< The offset of the service in Table.
+  VOID             *Hook;      ///< The installed function.
+  VOID             **Original; ///< The next function in the chain.
+};
+
+// OVERRIDE_FROM_LINK
+#define OVERRIDE_FROM_LINK(Entry)  BASE_CR ((Entry), MISC_OVERRIDE, Link)
+
+// OVERRIDE_SLOT
+#define OVERRIDE_SLOT(Override)  \
+  ((VOID **)((UINTN)(Override)->Table + (Override)->Offset))
+
+// mOverrides
+STATIC LIST_ENTRY mOverrides = INITIALIZE_LIST_HEAD_VARIABLE (mOverrides);
+
+// mBatchDepth
+STATIC UINTN mBatchDepth = 0;
+
+// mDirtyTables
+STATIC EFI_TABLE_HEADER *mDirtyTables[MISC_OVERRIDE_MAX_DIRTY_TABLES];
+
+// mNumberOfDirtyTables
+STATIC UINTN mNumberOfDirtyTables = 0;
+
+// InternalUpdateDirtyTables
+STATIC
+VOID
+InternalUpdateDirtyTables (
+  VOID
+  )
+{
+  EFI_TPL OldTpl;
+  UINTN   Index;
+
+  OldTpl = EfiRaiseTPL (TPL_HIGH_LEVEL);
+
+  for (Index = 0; Index < mNumberOfDirtyTables; ++Index) {
+    UPDATE_EFI_TABLE_HEADER_CRC32 (*mDirtyTables[Index]);
+  }
+
+  mNumberOfDirtyTables = 0;
+
+  EfiRestoreTPL (OldTpl);
+}
+
+// InternalMarkTableDirty
+STATIC
+VOID
+InternalMarkTableDirty (
+  IN EFI_TABLE_HEADER  *Table
+  )
+{
+  UINTN Index;
+
+  for (Index = 0; Index < mNumberOfDirtyTables; ++Index) {
+    if (mDirtyTables[Index] == Table) {
+      return;
+    }
+  }
+
+  if (mNumberOfDirtyTables == MISC_OVERRIDE_MAX_DIRTY_TABLES) {
+    InternalUpdateDirtyTables ();
+  }
+
+  mDirtyTables[mNumberOfDirtyTables] = Table;
+  ++mNumberOfDirtyTables;
+}
+
+// MiscOverrideBeginBatch
+/** Starts a batch of hook and unhook operations.
+
+  The CRC32 of the modified tables is updated once by the matching
+  MiscOverrideEndBatch() call rather than by every operation.  Batches may be
+  nested.
+**/
+VOID
+MiscOverrideBeginBatch (
+  VOID
+  )
+{
+  ASSERT (!EfiAtRuntime ());
+
+  ++mBatchDepth;
+}
+
+// MiscOverrideEndBatch
+/** Ends a batch of hook and unhook operations and updates the CRC32 of the
+    tables modified during it.
+**/
+VOID
+MiscOverrideEndBatch (
+  VOID
+  )
+{
+  ASSERT (mBatchDepth > 0);
+
+  --mBatchDepth;
+
+  if (mBatchDepth == 0) {
+    InternalUpdateDirtyTables ();
+  }
+}
+
+// MiscOverrideHook
+/** Replaces a service of an EFI table with a hook.
+
+  The hook calls through Original to reach the next hook in the chain, or the
+  original service.  Original must stay valid until the hook has been
+  removed, as it is updated when a hook installed earlier is removed.
+
+  @param[in]  Table     The header of the table to modify, e.g. &gBS->Hdr.
+  @param[in]  Offset    The offset of the service within the table, e.g.
+                        MISC_OVERRIDE_BOOT_SERVICE (AllocatePool).
+  @param[in]  Hook      The function to install.
+  @param[out] Original  The location receiving the function replaced.
+  @param[out] Override  On output, the handle to pass to MiscOverrideUnhook().
+
+  @retval EFI_SUCCESS           The hook has been installed.
+  @retval EFI_OUT_OF_RESOURCES  The hook could not be tracked.
+**/
+EFI_STATUS
+MiscOverrideHook (
+  IN  EFI_TABLE_HEADER  *Table,
+  IN  UINTN             Offset,
+  IN  VOID              *Hook,
+  OUT VOID              **Original,
+  OUT MISC_OVERRIDE     **Override
+  )
+{
+  MISC_OVERRIDE *NewOverride;
+  VOID          **Slot;
+  EFI_TPL       OldTpl;
+
+  ASSERT (Table != NULL);
+  ASSERT (Offset >= sizeof (*Table));
+  ASSERT ((Offset + sizeof (VOID *)) <= Table->HeaderSize);
+  ASSERT ((Offset % sizeof (VOID *)) == 0);
+  ASSERT (Hook != NULL);
+  ASSERT (Original != NULL);
+  ASSERT (Override != NULL);
+  ASSERT (!EfiAtRuntime ());
+
+  NewOverride = AllocatePool (sizeof (*NewOverride));
+
+  if (NewOverride == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NewOverride->Table    = Table;
+  NewOverride->Offset   = Offset;
+  NewOverride->Hook     = Hook;
+  NewOverride->Original = Original;
+
+  Slot = OVERRIDE_SLOT (NewOverride);
+
+  MiscOverrideBeginBatch ();
+
+  // Original is set before the hook is installed, so that the hook can never
+  // be called with it unset.
+
+  OldTpl    = EfiRaiseTPL (TPL_HIGH_LEVEL);
+  *Original = *Slot;
+  *Slot     = Hook;
+  EfiRestoreTPL (OldTpl);
+
+  InsertHeadList (&mOverrides, &NewOverride->Link);
+  InternalMarkTableDirty (Table);
+
+  MiscOverrideEndBatch ();
+
+  *Override = NewOverride;
+
+  return EFI_SUCCESS;
+}
+
+// MiscOverrideBootService
+/** Replaces a service of the Boot Services Table with a hook.
+
+  @param[in]  Offset    The offset of the service within the table, e.g.
+                        MISC_OVERRIDE_BOOT_SERVICE (AllocatePool).
+  @param[in]  Hook      The function to install.
+  @param[out] Original  The location receiving the function replaced.
+  @param[out] Override  On output, the handle to pass to MiscOverrideUnhook().
+
+  @retval EFI_SUCCESS           The hook has been installed.
+  @retval EFI_OUT_OF_RESOURCES  The hook could not be tracked.
+**/
+EFI_STATUS
+MiscOverrideBootService (
+  IN  UINTN          Offset,
+  IN  VOID           *Hook,
+  OUT VOID           **Original,
+  OUT MISC_OVERRIDE  **Override
+  )
+{
+  return MiscOverrideHook (&gBS->Hdr, Offset, Hook, Original, Override);
+}
+
+// MiscOverrideRuntimeService
+/** Replaces a service of the Runtime Services Table with a hook.
+
+  The hook and Original are not converted when the virtual address map is
+  set.  Hooks that stay installed at runtime must convert both themselves.
+
+  @param[in]  Offset    The offset of the service within the table, e.g.
+                        MISC_OVERRIDE_RUNTIME_SERVICE (GetVariable).
+  @param[in]  Hook      The function to install.
+  @param[out] Original  The location receiving the function replaced.
+  @param[out] Override  On output, the handle to pass to MiscOverrideUnhook().
+
+  @retval EFI_SUCCESS           The hook has been installed.
+  @retval EFI_OUT_OF_RESOURCES  The hook could not be tracked.
+**/
+EFI_STATUS
+MiscOverrideRuntimeService (
+  IN  UINTN          Offset,
+  IN  VOID           *Hook,
+  OUT VOID           **Original,
+  OUT MISC_OVERRIDE  **Override
+  )
+{
+  return MiscOverrideHook (&gRT->Hdr, Offset, Hook, Original, Override);
+}
+
+// MiscOverrideUnhook
+/** Removes a hook installed by MiscOverrideHook().
+
+  Hooks may be removed in any order.  When a hook installed later by this
+  library sits above the removed one, its Original is redirected to the
+  function the removed hook replaced.
+
+  @param[in] Override  The handle returned by MiscOverrideHook().
+
+  @retval EFI_SUCCESS        The hook has been removed.
+  @retval EFI_ACCESS_DENIED  A hook not installed by this library has replaced
+                             the hook, which hence cannot be removed safely.
+**/
+EFI_STATUS
+MiscOverrideUnhook (
+  IN MISC_OVERRIDE  *Override
+  )
+{
+  EFI_STATUS    Status;
+
+  MISC_OVERRIDE *Above;
+  MISC_OVERRIDE *Entry;
+  LIST_ENTRY    *Link;
+  VOID          **Slot;
+  EFI_TPL       OldTpl;
+
+  ASSERT (Override != NULL);
+  ASSERT (!EfiAtRuntime ());
+
+  // The overrides are linked newest first, hence the last override of the
+  // same service found before Override is the one directly above it.
+
+  Above = NULL;
+
+  for (
+    Link = GetFirstNode (&mOverrides);
+    Link != &Override->Link;
+    Link = GetNextNode (&mOverrides, Link)
+    ) {
+    ASSERT (!IsNull (&mOverrides, Link));
+
+    Entry = OVERRIDE_FROM_LINK (Link);
+
+    if ((Entry->Table == Override->Table)
+     && (Entry->Offset == Override->Offset)) {
+      Above = Entry;
+    }
+  }
+
+  Slot   = OVERRIDE_SLOT (Override);
+  Status = EFI_ACCESS_DENIED;
+
+  MiscOverrideBeginBatch ();
+
+  OldTpl = EfiRaiseTPL (TPL_HIGH_LEVEL);
+
+  if (Above != NULL) {
+    if (*Above->Original == Override->Hook) {
+      *Above->Original = *Override->Original;
+      Status           = EFI_SUCCESS;
+    }
+  } else if (*Slot == Override->Hook) {
+    *Slot  = *Override->Original;
+    Status = EFI_SUCCESS;
+
+    InternalMarkTableDirty (Override->Table);
+  }
+
+  EfiRestoreTPL (OldTpl);
+
+  MiscOverrideEndBatch ();
+
+  if (!EFI_ERROR (Status)) {
+    RemoveEntryList (&Override->Link);
+    FreePool ((VOID *)Override);
+  }
+
+  return Status;
+}
+
+// MiscOverrideUnhookAll
+/** Removes all hooks installed by this library instance in the reverse order
+    of their installation, within a single batch.
+
+  @retval EFI_SUCCESS        All hooks have been removed.
+  @retval EFI_ACCESS_DENIED  A hook could not be removed safely.  The hooks
+                             installed before it are left in place.
+**/
+EFI_STATUS
+MiscOverrideUnhookAll (
+  VOID
+  )
+{
+  EFI_STATUS Status;
+
+  ASSERT (!EfiAtRuntime ());
+
+  Status = EFI_SUCCESS;
+
+  MiscOverrideBeginBatch ();
+
+  while (!IsListEmpty (&mOverrides)) {
+    Status = MiscOverrideUnhook (
+               OVERRIDE_FROM_LINK (GetFirstNode (&mOverrides))
+               );
+
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+  }
+
+  MiscOverrideEndBatch ();
+
+  return Status;
+}
@@ -0,0 +1,370 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#include <Uefi.h>
+
+#include <IndustryStandard/FpdtRecord.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/EfiBootServicesLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/MiscPerformanceLib.h>
+#include <Library/MiscRuntimeLib.h>
+#include <Library/PrintLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiLib.h>
+
+// PERFORMANCE_RECORDS
+#define PERFORMANCE_RECORDS(Table)  \
+  ((MISC_PERFORMANCE_RECORD *)((UINTN)(Table) + (Table)->HeaderSize))
+
+// mTable
+/// The table is shared by all modules through the configuration table.
+STATIC MISC_PERFORMANCE_TABLE *mTable = NULL;
+
+// mModuleNames
+STATIC CONST CHAR8 *mModuleNames[] = {
+  NULL,
+  "File",
+  "Memory",
+  "Event",
+  "Variable",
+  "Dispatch"
+};
+
+// MISC_PERFORMANCE_NUMBER_OF_MODULE_NAMES
+#define MISC_PERFORMANCE_NUMBER_OF_MODULE_NAMES  \
+  (sizeof (mModuleNames) / sizeof (mModuleNames[0]))
+
+// InternalGetTable
+STATIC
+MISC_PERFORMANCE_TABLE *
+InternalGetTable (
+  VOID
+  )
+{
+  if (mTable == NULL) {
+    EfiGetSystemConfigurationTable (&gMiscPerformanceGuid, (VOID **)&mTable);
+  }
+
+  return mTable;
+}
+
+// InternalGetNumberOfRecords
+STATIC
+UINT32
+InternalGetNumberOfRecords (
+  IN CONST MISC_PERFORMANCE_TABLE  *Table
+  )
+{
+  return MIN (Table->NextRecord, Table->NumberOfRecords);
+}
+
+// InternalTicksToNs
+/** Converts a counter value into the time since processor reset, as FPDT
+    timestamps are.  BaseTicks is only a reference for the raw records.
+**/
+STATIC
+UINT64
+InternalTicksToNs (
+  IN CONST MISC_PERFORMANCE_TABLE  *Table,
+  IN UINT64                        Ticks
+  )
+{
+  UINT64 Counter;
+
+  if (Table->CounterStart > Table->CounterEnd) {
+    Counter = (Table->CounterStart - Ticks);
+  } else {
+    Counter = (Ticks - Table->CounterStart);
+  }
+
+  return GetTimeInNanoSecond (Counter);
+}
+
+// MiscPerformanceCreateTable
+/** Creates the performance record table and installs it as a configuration
+    table, so that the library instances of all modules record into it.
+
+  The table should be created by an early DXE driver.  Records are dropped
+  while no table exists.
+
+  @param[in] NumberOfRecords  The number of records the table can hold.
+
+  @retval EFI_SUCCESS           The table has been created.
+  @retval EFI_ALREADY_STARTED   A table has been created before.
+  @retval EFI_OUT_OF_RESOURCES  The table could not be allocated.
+**/
+EFI_STATUS
+MiscPerformanceCreateTable (
+  IN UINTN  NumberOfRecords
+  )
+{
+  EFI_STATUS             Status;
+
+  MISC_PERFORMANCE_TABLE *Table;
+
+  ASSERT (NumberOfRecords > 0);
+  ASSERT (NumberOfRecords <= MAX_UINT32);
+  ASSERT (!EfiAtRuntime ());
+
+  if (InternalGetTable () != NULL) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  Table = AllocateReservedPool (
+            sizeof (*Table)
+              + (NumberOfRecords * sizeof (MISC_PERFORMANCE_RECORD))
+            );
+
+  if (Table == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Table->Signature       = MISC_PERFORMANCE_SIGNATURE;
+  Table->HeaderSize      = sizeof (*Table);
+  Table->NumberOfRecords = (UINT32)NumberOfRecords;
+  Table->NextRecord      = 0;
+  Table->Frequency       = GetPerformanceCounterProperties (
+                             &Table->CounterStart,
+                             &Table->CounterEnd
+                             );
+
+  Table->BaseTicks = GetPerformanceCounter ();
+
+  Status = EfiInstallConfigurationTable (&gMiscPerformanceGuid, Table);
+
+  if (EFI_ERROR (Status)) {
+    FreePool ((VOID *)Table);
+  } else {
+    mTable = Table;
+  }
+
+  return Status;
+}
+
+// MiscPerformanceRecord
+/** Adds a record to the performance record table.
+
+  The record is dropped when no table has been created, the table is full, or
+  ExitBootServices() has been called.  The function may be called at any TPL
+  and on any processor.
+
+  @param[in] ModuleId  The module ID of the record.
+  @param[in] Type      The record type.
+  @param[in] Id        The module-specific record ID.
+**/
+VOID
+MiscPerformanceRecord (
+  IN UINT16  ModuleId,
+  IN UINT8   Type,
+  IN UINT32  Id
+  )
+{
+  MISC_PERFORMANCE_TABLE  *Table;
+  MISC_PERFORMANCE_RECORD *Record;
+  UINT64                  Ticks;
+  UINT32                  Index;
+
+  ASSERT (Type <= MISC_PERFORMANCE_RECORD_POINT);
+
+  // The cached table pointer is physical and cannot be dereferenced once the
+  // virtual address map has been set.
+
+  if (EfiAtRuntime ()) {
+    return;
+  }
+
+  Ticks = GetPerformanceCounter ();
+  Table = InternalGetTable ();
+
+  if (Table == NULL) {
+    return;
+  }
+
+  // NextRecord keeps counting once the table is full, which tells the number
+  // of dropped records.
+
+  Index = (InterlockedIncrement (&Table->NextRecord) - 1);
+
+  if (Index >= Table->NumberOfRecords) {
+    return;
+  }
+
+  Record           = &PERFORMANCE_RECORDS (Table)[Index];
+  Record->Ticks    = Ticks;
+  Record->ModuleId = ModuleId;
+  Record->Type     = Type;
+  Record->Reserved = 0;
+  Record->Id       = Id;
+}
+
+// MiscPerformanceGetTable
+/** Returns the performance record table as a raw binary for host-side
+    analysis.
+
+  @param[out] Table      On output, a pointer to the table.  The table is
+                         owned by the library and keeps growing.
+  @param[out] TableSize  On output, the size, in bytes, of the header and the
+                         records written so far.
+
+  @retval EFI_SUCCESS    The table has been returned.
+  @retval EFI_NOT_FOUND  No table has been created.
+**/
+EFI_STATUS
+MiscPerformanceGetTable (
+  OUT CONST MISC_PERFORMANCE_TABLE  **Table,
+  OUT UINTN                         *TableSize
+  )
+{
+  MISC_PERFORMANCE_TABLE *PerformanceTable;
+
+  ASSERT (Table != NULL);
+  ASSERT (TableSize != NULL);
+
+  PerformanceTable = InternalGetTable ();
+
+  if (PerformanceTable == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  *Table     = PerformanceTable;
+  *TableSize = (PerformanceTable->HeaderSize
+                 + (InternalGetNumberOfRecords (PerformanceTable)
+                     * sizeof (MISC_PERFORMANCE_RECORD)));
+
+  return EFI_SUCCESS;
+}
+
+// MiscPerformanceGetFpdtRecords
+/** Exports the performance records as an FPDT dynamic string event record
+    stream.
+
+  Begin and end records are exported with the MODULE_START and MODULE_END
+  progress IDs, point records with a progress ID of zero.  The GUID of all
+  records is gMiscPerformanceGuid, the string holds the module and record ID.
+  Like all FPDT timestamps, the timestamps count from processor reset rather
+  than from BaseTicks.
+
+  @param[out] Buffer      On output, a pointer to the record stream.  The
+                          caller is responsible for freeing it.
+  @param[out] BufferSize  On output, the size, in bytes, of Buffer.
+
+  @retval EFI_SUCCESS           The records were exported.
+  @retval EFI_NOT_FOUND         No records have been collected.
+  @retval EFI_OUT_OF_RESOURCES  The record stream could not be allocated.
+**/
+EFI_STATUS
+MiscPerformanceGetFpdtRecords (
+  OUT VOID   **Buffer,
+  OUT UINTN  *BufferSize
+  )
+{
+  MISC_PERFORMANCE_TABLE           *Table;
+  CONST MISC_PERFORMANCE_RECORD    *Records;
+  FPDT_DYNAMIC_STRING_EVENT_RECORD *FpdtRecords;
+  UINT32                           NumberOfRecords;
+  UINT32                           Index;
+
+  ASSERT (Buffer != NULL);
+  ASSERT (BufferSize != NULL);
+  ASSERT (!EfiAtRuntime ());
+
+  Table = InternalGetTable ();
+
+  if (Table == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  NumberOfRecords = InternalGetNumberOfRecords (Table);
+
+  if (NumberOfRecords == 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  FpdtRecords = AllocateZeroPool (NumberOfRecords * sizeof (*FpdtRecords));
+
+  if (FpdtRecords == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *Buffer     = (VOID *)FpdtRecords;
+  *BufferSize = (NumberOfRecords * sizeof (*FpdtRecords));
+
+  Records = PERFORMANCE_RECORDS (Table);
+
+  for (Index = 0; Index < NumberOfRecords; ++Index) {
+    FpdtRecords->Header.Type     = FPDT_DYNAMIC_STRING_EVENT_RECORD_TYPE;
+    FpdtRecords->Header.Length   = sizeof (*FpdtRecords);
+    FpdtRecords->Header.Revision = FPDT_RECORD_REVISION_1;
+
+    switch (Records[Index].Type) {
+      case MISC_PERFORMANCE_RECORD_BEGIN:
+      {
+        FpdtRecords->ProgressId = FPDT_MODULE_START_ID;
+        break;
+      }
+
+      case MISC_PERFORMANCE_RECORD_END:
+      {
+        FpdtRecords->ProgressId = FPDT_MODULE_END_ID;
+        break;
+      }
+
+      default:
+      {
+        FpdtRecords->ProgressId = 0;
+        break;
+      }
+    }
+
+    FpdtRecords->ApicId    = 0;
+    FpdtRecords->Timestamp = InternalTicksToNs (Table, Records[Index].Ticks);
+
+    CopyMem (
+      (VOID *)&FpdtRecords->Guid,
+      (VOID *)&gMiscPerformanceGuid,
+      sizeof (FpdtRecords->Guid)
+      );
+
+    if ((Records[Index].ModuleId < MISC_PERFORMANCE_NUMBER_OF_MODULE_NAMES)
+     && (mModuleNames[Records[Index].ModuleId] != NULL)) {
+      AsciiSPrint (
+        FpdtRecords->String,
+        sizeof (FpdtRecords->String),
+        "%a:%x",
+        mModuleNames[Records[Index].ModuleId],
+        Records[Index].Id
+        );
+    } else {
+      AsciiSPrint (
+        FpdtRecords->String,
+        sizeof (FpdtRecords->String),
+        "%04x:%x",
+        Records[Index].ModuleId,
+        Records[Index].Id
+        );
+    }
+
+    ++FpdtRecords;
+  }
+
+  return EFI_SUCCESS;
+}
@@ -139,8 +139,8 @@ RuntimeDriverLibDeconstruct (
 {
   // Close SetVirtualAddressMap () notify function
 
-  EfiCloseEvent (mEfiVirtualNotifyEvent);
-  EfiCloseEvent (mEfiExitBootServicesEvent);
+  MiscCloseEvent (mEfiVirtualNotifyEvent);
+  MiscCloseEvent (mEfiExitBootServicesEvent);
 
   return EFI_SUCCESS;
 }
@@ -0,0 +1,515 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiSmm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MiscSmiDispatchLib.h>
+#include <Library/SmmServicesLib.h>
+
+// MISC_SMI_DISPATCH_BUCKETS
+/// The number of hash buckets for the tables.  Must be a power of two.
+#define MISC_SMI_DISPATCH_BUCKETS  16
+
+// MISC_SMI_DISPATCH_ENTRY
+typedef struct {
+  EFI_SMM_HANDLER_ENTRY_POINT2 Handler;     ///< The command handler, or NULL.
+  MISC_SMI_DISPATCH_STATISTICS Statistics;  ///< The statistics of Handler.
+} MISC_SMI_DISPATCH_ENTRY;
+
+// MISC_SMI_DISPATCH_TABLE
+/// The entries, indexed by command number, follow the structure.
+struct MISC_SMI_DISPATCH_TABLE {
+  MISC_SMI_DISPATCH_TABLE *NextByType;       ///< The next table in the
+                                             ///< bucket of HandlerType.
+  MISC_SMI_DISPATCH_TABLE *NextByHandle;     ///< The next table in the
+                                             ///< bucket of DispatchHandle.
+  EFI_GUID                HandlerType;       ///< The dispatched handler type.
+  EFI_HANDLE              DispatchHandle;    ///< The handle of the root
+                                             ///< handler.
+  UINTN                   NumberOfCommands;  ///< The number of entries.
+};
+
+// DISPATCH_ENTRIES
+#define DISPATCH_ENTRIES(Table)  ((MISC_SMI_DISPATCH_ENTRY *)((Table) + 1))
+
+// mTablesByType
+/// The tables, hashed by handler type for MiscSmiDispatchManage().
+STATIC MISC_SMI_DISPATCH_TABLE *mTablesByType[MISC_SMI_DISPATCH_BUCKETS];
+
+// mTablesByHandle
+/// The tables, hashed by the handle of their root handler, as the SMM Core
+/// passes no other context to it.
+STATIC MISC_SMI_DISPATCH_TABLE *mTablesByHandle[MISC_SMI_DISPATCH_BUCKETS];
+
+// InternalHashGuid
+STATIC
+UINTN
+InternalHashGuid (
+  IN CONST EFI_GUID  *Guid
+  )
+{
+  CONST UINT32 *Data;
+
+  Data = (CONST UINT32 *)Guid;
+
+  return ((Data[0] ^ Data[1] ^ Data[2] ^ Data[3])
+            & (MISC_SMI_DISPATCH_BUCKETS - 1));
+}
+
+// InternalHashHandle
+STATIC
+UINTN
+InternalHashHandle (
+  IN EFI_HANDLE  Handle
+  )
+{
+  // Handles are pool allocations, hence the low bits carry no information.
+  return (((UINTN)Handle >> 4) & (MISC_SMI_DISPATCH_BUCKETS - 1));
+}
+
+// InternalFindTableByType
+STATIC
+MISC_SMI_DISPATCH_TABLE *
+InternalFindTableByType (
+  IN CONST EFI_GUID  *HandlerType
+  )
+{
+  MISC_SMI_DISPATCH_TABLE *Table;
+
+  for (Table = mTablesByType[InternalHashGuid (HandlerType)];
+       Table != NULL;
+       Table = Table->NextByType) {
+    if (CompareGuid (&Table->HandlerType, HandlerType)) {
+      break;
+    }
+  }
+
+  return Table;
+}
+
+// InternalDispatch
+/** Routes an SMI to the handler of the command in the communication buffer.
+
+  @param[in]     Table           The table to dispatch with.
+  @param[in]     Context         Points to an optional context buffer.
+  @param[in,out] CommBuffer      Points to the optional communication buffer.
+  @param[in,out] CommBufferSize  Points to the size of the optional
+                                 communication buffer.
+  @param[in]     Unhandled       The status to return if the command is not
+                                 handled.
+
+  @return  The status returned by the command handler, or Unhandled if the
+           command is not handled.
+**/
+STATIC
+EFI_STATUS
+InternalDispatch (
+  IN     MISC_SMI_DISPATCH_TABLE  *Table,
+  IN     CONST VOID               *Context, OPTIONAL
+  IN OUT VOID                     *CommBuffer, OPTIONAL
+  IN OUT UINTN                    *CommBufferSize, OPTIONAL
+  IN     EFI_STATUS               Unhandled
+  )
+{
+  EFI_STATUS                   Status;
+
+  MISC_SMI_DISPATCH_ENTRY      *Entry;
+  MISC_SMI_DISPATCH_STATISTICS *Statistics;
+  UINTN                        Command;
+  UINT64                       Start;
+  UINT64                       Cycles;
+
+  if ((CommBuffer == NULL)
+   || (CommBufferSize == NULL)
+   || (*CommBufferSize < sizeof (Command))) {
+    return Unhandled;
+  }
+
+  CopyMem ((VOID *)&Command, CommBuffer, sizeof (Command));
+
+  if (Command >= Table->NumberOfCommands) {
+    return Unhandled;
+  }
+
+  Entry = &DISPATCH_ENTRIES (Table)[Command];
+
+  if (Entry->Handler == NULL) {
+    return Unhandled;
+  }
+
+  Start  = AsmReadTsc ();
+  Status = Entry->Handler (
+                    Table->DispatchHandle,
+                    Context,
+                    CommBuffer,
+                    CommBufferSize
+                    );
+
+  Cycles     = (AsmReadTsc () - Start);
+  Statistics = &Entry->Statistics;
+
+  ++Statistics->NumberOfCalls;
+  Statistics->TotalCycles += Cycles;
+
+  if (Cycles > Statistics->MaximumCycles) {
+    Statistics->MaximumCycles = Cycles;
+  }
+
+  return Status;
+}
+
+// InternalSmiDispatchHandler
+/** The root handler of all tables.
+
+  The SMM Core asserts on any status but the ones defined for SMI handlers,
+  hence SMIs that are not handled are reported as pending rather than as
+  EFI_NOT_FOUND.  SmiManage() then returns EFI_NOT_FOUND if no other handler
+  has handled the SMI, so that Communicate() does not report success for an
+  unknown command.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmiDispatchHandler (
+  IN     EFI_HANDLE  DispatchHandle,
+  IN     CONST VOID  *Context, OPTIONAL
+  IN OUT VOID        *CommBuffer, OPTIONAL
+  IN OUT UINTN       *CommBufferSize OPTIONAL
+  )
+{
+  MISC_SMI_DISPATCH_TABLE *Table;
+
+  for (Table = mTablesByHandle[InternalHashHandle (DispatchHandle)];
+       Table != NULL;
+       Table = Table->NextByHandle) {
+    if (Table->DispatchHandle == DispatchHandle) {
+      return InternalDispatch (
+               Table,
+               Context,
+               CommBuffer,
+               CommBufferSize,
+               EFI_WARN_INTERRUPT_SOURCE_PENDING
+               );
+    }
+  }
+
+  ASSERT (FALSE);
+
+  return EFI_WARN_INTERRUPT_SOURCE_PENDING;
+}
+
+// MiscSmiDispatchCreateTable
+/** Creates a dispatch table and registers it as the SMI handler for a handler
+    type.
+
+  @param[in]  HandlerType       The handler type to dispatch.
+  @param[in]  NumberOfCommands  The number of commands.  Valid command numbers
+                                are 0 to NumberOfCommands - 1.
+  @param[out] Table             On output, a pointer to the table.
+
+  @retval EFI_SUCCESS           The table was created.
+  @retval EFI_ALREADY_STARTED   A table for HandlerType already exists.
+  @retval EFI_OUT_OF_RESOURCES  The table could not be allocated.
+**/
+EFI_STATUS
+MiscSmiDispatchCreateTable (
+  IN  CONST EFI_GUID           *HandlerType,
+  IN  UINTN                    NumberOfCommands,
+  OUT MISC_SMI_DISPATCH_TABLE  **Table
+  )
+{
+  EFI_STATUS              Status;
+
+  MISC_SMI_DISPATCH_TABLE *NewTable;
+  UINTN                   Size;
+  UINTN                   Bucket;
+
+  ASSERT (HandlerType != NULL);
+  ASSERT (NumberOfCommands > 0);
+  ASSERT (Table != NULL);
+
+  if (InternalFindTableByType (HandlerType) != NULL) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  Size   = (sizeof (*NewTable)
+              + (NumberOfCommands * sizeof (MISC_SMI_DISPATCH_ENTRY)));
+  Status = SmmAllocatePool (EfiRuntimeServicesData, Size, (VOID **)&NewTable);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ZeroMem ((VOID *)NewTable, Size);
+
+  CopyGuid (&NewTable->HandlerType, HandlerType);
+
+  NewTable->NumberOfCommands = NumberOfCommands;
+
+  Status = SmiHandlerRegister (
+             InternalSmiDispatchHandler,
+             HandlerType,
+             &NewTable->DispatchHandle
+             );
+
+  if (EFI_ERROR (Status)) {
+    SmmFreePool ((VOID *)NewTable);
+
+    return Status;
+  }
+
+  Bucket                  = InternalHashGuid (HandlerType);
+  NewTable->NextByType    = mTablesByType[Bucket];
+  mTablesByType[Bucket]   = NewTable;
+  Bucket                  = InternalHashHandle (NewTable->DispatchHandle);
+  NewTable->NextByHandle  = mTablesByHandle[Bucket];
+  mTablesByHandle[Bucket] = NewTable;
+
+  *Table = NewTable;
+
+  return EFI_SUCCESS;
+}
+
+// MiscSmiDispatchDestroyTable
+/** Unregisters and frees a dispatch table.
+
+  @param[in] Table  The table returned by MiscSmiDispatchCreateTable().
+**/
+VOID
+MiscSmiDispatchDestroyTable (
+  IN MISC_SMI_DISPATCH_TABLE  *Table
+  )
+{
+  MISC_SMI_DISPATCH_TABLE **Link;
+
+  ASSERT (Table != NULL);
+
+  SmiHandlerUnRegister (Table->DispatchHandle);
+
+  for (Link = &mTablesByType[InternalHashGuid (&Table->HandlerType)];
+       *Link != Table;
+       Link = &(*Link)->NextByType) {
+    ASSERT (*Link != NULL);
+  }
+
+  *Link = Table->NextByType;
+
+  for (Link = &mTablesByHandle[InternalHashHandle (Table->DispatchHandle)];
+       *Link != Table;
+       Link = &(*Link)->NextByHandle) {
+    ASSERT (*Link != NULL);
+  }
+
+  *Link = Table->NextByHandle;
+
+  SmmFreePool ((VOID *)Table);
+}
+
+// MiscSmiDispatchRegister
+/** Registers the handler of a command.
+
+  The handler is passed the whole communication buffer, including the command
+  number.
+
+  @param[in] Table    The table returned by MiscSmiDispatchCreateTable().
+  @param[in] Command  The command number to handle.
+  @param[in] Handler  The handler of the command.
+
+  @retval EFI_SUCCESS            The handler was registered.
+  @retval EFI_INVALID_PARAMETER  Command is out of range.
+  @retval EFI_ALREADY_STARTED    A handler for Command is already registered.
+**/
+EFI_STATUS
+MiscSmiDispatchRegister (
+  IN MISC_SMI_DISPATCH_TABLE       *Table,
+  IN UINTN                         Command,
+  IN EFI_SMM_HANDLER_ENTRY_POINT2  Handler
+  )
+{
+  MISC_SMI_DISPATCH_ENTRY *Entry;
+
+  ASSERT (Table != NULL);
+  ASSERT (Handler != NULL);
+
+  if (Command >= Table->NumberOfCommands) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Entry = &DISPATCH_ENTRIES (Table)[Command];
+
+  if (Entry->Handler != NULL) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  Entry->Handler = Handler;
+
+  return EFI_SUCCESS;
+}
+
+// MiscSmiDispatchUnregister
+/** Unregisters the handler of a command and resets its statistics.
+
+  @param[in] Table    The table returned by MiscSmiDispatchCreateTable().
+  @param[in] Command  The command number to unregister the handler of.
+
+  @retval EFI_SUCCESS    The handler was unregistered.
+  @retval EFI_NOT_FOUND  No handler is registered for Command.
+**/
+EFI_STATUS
+MiscSmiDispatchUnregister (
+  IN MISC_SMI_DISPATCH_TABLE  *Table,
+  IN UINTN                    Command
+  )
+{
+  MISC_SMI_DISPATCH_ENTRY *Entry;
+
+  ASSERT (Table != NULL);
+
+  if (Command >= Table->NumberOfCommands) {
+    return EFI_NOT_FOUND;
+  }
+
+  Entry = &DISPATCH_ENTRIES (Table)[Command];
+
+  if (Entry->Handler == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  ZeroMem ((VOID *)Entry, sizeof (*Entry));
+
+  return EFI_SUCCESS;
+}
+
+// MiscSmiDispatchManage
+/** Dispatches an SMI of a handler type like SmiManage(), routing it through
+    the dispatch table of the type if one exists.
+
+  The table is found by a hash of HandlerType and the command by indexing,
+  without walking the SMI handlers registered with the SMST.
+
+  @param[in]     HandlerType     The handler type.
+  @param[in]     Context         Points to an optional context buffer.
+  @param[in,out] CommBuffer      Points to the optional communication buffer.
+  @param[in,out] CommBufferSize  Points to the size of the optional
+                                 communication buffer.
+
+  @return  The status returned by the command handler, by SmiManage() if there
+           is no table for HandlerType, or EFI_NOT_FOUND if the command is not
+           handled, as SmiManage() returns when the SMI handler of the table
+           reports EFI_WARN_INTERRUPT_SOURCE_PENDING for such commands.
+**/
+EFI_STATUS
+MiscSmiDispatchManage (
+  IN     CONST EFI_GUID  *HandlerType,
+  IN     CONST VOID      *Context, OPTIONAL
+  IN OUT VOID            *CommBuffer, OPTIONAL
+  IN OUT UINTN           *CommBufferSize OPTIONAL
+  )
+{
+  MISC_SMI_DISPATCH_TABLE *Table;
+
+  ASSERT (HandlerType != NULL);
+
+  Table = InternalFindTableByType (HandlerType);
+
+  if (Table == NULL) {
+    return SmiManage (HandlerType, Context, CommBuffer, CommBufferSize);
+  }
+
+  return InternalDispatch (
+           Table,
+           Context,
+           CommBuffer,
+           CommBufferSize,
+           EFI_NOT_FOUND
+           );
+}
+
+// MiscSmiDispatchGetStatistics
+/** Returns the statistics of a command handler.
+
+  @param[in]  Table       The table returned by MiscSmiDispatchCreateTable().
+  @param[in]  Command     The command number.
+  @param[out] Statistics  On output, the statistics of the command handler.
+**/
+VOID
+MiscSmiDispatchGetStatistics (
+  IN  CONST MISC_SMI_DISPATCH_TABLE  *Table,
+  IN  UINTN                          Command,
+  OUT MISC_SMI_DISPATCH_STATISTICS   *Statistics
+  )
+{
+  ASSERT (Table != NULL);
+  ASSERT (Command < Table->NumberOfCommands);
+  ASSERT (Statistics != NULL);
+
+  CopyMem (
+    (VOID *)Statistics,
+    (VOID *)&DISPATCH_ENTRIES (Table)[Command].Statistics,
+    sizeof (*Statistics)
+    );
+}
+
+// MiscSmiDispatchDumpStatistics
+/** Prints the statistics of all registered command handlers to the debug
+    output.
+
+  @param[in] Table  The table returned by MiscSmiDispatchCreateTable().
+**/
+VOID
+MiscSmiDispatchDumpStatistics (
+  IN CONST MISC_SMI_DISPATCH_TABLE  *Table
+  )
+{
+  CONST MISC_SMI_DISPATCH_ENTRY *Entry;
+  UINT64                        Average;
+  UINTN                         Command;
+
+  ASSERT (Table != NULL);
+
+  DEBUG ((DEBUG_INFO, "SMI dispatch table %g:\n", &Table->HandlerType));
+  DEBUG ((DEBUG_INFO, "  Command      Calls    Avg cycles    Max cycles\n"));
+
+  for (Command = 0; Command < Table->NumberOfCommands; ++Command) {
+    Entry = &DISPATCH_ENTRIES (Table)[Command];
+
+    if (Entry->Handler == NULL) {
+      continue;
+    }
+
+    Average = 0;
+
+    if (Entry->Statistics.NumberOfCalls > 0) {
+      Average = DivU64x64Remainder (
+                  Entry->Statistics.TotalCycles,
+                  Entry->Statistics.NumberOfCalls,
+                  NULL
+                  );
+    }
+
+    DEBUG ((
+      DEBUG_INFO,
+      "  %7u %10lu %13lu %13lu\n",
+      (UINT32)Command,
+      Entry->Statistics.NumberOfCalls,
+      Average,
+      Entry->Statistics.MaximumCycles
+      ));
+  }
+}
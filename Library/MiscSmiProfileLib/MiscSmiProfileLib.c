@@ -0,0 +1,331 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiSmm.h>
+
+#include <Guid/MiscSmiProfile.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MiscSmiProfileLib.h>
+#include <Library/SmmMemLib.h>
+#include <Library/SmmServicesLib.h>
+
+// SMI_PROFILE_BUCKETS
+/// The number of hash buckets for the profiles.  Must be a power of two.
+#define SMI_PROFILE_BUCKETS  32
+
+// SMI_PROFILE
+typedef struct SMI_PROFILE SMI_PROFILE;
+
+// SMI_PROFILE
+struct SMI_PROFILE {
+  SMI_PROFILE                  *Next;           ///< The next profile in the
+                                                ///< bucket.
+  EFI_HANDLE                   DispatchHandle;  ///< The handle of the
+                                                ///< profiled handler.
+  EFI_SMM_HANDLER_ENTRY_POINT2 Handler;         ///< The profiled handler.
+  MISC_SMI_PROFILE_RECORD      Record;          ///< The collected profile.
+};
+
+// mProfiles
+/// The profiles, hashed by the dispatch handle of the profiled handler, as
+/// the SMM Core passes no other context to the handler.
+STATIC SMI_PROFILE *mProfiles[SMI_PROFILE_BUCKETS];
+
+// mNumberOfProfiles
+STATIC UINT32 mNumberOfProfiles = 0;
+
+// mSnapshotHandle
+STATIC EFI_HANDLE mSnapshotHandle = NULL;
+
+// InternalHashHandle
+STATIC
+UINTN
+InternalHashHandle (
+  IN EFI_HANDLE  Handle
+  )
+{
+  // Handles are pool allocations, hence the low bits carry no information.
+  return (((UINTN)Handle >> 4) & (SMI_PROFILE_BUCKETS - 1));
+}
+
+// InternalProfiledHandler
+/** Calls the profiled handler registered with DispatchHandle and records the
+    duration of the call.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalProfiledHandler (
+  IN     EFI_HANDLE  DispatchHandle,
+  IN     CONST VOID  *Context, OPTIONAL
+  IN OUT VOID        *CommBuffer, OPTIONAL
+  IN OUT UINTN       *CommBufferSize OPTIONAL
+  )
+{
+  EFI_STATUS              Status;
+
+  SMI_PROFILE             *Profile;
+  MISC_SMI_PROFILE_RECORD *Record;
+  UINT64                  Start;
+  UINT64                  Cycles;
+  INTN                    Bucket;
+
+  for (Profile = mProfiles[InternalHashHandle (DispatchHandle)];
+       Profile != NULL;
+       Profile = Profile->Next) {
+    if (Profile->DispatchHandle == DispatchHandle) {
+      break;
+    }
+  }
+
+  if (Profile == NULL) {
+    ASSERT (FALSE);
+
+    return EFI_WARN_INTERRUPT_SOURCE_PENDING;
+  }
+
+  Start  = AsmReadTsc ();
+  Status = Profile->Handler (
+                      DispatchHandle,
+                      Context,
+                      CommBuffer,
+                      CommBufferSize
+                      );
+
+  Cycles = (AsmReadTsc () - Start);
+  Record = &Profile->Record;
+  Bucket = HighBitSet64 (Cycles);
+
+  if (Bucket < 0) {
+    Bucket = 0;
+  } else if (Bucket >= MISC_SMI_PROFILE_NUMBER_OF_BUCKETS) {
+    Bucket = (MISC_SMI_PROFILE_NUMBER_OF_BUCKETS - 1);
+  }
+
+  ++Record->Histogram[Bucket];
+  ++Record->NumberOfCalls;
+  Record->TotalCycles += Cycles;
+
+  if (Cycles > Record->MaximumCycles) {
+    Record->MaximumCycles = Cycles;
+  }
+
+  return Status;
+}
+
+// InternalSnapshotHandler
+/** Appends the profiles of this driver to a MISC_SMI_PROFILE_SNAPSHOT.
+
+  The handler of every driver using this library is registered with the same
+  handler type, so the status returned lets the SMM Core call all of them.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSnapshotHandler (
+  IN     EFI_HANDLE  DispatchHandle,
+  IN     CONST VOID  *Context, OPTIONAL
+  IN OUT VOID        *CommBuffer, OPTIONAL
+  IN OUT UINTN       *CommBufferSize OPTIONAL
+  )
+{
+  MISC_SMI_PROFILE_SNAPSHOT *Snapshot;
+  MISC_SMI_PROFILE_RECORD   *Records;
+  SMI_PROFILE               *Profile;
+  UINTN                     BufferSize;
+  UINTN                     Capacity;
+  UINT32                    NumberOfRecords;
+  UINTN                     Index;
+
+  if ((CommBuffer == NULL) || (CommBufferSize == NULL)) {
+    return EFI_WARN_INTERRUPT_SOURCE_QUIESCED;
+  }
+
+  // Read all caller-controlled values once, so they cannot change between the
+  // validation and their use.
+
+  BufferSize = *CommBufferSize;
+
+  if ((BufferSize < sizeof (*Snapshot))
+   || !SmmIsBufferOutsideSmmValid (
+         (EFI_PHYSICAL_ADDRESS)(UINTN)CommBuffer,
+         BufferSize
+         )) {
+    DEBUG ((DEBUG_ERROR, "SMI profile: Invalid communication buffer\n"));
+
+    return EFI_WARN_INTERRUPT_SOURCE_QUIESCED;
+  }
+
+  Snapshot        = (MISC_SMI_PROFILE_SNAPSHOT *)CommBuffer;
+  Records         = (MISC_SMI_PROFILE_RECORD *)(Snapshot + 1);
+  Capacity        = ((BufferSize - sizeof (*Snapshot)) / sizeof (*Records));
+  NumberOfRecords = Snapshot->NumberOfRecords;
+
+  if (NumberOfRecords > Capacity) {
+    return EFI_WARN_INTERRUPT_SOURCE_QUIESCED;
+  }
+
+  for (Index = 0; Index < SMI_PROFILE_BUCKETS; ++Index) {
+    for (Profile = mProfiles[Index];
+         (Profile != NULL) && (NumberOfRecords < Capacity);
+         Profile = Profile->Next) {
+      CopyMem (
+        (VOID *)&Records[NumberOfRecords],
+        (VOID *)&Profile->Record,
+        sizeof (*Records)
+        );
+
+      ++NumberOfRecords;
+    }
+  }
+
+  Snapshot->NumberOfRecords       = NumberOfRecords;
+  Snapshot->TotalNumberOfRecords += mNumberOfProfiles;
+
+  return EFI_WARN_INTERRUPT_SOURCE_QUIESCED;
+}
+
+// MiscSmiProfileHandlerRegister
+/** Registers an SMI handler like SmiHandlerRegister() and profiles its calls.
+
+  @param[in]  Handler         The handler to register.
+  @param[in]  HandlerType     Points to the handler type or NULL for root SMI
+                              handlers.
+  @param[out] DispatchHandle  On return, contains a unique handle which can be
+                              used to later unregister the handler function.
+
+  @retval EFI_SUCCESS           The handler was registered.
+  @retval EFI_OUT_OF_RESOURCES  The profile could not be allocated.
+**/
+EFI_STATUS
+MiscSmiProfileHandlerRegister (
+  IN  EFI_SMM_HANDLER_ENTRY_POINT2  Handler,
+  IN  CONST EFI_GUID                *HandlerType, OPTIONAL
+  OUT EFI_HANDLE                    *DispatchHandle
+  )
+{
+  EFI_STATUS  Status;
+
+  SMI_PROFILE *Profile;
+  UINTN       Bucket;
+
+  ASSERT (Handler != NULL);
+  ASSERT (DispatchHandle != NULL);
+
+  if (mSnapshotHandle == NULL) {
+    Status = SmiHandlerRegister (
+               InternalSnapshotHandler,
+               &gMiscSmiProfileGuid,
+               &mSnapshotHandle
+               );
+
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  Status = SmmAllocatePool (
+             EfiRuntimeServicesData,
+             sizeof (*Profile),
+             (VOID **)&Profile
+             );
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ZeroMem ((VOID *)Profile, sizeof (*Profile));
+
+  if (HandlerType != NULL) {
+    CopyGuid (&Profile->Record.HandlerType, HandlerType);
+  }
+
+  Profile->Handler        = Handler;
+  Profile->Record.Handler = (UINT64)(UINTN)Handler;
+
+  Status = SmiHandlerRegister (
+             InternalProfiledHandler,
+             HandlerType,
+             &Profile->DispatchHandle
+             );
+
+  if (EFI_ERROR (Status)) {
+    SmmFreePool ((VOID *)Profile);
+
+    return Status;
+  }
+
+  Bucket            = InternalHashHandle (Profile->DispatchHandle);
+  Profile->Next     = mProfiles[Bucket];
+  mProfiles[Bucket] = Profile;
+
+  ++mNumberOfProfiles;
+
+  *DispatchHandle = Profile->DispatchHandle;
+
+  return EFI_SUCCESS;
+}
+
+// MiscSmiProfileHandlerUnRegister
+/** Unregisters a handler registered by MiscSmiProfileHandlerRegister() and
+    discards its profile.
+
+  @param[in] DispatchHandle  The handle returned by
+                             MiscSmiProfileHandlerRegister().
+
+  @retval EFI_SUCCESS            The handler was unregistered.
+  @retval EFI_INVALID_PARAMETER  DispatchHandle does not refer to a profiled
+                                 handler.
+**/
+EFI_STATUS
+MiscSmiProfileHandlerUnRegister (
+  IN EFI_HANDLE  DispatchHandle
+  )
+{
+  EFI_STATUS  Status;
+
+  SMI_PROFILE **Link;
+  SMI_PROFILE *Profile;
+
+  for (Link = &mProfiles[InternalHashHandle (DispatchHandle)];
+       *Link != NULL;
+       Link = &(*Link)->Next) {
+    if ((*Link)->DispatchHandle == DispatchHandle) {
+      break;
+    }
+  }
+
+  Profile = *Link;
+
+  if (Profile == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = SmiHandlerUnRegister (DispatchHandle);
+
+  if (!EFI_ERROR (Status)) {
+    *Link = Profile->Next;
+
+    --mNumberOfProfiles;
+
+    SmmFreePool ((VOID *)Profile);
+  }
+
+  return Status;
+}
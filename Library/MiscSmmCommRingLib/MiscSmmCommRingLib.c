@@ -0,0 +1,289 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#include <PiDxe.h>
+
+#include <Guid/MiscSmmCommRing.h>
+
+#include <Protocol/SmmCommunication.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/EfiBootServicesLib.h>
+#include <Library/MiscSmmCommRingLib.h>
+
+// SMM_COMM_RING_BUFFER_SIZE
+#define SMM_COMM_RING_BUFFER_SIZE  \
+  (OFFSET_OF (EFI_SMM_COMMUNICATE_HEADER, Data)  \
+    + sizeof (MISC_SMM_COMM_RING_MESSAGE))
+
+// MISC_SMM_COMM_RING
+/// The communication buffer and the ring follow the structure within the same
+/// allocation.
+struct MISC_SMM_COMM_RING {
+  EFI_SMM_COMMUNICATION_PROTOCOL *Communication;  ///< The protocol to trigger
+                                                  ///< SMIs with.
+  EFI_SMM_COMMUNICATE_HEADER     *CommBuffer;     ///< The communication
+                                                  ///< buffer.
+  MISC_SMM_COMM_RING_HEADER      *Header;         ///< The ring.
+  UINT32                         Size;            ///< The size, in bytes, of
+                                                  ///< the ring.
+};
+
+// COMM_RING_MESSAGE
+#define COMM_RING_MESSAGE(Ring)  \
+  ((MISC_SMM_COMM_RING_MESSAGE *)(Ring)->CommBuffer->Data)
+
+// InternalCommRingCommunicate
+STATIC
+EFI_STATUS
+InternalCommRingCommunicate (
+  IN MISC_SMM_COMM_RING  *Ring,
+  IN UINT64              Command
+  )
+{
+  EFI_STATUS                 Status;
+
+  MISC_SMM_COMM_RING_MESSAGE *Message;
+  UINTN                      CommSize;
+
+  Message = COMM_RING_MESSAGE (Ring);
+
+  CopyGuid (&Ring->CommBuffer->HeaderGuid, &gMiscSmmCommRingGuid);
+
+  Ring->CommBuffer->MessageLength = sizeof (*Message);
+
+  Message->Command     = Command;
+  Message->Status      = (UINT64)EFI_PROTOCOL_ERROR;
+  Message->RingAddress = (UINT64)(UINTN)Ring->Header;
+  Message->RingSize    = Ring->Size;
+
+  CommSize = SMM_COMM_RING_BUFFER_SIZE;
+  Status   = Ring->Communication->Communicate (
+                                    Ring->Communication,
+                                    (VOID *)Ring->CommBuffer,
+                                    &CommSize
+                                    );
+
+  if (!EFI_ERROR (Status)) {
+    Status = (EFI_STATUS)Message->Status;
+  }
+
+  return Status;
+}
+
+// MiscSmmCommRingCreate
+/** Allocates a communication ring and registers it with the SMI handler
+    installed by SmmInstallCommRing().
+
+  The ring is allocated as runtime memory and stays registered until the
+  system is reset, hence it is never freed.
+
+  @param[in]  Size  The size, in bytes, of the ring data.
+  @param[out] Ring  On output, a pointer to the ring.
+
+  @retval EFI_SUCCESS           The ring was created.
+  @retval EFI_NOT_FOUND         The SMM Communication Protocol is not
+                                installed.
+  @retval EFI_OUT_OF_RESOURCES  The ring could not be allocated.
+  @retval EFI_ACCESS_DENIED     A ring has already been registered.
+  @retval other                 The ring could not be registered.
+**/
+EFI_STATUS
+MiscSmmCommRingCreate (
+  IN  UINTN               Size,
+  OUT MISC_SMM_COMM_RING  **Ring
+  )
+{
+  EFI_STATUS                     Status;
+
+  EFI_SMM_COMMUNICATION_PROTOCOL *Communication;
+  MISC_SMM_COMM_RING             *NewRing;
+  EFI_PHYSICAL_ADDRESS           Address;
+  UINTN                          RingOffset;
+  UINTN                          TotalSize;
+
+  ASSERT (Size > 0);
+  ASSERT (Ring != NULL);
+
+  Status = EfiLocateProtocol (
+             &gEfiSmmCommunicationProtocolGuid,
+             NULL,
+             (VOID **)&Communication
+             );
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  RingOffset = ALIGN_VALUE (
+                 sizeof (*NewRing) + SMM_COMM_RING_BUFFER_SIZE,
+                 sizeof (UINT64)
+                 );
+
+  Size = (sizeof (MISC_SMM_COMM_RING_HEADER)
+            + ALIGN_VALUE (Size, sizeof (UINT64)));
+
+  if (Size > (MAX_UINT32 - RingOffset)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  TotalSize = (RingOffset + Size);
+  Status    = EfiAllocatePages (
+                AllocateAnyPages,
+                EfiRuntimeServicesData,
+                EFI_SIZE_TO_PAGES (TotalSize),
+                &Address
+                );
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  NewRing                = (MISC_SMM_COMM_RING *)(UINTN)Address;
+  NewRing->Communication = Communication;
+  NewRing->CommBuffer    = (EFI_SMM_COMMUNICATE_HEADER *)(NewRing + 1);
+  NewRing->Header        = (MISC_SMM_COMM_RING_HEADER *)(
+                             (UINTN)NewRing + RingOffset
+                             );
+  NewRing->Size          = (UINT32)Size;
+
+  NewRing->Header->Signature = MISC_SMM_COMM_RING_SIGNATURE;
+  NewRing->Header->Reserved  = 0;
+
+  MiscSmmCommRingReset (NewRing);
+
+  Status = InternalCommRingCommunicate (
+             NewRing,
+             MiscSmmCommRingCommandRegister
+             );
+
+  if (EFI_ERROR (Status)) {
+    EfiFreePages (Address, EFI_SIZE_TO_PAGES (TotalSize));
+  } else {
+    *Ring = NewRing;
+  }
+
+  return Status;
+}
+
+// MiscSmmCommRingEnqueue
+/** Appends a request to a ring.
+
+  The request data is written by the caller to the data buffer of the entry.
+  After MiscSmmCommRingSubmit() has returned, the entry holds the response and
+  the status of the handler.
+
+  @param[in]  Ring         The ring returned by MiscSmmCommRingCreate().
+  @param[in]  HandlerType  The type of the SMI handler to process the request.
+  @param[in]  RequestSize  The size, in bytes, of the request.
+  @param[in]  BufferSize   The size, in bytes, of the data buffer to reserve.
+                           Must be at least RequestSize.
+  @param[out] Entry        On output, a pointer to the entry.
+
+  @retval EFI_SUCCESS           The entry was appended.
+  @retval EFI_OUT_OF_RESOURCES  The ring is full.
+**/
+EFI_STATUS
+MiscSmmCommRingEnqueue (
+  IN  MISC_SMM_COMM_RING        *Ring,
+  IN  CONST EFI_GUID            *HandlerType,
+  IN  UINTN                     RequestSize,
+  IN  UINTN                     BufferSize,
+  OUT MISC_SMM_COMM_RING_ENTRY  **Entry
+  )
+{
+  MISC_SMM_COMM_RING_HEADER *Header;
+  MISC_SMM_COMM_RING_ENTRY  *NewEntry;
+  UINTN                     EntrySize;
+
+  ASSERT (Ring != NULL);
+  ASSERT (HandlerType != NULL);
+  ASSERT (RequestSize <= BufferSize);
+  ASSERT (Entry != NULL);
+
+  Header = Ring->Header;
+
+  if (BufferSize > (Ring->Size - Header->Tail - sizeof (*NewEntry))) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  EntrySize = ALIGN_VALUE (sizeof (*NewEntry) + BufferSize, sizeof (UINT64));
+
+  if (EntrySize > (Ring->Size - Header->Tail)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NewEntry = (MISC_SMM_COMM_RING_ENTRY *)((UINTN)Header + Header->Tail);
+
+  CopyGuid (&NewEntry->HandlerType, HandlerType);
+
+  NewEntry->EntrySize = (UINT32)EntrySize;
+  NewEntry->DataSize  = (UINT32)RequestSize;
+  NewEntry->Status    = (UINT64)EFI_NOT_STARTED;
+
+  Header->Tail += (UINT32)EntrySize;
+  ++Header->NumberOfEntries;
+
+  *Entry = NewEntry;
+
+  return EFI_SUCCESS;
+}
+
+// MiscSmmCommRingSubmit
+/** Processes all entries of a ring with a single SMI.
+
+  @param[in] Ring  The ring returned by MiscSmmCommRingCreate().
+
+  @retval EFI_SUCCESS            All entries were processed.  The status of
+                                 each entry is returned in the entry.
+  @retval EFI_INVALID_PARAMETER  The ring has been rejected as malformed.
+  @retval other                  The SMI could not be triggered.
+**/
+EFI_STATUS
+MiscSmmCommRingSubmit (
+  IN MISC_SMM_COMM_RING  *Ring
+  )
+{
+  ASSERT (Ring != NULL);
+
+  if (Ring->Header->NumberOfEntries == 0) {
+    return EFI_SUCCESS;
+  }
+
+  return InternalCommRingCommunicate (Ring, MiscSmmCommRingCommandDrain);
+}
+
+// MiscSmmCommRingReset
+/** Removes all entries from a ring.
+
+  The entries returned by MiscSmmCommRingEnqueue() must not be used
+  afterwards.
+
+  @param[in] Ring  The ring returned by MiscSmmCommRingCreate().
+**/
+VOID
+MiscSmmCommRingReset (
+  IN MISC_SMM_COMM_RING  *Ring
+  )
+{
+  ASSERT (Ring != NULL);
+
+  Ring->Header->Tail            = sizeof (*Ring->Header);
+  Ring->Header->NumberOfEntries = 0;
+}
@@ -0,0 +1,465 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/EfiBootServicesLib.h>
+#include <Library/MiscEventLib.h>
+#include <Library/MiscUsbHidKeyRepeatLib.h>
+#include <Library/TimerLib.h>
+
+// KEY_REPEAT_MAX_KEYS
+#define KEY_REPEAT_MAX_KEYS  \
+  (USB_HID_KB_KP_NUMBER_OF_MODIFIERS + USB_HID_KB_BOOT_REPORT_NUMBER_OF_KEYS)
+
+// KEY_REPEAT_KEY
+typedef struct {
+  UINT8   KeyCode;          ///< The USB Keycode of the held key.
+  BOOLEAN ReleasePending;   ///< Whether the key has been released within
+                            ///< the debounce time.
+  UINT64  ReleaseDeadline;  ///< The time the release is forwarded at.
+} KEY_REPEAT_KEY;
+
+// MISC_USB_HID_KEY_REPEAT
+struct MISC_USB_HID_KEY_REPEAT {
+  EFI_EVENT                      Timer;              ///< The timer driving
+                                                     ///< all deadlines.
+  MISC_USB_HID_KEY_REPEAT_NOTIFY Notify;             ///< Receives the events.
+  VOID                           *Context;           ///< Passed to Notify.
+  UINT64                         Delay;              ///< The repeat delay.
+  UINT64                         Rate;               ///< The repeat period.
+  UINT64                         DebounceTime;       ///< The release delay.
+  UINT64                         CounterStart;       ///< The first value of
+                                                     ///< the counter.
+  UINT64                         CounterEnd;         ///< The last value of
+                                                     ///< the counter.
+  UINT64                         CounterLast;        ///< The counter at the
+                                                     ///< last time read.
+  UINT64                         CounterTicks;       ///< The ticks counted
+                                                     ///< since creation.
+  UINT8                          RepeatKeyCode;      ///< The repeated key, or
+                                                     ///< 0.
+  UINT64                         RepeatDeadline;     ///< The time of the next
+                                                     ///< repeat.
+  UINT64                         RepeatRate;         ///< The repeat period
+                                                     ///< of the repeated key.
+  UINTN                          NumberOfKeys;       ///< The number of held
+                                                     ///< keys.
+  KEY_REPEAT_KEY                 Keys[KEY_REPEAT_MAX_KEYS];
+};
+
+// InternalKeyRepeatGetTime
+/** Returns the time, in 100 ns units, since the engine was created.
+
+  The performance counter may wrap, e.g. the 24-bit ACPI timer every few
+  seconds, hence the ticks since the last read are accumulated modulo the
+  range of the counter.  The time is accurate as long as it is read at least
+  once per period of the counter.  While a deadline is pending, this holds if
+  the repeat delay, the rate and the debounce time are shorter than the period.
+  Idle time may be lost, which does not matter as no deadline spans it.
+**/
+STATIC
+UINT64
+InternalKeyRepeatGetTime (
+  IN OUT MISC_USB_HID_KEY_REPEAT  *KeyRepeat
+  )
+{
+  UINT64 Counter;
+  UINT64 Ticks;
+
+  Counter = GetPerformanceCounter ();
+
+  if (KeyRepeat->CounterStart > KeyRepeat->CounterEnd) {
+    // The counter decrements from CounterStart to CounterEnd.
+    if (Counter <= KeyRepeat->CounterLast) {
+      Ticks = (KeyRepeat->CounterLast - Counter);
+    } else {
+      Ticks = ((KeyRepeat->CounterLast - KeyRepeat->CounterEnd)
+                + (KeyRepeat->CounterStart - Counter) + 1);
+    }
+  } else if (Counter >= KeyRepeat->CounterLast) {
+    Ticks = (Counter - KeyRepeat->CounterLast);
+  } else {
+    Ticks = ((KeyRepeat->CounterEnd - KeyRepeat->CounterLast)
+              + (Counter - KeyRepeat->CounterStart) + 1);
+  }
+
+  KeyRepeat->CounterLast   = Counter;
+  KeyRepeat->CounterTicks += Ticks;
+
+  return DivU64x32 (GetTimeInNanoSecond (KeyRepeat->CounterTicks), 100);
+}
+
+// InternalKeyRepeatFindKey
+STATIC
+KEY_REPEAT_KEY *
+InternalKeyRepeatFindKey (
+  IN MISC_USB_HID_KEY_REPEAT  *KeyRepeat,
+  IN UINT8                    KeyCode
+  )
+{
+  UINTN Index;
+
+  for (Index = 0; Index < KeyRepeat->NumberOfKeys; ++Index) {
+    if (KeyRepeat->Keys[Index].KeyCode == KeyCode) {
+      return &KeyRepeat->Keys[Index];
+    }
+  }
+
+  return NULL;
+}
+
+// InternalKeyRepeatRelease
+/** Forwards the release of a key and stops tracking it.
+**/
+STATIC
+VOID
+InternalKeyRepeatRelease (
+  IN MISC_USB_HID_KEY_REPEAT  *KeyRepeat,
+  IN UINT8                    KeyCode,
+  IN KEY_REPEAT_KEY           *Key OPTIONAL
+  )
+{
+  if (KeyRepeat->RepeatKeyCode == KeyCode) {
+    KeyRepeat->RepeatKeyCode = 0;
+  }
+
+  if (Key != NULL) {
+    --KeyRepeat->NumberOfKeys;
+
+    *Key = KeyRepeat->Keys[KeyRepeat->NumberOfKeys];
+  }
+
+  KeyRepeat->Notify (KeyCode, FALSE, KeyRepeat->Context);
+}
+
+// InternalKeyRepeatArmTimer
+/** Arms the timer for the earliest pending deadline, or cancels it if there
+    is none.
+**/
+STATIC
+VOID
+InternalKeyRepeatArmTimer (
+  IN MISC_USB_HID_KEY_REPEAT  *KeyRepeat,
+  IN UINT64                   Now
+  )
+{
+  UINT64  Deadline;
+  BOOLEAN Pending;
+  UINTN   Index;
+
+  Deadline = MAX_UINT64;
+  Pending  = FALSE;
+
+  if (KeyRepeat->RepeatKeyCode != 0) {
+    Deadline = KeyRepeat->RepeatDeadline;
+    Pending  = TRUE;
+  }
+
+  for (Index = 0; Index < KeyRepeat->NumberOfKeys; ++Index) {
+    if (KeyRepeat->Keys[Index].ReleasePending
+     && (KeyRepeat->Keys[Index].ReleaseDeadline < Deadline)) {
+      Deadline = KeyRepeat->Keys[Index].ReleaseDeadline;
+      Pending  = TRUE;
+    }
+  }
+
+  if (!Pending) {
+    MiscCancelTimer (KeyRepeat->Timer);
+    return;
+  }
+
+  EfiSetTimer (
+    KeyRepeat->Timer,
+    TimerRelative,
+    ((Deadline > Now) ? (Deadline - Now) : 0)
+    );
+}
+
+// InternalKeyRepeatTimerNotify
+/** Forwards the releases and repeats that are due and rearms the timer.
+**/
+STATIC
+VOID
+EFIAPI
+InternalKeyRepeatTimerNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  MISC_USB_HID_KEY_REPEAT *KeyRepeat;
+  UINT64                  Now;
+  UINT64                  Missed;
+  UINTN                   Index;
+  KEY_REPEAT_KEY          *Key;
+  BOOLEAN                 RepeatReleasePending;
+
+  KeyRepeat = (MISC_USB_HID_KEY_REPEAT *)Context;
+  Now       = InternalKeyRepeatGetTime (KeyRepeat);
+
+  for (Index = 0; Index < KeyRepeat->NumberOfKeys;) {
+    Key = &KeyRepeat->Keys[Index];
+
+    if (Key->ReleasePending && (Key->ReleaseDeadline <= Now)) {
+      // The last key is moved to Index.
+      InternalKeyRepeatRelease (KeyRepeat, Key->KeyCode, Key);
+    } else {
+      ++Index;
+    }
+  }
+
+  if ((KeyRepeat->RepeatKeyCode != 0)
+   && (KeyRepeat->RepeatDeadline <= Now)) {
+    // Repeats missed under load are dropped rather than delivered in a burst,
+    // and the deadline keeps its phase, so the rate stays steady.
+    Missed = DivU64x64Remainder (
+               Now - KeyRepeat->RepeatDeadline,
+               KeyRepeat->RepeatRate,
+               NULL
+               );
+
+    KeyRepeat->RepeatDeadline += MultU64x64 (
+                                   Missed + 1,
+                                   KeyRepeat->RepeatRate
+                                   );
+
+    Key                  = InternalKeyRepeatFindKey (
+                             KeyRepeat,
+                             KeyRepeat->RepeatKeyCode
+                             );
+    RepeatReleasePending = (BOOLEAN)((Key != NULL) && Key->ReleasePending);
+
+    if (!RepeatReleasePending) {
+      KeyRepeat->Notify (
+                   (MISC_USB_HID_KEY_EVENT)(
+                     KeyRepeat->RepeatKeyCode | MISC_USB_HID_KEY_EVENT_PRESSED
+                     ),
+                   TRUE,
+                   KeyRepeat->Context
+                   );
+    }
+  }
+
+  InternalKeyRepeatArmTimer (KeyRepeat, Now);
+}
+
+// MiscUsbHidCreateKeyRepeat
+/** Creates a key repeat engine.
+
+  The engine tracks the held keys and repeats the most recently pressed
+  non-modifier key.  All repeats and delayed releases are driven by a single
+  timer event, which is only armed while there is a deadline pending.
+
+  @param[in]  Delay         The time, in 100 ns units, before a held key is
+                            repeated.
+  @param[in]  Rate          The time, in 100 ns units, between two repeats.
+  @param[in]  DebounceTime  The time, in 100 ns units, releases are delayed
+                            by.  A release followed by a press of the same
+                            key within this time is dropped along with the
+                            press.  0 disables debouncing.
+  @param[in]  Notify        The function to receive the key events.
+  @param[in]  Context       The context to pass to Notify.
+  @param[out] KeyRepeat     On output, a pointer to the engine.
+
+  @retval EFI_SUCCESS           The engine was created.
+  @retval EFI_OUT_OF_RESOURCES  The engine could not be allocated.
+**/
+EFI_STATUS
+MiscUsbHidCreateKeyRepeat (
+  IN  UINT64                          Delay,
+  IN  UINT64                          Rate,
+  IN  UINT64                          DebounceTime,
+  IN  MISC_USB_HID_KEY_REPEAT_NOTIFY  Notify,
+  IN  VOID                            *Context, OPTIONAL
+  OUT MISC_USB_HID_KEY_REPEAT         **KeyRepeat
+  )
+{
+  EFI_STATUS              Status;
+
+  MISC_USB_HID_KEY_REPEAT *NewKeyRepeat;
+
+  ASSERT (Rate > 0);
+  ASSERT (Notify != NULL);
+  ASSERT (KeyRepeat != NULL);
+
+  Status = EfiAllocatePool (
+             EfiBootServicesData,
+             sizeof (*NewKeyRepeat),
+             (VOID **)&NewKeyRepeat
+             );
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  NewKeyRepeat->Notify         = Notify;
+  NewKeyRepeat->Context        = Context;
+  NewKeyRepeat->Delay          = Delay;
+  NewKeyRepeat->Rate           = Rate;
+  NewKeyRepeat->DebounceTime   = DebounceTime;
+  NewKeyRepeat->RepeatKeyCode  = 0;
+  NewKeyRepeat->RepeatDeadline = 0;
+  NewKeyRepeat->RepeatRate     = Rate;
+  NewKeyRepeat->NumberOfKeys   = 0;
+  NewKeyRepeat->CounterTicks   = 0;
+
+  GetPerformanceCounterProperties (
+    &NewKeyRepeat->CounterStart,
+    &NewKeyRepeat->CounterEnd
+    );
+
+  NewKeyRepeat->CounterLast = GetPerformanceCounter ();
+
+  // The timer is created once and only rearmed afterwards.
+  NewKeyRepeat->Timer = MiscCreateNotifyTimerEvent (
+                          InternalKeyRepeatTimerNotify,
+                          NewKeyRepeat,
+                          Delay,
+                          FALSE
+                          );
+
+  if (NewKeyRepeat->Timer == NULL) {
+    EfiFreePool ((VOID *)NewKeyRepeat);
+
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  MiscCancelTimer (NewKeyRepeat->Timer);
+
+  *KeyRepeat = NewKeyRepeat;
+
+  return EFI_SUCCESS;
+}
+
+// MiscUsbHidDestroyKeyRepeat
+/** Destroys a key repeat engine.  Pending releases are discarded.
+
+  @param[in] KeyRepeat  The engine returned by MiscUsbHidCreateKeyRepeat().
+**/
+VOID
+MiscUsbHidDestroyKeyRepeat (
+  IN MISC_USB_HID_KEY_REPEAT  *KeyRepeat
+  )
+{
+  ASSERT (KeyRepeat != NULL);
+
+  MiscCancelTimerEvent (KeyRepeat->Timer);
+  EfiFreePool ((VOID *)KeyRepeat);
+}
+
+// MiscUsbHidKeyRepeatSetTiming
+/** Changes the repeat timing of a key repeat engine.
+
+  The new timing applies from the next key press.  A key already being
+  repeated keeps the rate it started with.
+
+  @param[in] KeyRepeat  The engine returned by MiscUsbHidCreateKeyRepeat().
+  @param[in] Delay      The time, in 100 ns units, before a held key is
+                        repeated.
+  @param[in] Rate       The time, in 100 ns units, between two repeats.
+**/
+VOID
+MiscUsbHidKeyRepeatSetTiming (
+  IN MISC_USB_HID_KEY_REPEAT  *KeyRepeat,
+  IN UINT64                   Delay,
+  IN UINT64                   Rate
+  )
+{
+  EFI_TPL OldTpl;
+
+  ASSERT (KeyRepeat != NULL);
+  ASSERT (Rate > 0);
+
+  OldTpl = EfiRaiseTPL (TPL_NOTIFY);
+
+  KeyRepeat->Delay = Delay;
+  KeyRepeat->Rate  = Rate;
+
+  EfiRestoreTPL (OldTpl);
+}
+
+// MiscUsbHidKeyRepeatProcessEvents
+/** Passes key events, such as the ones returned by
+    MiscUsbHidDiffBootReport(), to a key repeat engine.
+
+  Presses are forwarded right away.  Releases are forwarded once the debounce
+  time has passed.
+
+  @param[in] KeyRepeat       The engine returned by
+                             MiscUsbHidCreateKeyRepeat().
+  @param[in] Events          The key events to process.
+  @param[in] NumberOfEvents  The number of entries of Events.
+**/
+VOID
+MiscUsbHidKeyRepeatProcessEvents (
+  IN MISC_USB_HID_KEY_REPEAT       *KeyRepeat,
+  IN CONST MISC_USB_HID_KEY_EVENT  *Events,
+  IN UINTN                         NumberOfEvents
+  )
+{
+  EFI_TPL        OldTpl;
+  UINT64         Now;
+  UINTN          Index;
+  UINT8          KeyCode;
+  KEY_REPEAT_KEY *Key;
+
+  ASSERT (KeyRepeat != NULL);
+  ASSERT ((Events != NULL) || (NumberOfEvents == 0));
+
+  // The timer notification function runs at TPL_NOTIFY.
+  OldTpl = EfiRaiseTPL (TPL_NOTIFY);
+  Now    = InternalKeyRepeatGetTime (KeyRepeat);
+
+  for (Index = 0; Index < NumberOfEvents; ++Index) {
+    KeyCode = MISC_USB_HID_KEY_EVENT_KEY_CODE (Events[Index]);
+    Key     = InternalKeyRepeatFindKey (KeyRepeat, KeyCode);
+
+    if ((Events[Index] & MISC_USB_HID_KEY_EVENT_PRESSED) != 0) {
+      if ((Key != NULL) && Key->ReleasePending) {
+        // The key bounced, drop the release and the press.
+        Key->ReleasePending = FALSE;
+        continue;
+      }
+
+      if ((Key == NULL) && (KeyRepeat->NumberOfKeys < KEY_REPEAT_MAX_KEYS)) {
+        Key                 = &KeyRepeat->Keys[KeyRepeat->NumberOfKeys];
+        Key->KeyCode        = KeyCode;
+        Key->ReleasePending = FALSE;
+
+        ++KeyRepeat->NumberOfKeys;
+      }
+
+      if (KeyCode < UsbHidUsageIdKbKpModifierKeyLeftControl) {
+        KeyRepeat->RepeatKeyCode  = KeyCode;
+        KeyRepeat->RepeatDeadline = (Now + KeyRepeat->Delay);
+        KeyRepeat->RepeatRate     = KeyRepeat->Rate;
+      }
+
+      KeyRepeat->Notify (Events[Index], FALSE, KeyRepeat->Context);
+    } else if ((Key != NULL) && (KeyRepeat->DebounceTime > 0)) {
+      Key->ReleasePending  = TRUE;
+      Key->ReleaseDeadline = (Now + KeyRepeat->DebounceTime);
+    } else {
+      InternalKeyRepeatRelease (KeyRepeat, KeyCode, Key);
+    }
+  }
+
+  InternalKeyRepeatArmTimer (KeyRepeat, Now);
+
+  EfiRestoreTPL (OldTpl);
+}
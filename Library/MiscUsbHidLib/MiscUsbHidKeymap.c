@@ -0,0 +1,98 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MiscUsbHidLib.h>
+
+// KEY_SET_CONTAINS
+#define KEY_SET_CONTAINS(Set, KeyCode)                                  \
+  (((Set)->Bits[(KeyCode) / 64] & LShiftU64 (1, (KeyCode) % 64)) != 0)
+
+// MiscUsbHidKeymapIsValid
+/** Returns whether a buffer holds a valid keymap, such as a keymap loaded
+    from a file written by Scripts/KeymapCompiler.py.
+
+  @param[in] Keymap  The keymap to validate.
+  @param[in] Size    The size, in bytes, of the buffer of Keymap.
+
+  @return  Whether Keymap is a valid keymap.
+**/
+BOOLEAN
+MiscUsbHidKeymapIsValid (
+  IN CONST MISC_USB_HID_KEYMAP  *Keymap,
+  IN UINTN                      Size
+  )
+{
+  ASSERT (Keymap != NULL);
+
+  return (BOOLEAN)((Size >= sizeof (*Keymap))
+                && (Keymap->Signature == MISC_USB_HID_KEYMAP_SIGNATURE)
+                && (Keymap->Reserved == 0));
+}
+
+// MiscUsbHidKeymapTranslate
+/** Translates a USB Keycode into a character.
+
+  @param[in] Keymap     The keymap to translate with.
+  @param[in] KeyCode    The USB Keycode to translate.
+  @param[in] Modifiers  The pressed modifier keys.
+  @param[in] Locks      The active MISC_USB_HID_LOCK_* locks.
+
+  @return  The character of the key, or 0 if it does not produce one.
+**/
+CHAR16
+MiscUsbHidKeymapTranslate (
+  IN CONST MISC_USB_HID_KEYMAP  *Keymap,
+  IN UINT8                      KeyCode,
+  IN USB_HID_KB_MODIFIER_MAP    Modifiers,
+  IN UINT8                      Locks
+  )
+{
+  UINTN State;
+
+  ASSERT (Keymap != NULL);
+  ASSERT (Keymap->Signature == MISC_USB_HID_KEYMAP_SIGNATURE);
+
+  if (KeyCode >= MISC_USB_HID_NUMBER_OF_KEY_CODES) {
+    return 0;
+  }
+
+  if (((Locks & MISC_USB_HID_LOCK_NUM) == 0)
+   && KEY_SET_CONTAINS (&Keymap->NumLockKeys, KeyCode)) {
+    return 0;
+  }
+
+  State = MiscUsbHidKeymapStateNormal;
+
+  if ((Modifiers & USB_HID_KB_KP_MODIFIERS_SHIFT) != 0) {
+    State = MiscUsbHidKeymapStateShift;
+  }
+
+  if (((Locks & MISC_USB_HID_LOCK_CAPS) != 0)
+   && KEY_SET_CONTAINS (&Keymap->CapsLockKeys, KeyCode)) {
+    State ^= MiscUsbHidKeymapStateShift;
+  }
+
+  if ((Modifiers & USB_HID_KB_KP_MODIFIER_RIGHT_ALT) != 0) {
+    State |= MiscUsbHidKeymapStateAltGr;
+  }
+
+  return Keymap->Characters[State][KeyCode];
+}
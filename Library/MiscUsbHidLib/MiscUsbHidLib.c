@@ -11,7 +11,9 @@
 
 #include <Uefi.h>
 
-#include <IndustryStandard/UsbHid.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MiscUsbHidLib.h>
 
 // gEfiKeyToUsbKeyCodeConvertionTable
 /// EFI_KEY to USB Keycode conversion table
@@ -30,8 +32,8 @@ USB_HID_USAGE_ID gEfiKeyToUsbKeyCodeConvertionTable[] = {
   UsbHidUsageIdKbKpKeyLeftArrow,  // EfiKeyLeftArrow
   UsbHidUsageIdKbKpKeyDownArrow,  // EfiKeyDownArrow
   UsbHidUsageIdKbKpKeyRightArrow,  // EfiKeyRightArrow
-  UsbHidUsageIdKbKpKeyZero,  // EfiKeyZero
-  UsbHidUsageIdKbKpKeyPeriod,  // EfiKeyPeriod
+  UsbHidUsageIdKbKpPadKeyIns,  // EfiKeyZero
+  UsbHidUsageIdKbKpPadKeyDel,  // EfiKeyPeriod
   UsbHidUsageIdKbKpKeyEnter,  // EfiKeyEnter
   UsbHidUsageIdKbKpModifierKeyLeftShift,  // EfiKeyLShift
   UsbHidUsageIdKbKpPadKeyNonUsBackslash,  // EfiKeyB0
@@ -47,9 +49,9 @@ USB_HID_USAGE_ID gEfiKeyToUsbKeyCodeConvertionTable[] = {
   UsbHidUsageIdKbKpKeySlash,  // EfiKeyB10
   UsbHidUsageIdKbKpModifierKeyRightShift,  // EfiKeyRShift
   UsbHidUsageIdKbKpKeyUpArrow,  // EfiKeyUpArrow
-  UsbHidUsageIdKbKpKeyOne,  // EfiKeyOne
-  UsbHidUsageIdKbKpKeyTwo,  // EfiKeyTwo
-  UsbHidUsageIdKbKpKeyThree,  // EfiKeyThree
+  UsbHidUsageIdKbKpPadKeyOne,  // EfiKeyOne
+  UsbHidUsageIdKbKpPadKeyTwo,  // EfiKeyTwo
+  UsbHidUsageIdKbKpPadKeyThree,  // EfiKeyThree
   UsbHidUsageIdKbKpKeyCLock,  // EfiKeyCapsLock
   UsbHidUsageIdKbKpKeyA,  // EfiKeyC1
   UsbHidUsageIdKbKpKeyS,  // EfiKeyC2
@@ -63,9 +65,9 @@ USB_HID_USAGE_ID gEfiKeyToUsbKeyCodeConvertionTable[] = {
   UsbHidUsageIdKbKpKeySemicolon,  // EfiKeyC10
   UsbHidUsageIdKbKpKeyQuotation,  // EfiKeyC11
   UsbHidUsageIdKbKpKeyNonUsHash,  // EfiKeyC12
-  UsbHidUsageIdKbKpKeyFour,  // EfiKeyFour
-  UsbHidUsageIdKbKpKeyFive,  // EfiKeyFive
-  UsbHidUsageIdKbKpKeySix,  // EfiKeySix
+  UsbHidUsageIdKbKpPadKeyFour,  // EfiKeyFour
+  UsbHidUsageIdKbKpPadKeyFive,  // EfiKeyFive
+  UsbHidUsageIdKbKpPadKeySix,  // EfiKeySix
   UsbHidUsageIdKbKpPadKeyPlus,  // EfiKeyPlus
   UsbHidUsageIdKbKpKeyTab,  // EfiKeyTab
   UsbHidUsageIdKbKpKeyQ,  // EfiKeyD1
@@ -84,9 +86,9 @@ USB_HID_USAGE_ID gEfiKeyToUsbKeyCodeConvertionTable[] = {
   UsbHidUsageIdKbKpKeyDel,  // EfiKeyDel
   UsbHidUsageIdKbKpKeyEnd,  // EfiKeyEnd
   UsbHidUsageIdKbKpKeyPgDn,  // EfiKeyPgDn
-  UsbHidUsageIdKbKpKeySeven,  // EfiKeySeven
-  UsbHidUsageIdKbKpKeyEight,  // EfiKeyEight
-  UsbHidUsageIdKbKpKeyNine,  // EfiKeyNine
+  UsbHidUsageIdKbKpPadKeySeven,  // EfiKeySeven
+  UsbHidUsageIdKbKpPadKeyEight,  // EfiKeyEight
+  UsbHidUsageIdKbKpPadKeyNine,  // EfiKeyNine
   UsbHidUsageIdKbKpKeyAcute,  // EfiKeyE0
   UsbHidUsageIdKbKpKeyOne,  // EfiKeyE1
   UsbHidUsageIdKbKpKeyTwo,  // EfiKeyE2
@@ -105,7 +107,7 @@ USB_HID_USAGE_ID gEfiKeyToUsbKeyCodeConvertionTable[] = {
   UsbHidUsageIdKbKpKeyHome,  // EfiKeyHome
   UsbHidUsageIdKbKpKeyPgUp,  // EfiKeyPgUp
   UsbHidUsageIdKbKpPadKeyNLck,  // EfiKeyNLck
-  UsbHidUsageIdKbKpKeySlash,  // EfiKeySlash
+  UsbHidUsageIdKbKpPadKeySlash,  // EfiKeySlash
   UsbHidUsageIdKbKpPadKeyAsterisk,  // EfiKeyAsterisk
   UsbHidUsageIdKbKpPadKeyMinus,  // EfiKeyMinus
   UsbHidUsageIdKbKpKeyEsc,  // EfiKeyEsc
@@ -125,3 +127,475 @@ USB_HID_USAGE_ID gEfiKeyToUsbKeyCodeConvertionTable[] = {
   UsbHidUsageIdKbKpKeySLock,  // EfiKeySLck
   UsbHidUsageIdKbKpKeyPause   // EfiKeyPause
 };
+
+// gUsbKeyCodeToEfiKeyConvertionTable
+/// USB Keycode to EFI_KEY conversion table, the inverse of
+/// gEfiKeyToUsbKeyCodeConvertionTable.  It has
+/// MISC_USB_HID_NUMBER_OF_KEY_CODES entries.  UEFI has a single EfiKeyEnter,
+/// hence both the main and the keypad Enter keys map to it.
+GLOBAL_REMOVE_IF_UNREFERENCED
+CONST UINT8 gUsbKeyCodeToEfiKeyConvertionTable[] = {
+  MISC_USB_HID_NO_EFI_KEY,  // 0x00 KeyReserved
+  MISC_USB_HID_NO_EFI_KEY,  // 0x01 KeyErrorRollOver
+  MISC_USB_HID_NO_EFI_KEY,  // 0x02 KeyPostFail
+  MISC_USB_HID_NO_EFI_KEY,  // 0x03 KeyErrorUndefined
+  EfiKeyC1,                 // 0x04 KeyA
+  EfiKeyB5,                 // 0x05 KeyB
+  EfiKeyB3,                 // 0x06 KeyC
+  EfiKeyC3,                 // 0x07 KeyD
+  EfiKeyD3,                 // 0x08 KeyE
+  EfiKeyC4,                 // 0x09 KeyF
+  EfiKeyC5,                 // 0x0A KeyG
+  EfiKeyC6,                 // 0x0B KeyH
+  EfiKeyD8,                 // 0x0C KeyI
+  EfiKeyC7,                 // 0x0D KeyJ
+  EfiKeyC8,                 // 0x0E KeyK
+  EfiKeyC9,                 // 0x0F KeyL
+  EfiKeyB7,                 // 0x10 KeyM
+  EfiKeyB6,                 // 0x11 KeyN
+  EfiKeyD9,                 // 0x12 KeyO
+  EfiKeyD10,                // 0x13 KeyP
+  EfiKeyD1,                 // 0x14 KeyQ
+  EfiKeyD4,                 // 0x15 KeyR
+  EfiKeyC2,                 // 0x16 KeyS
+  EfiKeyD5,                 // 0x17 KeyT
+  EfiKeyD7,                 // 0x18 KeyU
+  EfiKeyB4,                 // 0x19 KeyV
+  EfiKeyD2,                 // 0x1A KeyW
+  EfiKeyB2,                 // 0x1B KeyX
+  EfiKeyD6,                 // 0x1C KeyY
+  EfiKeyB1,                 // 0x1D KeyZ
+  EfiKeyE1,                 // 0x1E KeyOne
+  EfiKeyE2,                 // 0x1F KeyTwo
+  EfiKeyE3,                 // 0x20 KeyThree
+  EfiKeyE4,                 // 0x21 KeyFour
+  EfiKeyE5,                 // 0x22 KeyFive
+  EfiKeyE6,                 // 0x23 KeySix
+  EfiKeyE7,                 // 0x24 KeySeven
+  EfiKeyE8,                 // 0x25 KeyEight
+  EfiKeyE9,                 // 0x26 KeyNine
+  EfiKeyE10,                // 0x27 KeyZero
+  EfiKeyEnter,              // 0x28 KeyEnter
+  EfiKeyEsc,                // 0x29 KeyEsc
+  EfiKeyBackSpace,          // 0x2A KeyBackSpace
+  EfiKeyTab,                // 0x2B KeyTab
+  EfiKeySpaceBar,           // 0x2C KeySpaceBar
+  EfiKeyE11,                // 0x2D KeyMinus
+  EfiKeyE12,                // 0x2E KeyEquals
+  EfiKeyD11,                // 0x2F KeyLeftBracket
+  EfiKeyD12,                // 0x30 KeyRightBracket
+  EfiKeyD13,                // 0x31 KeyBackslash
+  EfiKeyC12,                // 0x32 KeyNonUsHash
+  EfiKeyC10,                // 0x33 KeySemicolon
+  EfiKeyC11,                // 0x34 KeyQuotation
+  EfiKeyE0,                 // 0x35 KeyAcute
+  EfiKeyB8,                 // 0x36 KeyComma
+  EfiKeyB9,                 // 0x37 KeyPeriod
+  EfiKeyB10,                // 0x38 KeySlash
+  EfiKeyCapsLock,           // 0x39 KeyCLock
+  EfiKeyF1,                 // 0x3A KeyF1
+  EfiKeyF2,                 // 0x3B KeyF2
+  EfiKeyF3,                 // 0x3C KeyF3
+  EfiKeyF4,                 // 0x3D KeyF4
+  EfiKeyF5,                 // 0x3E KeyF5
+  EfiKeyF6,                 // 0x3F KeyF6
+  EfiKeyF7,                 // 0x40 KeyF7
+  EfiKeyF8,                 // 0x41 KeyF8
+  EfiKeyF9,                 // 0x42 KeyF9
+  EfiKeyF10,                // 0x43 KeyF10
+  EfiKeyF11,                // 0x44 KeyF11
+  EfiKeyF12,                // 0x45 KeyF12
+  EfiKeyPrint,              // 0x46 KeyPrint
+  EfiKeySLck,               // 0x47 KeySLock
+  EfiKeyPause,              // 0x48 KeyPause
+  EfiKeyIns,                // 0x49 KeyIns
+  EfiKeyHome,               // 0x4A KeyHome
+  EfiKeyPgUp,               // 0x4B KeyPgUp
+  EfiKeyDel,                // 0x4C KeyDel
+  EfiKeyEnd,                // 0x4D KeyEnd
+  EfiKeyPgDn,               // 0x4E KeyPgDn
+  EfiKeyRightArrow,         // 0x4F KeyRightArrow
+  EfiKeyLeftArrow,          // 0x50 KeyLeftArrow
+  EfiKeyDownArrow,          // 0x51 KeyDownArrow
+  EfiKeyUpArrow,            // 0x52 KeyUpArrow
+  EfiKeyNLck,               // 0x53 PadKeyNLck
+  EfiKeySlash,              // 0x54 PadKeySlash
+  EfiKeyAsterisk,           // 0x55 PadKeyAsterisk
+  EfiKeyMinus,              // 0x56 PadKeyMinus
+  EfiKeyPlus,               // 0x57 PadKeyPlus
+  EfiKeyEnter,              // 0x58 PadKeyEnter
+  EfiKeyOne,                // 0x59 PadKeyOne
+  EfiKeyTwo,                // 0x5A PadKeyTwo
+  EfiKeyThree,              // 0x5B PadKeyThree
+  EfiKeyFour,               // 0x5C PadKeyFour
+  EfiKeyFive,               // 0x5D PadKeyFive
+  EfiKeySix,                // 0x5E PadKeySix
+  EfiKeySeven,              // 0x5F PadKeySeven
+  EfiKeyEight,              // 0x60 PadKeyEight
+  EfiKeyNine,               // 0x61 PadKeyNine
+  EfiKeyZero,               // 0x62 PadKeyIns
+  EfiKeyPeriod,             // 0x63 PadKeyDel
+  EfiKeyB0,                 // 0x64 PadKeyNonUsBackslash
+  EfiKeyA4,                 // 0x65 PadKeyApplication
+  MISC_USB_HID_NO_EFI_KEY,  // 0x66 PadKeyPower
+  MISC_USB_HID_NO_EFI_KEY,  // 0x67 PadKeyEquals
+  MISC_USB_HID_NO_EFI_KEY,  // 0x68 KeyF13
+  MISC_USB_HID_NO_EFI_KEY,  // 0x69 KeyF14
+  MISC_USB_HID_NO_EFI_KEY,  // 0x6A KeyF15
+  MISC_USB_HID_NO_EFI_KEY,  // 0x6B KeyF16
+  MISC_USB_HID_NO_EFI_KEY,  // 0x6C KeyF17
+  MISC_USB_HID_NO_EFI_KEY,  // 0x6D KeyF18
+  MISC_USB_HID_NO_EFI_KEY,  // 0x6E KeyF19
+  MISC_USB_HID_NO_EFI_KEY,  // 0x6F KeyF20
+  MISC_USB_HID_NO_EFI_KEY,  // 0x70 KeyF21
+  MISC_USB_HID_NO_EFI_KEY,  // 0x71 KeyF22
+  MISC_USB_HID_NO_EFI_KEY,  // 0x72 KeyF23
+  MISC_USB_HID_NO_EFI_KEY,  // 0x73 KeyF24
+  MISC_USB_HID_NO_EFI_KEY,  // 0x74 KeyExecute
+  MISC_USB_HID_NO_EFI_KEY,  // 0x75 KeyHelp
+  MISC_USB_HID_NO_EFI_KEY,  // 0x76 KeyMenu
+  MISC_USB_HID_NO_EFI_KEY,  // 0x77 KeySelect
+  MISC_USB_HID_NO_EFI_KEY,  // 0x78 KeyStop
+  MISC_USB_HID_NO_EFI_KEY,  // 0x79 KeyAgain
+  MISC_USB_HID_NO_EFI_KEY,  // 0x7A KeyUndo
+  MISC_USB_HID_NO_EFI_KEY,  // 0x7B KeyCut
+  MISC_USB_HID_NO_EFI_KEY,  // 0x7C KeyCopy
+  MISC_USB_HID_NO_EFI_KEY,  // 0x7D KeyPaste
+  MISC_USB_HID_NO_EFI_KEY,  // 0x7E KeyFind
+  MISC_USB_HID_NO_EFI_KEY,  // 0x7F KeyMute
+  MISC_USB_HID_NO_EFI_KEY,  // 0x80 KeyVolumeUp
+  MISC_USB_HID_NO_EFI_KEY,  // 0x81 KeyVolumeDown
+  MISC_USB_HID_NO_EFI_KEY,  // 0x82 LockKeyCLock
+  MISC_USB_HID_NO_EFI_KEY,  // 0x83 LockKeyNLock
+  MISC_USB_HID_NO_EFI_KEY,  // 0x84 LockKeySLock
+  MISC_USB_HID_NO_EFI_KEY,  // 0x85 PadKeyComma
+  MISC_USB_HID_NO_EFI_KEY,  // 0x86 PadKeyEqualSign
+  MISC_USB_HID_NO_EFI_KEY,  // 0x87 KeyInternational1
+  MISC_USB_HID_NO_EFI_KEY,  // 0x88 KeyInternational2
+  MISC_USB_HID_NO_EFI_KEY,  // 0x89 KeyInternational3
+  MISC_USB_HID_NO_EFI_KEY,  // 0x8A KeyInternational4
+  MISC_USB_HID_NO_EFI_KEY,  // 0x8B KeyInternational5
+  MISC_USB_HID_NO_EFI_KEY,  // 0x8C KeyInternational6
+  MISC_USB_HID_NO_EFI_KEY,  // 0x8D KeyInternational7
+  MISC_USB_HID_NO_EFI_KEY,  // 0x8E KeyInternational8
+  MISC_USB_HID_NO_EFI_KEY,  // 0x8F KeyInternational9
+  MISC_USB_HID_NO_EFI_KEY,  // 0x90 KeyLang1
+  MISC_USB_HID_NO_EFI_KEY,  // 0x91 KeyLang2
+  MISC_USB_HID_NO_EFI_KEY,  // 0x92 KeyLang3
+  MISC_USB_HID_NO_EFI_KEY,  // 0x93 KeyLang4
+  MISC_USB_HID_NO_EFI_KEY,  // 0x94 KeyLang5
+  MISC_USB_HID_NO_EFI_KEY,  // 0x95 KeyLang6
+  MISC_USB_HID_NO_EFI_KEY,  // 0x96 KeyLang7
+  MISC_USB_HID_NO_EFI_KEY,  // 0x97 KeyLang8
+  MISC_USB_HID_NO_EFI_KEY,  // 0x98 KeyLang9
+  MISC_USB_HID_NO_EFI_KEY,  // 0x99 KeyAlternateErase
+  MISC_USB_HID_NO_EFI_KEY,  // 0x9A KeySysReq
+  MISC_USB_HID_NO_EFI_KEY,  // 0x9B KeyCancel
+  MISC_USB_HID_NO_EFI_KEY,  // 0x9C KeyClear
+  MISC_USB_HID_NO_EFI_KEY,  // 0x9D KeyPrior
+  MISC_USB_HID_NO_EFI_KEY,  // 0x9E KeyReturn
+  MISC_USB_HID_NO_EFI_KEY,  // 0x9F KeySeparator
+  MISC_USB_HID_NO_EFI_KEY,  // 0xA0 KeyOut
+  MISC_USB_HID_NO_EFI_KEY,  // 0xA1 KeyOper
+  MISC_USB_HID_NO_EFI_KEY,  // 0xA2 KeyClearAgain
+  MISC_USB_HID_NO_EFI_KEY,  // 0xA3 KeyCrSel
+  MISC_USB_HID_NO_EFI_KEY,  // 0xA4 KeyExSel
+  MISC_USB_HID_NO_EFI_KEY,  // 0xA5
+  MISC_USB_HID_NO_EFI_KEY,  // 0xA6
+  MISC_USB_HID_NO_EFI_KEY,  // 0xA7
+  MISC_USB_HID_NO_EFI_KEY,  // 0xA8
+  MISC_USB_HID_NO_EFI_KEY,  // 0xA9
+  MISC_USB_HID_NO_EFI_KEY,  // 0xAA
+  MISC_USB_HID_NO_EFI_KEY,  // 0xAB
+  MISC_USB_HID_NO_EFI_KEY,  // 0xAC
+  MISC_USB_HID_NO_EFI_KEY,  // 0xAD
+  MISC_USB_HID_NO_EFI_KEY,  // 0xAE
+  MISC_USB_HID_NO_EFI_KEY,  // 0xAF
+  MISC_USB_HID_NO_EFI_KEY,  // 0xB0 PadKeyDoubleZero
+  MISC_USB_HID_NO_EFI_KEY,  // 0xB1 KeyTrippleZero
+  MISC_USB_HID_NO_EFI_KEY,  // 0xB2 KeyThousandsSeparator
+  MISC_USB_HID_NO_EFI_KEY,  // 0xB3 KeyDecimalSeparator
+  MISC_USB_HID_NO_EFI_KEY,  // 0xB4 KeyCurrencyUnit
+  MISC_USB_HID_NO_EFI_KEY,  // 0xB5 KeyCurrencySubUnit
+  MISC_USB_HID_NO_EFI_KEY,  // 0xB6 PadKeyLeftBracket
+  MISC_USB_HID_NO_EFI_KEY,  // 0xB7 PadKeyRightBracket
+  MISC_USB_HID_NO_EFI_KEY,  // 0xB8 PadKeyCurlyLeftBracket
+  MISC_USB_HID_NO_EFI_KEY,  // 0xB9 PadKeyCurlyRightBracket
+  MISC_USB_HID_NO_EFI_KEY,  // 0xBA PadKeyTab
+  MISC_USB_HID_NO_EFI_KEY,  // 0xBB PadKeyBackspace
+  MISC_USB_HID_NO_EFI_KEY,  // 0xBC PadKeyA
+  MISC_USB_HID_NO_EFI_KEY,  // 0xBD PadKeyB
+  MISC_USB_HID_NO_EFI_KEY,  // 0xBE PadKeyC
+  MISC_USB_HID_NO_EFI_KEY,  // 0xBF PadKeyD
+  MISC_USB_HID_NO_EFI_KEY,  // 0xC0 PadKeyE
+  MISC_USB_HID_NO_EFI_KEY,  // 0xC1 PadKeyF
+  MISC_USB_HID_NO_EFI_KEY,  // 0xC2 PadKeyXor
+  MISC_USB_HID_NO_EFI_KEY,  // 0xC3 PadKeyCaret
+  MISC_USB_HID_NO_EFI_KEY,  // 0xC4 PadKeyPercent
+  MISC_USB_HID_NO_EFI_KEY,  // 0xC5 PadKeyLeftAngleBracket
+  MISC_USB_HID_NO_EFI_KEY,  // 0xC6 PadKeyRightAngleBracket
+  MISC_USB_HID_NO_EFI_KEY,  // 0xC7 PadKeyBitwiseAnd
+  MISC_USB_HID_NO_EFI_KEY,  // 0xC8 PadKeyLogicalAnd
+  MISC_USB_HID_NO_EFI_KEY,  // 0xC9 PadKeyBitwiseOr
+  MISC_USB_HID_NO_EFI_KEY,  // 0xCA PadKeyLogicalOr
+  MISC_USB_HID_NO_EFI_KEY,  // 0xCB PadKeyColon
+  MISC_USB_HID_NO_EFI_KEY,  // 0xCC PadKeyHash
+  MISC_USB_HID_NO_EFI_KEY,  // 0xCD PadKeySpace
+  MISC_USB_HID_NO_EFI_KEY,  // 0xCE PadKeyAt
+  MISC_USB_HID_NO_EFI_KEY,  // 0xCF PadKeyExclamationMark
+  MISC_USB_HID_NO_EFI_KEY,  // 0xD0 PadKeyMemoryStore
+  MISC_USB_HID_NO_EFI_KEY,  // 0xD1 PadKeyMemoryRecall
+  MISC_USB_HID_NO_EFI_KEY,  // 0xD2 PadKeyMemoryClear
+  MISC_USB_HID_NO_EFI_KEY,  // 0xD3 PadKeyMemoryAdd
+  MISC_USB_HID_NO_EFI_KEY,  // 0xD4 PadKeyMemorySubtract
+  MISC_USB_HID_NO_EFI_KEY,  // 0xD5 PadKeyMemoryMultiply
+  MISC_USB_HID_NO_EFI_KEY,  // 0xD6 PadKeyMemoryDivide
+  MISC_USB_HID_NO_EFI_KEY,  // 0xD7 PadKeySign
+  MISC_USB_HID_NO_EFI_KEY,  // 0xD8 PadKeyClear
+  MISC_USB_HID_NO_EFI_KEY,  // 0xD9 PadKeyClearEntry
+  MISC_USB_HID_NO_EFI_KEY,  // 0xDA PadKeyBinary
+  MISC_USB_HID_NO_EFI_KEY,  // 0xDB PadKeyOctal
+  MISC_USB_HID_NO_EFI_KEY,  // 0xDC PadKeyDecimal
+  MISC_USB_HID_NO_EFI_KEY,  // 0xDD PadKeyHexadecimal
+  MISC_USB_HID_NO_EFI_KEY,  // 0xDE
+  MISC_USB_HID_NO_EFI_KEY,  // 0xDF
+  EfiKeyLCtrl,              // 0xE0 ModifierKeyLeftControl
+  EfiKeyLShift,             // 0xE1 ModifierKeyLeftShift
+  EfiKeyLAlt,               // 0xE2 ModifierKeyLeftAlt
+  EfiKeyA0,                 // 0xE3 ModifierKeyLeftGui
+  EfiKeyRCtrl,              // 0xE4 ModifierKeyRightControl
+  EfiKeyRShift,             // 0xE5 ModifierKeyRightShift
+  EfiKeyA2,                 // 0xE6 ModifierKeyRightAlt
+  EfiKeyA3                  // 0xE7 ModifierKeyRightGui
+};
+
+// gUsbModifierToEfiKeyConvertionTable
+/// USB modifier bit index to EFI_KEY conversion table.
+GLOBAL_REMOVE_IF_UNREFERENCED
+CONST UINT8 gUsbModifierToEfiKeyConvertionTable[] = {
+  EfiKeyLCtrl,   // USB_HID_KB_KP_MODIFIER_LEFT_CONTROL
+  EfiKeyLShift,  // USB_HID_KB_KP_MODIFIER_LEFT_SHIFT
+  EfiKeyLAlt,    // USB_HID_KB_KP_MODIFIER_LEFT_ALT
+  EfiKeyA0,      // USB_HID_KB_KP_MODIFIER_LEFT_GUI
+  EfiKeyRCtrl,   // USB_HID_KB_KP_MODIFIER_RIGHT_CONTROL
+  EfiKeyRShift,  // USB_HID_KB_KP_MODIFIER_RIGHT_SHIFT
+  EfiKeyA2,      // USB_HID_KB_KP_MODIFIER_RIGHT_ALT
+  EfiKeyA3       // USB_HID_KB_KP_MODIFIER_RIGHT_GUI
+};
+
+// MiscUsbHidBootReportToEfiKeys
+/** Translates a keyboard boot report into the EFI_KEYs of the pressed keys.
+
+  The modifier keys are returned first, followed by the keys of the report in
+  report order.  Keycodes without an EFI_KEY and the error codes are skipped.
+
+  @param[in]  Report  The report to translate.
+  @param[out] Keys    On output, the pressed keys.  Must have room for
+                      USB_HID_KB_KP_NUMBER_OF_MODIFIERS
+                      + USB_HID_KB_BOOT_REPORT_NUMBER_OF_KEYS entries.
+
+  @return  The number of keys returned in Keys.
+**/
+UINTN
+MiscUsbHidBootReportToEfiKeys (
+  IN  CONST USB_HID_KB_BOOT_REPORT  *Report,
+  OUT EFI_KEY                       *Keys
+  )
+{
+  UINTN                   NumberOfKeys;
+  USB_HID_KB_MODIFIER_MAP Modifiers;
+  UINTN                   Index;
+  UINT8                   EfiKey;
+
+  ASSERT (Report != NULL);
+  ASSERT (Keys != NULL);
+
+  NumberOfKeys = 0;
+  Modifiers    = Report->Modifiers;
+
+  for (Index = 0; Modifiers != 0; ++Index, Modifiers >>= 1) {
+    if ((Modifiers & BIT0) != 0) {
+      Keys[NumberOfKeys] = (EFI_KEY)gUsbModifierToEfiKeyConvertionTable[Index];
+      ++NumberOfKeys;
+    }
+  }
+
+  for (Index = 0; Index < USB_HID_KB_BOOT_REPORT_NUMBER_OF_KEYS; ++Index) {
+    EfiKey = MISC_USB_HID_KEY_CODE_TO_EFI_KEY (Report->KeyCodes[Index]);
+
+    if (EfiKey != MISC_USB_HID_NO_EFI_KEY) {
+      Keys[NumberOfKeys] = (EFI_KEY)EfiKey;
+      ++NumberOfKeys;
+    }
+  }
+
+  return NumberOfKeys;
+}
+
+// ARRAY_SIZE_OF_KEY_SET
+#define ARRAY_SIZE_OF_KEY_SET  \
+  (sizeof (((MISC_USB_HID_KEY_SET *)NULL)->Bits) / sizeof (UINT64))
+
+// KEY_SET_WORD
+#define KEY_SET_WORD(KeyCode)  ((KeyCode) / 64)
+
+// KEY_SET_BIT
+#define KEY_SET_BIT(KeyCode)  LShiftU64 (1, (KeyCode) % 64)
+
+// KEY_SET_MODIFIERS_SHIFT
+/// The modifier bits are stored in the set as keycodes 0xE0 to 0xE7.
+#define KEY_SET_MODIFIERS_SHIFT  \
+  (UsbHidUsageIdKbKpModifierKeyLeftControl % 64)
+
+// KEY_SET_MODIFIERS_WORD
+#define KEY_SET_MODIFIERS_WORD  \
+  KEY_SET_WORD (UsbHidUsageIdKbKpModifierKeyLeftControl)
+
+// KEY_SET_MODIFIERS_MASK
+#define KEY_SET_MODIFIERS_MASK  \
+  LShiftU64 (MAX_UINT8, KEY_SET_MODIFIERS_SHIFT)
+
+// InternalAppendKeyEvents
+/** Appends an event for every keycode of a set.
+**/
+STATIC
+UINTN
+InternalAppendKeyEvents (
+  IN  CONST MISC_USB_HID_KEY_SET  *Set,
+  IN  UINT16                      Flags,
+  OUT MISC_USB_HID_KEY_EVENT      *Events
+  )
+{
+  UINTN  NumberOfEvents;
+  UINTN  Index;
+  UINT64 Bits;
+  INTN   Bit;
+
+  NumberOfEvents = 0;
+
+  for (Index = 0; Index < ARRAY_SIZE_OF_KEY_SET; ++Index) {
+    for (Bits = Set->Bits[Index]; Bits != 0; Bits &= (Bits - 1)) {
+      Bit = LowBitSet64 (Bits);
+
+      Events[NumberOfEvents] = (MISC_USB_HID_KEY_EVENT)(
+                                 ((Index * 64) + (UINTN)Bit) | Flags
+                                 );
+
+      ++NumberOfEvents;
+    }
+  }
+
+  return NumberOfEvents;
+}
+
+// MiscUsbHidInitializeKbState
+/** Initializes the state of a keyboard to no keys being pressed.
+
+  @param[out] State  The state to initialize.
+**/
+VOID
+MiscUsbHidInitializeKbState (
+  OUT MISC_USB_HID_KB_STATE  *State
+  )
+{
+  UINTN Index;
+
+  ASSERT (State != NULL);
+
+  for (Index = 0; Index < ARRAY_SIZE_OF_KEY_SET; ++Index) {
+    State->Keys.Bits[Index] = 0;
+  }
+
+  State->RollOver = FALSE;
+}
+
+// MiscUsbHidDiffBootReport
+/** Derives the key events from a keyboard boot report.
+
+  The pressed keys of the report and of the previous report are compared as
+  bitmaps, so the cost does not depend on the order of the keycodes.  The
+  release events are returned first, each group in ascending keycode order.
+  Modifier changes are returned as events of the modifier keycodes.
+
+  When the report is an error report, such as ErrorRollOver, the keys are
+  considered unchanged and only the modifier changes are returned.
+
+  @param[in, out] State   The state of the keyboard.  On output, the state
+                          after the report.
+  @param[in]      Report  The report to process.
+  @param[out]     Events  On output, the key events.  Must have room for
+                          MISC_USB_HID_MAX_KEY_EVENTS entries.
+
+  @return  The number of events returned in Events.
+**/
+UINTN
+MiscUsbHidDiffBootReport (
+  IN OUT MISC_USB_HID_KB_STATE         *State,
+  IN     CONST USB_HID_KB_BOOT_REPORT  *Report,
+  OUT    MISC_USB_HID_KEY_EVENT        *Events
+  )
+{
+  UINTN                NumberOfEvents;
+  MISC_USB_HID_KEY_SET Keys;
+  MISC_USB_HID_KEY_SET Released;
+  MISC_USB_HID_KEY_SET Pressed;
+  UINT64               Changed;
+  BOOLEAN              RollOver;
+  UINTN                Index;
+  UINT8                KeyCode;
+
+  ASSERT (State != NULL);
+  ASSERT (Report != NULL);
+  ASSERT (Events != NULL);
+
+  Keys.Bits[0] = 0;
+  Keys.Bits[1] = 0;
+  Keys.Bits[2] = 0;
+  Keys.Bits[3] = 0;
+  RollOver     = FALSE;
+
+  for (Index = 0; Index < USB_HID_KB_BOOT_REPORT_NUMBER_OF_KEYS; ++Index) {
+    KeyCode = Report->KeyCodes[Index];
+
+    if (USB_HID_KB_KP_VALID_KEYCODE (KeyCode)) {
+      Keys.Bits[KEY_SET_WORD (KeyCode)] |= KEY_SET_BIT (KeyCode);
+    } else if (KeyCode != UsbHidUsageIdKbKpKeyReserved) {
+      RollOver = TRUE;
+    }
+  }
+
+  if (RollOver) {
+    // The keycodes of an error report are meaningless, but the modifier byte
+    // is valid.
+    for (Index = 0; Index < ARRAY_SIZE_OF_KEY_SET; ++Index) {
+      Keys.Bits[Index] = State->Keys.Bits[Index];
+    }
+
+    Keys.Bits[KEY_SET_MODIFIERS_WORD] &= ~KEY_SET_MODIFIERS_MASK;
+  }
+
+  Keys.Bits[KEY_SET_MODIFIERS_WORD] |= LShiftU64 (
+                                         Report->Modifiers,
+                                         KEY_SET_MODIFIERS_SHIFT
+                                         );
+
+  for (Index = 0; Index < ARRAY_SIZE_OF_KEY_SET; ++Index) {
+    Changed                 = (State->Keys.Bits[Index] ^ Keys.Bits[Index]);
+    Released.Bits[Index]    = (Changed & State->Keys.Bits[Index]);
+    Pressed.Bits[Index]     = (Changed & Keys.Bits[Index]);
+    State->Keys.Bits[Index] = Keys.Bits[Index];
+  }
+
+  State->RollOver = RollOver;
+
+  NumberOfEvents  = InternalAppendKeyEvents (&Released, 0, Events);
+  NumberOfEvents += InternalAppendKeyEvents (
+                      &Pressed,
+                      MISC_USB_HID_KEY_EVENT_PRESSED,
+                      &Events[NumberOfEvents]
+                      );
+
+  ASSERT (NumberOfEvents <= MISC_USB_HID_MAX_KEY_EVENTS);
+
+  return NumberOfEvents;
+}
@@ -0,0 +1,509 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MiscUsbHidLib.h>
+
+// HID_MAX_USAGES
+#define HID_MAX_USAGES  32
+
+// HID_MAX_GLOBAL_STACK_DEPTH
+#define HID_MAX_GLOBAL_STACK_DEPTH  4
+
+// HID_GLOBAL_STATE
+typedef struct {
+  USB_HID_PAGE_ID UsagePage;           ///< The current usage page.
+  INT32           LogicalMinimum;      ///< The signed logical minimum.
+  UINT32          LogicalMaximum;      ///< The raw logical maximum.
+  UINT8           LogicalMaximumSize;  ///< The size, in bytes, of
+                                       ///< LogicalMaximum.
+  UINT8           ReportId;            ///< The current report ID.
+  UINT32          ReportSize;          ///< The size, in bits, of an element.
+  UINT32          ReportCount;         ///< The number of elements.
+} HID_GLOBAL_STATE;
+
+// HID_LOCAL_STATE
+typedef struct {
+  USB_HID_USAGE Usages[HID_MAX_USAGES];  ///< The declared usages.
+  UINTN         NumberOfUsages;          ///< The number of used Usages.
+  USB_HID_USAGE UsageMinimum;            ///< The minimum of the usage range.
+  USB_HID_USAGE UsageMaximum;            ///< The maximum of the usage range.
+  BOOLEAN       HasUsageRange;           ///< Whether a usage range was
+                                         ///< declared.
+} HID_LOCAL_STATE;
+
+// InternalHidResetLocalState
+STATIC
+VOID
+InternalHidResetLocalState (
+  OUT HID_LOCAL_STATE  *Local
+  )
+{
+  Local->NumberOfUsages = 0;
+  Local->UsageMinimum   = 0;
+  Local->UsageMaximum   = 0;
+  Local->HasUsageRange  = FALSE;
+}
+
+// InternalHidGetUsage
+/** Returns the usage of an element of a main item.
+**/
+STATIC
+USB_HID_USAGE
+InternalHidGetUsage (
+  IN CONST HID_LOCAL_STATE  *Local,
+  IN UINT32                 Index
+  )
+{
+  if (Local->HasUsageRange) {
+    if (Index > (Local->UsageMaximum - Local->UsageMinimum)) {
+      return Local->UsageMaximum;
+    }
+
+    return (Local->UsageMinimum + Index);
+  }
+
+  if (Local->NumberOfUsages == 0) {
+    return 0;
+  }
+
+  if (Index >= Local->NumberOfUsages) {
+    return Local->Usages[Local->NumberOfUsages - 1];
+  }
+
+  return Local->Usages[Index];
+}
+
+// InternalHidGetLogicalMaximum
+/** Returns the logical maximum of the global state.
+
+  Many devices declare an unsigned logical maximum, such as 255 encoded as a
+  single byte, which is negative when interpreted as the specification
+  demands.  The maximum is interpreted as unsigned if the minimum is not
+  negative.
+**/
+STATIC
+INT32
+InternalHidGetLogicalMaximum (
+  IN CONST HID_GLOBAL_STATE  *Global
+  )
+{
+  UINT32 Maximum;
+
+  Maximum = Global->LogicalMaximum;
+
+  if (Global->LogicalMinimum >= 0) {
+    return ((Maximum > MAX_INT32) ? MAX_INT32 : (INT32)Maximum);
+  }
+
+  if ((Global->LogicalMaximumSize == 1) && ((Maximum & BIT7) != 0)) {
+    Maximum |= 0xFFFFFF00U;
+  } else if ((Global->LogicalMaximumSize == 2) && ((Maximum & BIT15) != 0)) {
+    Maximum |= 0xFFFF0000U;
+  }
+
+  return (INT32)Maximum;
+}
+
+// MiscUsbHidCompileReportDescriptor
+/** Compiles the Input items of a report descriptor into an extraction
+    program for MiscUsbHidExtractFields().
+
+  Every element of a variable Input item results in a field with its own
+  usage.  Every element of an array Input item results in a field with the
+  usage range of the item.  Array items declaring a usage list rather than a
+  range are described by their first and last usage.  Constant Input items
+  only advance the bit offset.  Output and Feature items are skipped.
+
+  @param[in]      Descriptor      The report descriptor to compile.
+  @param[in]      DescriptorSize  The size, in bytes, of Descriptor.
+  @param[out]     Fields          The buffer to return the fields in.
+  @param[in, out] NumberOfFields  On input, the number of entries of Fields.
+                                  On output, the number of fields of the
+                                  descriptor.
+
+  @retval EFI_SUCCESS            The descriptor was compiled.
+  @retval EFI_BUFFER_TOO_SMALL   Fields is too small.  NumberOfFields has been
+                                 updated with the required number.
+  @retval EFI_INVALID_PARAMETER  The descriptor is malformed or uses a field
+                                 larger than 32 bits.
+**/
+EFI_STATUS
+MiscUsbHidCompileReportDescriptor (
+  IN     CONST UINT8         *Descriptor,
+  IN     UINTN               DescriptorSize,
+  OUT    MISC_USB_HID_FIELD  *Fields, OPTIONAL
+  IN OUT UINTN               *NumberOfFields
+  )
+{
+  HID_GLOBAL_STATE   Global;
+  HID_GLOBAL_STATE   GlobalStack[HID_MAX_GLOBAL_STACK_DEPTH];
+  UINTN              StackDepth;
+  HID_LOCAL_STATE    Local;
+  UINT16             BitOffsets[MAX_UINT8 + 1];
+  MISC_USB_HID_FIELD *Field;
+  UINTN              FieldIndex;
+  UINTN              Offset;
+  UINT8              Prefix;
+  UINTN              DataSize;
+  UINT32             Data;
+  INT32              SignedData;
+  UINTN              Index;
+  UINT32             Element;
+  UINT32             BitSize;
+
+  ASSERT (Descriptor != NULL);
+  ASSERT (NumberOfFields != NULL);
+  ASSERT ((Fields != NULL) || (*NumberOfFields == 0));
+
+  Global.UsagePage          = UsbHidUndefined;
+  Global.LogicalMinimum     = 0;
+  Global.LogicalMaximum     = 0;
+  Global.LogicalMaximumSize = 0;
+  Global.ReportId           = 0;
+  Global.ReportSize         = 0;
+  Global.ReportCount        = 0;
+  StackDepth                = 0;
+  FieldIndex                = 0;
+
+  InternalHidResetLocalState (&Local);
+
+  for (Index = 0; Index <= MAX_UINT8; ++Index) {
+    BitOffsets[Index] = 0;
+  }
+
+  for (Offset = 0; Offset < DescriptorSize; Offset += (1 + DataSize)) {
+    Prefix = Descriptor[Offset];
+
+    if (Prefix == USB_HID_ITEM_LONG) {
+      // Long items carry no information for input reports.
+      if ((DescriptorSize - Offset) < 3) {
+        return EFI_INVALID_PARAMETER;
+      }
+
+      DataSize = (2 + (UINTN)Descriptor[Offset + 1]);
+
+      if (DataSize > (DescriptorSize - Offset - 1)) {
+        return EFI_INVALID_PARAMETER;
+      }
+
+      continue;
+    }
+
+    DataSize = USB_HID_ITEM_SIZE (Prefix);
+
+    if (DataSize > (DescriptorSize - Offset - 1)) {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    Data = 0;
+
+    for (Index = 0; Index < DataSize; ++Index) {
+      Data |= ((UINT32)Descriptor[Offset + 1 + Index] << (Index * 8));
+    }
+
+    SignedData = (INT32)Data;
+
+    if ((DataSize == 1) && ((Data & BIT7) != 0)) {
+      SignedData = (INT32)(Data | 0xFFFFFF00U);
+    } else if ((DataSize == 2) && ((Data & BIT15) != 0)) {
+      SignedData = (INT32)(Data | 0xFFFF0000U);
+    }
+
+    switch (USB_HID_ITEM_TYPE (Prefix)) {
+      case UsbHidItemTypeMain:
+      {
+        if (USB_HID_ITEM_TAG (Prefix) == UsbHidMainItemTagInput) {
+          BitSize = (Global.ReportSize * Global.ReportCount);
+
+          if ((Global.ReportSize > 32)
+           || ((Global.ReportCount != 0)
+            && (BitSize / Global.ReportCount != Global.ReportSize))
+           || (BitSize > (MAX_UINT16 - BitOffsets[Global.ReportId]))) {
+            return EFI_INVALID_PARAMETER;
+          }
+
+          if (((Data & USB_HID_MAIN_ITEM_CONSTANT) == 0)
+           && (Global.ReportSize > 0)) {
+            for (Element = 0; Element < Global.ReportCount; ++Element) {
+              if ((Fields != NULL) && (FieldIndex < *NumberOfFields)) {
+                Field                 = &Fields[FieldIndex];
+                Field->BitOffset      = (UINT16)(
+                                          BitOffsets[Global.ReportId]
+                                            + (Element * Global.ReportSize)
+                                          );
+                Field->BitSize        = (UINT8)Global.ReportSize;
+                Field->ReportId       = Global.ReportId;
+                Field->Flags          = 0;
+                Field->LogicalMinimum = Global.LogicalMinimum;
+                Field->LogicalMaximum = InternalHidGetLogicalMaximum (
+                                          &Global
+                                          );
+
+                if ((Data & USB_HID_MAIN_ITEM_VARIABLE) != 0) {
+                  Field->Usage        = InternalHidGetUsage (&Local, Element);
+                  Field->UsageMaximum = Field->Usage;
+                } else {
+                  Field->Flags       |= MISC_USB_HID_FIELD_ARRAY;
+                  Field->Usage        = InternalHidGetUsage (&Local, 0);
+                  Field->UsageMaximum = InternalHidGetUsage (
+                                          &Local,
+                                          MAX_UINT32
+                                          );
+                }
+
+                if ((Data & USB_HID_MAIN_ITEM_RELATIVE) != 0) {
+                  Field->Flags |= MISC_USB_HID_FIELD_RELATIVE;
+                }
+
+                if (Global.LogicalMinimum < 0) {
+                  Field->Flags |= MISC_USB_HID_FIELD_SIGNED;
+                }
+              }
+
+              ++FieldIndex;
+            }
+          }
+
+          BitOffsets[Global.ReportId] += (UINT16)BitSize;
+        }
+
+        InternalHidResetLocalState (&Local);
+
+        break;
+      }
+
+      case UsbHidItemTypeGlobal:
+      {
+        switch (USB_HID_ITEM_TAG (Prefix)) {
+          case UsbHidGlobalItemTagUsagePage:
+          {
+            Global.UsagePage = (USB_HID_PAGE_ID)Data;
+            break;
+          }
+
+          case UsbHidGlobalItemTagLogicalMinimum:
+          {
+            Global.LogicalMinimum = SignedData;
+            break;
+          }
+
+          case UsbHidGlobalItemTagLogicalMaximum:
+          {
+            Global.LogicalMaximum     = Data;
+            Global.LogicalMaximumSize = (UINT8)DataSize;
+            break;
+          }
+
+          case UsbHidGlobalItemTagReportSize:
+          {
+            Global.ReportSize = Data;
+            break;
+          }
+
+          case UsbHidGlobalItemTagReportId:
+          {
+            if ((Data == 0) || (Data > MAX_UINT8)) {
+              return EFI_INVALID_PARAMETER;
+            }
+
+            Global.ReportId = (UINT8)Data;
+            break;
+          }
+
+          case UsbHidGlobalItemTagReportCount:
+          {
+            Global.ReportCount = Data;
+            break;
+          }
+
+          case UsbHidGlobalItemTagPush:
+          {
+            if (StackDepth == HID_MAX_GLOBAL_STACK_DEPTH) {
+              return EFI_INVALID_PARAMETER;
+            }
+
+            GlobalStack[StackDepth] = Global;
+            ++StackDepth;
+            break;
+          }
+
+          case UsbHidGlobalItemTagPop:
+          {
+            if (StackDepth == 0) {
+              return EFI_INVALID_PARAMETER;
+            }
+
+            --StackDepth;
+            Global = GlobalStack[StackDepth];
+            break;
+          }
+
+          default:
+          {
+            break;
+          }
+        }
+
+        break;
+      }
+
+      case UsbHidItemTypeLocal:
+      {
+        // Usages without a usage page are combined with the current one.
+        if (DataSize < 4) {
+          Data = USB_HID_USAGE (Data, Global.UsagePage);
+        }
+
+        switch (USB_HID_ITEM_TAG (Prefix)) {
+          case UsbHidLocalItemTagUsage:
+          {
+            if (Local.NumberOfUsages < HID_MAX_USAGES) {
+              Local.Usages[Local.NumberOfUsages] = Data;
+              ++Local.NumberOfUsages;
+            }
+
+            break;
+          }
+
+          case UsbHidLocalItemTagUsageMinimum:
+          {
+            Local.UsageMinimum  = Data;
+            Local.HasUsageRange = TRUE;
+            break;
+          }
+
+          case UsbHidLocalItemTagUsageMaximum:
+          {
+            Local.UsageMaximum  = Data;
+            Local.HasUsageRange = TRUE;
+            break;
+          }
+
+          default:
+          {
+            break;
+          }
+        }
+
+        break;
+      }
+
+      default:
+      {
+        break;
+      }
+    }
+  }
+
+  if ((Fields == NULL) || (FieldIndex > *NumberOfFields)) {
+    *NumberOfFields = FieldIndex;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  *NumberOfFields = FieldIndex;
+
+  return EFI_SUCCESS;
+}
+
+// MiscUsbHidExtractFields
+/** Extracts the values of the fields of a report.
+
+  @param[in]  Fields          The program returned by
+                              MiscUsbHidCompileReportDescriptor().
+  @param[in]  NumberOfFields  The number of entries of Fields.
+  @param[in]  Report          The report to extract the values of.
+  @param[in]  ReportSize      The size, in bytes, of Report.
+  @param[out] Values          On output, the value of each field of the
+                              report.  The entries of fields of other
+                              reports, or exceeding ReportSize, are not
+                              changed.
+
+  @return  The number of values extracted.
+**/
+UINTN
+MiscUsbHidExtractFields (
+  IN  CONST MISC_USB_HID_FIELD  *Fields,
+  IN  UINTN                     NumberOfFields,
+  IN  CONST UINT8               *Report,
+  IN  UINTN                     ReportSize,
+  OUT INT32                     *Values
+  )
+{
+  UINTN       NumberOfValues;
+  UINTN       Index;
+  CONST UINT8 *Data;
+  UINTN       DataSize;
+  UINTN       ByteOffset;
+  UINTN       ByteIndex;
+  UINT64      Raw;
+  UINT32      Value;
+  UINT32      Mask;
+
+  ASSERT ((Fields != NULL) || (NumberOfFields == 0));
+  ASSERT (Report != NULL);
+  ASSERT (Values != NULL);
+
+  NumberOfValues = 0;
+
+  for (Index = 0; Index < NumberOfFields; ++Index) {
+    Data     = Report;
+    DataSize = ReportSize;
+
+    if (Fields[Index].ReportId != 0) {
+      if ((ReportSize == 0) || (Report[0] != Fields[Index].ReportId)) {
+        continue;
+      }
+
+      ++Data;
+      --DataSize;
+    }
+
+    if (((UINTN)Fields[Index].BitOffset + Fields[Index].BitSize)
+          > (DataSize * 8)) {
+      continue;
+    }
+
+    ByteOffset = (Fields[Index].BitOffset / 8);
+    Raw        = 0;
+
+    for (ByteIndex = 0;
+         (ByteIndex * 8) < ((Fields[Index].BitOffset % 8U)
+                              + Fields[Index].BitSize);
+         ++ByteIndex) {
+      Raw |= LShiftU64 (Data[ByteOffset + ByteIndex], ByteIndex * 8);
+    }
+
+    Mask  = ((Fields[Index].BitSize == 32)
+               ? MAX_UINT32
+               : ((1U << Fields[Index].BitSize) - 1));
+    Value = ((UINT32)RShiftU64 (Raw, Fields[Index].BitOffset % 8U) & Mask);
+
+    if (((Fields[Index].Flags & MISC_USB_HID_FIELD_SIGNED) != 0)
+     && ((Value & ~(Mask >> 1)) != 0)) {
+      Value |= ~Mask;
+    }
+
+    Values[Index] = (INT32)Value;
+    ++NumberOfValues;
+  }
+
+  return NumberOfValues;
+}
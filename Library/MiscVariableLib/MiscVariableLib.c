@@ -19,6 +19,7 @@
 #include <Guid/GlobalVariable.h>
 
 #include <Library/DebugLib.h>
+#include <Library/MiscPerformanceLib.h>
 #include <Library/MiscVariableLib.h>
 #include <Library/UefiRuntimeLib.h>
 
@@ -31,17 +32,31 @@ GetEfiGlobalVariable (
   OUT    VOID    *Data
   )
 {
+  EFI_STATUS Status;
+
   ASSERT (VariableName != NULL);
   ASSERT (VariableName[0] != L'\0');
   ASSERT (DataSize != NULL);
 
-  return EfiGetVariable (
-           VariableName,
-           &gEfiGlobalVariableGuid,
-           Attributes,
-           DataSize,
-           Data
-           );
+  MISC_PERFORMANCE_BEGIN (
+    MISC_PERFORMANCE_MODULE_VARIABLE,
+    MISC_PERFORMANCE_ID_GET_VARIABLE
+    );
+
+  Status = EfiGetVariable (
+             VariableName,
+             &gEfiGlobalVariableGuid,
+             Attributes,
+             DataSize,
+             Data
+             );
+
+  MISC_PERFORMANCE_END (
+    MISC_PERFORMANCE_MODULE_VARIABLE,
+    MISC_PERFORMANCE_ID_GET_VARIABLE
+    );
+
+  return Status;
 }
 
 // GetNextEfiGlobalVariableName
@@ -71,17 +86,31 @@ SetEfiGlobalVariable (
   IN VOID    *Data
   )
 {
+  EFI_STATUS Status;
+
   ASSERT (VariableName != NULL);
   ASSERT (VariableName[0] != L'\0');
   ASSERT ((((DataSize > 0) ? 1 : 0) ^ ((Data == NULL) ? 1 : 0)) != 0);
 
-  return EfiSetVariable (
-           VariableName,
-           &gEfiGlobalVariableGuid,
-           Attributes,
-           DataSize,
-           Data
-           );
+  MISC_PERFORMANCE_BEGIN (
+    MISC_PERFORMANCE_MODULE_VARIABLE,
+    MISC_PERFORMANCE_ID_SET_VARIABLE
+    );
+
+  Status = EfiSetVariable (
+             VariableName,
+             &gEfiGlobalVariableGuid,
+             Attributes,
+             DataSize,
+             Data
+             );
+
+  MISC_PERFORMANCE_END (
+    MISC_PERFORMANCE_MODULE_VARIABLE,
+    MISC_PERFORMANCE_ID_SET_VARIABLE
+    );
+
+  return Status;
 }
 
 // DeleteVariable
@@ -91,11 +120,25 @@ DeleteVariable (
   IN EFI_GUID  *VendorGuid
   )
 {
+  EFI_STATUS Status;
+
   ASSERT (VariableName != NULL);
   ASSERT (VariableName[0] != L'\0');
   ASSERT (VendorGuid != NULL);
 
-  return EfiSetVariable (VariableName, VendorGuid, 0, 0, NULL);
+  MISC_PERFORMANCE_BEGIN (
+    MISC_PERFORMANCE_MODULE_VARIABLE,
+    MISC_PERFORMANCE_ID_SET_VARIABLE
+    );
+
+  Status = EfiSetVariable (VariableName, VendorGuid, 0, 0, NULL);
+
+  MISC_PERFORMANCE_END (
+    MISC_PERFORMANCE_MODULE_VARIABLE,
+    MISC_PERFORMANCE_ID_SET_VARIABLE
+    );
+
+  return Status;
 }
 
 // DeleteEfiGlobalVariable
@@ -124,8 +167,18 @@ VariableExists (
   ASSERT (VariableName[0] != L'\0');
   ASSERT (VendorGuid != NULL);
 
+  MISC_PERFORMANCE_BEGIN (
+    MISC_PERFORMANCE_MODULE_VARIABLE,
+    MISC_PERFORMANCE_ID_GET_VARIABLE
+    );
+
   Size   = 0;
   Status = EfiGetVariable (VariableName, VendorGuid, 0, &Size, NULL);
 
+  MISC_PERFORMANCE_END (
+    MISC_PERFORMANCE_MODULE_VARIABLE,
+    MISC_PERFORMANCE_ID_GET_VARIABLE
+    );
+
   return (BOOLEAN)(Status == EFI_BUFFER_TOO_SMALL);
 }
@@ -0,0 +1,291 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiPei.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PeiServicesLib.h>
+
+// PEI_ARENA_MAX_RELOCATIONS
+#define PEI_ARENA_MAX_RELOCATIONS  8
+
+// PEI_ARENA_MAX_POOL_SIZE
+/// Pool allocations are backed by a HOB, the length of which is 16-bit.
+#define PEI_ARENA_MAX_POOL_SIZE  (MAX_UINT16 - SIZE_4KB)
+
+// PEI_ARENA_RELOCATION
+typedef struct {
+  PEI_ARENA_RELOCATE Relocate;  ///< The function to call.
+  VOID               *Context;  ///< The context passed to Relocate.
+} PEI_ARENA_RELOCATION;
+
+// PEI_ARENA
+/// The arena data follows the structure within the same allocation, so both
+/// are migrated together with the PEI heap.  All state is kept as offsets.
+struct PEI_ARENA {
+  EFI_PEI_NOTIFY_DESCRIPTOR MemoryDiscovered;     ///< Relocates the arena.
+  UINTN                     Location;             ///< The address of the
+                                                  ///< arena when last seen.
+  UINTN                     Size;                 ///< The size of the data.
+  UINTN                     Used;                 ///< The bytes in use.
+  UINTN                     HighWaterMark;        ///< The maximum of Used.
+  UINTN                     NumberOfRelocations;  ///< The number of used
+                                                  ///< Relocations.
+  PEI_ARENA_RELOCATION      Relocations[PEI_ARENA_MAX_RELOCATIONS];
+};
+
+// ARENA_DATA
+#define ARENA_DATA(Arena)  ((UINT8 *)((Arena) + 1))
+
+// InternalArenaMemoryDiscoveredNotify
+/** Informs the registered callbacks about the migration of the arena when
+    permanent memory has been installed.
+
+  The PEI Foundation converts the pointer to the notify descriptor, hence the
+  arena is found at its new location.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalArenaMemoryDiscoveredNotify (
+  IN EFI_PEI_SERVICES           **PeiServices,
+  IN EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyDescriptor,
+  IN VOID                       *Ppi
+  )
+{
+  PEI_ARENA *Arena;
+  INTN      Delta;
+  UINTN     Index;
+
+  Arena           = BASE_CR (NotifyDescriptor, PEI_ARENA, MemoryDiscovered);
+  Delta           = (INTN)((UINTN)Arena - Arena->Location);
+  Arena->Location = (UINTN)Arena;
+
+  if (Delta != 0) {
+    for (Index = 0; Index < Arena->NumberOfRelocations; ++Index) {
+      Arena->Relocations[Index].Relocate (
+                                  Arena,
+                                  Delta,
+                                  Arena->Relocations[Index].Context
+                                  );
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+// PeiCreateArena
+/** Creates an arena to serve small allocations from a single block.
+
+  @param[in]  Size   The size, in bytes, of the arena.
+  @param[out] Arena  On output, a pointer to the arena.
+
+  @retval EFI_SUCCESS           The arena was created.
+  @retval EFI_OUT_OF_RESOURCES  The arena could not be allocated.
+**/
+EFI_STATUS
+PeiCreateArena (
+  IN  UINTN      Size,
+  OUT PEI_ARENA  **Arena
+  )
+{
+  EFI_STATUS           Status;
+
+  PEI_ARENA            *NewArena;
+  EFI_PHYSICAL_ADDRESS Address;
+  UINTN                TotalSize;
+
+  ASSERT (Size > 0);
+  ASSERT (Arena != NULL);
+
+  TotalSize = (sizeof (*NewArena) + Size);
+
+  if (TotalSize <= PEI_ARENA_MAX_POOL_SIZE) {
+    Status = PeiAllocatePool (TotalSize, (VOID **)&NewArena);
+  } else {
+    Status = PeiAllocatePages (
+               EfiBootServicesData,
+               EFI_SIZE_TO_PAGES (TotalSize),
+               &Address
+               );
+
+    NewArena = (PEI_ARENA *)(UINTN)Address;
+  }
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  NewArena->MemoryDiscovered.Flags = (EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK
+                                       | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST);
+
+  NewArena->MemoryDiscovered.Guid   = &gEfiPeiMemoryDiscoveredPpiGuid;
+  NewArena->MemoryDiscovered.Notify = InternalArenaMemoryDiscoveredNotify;
+  NewArena->Location                = (UINTN)NewArena;
+  NewArena->Size                    = Size;
+  NewArena->Used                    = 0;
+  NewArena->HighWaterMark           = 0;
+  NewArena->NumberOfRelocations     = 0;
+
+  Status = PeiNotifyPpi (&NewArena->MemoryDiscovered);
+
+  if (!EFI_ERROR (Status)) {
+    *Arena = NewArena;
+  }
+
+  return Status;
+}
+
+// PeiArenaAllocate
+/** Allocates a buffer from an arena.
+
+  @param[in] Arena      The arena returned by PeiCreateArena().
+  @param[in] Size       The size, in bytes, of the buffer.
+  @param[in] Alignment  The alignment of the buffer.  Must be a power of two.
+
+  @return  A pointer to the buffer, or NULL if the arena is exhausted.
+**/
+VOID *
+PeiArenaAllocate (
+  IN PEI_ARENA  *Arena,
+  IN UINTN      Size,
+  IN UINTN      Alignment
+  )
+{
+  UINTN Address;
+  UINTN Used;
+
+  ASSERT (Arena != NULL);
+  ASSERT (Size > 0);
+  ASSERT ((Alignment != 0) && ((Alignment & (Alignment - 1)) == 0));
+
+  Address = ALIGN_VALUE ((UINTN)ARENA_DATA (Arena) + Arena->Used, Alignment);
+  Used    = (Address - (UINTN)ARENA_DATA (Arena));
+
+  if ((Used > Arena->Size) || (Size > (Arena->Size - Used))) {
+    return NULL;
+  }
+
+  Arena->Used = (Used + Size);
+
+  if (Arena->Used > Arena->HighWaterMark) {
+    Arena->HighWaterMark = Arena->Used;
+  }
+
+  return (VOID *)Address;
+}
+
+// PeiArenaGetMark
+/** Returns the current allocation position of an arena.
+
+  @param[in] Arena  The arena returned by PeiCreateArena().
+
+  @return  A mark to pass to PeiArenaReleaseToMark().
+**/
+UINTN
+PeiArenaGetMark (
+  IN CONST PEI_ARENA  *Arena
+  )
+{
+  ASSERT (Arena != NULL);
+
+  return Arena->Used;
+}
+
+// PeiArenaReleaseToMark
+/** Frees all buffers allocated from an arena since a mark was taken.
+
+  @param[in] Arena  The arena returned by PeiCreateArena().
+  @param[in] Mark   The mark returned by PeiArenaGetMark(), or 0 to free all
+                    buffers.
+**/
+VOID
+PeiArenaReleaseToMark (
+  IN PEI_ARENA  *Arena,
+  IN UINTN      Mark
+  )
+{
+  ASSERT (Arena != NULL);
+  ASSERT (Mark <= Arena->Used);
+
+  Arena->Used = Mark;
+}
+
+// PeiArenaGetUsage
+/** Returns the usage of an arena.
+
+  @param[in]  Arena          The arena returned by PeiCreateArena().
+  @param[out] Size           On output, the size, in bytes, of the arena.
+  @param[out] Used           On output, the number of bytes in use.
+  @param[out] HighWaterMark  On output, the maximum number of bytes that have
+                             been in use.
+**/
+VOID
+PeiArenaGetUsage (
+  IN  CONST PEI_ARENA  *Arena,
+  OUT UINTN            *Size, OPTIONAL
+  OUT UINTN            *Used, OPTIONAL
+  OUT UINTN            *HighWaterMark OPTIONAL
+  )
+{
+  ASSERT (Arena != NULL);
+
+  if (Size != NULL) {
+    *Size = Arena->Size;
+  }
+
+  if (Used != NULL) {
+    *Used = Arena->Used;
+  }
+
+  if (HighWaterMark != NULL) {
+    *HighWaterMark = Arena->HighWaterMark;
+  }
+}
+
+// PeiArenaRegisterRelocation
+/** Registers a function to be called when an arena has been migrated to
+    permanent memory.
+
+  @param[in] Arena     The arena returned by PeiCreateArena().
+  @param[in] Relocate  The function to call.
+  @param[in] Context   The context to pass to Relocate.
+
+  @retval EFI_SUCCESS           The function was registered.
+  @retval EFI_OUT_OF_RESOURCES  No more functions can be registered.
+**/
+EFI_STATUS
+PeiArenaRegisterRelocation (
+  IN PEI_ARENA           *Arena,
+  IN PEI_ARENA_RELOCATE  Relocate,
+  IN VOID                *Context OPTIONAL
+  )
+{
+  ASSERT (Arena != NULL);
+  ASSERT (Relocate != NULL);
+
+  if (Arena->NumberOfRelocations == PEI_ARENA_MAX_RELOCATIONS) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Arena->Relocations[Arena->NumberOfRelocations].Relocate = Relocate;
+  Arena->Relocations[Arena->NumberOfRelocations].Context  = Context;
+
+  ++Arena->NumberOfRelocations;
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,223 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiPei.h>
+
+#include <Library/DebugLib.h>
+#include <Library/MiscFvLib.h>
+#include <Library/PeiServicesLib.h>
+
+// PEI_FV_FILE_INDEX
+/// The MISC_FV_FILE_INDEX_ENTRY entries follow the structure.
+struct PEI_FV_FILE_INDEX {
+  EFI_PEI_FV_HANDLE VolumeHandle;     ///< The indexed firmware volume.
+  UINTN             NumberOfEntries;  ///< The number of indexed files.
+};
+
+// FV_FILE_INDEX_ENTRIES
+#define FV_FILE_INDEX_ENTRIES(Index)  \
+  ((MISC_FV_FILE_INDEX_ENTRY *)((Index) + 1))
+
+// PeiFfsBuildFileIndex
+/** Indexes the files of a memory-mapped firmware volume by name.
+
+  PEI pool cannot be freed or shrunk, hence the volume is walked twice: once to
+  count the files, following only the file headers, and once to record them.
+  Later lookups do not walk the volume.
+
+  @param[in]  VolumeHandle  The firmware volume to index.
+  @param[out] FileIndex     On output, a pointer to the index.
+
+  @retval EFI_SUCCESS           The index was built.
+  @retval EFI_VOLUME_CORRUPTED  The firmware volume header is corrupted.
+  @retval EFI_OUT_OF_RESOURCES  The index could not be allocated.
+**/
+EFI_STATUS
+PeiFfsBuildFileIndex (
+  IN  EFI_PEI_FV_HANDLE  VolumeHandle,
+  OUT PEI_FV_FILE_INDEX  **FileIndex
+  )
+{
+  EFI_STATUS                       Status;
+
+  CONST EFI_FIRMWARE_VOLUME_HEADER *FvHeader;
+  PEI_FV_FILE_INDEX                *Index;
+  UINTN                            NumberOfEntries;
+
+  ASSERT (VolumeHandle != NULL);
+  ASSERT (FileIndex != NULL);
+
+  // The handles of memory-mapped firmware volumes are their headers.
+
+  FvHeader = (CONST EFI_FIRMWARE_VOLUME_HEADER *)VolumeHandle;
+  Status   = MiscFvValidateHeader (FvHeader, (UINTN)FvHeader->FvLength);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  NumberOfEntries = 0;
+
+  MiscFvBuildFileIndex (FvHeader, NULL, &NumberOfEntries);
+
+  Status = PeiAllocatePool (
+             (sizeof (*Index)
+               + (NumberOfEntries * sizeof (MISC_FV_FILE_INDEX_ENTRY))),
+             (VOID **)&Index
+             );
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = MiscFvBuildFileIndex (
+             FvHeader,
+             FV_FILE_INDEX_ENTRIES (Index),
+             &NumberOfEntries
+             );
+
+  ASSERT_EFI_ERROR (Status);
+
+  Index->VolumeHandle    = VolumeHandle;
+  Index->NumberOfEntries = NumberOfEntries;
+
+  *FileIndex = Index;
+
+  return EFI_SUCCESS;
+}
+
+// PeiFfsFindIndexedFileByName
+/** Finds a file within an indexed firmware volume by its name.
+
+  @param[in]  FileIndex   The index returned by PeiFfsBuildFileIndex().
+  @param[in]  FileName    A pointer to the name of the file to find.
+  @param[out] FileHandle  On output, the handle of the found file.
+
+  @retval EFI_SUCCESS    The file was found.
+  @retval EFI_NOT_FOUND  The file was not found.
+**/
+EFI_STATUS
+PeiFfsFindIndexedFileByName (
+  IN  CONST PEI_FV_FILE_INDEX  *FileIndex,
+  IN  CONST EFI_GUID           *FileName,
+  OUT EFI_PEI_FILE_HANDLE      *FileHandle
+  )
+{
+  CONST MISC_FV_FILE_INDEX_ENTRY *Entry;
+
+  ASSERT (FileIndex != NULL);
+  ASSERT (FileName != NULL);
+  ASSERT (FileHandle != NULL);
+
+  Entry = MiscFvFindIndexedFile (
+            FV_FILE_INDEX_ENTRIES (FileIndex),
+            FileIndex->NumberOfEntries,
+            FileName
+            );
+
+  if (Entry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  *FileHandle = (EFI_PEI_FILE_HANDLE)(
+                  (UINTN)FileIndex->VolumeHandle + Entry->Offset
+                  );
+
+  return EFI_SUCCESS;
+}
+
+// PeiFfsScanFiles
+/** Describes the files of a memory-mapped firmware volume, in volume order.
+
+  Unlike repeated calls to PeiFfsFindNextFile(), the files are returned as a
+  contiguous array by one call.  PEI pool cannot be freed or shrunk, hence the
+  volume is walked twice: once to count the files, following only the file
+  headers, and once to describe them.  The header checksums are only verified
+  by the second walk, so each is computed once.  Pad files are not described.
+
+  @param[in]  VolumeHandle   The firmware volume to scan.
+  @param[in]  VerifyHeaders  Whether to skip files with an invalid header
+                             checksum.
+  @param[out] Files          On output, a pointer to the pool-allocated file
+                             descriptors.  NULL if there are no files.
+  @param[out] NumberOfFiles  On output, the number of entries in Files.
+
+  @retval EFI_SUCCESS           The files were described.
+  @retval EFI_VOLUME_CORRUPTED  The firmware volume header is corrupted.
+  @retval EFI_OUT_OF_RESOURCES  The descriptors could not be allocated.
+**/
+EFI_STATUS
+PeiFfsScanFiles (
+  IN  EFI_PEI_FV_HANDLE         VolumeHandle,
+  IN  BOOLEAN                   VerifyHeaders,
+  OUT MISC_FV_FILE_INDEX_ENTRY  **Files,
+  OUT UINTN                     *NumberOfFiles
+  )
+{
+  EFI_STATUS                       Status;
+
+  CONST EFI_FIRMWARE_VOLUME_HEADER *FvHeader;
+  MISC_FV_FILE_INDEX_ENTRY         *Entries;
+  UINTN                            NumberOfEntries;
+
+  ASSERT (VolumeHandle != NULL);
+  ASSERT (Files != NULL);
+  ASSERT (NumberOfFiles != NULL);
+
+  FvHeader = (CONST EFI_FIRMWARE_VOLUME_HEADER *)VolumeHandle;
+  Status   = MiscFvValidateHeader (FvHeader, (UINTN)FvHeader->FvLength);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Entries         = NULL;
+  NumberOfEntries = 0;
+
+  // Counting all files bounds the number of files with a valid header without
+  // computing any checksum.
+
+  MiscFvScanFiles (FvHeader, FALSE, NULL, &NumberOfEntries);
+
+  if (NumberOfEntries > 0) {
+    Status = PeiAllocatePool (
+               (NumberOfEntries * sizeof (*Entries)),
+               (VOID **)&Entries
+               );
+
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Status = MiscFvScanFiles (
+               FvHeader,
+               VerifyHeaders,
+               Entries,
+               &NumberOfEntries
+               );
+
+    ASSERT_EFI_ERROR (Status);
+
+    if (NumberOfEntries == 0) {
+      Entries = NULL;
+    }
+  }
+
+  *Files         = Entries;
+  *NumberOfFiles = NumberOfEntries;
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,284 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiPei.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PeiServicesLib.h>
+
+// PeiHobBuilderReserve
+/** Reserves space for multiple HOBs with a single call to the PEI Foundation.
+
+  @param[in]  Length   The total length, in bytes, of the HOBs to build.  The
+                       length of every HOB is rounded up to 8 bytes.
+  @param[out] Builder  The builder to initialize.
+
+  @retval EFI_SUCCESS            The space was reserved.
+  @retval EFI_INVALID_PARAMETER  Length is greater than
+                                 PEI_HOB_BUILDER_MAX_LENGTH.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough space for the
+                                 reservation.
+**/
+EFI_STATUS
+PeiHobBuilderReserve (
+  IN  UINTN            Length,
+  OUT PEI_HOB_BUILDER  *Builder
+  )
+{
+  EFI_STATUS             Status;
+
+  EFI_HOB_GENERIC_HEADER *Hob;
+
+  ASSERT (Length >= sizeof (*Hob));
+  ASSERT (Builder != NULL);
+
+  Builder->Free       = NULL;
+  Builder->FreeLength = 0;
+
+  if (Length > PEI_HOB_BUILDER_MAX_LENGTH) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // The PEI Foundation rounds up the length and terminates the list after the
+  // HOB, the contents of which are left uninitialized.
+
+  Status = PeiCreateHob (EFI_HOB_TYPE_UNUSED, (UINT16)Length, (VOID **)&Hob);
+
+  if (!EFI_ERROR (Status)) {
+    Builder->Free       = Hob;
+    Builder->FreeLength = Hob->HobLength;
+  }
+
+  return Status;
+}
+
+// PeiHobBuilderCreateHob
+/** Creates a HOB within the reservation of a builder.
+
+  Only the HOB header is initialized.
+
+  @param[in, out] Builder  The builder initialized by PeiHobBuilderReserve().
+  @param[in]      Type     The type of the HOB.  Must not be
+                           EFI_HOB_TYPE_UNUSED or EFI_HOB_TYPE_END_OF_HOB_LIST.
+  @param[in]      Length   The length, in bytes, of the HOB.
+  @param[out]     Hob      On output, a pointer to the HOB.
+
+  @retval EFI_SUCCESS           The HOB was created.
+  @retval EFI_OUT_OF_RESOURCES  The remainder of the reservation is too small.
+**/
+EFI_STATUS
+PeiHobBuilderCreateHob (
+  IN OUT PEI_HOB_BUILDER  *Builder,
+  IN     UINT16           Type,
+  IN     UINT16           Length,
+  OUT    VOID             **Hob
+  )
+{
+  EFI_HOB_GENERIC_HEADER *Header;
+  UINTN                  HobLength;
+
+  ASSERT (Builder != NULL);
+  ASSERT (Type != EFI_HOB_TYPE_UNUSED);
+  ASSERT (Type != EFI_HOB_TYPE_END_OF_HOB_LIST);
+  ASSERT (Length >= sizeof (*Header));
+  ASSERT (Hob != NULL);
+
+  HobLength = ALIGN_VALUE ((UINTN)Length, 8);
+
+  if ((Builder->Free == NULL) || (HobLength > Builder->FreeLength)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  // Write the remainder before the HOB so the list never contains a header
+  // with a stale length.  Both lengths are multiples of 8, so any remainder
+  // can hold a header.
+
+  Header = Builder->Free;
+
+  Builder->Free        = (EFI_HOB_GENERIC_HEADER *)((UINTN)Header + HobLength);
+  Builder->FreeLength -= HobLength;
+
+  if (Builder->FreeLength > 0) {
+    Builder->Free->HobType   = EFI_HOB_TYPE_UNUSED;
+    Builder->Free->HobLength = (UINT16)Builder->FreeLength;
+    Builder->Free->Reserved  = 0;
+  } else {
+    Builder->Free = NULL;
+  }
+
+  Header->HobLength = (UINT16)HobLength;
+  Header->Reserved  = 0;
+  Header->HobType   = Type;
+
+  *Hob = (VOID *)Header;
+
+  return EFI_SUCCESS;
+}
+
+// PeiHobBuilderBuildGuidHob
+/** Creates a GUID extension HOB within the reservation of a builder.
+
+  @param[in, out] Builder     The builder initialized by PeiHobBuilderReserve().
+  @param[in]      Guid        The GUID of the HOB.
+  @param[in]      DataLength  The length, in bytes, of the HOB data.
+
+  @return  A pointer to the uninitialized HOB data, or NULL if the remainder
+           of the reservation is too small.
+**/
+VOID *
+PeiHobBuilderBuildGuidHob (
+  IN OUT PEI_HOB_BUILDER  *Builder,
+  IN     CONST EFI_GUID   *Guid,
+  IN     UINTN            DataLength
+  )
+{
+  EFI_STATUS        Status;
+
+  EFI_HOB_GUID_TYPE *Hob;
+
+  ASSERT (Builder != NULL);
+  ASSERT (Guid != NULL);
+
+  if (DataLength > (PEI_HOB_BUILDER_MAX_LENGTH - sizeof (*Hob))) {
+    return NULL;
+  }
+
+  Status = PeiHobBuilderCreateHob (
+             Builder,
+             EFI_HOB_TYPE_GUID_EXTENSION,
+             (UINT16)(sizeof (*Hob) + DataLength),
+             (VOID **)&Hob
+             );
+
+  if (EFI_ERROR (Status)) {
+    return NULL;
+  }
+
+  CopyGuid (&Hob->Name, Guid);
+
+  return (VOID *)(Hob + 1);
+}
+
+// PeiHobBuilderBuildResourceDescriptorHob
+/** Creates a resource descriptor HOB within the reservation of a builder.
+
+  @param[in, out] Builder            The builder initialized by
+                                     PeiHobBuilderReserve().
+  @param[in]      ResourceType       The type of the resource.
+  @param[in]      ResourceAttribute  The attributes of the resource.
+  @param[in]      PhysicalStart      The base address of the resource.
+  @param[in]      NumberOfBytes      The length, in bytes, of the resource.
+
+  @retval EFI_SUCCESS           The HOB was created.
+  @retval EFI_OUT_OF_RESOURCES  The remainder of the reservation is too small.
+**/
+EFI_STATUS
+PeiHobBuilderBuildResourceDescriptorHob (
+  IN OUT PEI_HOB_BUILDER              *Builder,
+  IN     EFI_RESOURCE_TYPE            ResourceType,
+  IN     EFI_RESOURCE_ATTRIBUTE_TYPE  ResourceAttribute,
+  IN     EFI_PHYSICAL_ADDRESS         PhysicalStart,
+  IN     UINT64                       NumberOfBytes
+  )
+{
+  EFI_STATUS                  Status;
+
+  EFI_HOB_RESOURCE_DESCRIPTOR *Hob;
+
+  ASSERT (Builder != NULL);
+
+  Status = PeiHobBuilderCreateHob (
+             Builder,
+             EFI_HOB_TYPE_RESOURCE_DESCRIPTOR,
+             (UINT16)sizeof (*Hob),
+             (VOID **)&Hob
+             );
+
+  if (!EFI_ERROR (Status)) {
+    ZeroMem ((VOID *)&Hob->Owner, sizeof (Hob->Owner));
+
+    Hob->ResourceType      = ResourceType;
+    Hob->ResourceAttribute = ResourceAttribute;
+    Hob->PhysicalStart     = PhysicalStart;
+    Hob->ResourceLength    = NumberOfBytes;
+  }
+
+  return Status;
+}
+
+// PeiBuildResourceDescriptorHobs
+/** Publishes a memory map as resource descriptor HOBs, reserving the space
+    for as many HOBs as possible at once.
+
+  The Header and Owner fields of the descriptors are ignored.  The Owner of
+  the created HOBs is zeroed.
+
+  @param[in] Descriptors          The resource descriptors to publish.
+  @param[in] NumberOfDescriptors  The number of entries in Descriptors.
+
+  @retval EFI_SUCCESS           The HOBs were created.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough space for the HOBs.
+**/
+EFI_STATUS
+PeiBuildResourceDescriptorHobs (
+  IN CONST EFI_HOB_RESOURCE_DESCRIPTOR  *Descriptors,
+  IN UINTN                              NumberOfDescriptors
+  )
+{
+  EFI_STATUS      Status;
+
+  PEI_HOB_BUILDER Builder;
+  UINTN           HobLength;
+  UINTN           NumberOfHobs;
+  UINTN           Index;
+
+  ASSERT ((Descriptors != NULL) || (NumberOfDescriptors == 0));
+
+  HobLength = ALIGN_VALUE (sizeof (*Descriptors), 8);
+  Status    = EFI_SUCCESS;
+
+  while (NumberOfDescriptors > 0) {
+    NumberOfHobs = (PEI_HOB_BUILDER_MAX_LENGTH / HobLength);
+
+    if (NumberOfHobs > NumberOfDescriptors) {
+      NumberOfHobs = NumberOfDescriptors;
+    }
+
+    Status = PeiHobBuilderReserve ((NumberOfHobs * HobLength), &Builder);
+
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    for (Index = 0; Index < NumberOfHobs; ++Index) {
+      Status = PeiHobBuilderBuildResourceDescriptorHob (
+                 &Builder,
+                 Descriptors[Index].ResourceType,
+                 Descriptors[Index].ResourceAttribute,
+                 Descriptors[Index].PhysicalStart,
+                 Descriptors[Index].ResourceLength
+                 );
+
+      ASSERT_EFI_ERROR (Status);
+    }
+
+    Descriptors         += NumberOfHobs;
+    NumberOfDescriptors -= NumberOfHobs;
+  }
+
+  return Status;
+}
@@ -0,0 +1,481 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiPei.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PeiServicesLib.h>
+
+// PEI_HOB_INDEX_GROWTH
+/// The number of entries reserved in addition to the HOBs present when the
+/// index grows.  Growing allocates a new pool buffer, which adds a HOB itself.
+#define PEI_HOB_INDEX_GROWTH  32
+
+// PEI_HOB_INDEX
+/// The index is shared among all PEIMs through a PPI.  It is allocated from the
+/// PEI heap and migrated along with it by the PEI Foundation.  As this does not
+/// update Entries, the index is rebuilt when the HOB list has moved.
+struct PEI_HOB_INDEX {
+  EFI_PEI_PPI_DESCRIPTOR Descriptor;       ///< The descriptor of the index PPI.
+  VOID                   *HobList;         ///< The indexed HOB list.
+  UINT32                 IndexedEnd;       ///< The offset of the end of the
+                                           ///< indexed HOBs.
+  UINT32                 NumberOfEntries;  ///< The number of used Entries.
+  UINT32                 NumberOfUnused;   ///< The number of indexed unused
+                                           ///< HOBs.
+  UINT32                 Capacity;         ///< The number of allocated Entries.
+  UINT32                 *Entries;         ///< The HOB offsets, sorted by type,
+                                           ///< GUID and offset.
+};
+
+// InternalCompareHob
+/** Compares an indexed HOB against a key.
+
+  @param[in] HobList  A pointer to the indexed HOB list.
+  @param[in] Offset   The offset of the indexed HOB.
+  @param[in] Type     The type of the key.
+  @param[in] Guid     The GUID of the key if Type is
+                      EFI_HOB_TYPE_GUID_EXTENSION.
+
+  @return  A value less than, equal to or greater than zero if the HOB orders
+           before, equal to or after the key.
+**/
+STATIC
+INTN
+InternalCompareHob (
+  IN CONST VOID      *HobList,
+  IN UINT32          Offset,
+  IN UINT16          Type,
+  IN CONST EFI_GUID  *Guid
+  )
+{
+  EFI_PEI_HOB_POINTERS Hob;
+
+  Hob.Raw = ((UINT8 *)HobList + Offset);
+
+  if (Hob.Header->HobType != Type) {
+    return ((Hob.Header->HobType < Type) ? -1 : 1);
+  }
+
+  if (Type != EFI_HOB_TYPE_GUID_EXTENSION) {
+    return 0;
+  }
+
+  return CompareMem ((VOID *)&Hob.Guid->Name, (VOID *)Guid, sizeof (*Guid));
+}
+
+// InternalFindBound
+/** Returns the first entry that orders after the key, or equal to it if
+    LowerBound is TRUE.
+**/
+STATIC
+UINT32
+InternalFindBound (
+  IN CONST PEI_HOB_INDEX  *HobIndex,
+  IN UINT16               Type,
+  IN CONST EFI_GUID       *Guid,
+  IN BOOLEAN              LowerBound
+  )
+{
+  UINT32 Low;
+  UINT32 High;
+  UINT32 Middle;
+  INTN   Result;
+
+  Low  = 0;
+  High = HobIndex->NumberOfEntries;
+
+  while (Low < High) {
+    Middle = (Low + ((High - Low) / 2));
+    Result = InternalCompareHob (
+               HobIndex->HobList,
+               HobIndex->Entries[Middle],
+               Type,
+               Guid
+               );
+
+    if ((Result < 0) || (!LowerBound && (Result == 0))) {
+      Low = (Middle + 1);
+    } else {
+      High = Middle;
+    }
+  }
+
+  return Low;
+}
+
+// InternalCountHobs
+STATIC
+UINT32
+InternalCountHobs (
+  IN CONST VOID  *HobList,
+  IN UINT32      Offset
+  )
+{
+  UINT32               NumberOfHobs;
+
+  EFI_PEI_HOB_POINTERS Hob;
+
+  NumberOfHobs = 0;
+
+  for (Hob.Raw = ((UINT8 *)HobList + Offset);
+       !END_OF_HOB_LIST (Hob);
+       Hob.Raw = GET_NEXT_HOB (Hob)) {
+    ++NumberOfHobs;
+  }
+
+  return NumberOfHobs;
+}
+
+// InternalIsUnusedHobReclaimed
+/** Returns whether an indexed unused HOB has since been reused in place, as
+    done by PeiHobBuilderCreateHob().
+
+  EFI_HOB_TYPE_UNUSED orders after all other types, so the unused HOBs are the
+  last entries of the index.
+
+  @param[in] HobIndex  The index to check.
+
+  @retval TRUE   An unused HOB has been reused and the index is stale.
+  @retval FALSE  All indexed unused HOBs are still unused.
+**/
+STATIC
+BOOLEAN
+InternalIsUnusedHobReclaimed (
+  IN CONST PEI_HOB_INDEX  *HobIndex
+  )
+{
+  EFI_PEI_HOB_POINTERS Hob;
+  UINT32               Index;
+
+  for (Index = (HobIndex->NumberOfEntries - HobIndex->NumberOfUnused);
+       Index < HobIndex->NumberOfEntries;
+       ++Index) {
+    Hob.Raw = ((UINT8 *)HobIndex->HobList + HobIndex->Entries[Index]);
+
+    if (Hob.Header->HobType != EFI_HOB_TYPE_UNUSED) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+// InternalUpdateHobIndex
+/** Brings the index up to date with the HOB list.
+
+  HOBs are only ever appended to the list, hence only those after the last
+  indexed HOB are added.  Since their offsets are greater than any indexed one,
+  each is inserted after the last entry of equal type and GUID.  Unused HOBs
+  may be reused in place, in which case the index is rebuilt.
+
+  @param[in, out] HobIndex  The index to update.
+
+  @retval EFI_SUCCESS           The index is up to date.
+  @retval EFI_OUT_OF_RESOURCES  The index could not be grown.
+**/
+STATIC
+EFI_STATUS
+InternalUpdateHobIndex (
+  IN OUT PEI_HOB_INDEX  *HobIndex
+  )
+{
+  EFI_STATUS           Status;
+
+  EFI_PEI_HOB_POINTERS Hob;
+  VOID                 *HobList;
+  UINT32               *Entries;
+  UINT32               NumberOfHobs;
+  UINT32               Capacity;
+  UINT32               Offset;
+  UINT32               Index;
+  CONST EFI_GUID       *Guid;
+
+  Status = PeiGetHobList (&HobList);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (HobList != HobIndex->HobList) {
+    HobIndex->HobList         = HobList;
+    HobIndex->IndexedEnd      = 0;
+    HobIndex->NumberOfEntries = 0;
+    HobIndex->Capacity        = 0;
+    HobIndex->Entries         = NULL;
+    HobIndex->NumberOfUnused  = 0;
+  } else if (InternalIsUnusedHobReclaimed (HobIndex)) {
+    // The entries buffer is still valid and is reused for the rebuild.
+    HobIndex->IndexedEnd      = 0;
+    HobIndex->NumberOfEntries = 0;
+    HobIndex->NumberOfUnused  = 0;
+  }
+
+  // The PHIT records the end of the list, so an up-to-date index is detected
+  // without a walk.
+
+  Hob.Raw = (UINT8 *)HobList;
+  Offset  = (UINT32)(
+              (UINTN)Hob.HandoffInformationTable->EfiEndOfHobList
+                - (UINTN)HobList
+              );
+
+  if (Offset == HobIndex->IndexedEnd) {
+    return EFI_SUCCESS;
+  }
+
+  do {
+    NumberOfHobs = InternalCountHobs (HobList, HobIndex->IndexedEnd);
+
+    if ((HobIndex->NumberOfEntries + NumberOfHobs) <= HobIndex->Capacity) {
+      break;
+    }
+
+    Capacity = (HobIndex->NumberOfEntries + NumberOfHobs);
+    Capacity = (Capacity + (Capacity / 2) + PEI_HOB_INDEX_GROWTH);
+    Status   = PeiAllocatePool (
+                 (Capacity * sizeof (*Entries)),
+                 (VOID **)&Entries
+                 );
+
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    // PEI pool cannot be freed, the previous buffer is abandoned.
+
+    if (HobIndex->NumberOfEntries > 0) {
+      CopyMem (
+        (VOID *)Entries,
+        (VOID *)HobIndex->Entries,
+        (HobIndex->NumberOfEntries * sizeof (*Entries))
+        );
+    }
+
+    HobIndex->Entries  = Entries;
+    HobIndex->Capacity = Capacity;
+  } while (TRUE);
+
+  for (Hob.Raw = ((UINT8 *)HobList + HobIndex->IndexedEnd);
+       !END_OF_HOB_LIST (Hob);
+       Hob.Raw = GET_NEXT_HOB (Hob)) {
+    Guid = NULL;
+
+    if (Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+      Guid = &Hob.Guid->Name;
+    }
+
+    Index = InternalFindBound (HobIndex, Hob.Header->HobType, Guid, FALSE);
+
+    if (Index < HobIndex->NumberOfEntries) {
+      CopyMem (
+        (VOID *)&HobIndex->Entries[Index + 1],
+        (VOID *)&HobIndex->Entries[Index],
+        ((HobIndex->NumberOfEntries - Index) * sizeof (*HobIndex->Entries))
+        );
+    }
+
+    HobIndex->Entries[Index] = (UINT32)((UINTN)Hob.Raw - (UINTN)HobList);
+    ++HobIndex->NumberOfEntries;
+
+    if (Hob.Header->HobType == EFI_HOB_TYPE_UNUSED) {
+      ++HobIndex->NumberOfUnused;
+    }
+  }
+
+  HobIndex->IndexedEnd = (UINT32)((UINTN)Hob.Raw - (UINTN)HobList);
+
+  return EFI_SUCCESS;
+}
+
+// InternalFindHobs
+STATIC
+EFI_STATUS
+InternalFindHobs (
+  IN  PEI_HOB_INDEX   *HobIndex,
+  IN  UINT16          Type,
+  IN  CONST EFI_GUID  *Guid,
+  IN  UINTN           Instance,
+  OUT VOID            **Hob,
+  OUT UINTN           *NumberOfHobs OPTIONAL
+  )
+{
+  EFI_STATUS Status;
+
+  UINT32     First;
+  UINT32     Last;
+
+  Status = InternalUpdateHobIndex (HobIndex);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  First = InternalFindBound (HobIndex, Type, Guid, TRUE);
+  Last  = InternalFindBound (HobIndex, Type, Guid, FALSE);
+
+  if (NumberOfHobs != NULL) {
+    *NumberOfHobs = (Last - First);
+  }
+
+  if (Instance >= (Last - First)) {
+    return EFI_NOT_FOUND;
+  }
+
+  *Hob = (VOID *)(
+           (UINT8 *)HobIndex->HobList
+             + HobIndex->Entries[First + Instance]
+           );
+
+  return EFI_SUCCESS;
+}
+
+// PeiGetHobIndex
+/** Returns the index over the HOB list, creating it on first use.
+
+  @param[out] HobIndex  On output, a pointer to the index.
+
+  @retval EFI_SUCCESS            The index was returned.
+  @retval EFI_NOT_AVAILABLE_YET  The HOB list is not yet published.
+  @retval EFI_OUT_OF_RESOURCES   The index could not be allocated.
+**/
+EFI_STATUS
+PeiGetHobIndex (
+  OUT PEI_HOB_INDEX  **HobIndex
+  )
+{
+  EFI_STATUS    Status;
+
+  PEI_HOB_INDEX *Index;
+  VOID          *HobList;
+
+  ASSERT (HobIndex != NULL);
+
+  Status = PeiLocatePpi (
+             &gMiscPeiHobIndexPpiGuid,
+             0,
+             NULL,
+             (VOID **)HobIndex
+             );
+
+  if (Status != EFI_NOT_FOUND) {
+    return Status;
+  }
+
+  Status = PeiGetHobList (&HobList);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = PeiAllocatePool (sizeof (*Index), (VOID **)&Index);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ZeroMem ((VOID *)Index, sizeof (*Index));
+
+  Index->Descriptor.Flags = (EFI_PEI_PPI_DESCRIPTOR_PPI
+                              | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST);
+
+  Index->Descriptor.Guid = &gMiscPeiHobIndexPpiGuid;
+  Index->Descriptor.Ppi  = (VOID *)Index;
+  Index->HobList         = HobList;
+
+  Status = InternalUpdateHobIndex (Index);
+
+  if (!EFI_ERROR (Status)) {
+    Status = PeiInstallPpi (&Index->Descriptor);
+
+    if (!EFI_ERROR (Status)) {
+      *HobIndex = Index;
+    }
+  }
+
+  return Status;
+}
+
+// PeiHobIndexFindGuidHobs
+/** Finds a GUID extension HOB by GUID.
+
+  @param[in]  HobIndex      The index returned by PeiGetHobIndex().
+  @param[in]  Guid          The GUID of the HOB to find.
+  @param[in]  Instance      The zero-based instance of the HOB, in order of
+                            creation.
+  @param[out] Hob           On output, a pointer to the HOB.
+  @param[out] NumberOfHobs  On output, the number of HOBs with the GUID.
+
+  @retval EFI_SUCCESS           The HOB was returned.
+  @retval EFI_NOT_FOUND         There are not more than Instance HOBs with the
+                                GUID.
+  @retval EFI_OUT_OF_RESOURCES  The index could not be updated.
+**/
+EFI_STATUS
+PeiHobIndexFindGuidHobs (
+  IN  PEI_HOB_INDEX   *HobIndex,
+  IN  CONST EFI_GUID  *Guid,
+  IN  UINTN           Instance,
+  OUT VOID            **Hob,
+  OUT UINTN           *NumberOfHobs OPTIONAL
+  )
+{
+  ASSERT (HobIndex != NULL);
+  ASSERT (Guid != NULL);
+  ASSERT (Hob != NULL);
+
+  return InternalFindHobs (
+           HobIndex,
+           EFI_HOB_TYPE_GUID_EXTENSION,
+           Guid,
+           Instance,
+           Hob,
+           NumberOfHobs
+           );
+}
+
+// PeiHobIndexFindTypeHobs
+/** Finds a HOB by type.
+
+  @param[in]  HobIndex      The index returned by PeiGetHobIndex().
+  @param[in]  Type          The type of the HOB to find.  Must not be
+                            EFI_HOB_TYPE_GUID_EXTENSION.
+  @param[in]  Instance      The zero-based instance of the HOB, in order of
+                            creation.
+  @param[out] Hob           On output, a pointer to the HOB.
+  @param[out] NumberOfHobs  On output, the number of HOBs of the type.
+
+  @retval EFI_SUCCESS           The HOB was returned.
+  @retval EFI_NOT_FOUND         There are not more than Instance HOBs of the
+                                type.
+  @retval EFI_OUT_OF_RESOURCES  The index could not be updated.
+**/
+EFI_STATUS
+PeiHobIndexFindTypeHobs (
+  IN  PEI_HOB_INDEX  *HobIndex,
+  IN  UINT16         Type,
+  IN  UINTN          Instance,
+  OUT VOID           **Hob,
+  OUT UINTN          *NumberOfHobs OPTIONAL
+  )
+{
+  ASSERT (HobIndex != NULL);
+  ASSERT (Type != EFI_HOB_TYPE_GUID_EXTENSION);
+  ASSERT (Hob != NULL);
+
+  return InternalFindHobs (HobIndex, Type, NULL, Instance, Hob, NumberOfHobs);
+}
@@ -0,0 +1,286 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiPei.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PeiServicesLib.h>
+
+// PEI_PPI_CACHE_ENTRY
+typedef struct {
+  EFI_PEI_NOTIFY_DESCRIPTOR Notify;      ///< Invalidates the entry when a PPI
+                                         ///< with Guid is (re)installed.
+  EFI_GUID                  Guid;        ///< The GUID of the cached PPI.
+  UINTN                     Instance;    ///< The instance of the cached PPI.
+  BOOLEAN                   Valid;       ///< Whether the entry is valid.
+  EFI_PEI_PPI_DESCRIPTOR    *Descriptor; ///< The cached descriptor.
+  VOID                      *Ppi;        ///< The cached PPI.
+  UINT32                    Hits;        ///< The number of lookups served.
+} PEI_PPI_CACHE_ENTRY;
+
+// PEI_PPI_CACHE
+struct PEI_PPI_CACHE {
+  EFI_PEI_NOTIFY_DESCRIPTOR MemoryDiscovered;  ///< Invalidates all entries
+                                               ///< when memory is installed.
+  UINT32                    NumberOfEntries;   ///< The number of used entries.
+  UINT32                    Capacity;          ///< The number of entries.
+  UINT32                    Hits;              ///< The number of cache hits.
+  UINT32                    Misses;            ///< The number of cache misses.
+};
+
+// PPI_CACHE_ENTRIES
+/// The entries follow the cache header.  They are not referenced by pointer so
+/// that the cache stays valid when migrated along with the PEI heap.
+#define PPI_CACHE_ENTRIES(Cache)  ((PEI_PPI_CACHE_ENTRY *)((Cache) + 1))
+
+// InternalPpiCacheEntryNotify
+/** Invalidates a cache entry when a PPI with its GUID is installed or
+    reinstalled.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalPpiCacheEntryNotify (
+  IN EFI_PEI_SERVICES           **PeiServices,
+  IN EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyDescriptor,
+  IN VOID                       *Ppi
+  )
+{
+  PEI_PPI_CACHE_ENTRY *Entry;
+
+  Entry        = BASE_CR (NotifyDescriptor, PEI_PPI_CACHE_ENTRY, Notify);
+  Entry->Valid = FALSE;
+
+  return EFI_SUCCESS;
+}
+
+// InternalPpiCacheMemoryDiscoveredNotify
+/** Invalidates all cache entries when permanent memory is installed, as cached
+    pointers into temporary RAM are stale after the migration.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalPpiCacheMemoryDiscoveredNotify (
+  IN EFI_PEI_SERVICES           **PeiServices,
+  IN EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyDescriptor,
+  IN VOID                       *Ppi
+  )
+{
+  PEI_PPI_CACHE       *Cache;
+  PEI_PPI_CACHE_ENTRY *Entries;
+  UINT32              Index;
+
+  Cache   = BASE_CR (NotifyDescriptor, PEI_PPI_CACHE, MemoryDiscovered);
+  Entries = PPI_CACHE_ENTRIES (Cache);
+
+  for (Index = 0; Index < Cache->NumberOfEntries; ++Index) {
+    Entries[Index].Valid = FALSE;
+  }
+
+  return EFI_SUCCESS;
+}
+
+// PeiCreatePpiCache
+/** Creates a cache for PeiCachedLocatePpi().
+
+  @param[in]  NumberOfEntries  The maximum number of PPIs to cache.  Each
+                               entry registers one notification.
+  @param[out] Cache            On output, a pointer to the cache.
+
+  @retval EFI_SUCCESS           The cache was created.
+  @retval EFI_OUT_OF_RESOURCES  The cache could not be allocated.
+**/
+EFI_STATUS
+PeiCreatePpiCache (
+  IN  UINTN          NumberOfEntries,
+  OUT PEI_PPI_CACHE  **Cache
+  )
+{
+  EFI_STATUS    Status;
+
+  PEI_PPI_CACHE *NewCache;
+  UINTN         Size;
+
+  ASSERT (NumberOfEntries > 0);
+  ASSERT (NumberOfEntries <= MAX_UINT32);
+  ASSERT (Cache != NULL);
+
+  Size   = (sizeof (*NewCache)
+              + (NumberOfEntries * sizeof (PEI_PPI_CACHE_ENTRY)));
+  Status = PeiAllocatePool (Size, (VOID **)&NewCache);
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ZeroMem ((VOID *)NewCache, Size);
+
+  NewCache->MemoryDiscovered.Flags = (EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK
+                                       | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST);
+
+  NewCache->MemoryDiscovered.Guid   = &gEfiPeiMemoryDiscoveredPpiGuid;
+  NewCache->MemoryDiscovered.Notify = InternalPpiCacheMemoryDiscoveredNotify;
+  NewCache->Capacity                = (UINT32)NumberOfEntries;
+
+  Status = PeiNotifyPpi (&NewCache->MemoryDiscovered);
+
+  if (!EFI_ERROR (Status)) {
+    *Cache = NewCache;
+  }
+
+  return Status;
+}
+
+// PeiCachedLocatePpi
+/** Locates an interface in the PEI PPI database by GUID, serving repeated
+    lookups from a cache.
+
+  @param[in]      Cache          The cache returned by PeiCreatePpiCache().
+  @param[in]      Guid           A pointer to the GUID whose corresponding
+                                 interface needs to be found.
+  @param[in]      Instance       The N-th instance of the interface that is
+                                 required.
+  @param[in, out] PpiDescriptor  A pointer to instance of the
+                                 EFI_PEI_PPI_DESCRIPTOR.
+  @param[in, out] Ppi            A pointer to the instance of the interface.
+
+  @retval EFI_SUCCESS    The interface was successfully returned.
+  @retval EFI_NOT_FOUND  The PPI descriptor is not found in the database.
+**/
+EFI_STATUS
+PeiCachedLocatePpi (
+  IN     PEI_PPI_CACHE           *Cache,
+  IN     CONST EFI_GUID          *Guid,
+  IN     UINTN                   Instance,
+  IN OUT EFI_PEI_PPI_DESCRIPTOR  **PpiDescriptor, OPTIONAL
+  IN OUT VOID                    **Ppi
+  )
+{
+  EFI_STATUS             Status;
+
+  PEI_PPI_CACHE_ENTRY    *Entries;
+  PEI_PPI_CACHE_ENTRY    *Entry;
+  EFI_PEI_PPI_DESCRIPTOR *Descriptor;
+  UINT32                 Index;
+
+  ASSERT (Cache != NULL);
+  ASSERT (Guid != NULL);
+  ASSERT (Ppi != NULL);
+
+  Entries = PPI_CACHE_ENTRIES (Cache);
+  Entry   = NULL;
+
+  for (Index = 0; Index < Cache->NumberOfEntries; ++Index) {
+    if ((Entries[Index].Instance == Instance)
+     && CompareGuid (&Entries[Index].Guid, Guid)) {
+      Entry = &Entries[Index];
+      break;
+    }
+  }
+
+  if ((Entry != NULL) && Entry->Valid) {
+    ++Cache->Hits;
+    ++Entry->Hits;
+
+    if (PpiDescriptor != NULL) {
+      *PpiDescriptor = Entry->Descriptor;
+    }
+
+    *Ppi = Entry->Ppi;
+
+    return EFI_SUCCESS;
+  }
+
+  ++Cache->Misses;
+
+  if ((Entry == NULL) && (Cache->NumberOfEntries < Cache->Capacity)) {
+    // Register the notification before the lookup.  It is invoked right away
+    // when the PPI is already installed, which would otherwise invalidate the
+    // entry filled below.
+    Entry = &Entries[Cache->NumberOfEntries];
+
+    CopyGuid (&Entry->Guid, Guid);
+
+    Entry->Instance     = Instance;
+    Entry->Notify.Flags = (EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK
+                            | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST);
+
+    Entry->Notify.Guid   = &Entry->Guid;
+    Entry->Notify.Notify = InternalPpiCacheEntryNotify;
+
+    Status = PeiNotifyPpi (&Entry->Notify);
+
+    if (EFI_ERROR (Status)) {
+      Entry = NULL;
+    } else {
+      ++Cache->NumberOfEntries;
+    }
+  }
+
+  Status = PeiLocatePpi (Guid, Instance, &Descriptor, Ppi);
+
+  if (!EFI_ERROR (Status)) {
+    if (Entry != NULL) {
+      Entry->Descriptor = Descriptor;
+      Entry->Ppi        = *Ppi;
+      Entry->Valid      = TRUE;
+    }
+
+    if (PpiDescriptor != NULL) {
+      *PpiDescriptor = Descriptor;
+    }
+  }
+
+  return Status;
+}
+
+// PeiReportPpiCache
+/** Prints the hit statistics of a cache to the debug output.
+
+  @param[in] Cache  The cache returned by PeiCreatePpiCache().
+**/
+VOID
+PeiReportPpiCache (
+  IN CONST PEI_PPI_CACHE  *Cache
+  )
+{
+  CONST PEI_PPI_CACHE_ENTRY *Entries;
+  UINT32                    Index;
+
+  ASSERT (Cache != NULL);
+
+  Entries = PPI_CACHE_ENTRIES (Cache);
+
+  DEBUG ((
+    DEBUG_INFO,
+    "%a: PPI cache %u hits, %u misses\n",
+    gEfiCallerBaseName,
+    Cache->Hits,
+    Cache->Misses
+    ));
+
+  for (Index = 0; Index < Cache->NumberOfEntries; ++Index) {
+    DEBUG ((
+      DEBUG_INFO,
+      "  %g[%u] %u hits\n",
+      &Entries[Index].Guid,
+      (UINT32)Entries[Index].Instance,
+      Entries[Index].Hits
+      ));
+  }
+}
@@ -0,0 +1,534 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiPei.h>
+
+#include <Ppi/Decompress.h>
+#include <Ppi/GuidedSectionExtraction.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MiscFvLib.h>
+#include <Library/PeiServicesLib.h>
+
+// PEI_SECTION_MAP_MAX_DEPTH
+/// The maximum nesting of encapsulation sections that is expanded.
+#define PEI_SECTION_MAP_MAX_DEPTH  8
+
+// PEI_SECTION_MAP_GROWTH
+#define PEI_SECTION_MAP_GROWTH  8
+
+// PEI_SECTION_MAP_ENTRY
+typedef struct {
+  EFI_SECTION_TYPE Type;                  ///< The type of the section.
+  UINT32           AuthenticationStatus;  ///< The accumulated authentication
+                                          ///< status of the encapsulations.
+  VOID             *Data;                 ///< The data of the section.
+  UINT32           DataSize;              ///< The size, in bytes, of Data.
+} PEI_SECTION_MAP_ENTRY;
+
+// PEI_SECTION_MAP
+/// The PEI_SECTION_MAP_ENTRY entries follow the structure.
+struct PEI_SECTION_MAP {
+  UINTN NumberOfEntries;  ///< The number of recorded sections.
+  UINTN Capacity;         ///< The number of allocated entries.
+};
+
+// SECTION_MAP_ENTRIES
+#define SECTION_MAP_ENTRIES(Map)  ((PEI_SECTION_MAP_ENTRY *)((Map) + 1))
+
+// InternalAppendSection
+/** Appends a section to a map, growing it if necessary.
+
+  PEI pool cannot be freed, hence a grown map abandons the previous buffer.
+**/
+STATIC
+EFI_STATUS
+InternalAppendSection (
+  IN OUT PEI_SECTION_MAP  **Map,
+  IN     EFI_SECTION_TYPE Type,
+  IN     UINT32           AuthenticationStatus,
+  IN     VOID             *Data,
+  IN     UINTN            DataSize
+  )
+{
+  EFI_STATUS            Status;
+
+  PEI_SECTION_MAP       *NewMap;
+  PEI_SECTION_MAP_ENTRY *Entry;
+  UINTN                 Capacity;
+
+  if ((*Map)->NumberOfEntries == (*Map)->Capacity) {
+    Capacity = ((*Map)->Capacity * 2);
+    Status   = PeiAllocatePool (
+                 (sizeof (*NewMap) + (Capacity * sizeof (*Entry))),
+                 (VOID **)&NewMap
+                 );
+
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    CopyMem (
+      (VOID *)NewMap,
+      (VOID *)*Map,
+      (sizeof (*NewMap) + ((*Map)->NumberOfEntries * sizeof (*Entry)))
+      );
+
+    NewMap->Capacity = Capacity;
+    *Map             = NewMap;
+  }
+
+  Entry = &SECTION_MAP_ENTRIES (*Map)[(*Map)->NumberOfEntries];
+
+  Entry->Type                 = Type;
+  Entry->AuthenticationStatus = AuthenticationStatus;
+  Entry->Data                 = Data;
+  Entry->DataSize             = (UINT32)DataSize;
+
+  ++(*Map)->NumberOfEntries;
+
+  return EFI_SUCCESS;
+}
+
+// InternalMapSections
+/** Records the leaf sections of a section stream, descending into
+    encapsulation sections.
+
+  Encapsulations that require processing are expanded only if
+  ProcessEncapsulations is TRUE and the required PPI is installed.  Otherwise,
+  they are recorded as leaves.  GUID-defined encapsulations are passed to
+  their PPI whenever one is installed, even if processing is not required.
+
+  @param[in, out] Map                    The map to record the sections in.
+  @param[in]      Sections               The section stream.
+  @param[in]      Length                 The length, in bytes, of Sections.
+  @param[in]      AuthenticationStatus   The authentication status of the
+                                         stream.
+  @param[in]      ProcessEncapsulations  Whether to decompress and extract
+                                         encapsulations.
+  @param[in]      Depth                  The nesting depth of the stream.
+
+  @retval EFI_SUCCESS           The sections were recorded.
+  @retval EFI_VOLUME_CORRUPTED  A section header is corrupted.
+  @retval EFI_OUT_OF_RESOURCES  The map could not be grown.
+**/
+STATIC
+EFI_STATUS
+InternalMapSections (
+  IN OUT PEI_SECTION_MAP  **Map,
+  IN     UINT8            *Sections,
+  IN     UINTN            Length,
+  IN     UINT32           AuthenticationStatus,
+  IN     BOOLEAN          ProcessEncapsulations,
+  IN     UINTN            Depth
+  )
+{
+  EFI_STATUS                            Status;
+
+  EFI_COMMON_SECTION_HEADER             *Section;
+  EFI_GUID_DEFINED_SECTION              *GuidSection;
+  EFI_GUID_DEFINED_SECTION2             *GuidSection2;
+  EFI_GUID                              *DefinitionGuid;
+  EFI_PEI_DECOMPRESS_PPI                *Decompress;
+  EFI_PEI_GUIDED_SECTION_EXTRACTION_PPI *Extraction;
+  UINTN                                 Offset;
+  UINTN                                 Size;
+  UINTN                                 HeaderSize;
+  UINTN                                 EncapsulationSize;
+  UINT8                                 CompressionType;
+  UINT16                                DataOffset;
+  UINT16                                Attributes;
+  VOID                                  *Output;
+  UINTN                                 OutputSize;
+  UINT32                                OutputAuthenticationStatus;
+  BOOLEAN                               Expanded;
+
+  for (Offset = 0;
+       (Offset + sizeof (*Section)) <= Length;
+       Offset += ALIGN_VALUE (Size, 4)) {
+    Section    = (EFI_COMMON_SECTION_HEADER *)&Sections[Offset];
+    Size       = SECTION_SIZE (Section);
+    HeaderSize = sizeof (EFI_COMMON_SECTION_HEADER);
+
+    if (IS_SECTION2 (Section)) {
+      if ((Offset + sizeof (EFI_COMMON_SECTION_HEADER2)) > Length) {
+        return EFI_VOLUME_CORRUPTED;
+      }
+
+      Size       = SECTION2_SIZE (Section);
+      HeaderSize = sizeof (EFI_COMMON_SECTION_HEADER2);
+    }
+
+    if ((Size < HeaderSize) || (Size > (Length - Offset))) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+
+    Expanded = FALSE;
+    Status   = EFI_SUCCESS;
+
+    if (Depth < PEI_SECTION_MAP_MAX_DEPTH) {
+      switch (Section->Type) {
+        case EFI_SECTION_DISPOSABLE:
+        {
+          Status = InternalMapSections (
+                     Map,
+                     ((UINT8 *)Section + HeaderSize),
+                     (Size - HeaderSize),
+                     AuthenticationStatus,
+                     ProcessEncapsulations,
+                     (Depth + 1)
+                     );
+
+          Expanded = TRUE;
+          break;
+        }
+
+        case EFI_SECTION_COMPRESSION:
+        {
+          if (IS_SECTION2 (Section)) {
+            EncapsulationSize = sizeof (EFI_COMPRESSION_SECTION2);
+            CompressionType   =
+              ((EFI_COMPRESSION_SECTION2 *)Section)->CompressionType;
+          } else {
+            EncapsulationSize = sizeof (EFI_COMPRESSION_SECTION);
+            CompressionType   =
+              ((EFI_COMPRESSION_SECTION *)Section)->CompressionType;
+          }
+
+          if (Size < EncapsulationSize) {
+            return EFI_VOLUME_CORRUPTED;
+          }
+
+          if (CompressionType == EFI_NOT_COMPRESSED) {
+            Status = InternalMapSections (
+                       Map,
+                       ((UINT8 *)Section + EncapsulationSize),
+                       (Size - EncapsulationSize),
+                       AuthenticationStatus,
+                       ProcessEncapsulations,
+                       (Depth + 1)
+                       );
+
+            Expanded = TRUE;
+            break;
+          }
+
+          if (!ProcessEncapsulations) {
+            break;
+          }
+
+          Status = PeiLocatePpi (
+                     &gEfiPeiDecompressPpiGuid,
+                     0,
+                     NULL,
+                     (VOID **)&Decompress
+                     );
+
+          if (EFI_ERROR (Status)) {
+            Status = EFI_SUCCESS;
+            break;
+          }
+
+          Status = Decompress->Decompress (
+                                 Decompress,
+                                 (EFI_COMPRESSION_SECTION *)Section,
+                                 &Output,
+                                 &OutputSize
+                                 );
+
+          if (!EFI_ERROR (Status)) {
+            Status = InternalMapSections (
+                       Map,
+                       (UINT8 *)Output,
+                       OutputSize,
+                       AuthenticationStatus,
+                       ProcessEncapsulations,
+                       (Depth + 1)
+                       );
+
+            Expanded = TRUE;
+          }
+
+          break;
+        }
+
+        case EFI_SECTION_GUID_DEFINED:
+        {
+          if (IS_SECTION2 (Section)) {
+            EncapsulationSize = sizeof (EFI_GUID_DEFINED_SECTION2);
+
+            if (Size < EncapsulationSize) {
+              return EFI_VOLUME_CORRUPTED;
+            }
+
+            GuidSection2   = (EFI_GUID_DEFINED_SECTION2 *)Section;
+            DefinitionGuid = &GuidSection2->SectionDefinitionGuid;
+            DataOffset     = GuidSection2->DataOffset;
+            Attributes     = GuidSection2->Attributes;
+          } else {
+            EncapsulationSize = sizeof (EFI_GUID_DEFINED_SECTION);
+
+            if (Size < EncapsulationSize) {
+              return EFI_VOLUME_CORRUPTED;
+            }
+
+            GuidSection    = (EFI_GUID_DEFINED_SECTION *)Section;
+            DefinitionGuid = &GuidSection->SectionDefinitionGuid;
+            DataOffset     = GuidSection->DataOffset;
+            Attributes     = GuidSection->Attributes;
+          }
+
+          // Like the PEI Core, prefer the extraction PPI of the section even
+          // if processing is not required, so that a platform can verify
+          // signed sections.  The data is only mapped in place without one.
+
+          Status = EFI_NOT_FOUND;
+
+          if (ProcessEncapsulations) {
+            Status = PeiLocatePpi (
+                       DefinitionGuid,
+                       0,
+                       NULL,
+                       (VOID **)&Extraction
+                       );
+          }
+
+          if (!EFI_ERROR (Status)) {
+            OutputAuthenticationStatus = 0;
+            Status = Extraction->ExtractSection (
+                                   Extraction,
+                                   (VOID *)Section,
+                                   &Output,
+                                   &OutputSize,
+                                   &OutputAuthenticationStatus
+                                   );
+
+            if (!EFI_ERROR (Status)) {
+              Status = InternalMapSections (
+                         Map,
+                         (UINT8 *)Output,
+                         OutputSize,
+                         (AuthenticationStatus | OutputAuthenticationStatus),
+                         ProcessEncapsulations,
+                         (Depth + 1)
+                         );
+
+              Expanded = TRUE;
+            }
+
+            break;
+          }
+
+          Status = EFI_SUCCESS;
+
+          if ((Attributes & EFI_GUIDED_SECTION_PROCESSING_REQUIRED) != 0) {
+            break;
+          }
+
+          if ((DataOffset < EncapsulationSize) || (DataOffset > Size)) {
+            return EFI_VOLUME_CORRUPTED;
+          }
+
+          OutputAuthenticationStatus = AuthenticationStatus;
+
+          if ((Attributes & EFI_GUIDED_SECTION_AUTH_STATUS_VALID) != 0) {
+            OutputAuthenticationStatus |= (EFI_AUTH_STATUS_IMAGE_SIGNED
+                                            | EFI_AUTH_STATUS_NOT_TESTED);
+          }
+
+          Status = InternalMapSections (
+                     Map,
+                     ((UINT8 *)Section + DataOffset),
+                     (Size - DataOffset),
+                     OutputAuthenticationStatus,
+                     ProcessEncapsulations,
+                     (Depth + 1)
+                     );
+
+          Expanded = TRUE;
+          break;
+        }
+
+        default:
+        {
+          break;
+        }
+      }
+    }
+
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    if (!Expanded) {
+      Status = InternalAppendSection (
+                 Map,
+                 Section->Type,
+                 AuthenticationStatus,
+                 (VOID *)((UINT8 *)Section + HeaderSize),
+                 (Size - HeaderSize)
+                 );
+
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+// PeiFfsBuildSectionMap
+/** Walks the sections of a file once and records all leaf sections, including
+    those within encapsulation sections.
+
+  @param[in]  FileHandle  The handle of the file.
+  @param[out] SectionMap  On output, a pointer to the map.
+
+  @retval EFI_SUCCESS           The map was built.
+  @retval EFI_UNSUPPORTED       The file type does not contain sections.
+  @retval EFI_VOLUME_CORRUPTED  A section header is corrupted.
+  @retval EFI_OUT_OF_RESOURCES  The map could not be allocated.
+**/
+EFI_STATUS
+PeiFfsBuildSectionMap (
+  IN  EFI_PEI_FILE_HANDLE  FileHandle,
+  OUT PEI_SECTION_MAP      **SectionMap
+  )
+{
+  EFI_STATUS          Status;
+
+  EFI_FFS_FILE_HEADER *File;
+  PEI_SECTION_MAP     *Map;
+  VOID                *MemoryDiscovered;
+  UINTN               HeaderSize;
+  BOOLEAN             ProcessEncapsulations;
+
+  ASSERT (FileHandle != NULL);
+  ASSERT (SectionMap != NULL);
+
+  File = (EFI_FFS_FILE_HEADER *)FileHandle;
+
+  if ((File->Type == EFI_FV_FILETYPE_RAW)
+   || (File->Type == EFI_FV_FILETYPE_FFS_PAD)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = PeiAllocatePool (
+             (sizeof (*Map)
+               + (PEI_SECTION_MAP_GROWTH * sizeof (PEI_SECTION_MAP_ENTRY))),
+             (VOID **)&Map
+             );
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Map->NumberOfEntries = 0;
+  Map->Capacity        = PEI_SECTION_MAP_GROWTH;
+
+  // Decompression output is allocated by the PPIs.  Only expand
+  // encapsulations once it lands in permanent memory so that the map can be
+  // kept for the rest of PEI.
+
+  Status = PeiLocatePpi (
+             &gEfiPeiMemoryDiscoveredPpiGuid,
+             0,
+             NULL,
+             &MemoryDiscovered
+             );
+
+  ProcessEncapsulations = (BOOLEAN)!EFI_ERROR (Status);
+
+  HeaderSize = MiscFfsGetHeaderSize (File);
+  Status     = InternalMapSections (
+                 &Map,
+                 ((UINT8 *)File + HeaderSize),
+                 (UINTN)(MiscFfsGetFileSize (File) - HeaderSize),
+                 0,
+                 ProcessEncapsulations,
+                 0
+                 );
+
+  if (!EFI_ERROR (Status)) {
+    *SectionMap = Map;
+  }
+
+  return Status;
+}
+
+// PeiSectionMapFindSection
+/** Finds a section recorded by PeiFfsBuildSectionMap().
+
+  @param[in]  SectionMap            The map returned by
+                                    PeiFfsBuildSectionMap().
+  @param[in]  SectionType           The type of the section to find, or
+                                    EFI_SECTION_ALL to iterate all sections.
+  @param[in]  SectionInstance       The zero-based instance of the section.
+  @param[out] SectionData           On output, a pointer to the section data.
+  @param[out] SectionDataSize       On output, the size, in bytes, of the
+                                    section data.
+  @param[out] AuthenticationStatus  On output, the authentication status of
+                                    the section.
+
+  @retval EFI_SUCCESS    The section was found.
+  @retval EFI_NOT_FOUND  The section was not found.
+**/
+EFI_STATUS
+PeiSectionMapFindSection (
+  IN  CONST PEI_SECTION_MAP  *SectionMap,
+  IN  EFI_SECTION_TYPE       SectionType,
+  IN  UINTN                  SectionInstance,
+  OUT VOID                   **SectionData,
+  OUT UINT32                 *SectionDataSize OPTIONAL,
+  OUT UINT32                 *AuthenticationStatus OPTIONAL
+  )
+{
+  CONST PEI_SECTION_MAP_ENTRY *Entries;
+  UINTN                       Index;
+
+  ASSERT (SectionMap != NULL);
+  ASSERT (SectionData != NULL);
+
+  Entries = SECTION_MAP_ENTRIES (SectionMap);
+
+  for (Index = 0; Index < SectionMap->NumberOfEntries; ++Index) {
+    if ((SectionType != EFI_SECTION_ALL)
+     && (Entries[Index].Type != SectionType)) {
+      continue;
+    }
+
+    if (SectionInstance > 0) {
+      --SectionInstance;
+      continue;
+    }
+
+    *SectionData = Entries[Index].Data;
+
+    if (SectionDataSize != NULL) {
+      *SectionDataSize = Entries[Index].DataSize;
+    }
+
+    if (AuthenticationStatus != NULL) {
+      *AuthenticationStatus = Entries[Index].AuthenticationStatus;
+    }
+
+    return EFI_SUCCESS;
+  }
+
+  return EFI_NOT_FOUND;
+}
@@ -197,7 +197,8 @@ PeiNotifyPpi (
   for (Index = 0;
         (NotifyList[Index].Flags & EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST) == 0;
           ++Index) {
-    ASSERT ((NotifyList[Index].Flags & EFI_PEI_PPI_DESCRIPTOR_PPI) != 0);
+    ASSERT ((NotifyList[Index].Flags & EFI_PEI_PPI_DESCRIPTOR_NOTIFY_TYPES)
+              != 0);
   }
 
   PeiServices = GetPeiServicesTablePointer ();
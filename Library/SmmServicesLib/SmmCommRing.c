@@ -0,0 +1,234 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiSmm.h>
+
+#include <Guid/MiscSmmCommRing.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SmmMemLib.h>
+#include <Library/SmmServicesLib.h>
+
+// mCommRingHandle
+STATIC EFI_HANDLE mCommRingHandle = NULL;
+
+// mCommRingAddress
+/// The address of the registered ring, or 0.  The ring cannot be moved once
+/// registered.
+STATIC UINTN mCommRingAddress = 0;
+
+// mCommRingSize
+STATIC UINTN mCommRingSize = 0;
+
+// InternalDrainCommRing
+/** Processes all entries of the registered ring in place.
+
+  The entries are read and validated one at a time.  Every value read from
+  the ring is copied before it is validated, so it cannot change before its
+  use.  The ring is validated again on every drain, as memory outside of SMRAM
+  that was valid on registration may since have become SMRAM or otherwise
+  unsafe to access, e.g. on a change of the SMM communication regions.
+
+  @retval EFI_SUCCESS            All entries were processed.
+  @retval EFI_ACCESS_DENIED      The ring is not in valid memory outside of
+                                 SMRAM anymore.  No entry was processed.
+  @retval EFI_INVALID_PARAMETER  The ring is malformed.  The entries before
+                                 the malformed one were processed.
+**/
+STATIC
+EFI_STATUS
+InternalDrainCommRing (
+  VOID
+  )
+{
+  EFI_STATUS                Status;
+
+  MISC_SMM_COMM_RING_HEADER *Header;
+  MISC_SMM_COMM_RING_ENTRY  *Entry;
+  MISC_SMM_COMM_RING_ENTRY  LocalEntry;
+  UINT32                    Tail;
+  UINTN                     Offset;
+  UINTN                     Capacity;
+  UINTN                     DataSize;
+
+  if (!SmmIsBufferOutsideSmmValid (
+         (EFI_PHYSICAL_ADDRESS)mCommRingAddress,
+         (UINT64)mCommRingSize
+         )) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  Header = (MISC_SMM_COMM_RING_HEADER *)mCommRingAddress;
+  Tail   = Header->Tail;
+
+  if ((Header->Signature != MISC_SMM_COMM_RING_SIGNATURE)
+   || (Tail < sizeof (*Header))
+   || (Tail > mCommRingSize)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  for (Offset = sizeof (*Header);
+       Offset < Tail;
+       Offset += LocalEntry.EntrySize) {
+    if ((Tail - Offset) < sizeof (*Entry)) {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    Entry = (MISC_SMM_COMM_RING_ENTRY *)(mCommRingAddress + Offset);
+
+    CopyMem ((VOID *)&LocalEntry, (VOID *)Entry, sizeof (LocalEntry));
+
+    if ((LocalEntry.EntrySize < sizeof (*Entry))
+     || ((LocalEntry.EntrySize & (sizeof (UINT64) - 1)) != 0)
+     || (LocalEntry.EntrySize > (Tail - Offset))) {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    Capacity = (LocalEntry.EntrySize - sizeof (*Entry));
+    DataSize = LocalEntry.DataSize;
+
+    if (DataSize > Capacity) {
+      Status = EFI_BAD_BUFFER_SIZE;
+    } else if (CompareGuid (&LocalEntry.HandlerType, &gMiscSmmCommRingGuid)) {
+      // Draining the ring from within an entry would recurse indefinitely.
+      Status = EFI_ACCESS_DENIED;
+    } else {
+      Status = SmiManage (
+                 &LocalEntry.HandlerType,
+                 NULL,
+                 MISC_SMM_COMM_RING_ENTRY_DATA (Entry),
+                 &DataSize
+                 );
+
+      if (DataSize > Capacity) {
+        DataSize = Capacity;
+      }
+
+      Entry->DataSize = (UINT32)DataSize;
+    }
+
+    Entry->Status = (UINT64)Status;
+  }
+
+  return EFI_SUCCESS;
+}
+
+// InternalCommRingHandler
+/** Registers or drains the communication ring.
+
+  The status of the command is returned in the message, as the SMM Core only
+  reports whether the SMI was handled.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalCommRingHandler (
+  IN     EFI_HANDLE  DispatchHandle,
+  IN     CONST VOID  *Context, OPTIONAL
+  IN OUT VOID        *CommBuffer, OPTIONAL
+  IN OUT UINTN       *CommBufferSize OPTIONAL
+  )
+{
+  EFI_STATUS                 Status;
+
+  MISC_SMM_COMM_RING_MESSAGE Message;
+
+  if ((CommBuffer == NULL)
+   || (CommBufferSize == NULL)
+   || (*CommBufferSize < sizeof (Message))
+   || !SmmIsBufferOutsideSmmValid (
+         (EFI_PHYSICAL_ADDRESS)(UINTN)CommBuffer,
+         sizeof (Message)
+         )) {
+    return EFI_SUCCESS;
+  }
+
+  CopyMem ((VOID *)&Message, CommBuffer, sizeof (Message));
+
+  switch (Message.Command) {
+    case MiscSmmCommRingCommandRegister:
+    {
+      if (mCommRingAddress != 0) {
+        Status = EFI_ACCESS_DENIED;
+      } else if ((Message.RingSize < sizeof (MISC_SMM_COMM_RING_HEADER))
+              || (Message.RingSize > MAX_UINT32)
+              || (Message.RingAddress > (MAX_UINTN - Message.RingSize))
+              || ((Message.RingAddress & (sizeof (UINT64) - 1)) != 0)
+              || !SmmIsBufferOutsideSmmValid (
+                    Message.RingAddress,
+                    Message.RingSize
+                    )) {
+        Status = EFI_INVALID_PARAMETER;
+      } else {
+        mCommRingAddress = (UINTN)Message.RingAddress;
+        mCommRingSize    = (UINTN)Message.RingSize;
+        Status           = EFI_SUCCESS;
+      }
+
+      break;
+    }
+
+    case MiscSmmCommRingCommandDrain:
+    {
+      Status = EFI_NOT_READY;
+
+      if (mCommRingAddress != 0) {
+        Status = InternalDrainCommRing ();
+      }
+
+      break;
+    }
+
+    default:
+    {
+      Status = EFI_UNSUPPORTED;
+      break;
+    }
+  }
+
+  ((MISC_SMM_COMM_RING_MESSAGE *)CommBuffer)->Status = (UINT64)Status;
+
+  return EFI_SUCCESS;
+}
+
+// SmmInstallCommRing
+/** Registers the SMI handler draining the communication ring.
+
+  The ring lets callers outside of SMM queue requests to multiple SMI handlers
+  and process all of them with a single SMI.  Each request is passed to
+  SmiManage() in place, without copying it through the communication buffer.
+  The ring itself is allocated and registered by MiscSmmCommRingCreate().  A
+  single driver of the platform installs the handler.
+
+  @retval EFI_SUCCESS          The handler was registered.
+  @retval EFI_ALREADY_STARTED  The handler is already registered.
+**/
+EFI_STATUS
+SmmInstallCommRing (
+  VOID
+  )
+{
+  if (mCommRingHandle != NULL) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  return SmiHandlerRegister (
+           InternalCommRingHandler,
+           &gMiscSmmCommRingGuid,
+           &mCommRingHandle
+           );
+}
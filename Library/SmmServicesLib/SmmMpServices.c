@@ -0,0 +1,276 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiSmm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SmmServicesLib.h>
+#include <Library/SmmServicesTableLib.h>
+#include <Library/TimerLib.h>
+
+// SMM_MP_CACHE_LINE_SIZE
+/// The size each CPU slot is padded to, so that no two CPUs write to the same
+/// cache line.
+#define SMM_MP_CACHE_LINE_SIZE  64
+
+// SMM_MP_POLL_INTERVAL
+/// The interval, in microseconds, at which the completion of the APs is
+/// polled.
+#define SMM_MP_POLL_INTERVAL  1
+
+// SMM_MP_SLOT_DATA
+typedef struct {
+  SMM_MP_PROCEDURE Procedure;  ///< The procedure to run.
+  VOID             *Context;   ///< The context passed to Procedure.
+  UINTN            CpuNumber;  ///< The number of the CPU.
+  EFI_STATUS       Status;     ///< The status returned by Procedure.
+  volatile BOOLEAN Finished;   ///< Whether Procedure has returned.
+} SMM_MP_SLOT_DATA;
+
+// SMM_MP_SLOT
+typedef union {
+  SMM_MP_SLOT_DATA Data;
+  UINT8            Padding[SMM_MP_CACHE_LINE_SIZE];
+} SMM_MP_SLOT;
+
+// mSmmMpSlots
+/// The per-CPU slots, allocated on first use.  When an AP does not finish in
+/// time, the slots are abandoned, as the AP may still write to its slot.
+STATIC SMM_MP_SLOT *mSmmMpSlots = NULL;
+
+// InternalSmmMpEntry
+/** Runs the procedure of a slot and signals its completion.
+
+  @param[in, out] Buffer  The slot of the executing CPU.
+**/
+STATIC
+VOID
+EFIAPI
+InternalSmmMpEntry (
+  IN OUT VOID  *Buffer
+  )
+{
+  SMM_MP_SLOT_DATA *Slot;
+
+  Slot         = &((SMM_MP_SLOT *)Buffer)->Data;
+  Slot->Status = Slot->Procedure (Slot->CpuNumber, Slot->Context);
+
+  // Publish the status before the completion.
+  MemoryFence ();
+
+  Slot->Finished = TRUE;
+}
+
+// InternalGetSmmMpSlots
+STATIC
+SMM_MP_SLOT *
+InternalGetSmmMpSlots (
+  VOID
+  )
+{
+  EFI_STATUS Status;
+
+  UINT8      *Buffer;
+
+  if (mSmmMpSlots == NULL) {
+    Status = gSmst->SmmAllocatePool (
+                      EfiRuntimeServicesData,
+                      ((gSmst->NumberOfCpus + 1) * sizeof (*mSmmMpSlots)),
+                      (VOID **)&Buffer
+                      );
+
+    if (!EFI_ERROR (Status)) {
+      mSmmMpSlots = (SMM_MP_SLOT *)ALIGN_POINTER (
+                                     Buffer,
+                                     SMM_MP_CACHE_LINE_SIZE
+                                     );
+    }
+  }
+
+  return mSmmMpSlots;
+}
+
+// SmmStartupAllCpus
+/** Runs a procedure on all or a subset of the CPUs in SMM, including the
+    calling one, and waits for the APs to finish.
+
+  The APs are started with SmmStartupThisAp().  With the PiSmmCpuDxeSmm
+  PcdCpuSmmBlockStartupThisAp set to FALSE, the default, it does not wait for
+  the AP, hence all CPUs run Procedure concurrently.  The calling CPU runs
+  Procedure once all APs have been started.  Each CPU signals its completion in
+  a separate cache line.
+
+  With PcdCpuSmmBlockStartupThisAp set to TRUE, SmmStartupThisAp() returns only
+  once the AP has finished, hence the APs run Procedure one after another, and
+  the timeout is not enforced: an AP that does not finish blocks the call.
+
+  @param[in]      Procedure              The procedure to run.
+  @param[in]      CpuMask                An array of gSmst->NumberOfCpus
+                                         entries, which are TRUE for each CPU
+                                         to run Procedure on.  If NULL,
+                                         Procedure is run on all CPUs.
+  @param[in]      TimeoutInMicroSeconds  The time to wait for the APs to
+                                         finish, or 0 to wait indefinitely.
+                                         Only enforced when startup does not
+                                         block.
+  @param[in, out] Context                The context to pass to Procedure.
+  @param[out]     CpuStatus              An array of gSmst->NumberOfCpus
+                                         entries which, on output, holds the
+                                         status returned by Procedure on each
+                                         CPU.  CPUs not selected hold
+                                         EFI_NOT_STARTED, those which did not
+                                         finish in time EFI_TIMEOUT.
+
+  @retval EFI_SUCCESS           Procedure returned EFI_SUCCESS on all CPUs.
+  @retval EFI_TIMEOUT           Not all APs finished in time.
+  @retval EFI_OUT_OF_RESOURCES  The per-CPU state could not be allocated.
+  @retval other                 The first error returned by Procedure or
+                                SmmStartupThisAp(), in order of CPU number.
+**/
+EFI_STATUS
+SmmStartupAllCpus (
+  IN     SMM_MP_PROCEDURE  Procedure,
+  IN     CONST BOOLEAN     *CpuMask, OPTIONAL
+  IN     UINTN             TimeoutInMicroSeconds,
+  IN OUT VOID              *Context, OPTIONAL
+  OUT    EFI_STATUS        *CpuStatus OPTIONAL
+  )
+{
+  EFI_STATUS       Status;
+
+  EFI_STATUS       Result;
+  SMM_MP_SLOT      *Slots;
+  SMM_MP_SLOT_DATA *Slot;
+  UINTN            NumberOfPending;
+  UINTN            Elapsed;
+  UINTN            Index;
+
+  ASSERT (Procedure != NULL);
+  ASSERT (InSmm ());
+
+  Slots = InternalGetSmmMpSlots ();
+
+  if (Slots == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  // Prepare all slots before starting any AP.
+
+  for (Index = 0; Index < gSmst->NumberOfCpus; ++Index) {
+    Slot            = &Slots[Index].Data;
+    Slot->Procedure = Procedure;
+    Slot->Context   = Context;
+    Slot->CpuNumber = Index;
+    Slot->Status    = EFI_NOT_STARTED;
+    Slot->Finished  = TRUE;
+
+    if ((CpuMask == NULL) || CpuMask[Index]) {
+      Slot->Finished = FALSE;
+    }
+  }
+
+  for (Index = 0; Index < gSmst->NumberOfCpus; ++Index) {
+    Slot = &Slots[Index].Data;
+
+    if (Slot->Finished || (Index == gSmst->CurrentlyExecutingCpu)) {
+      continue;
+    }
+
+    // This returns once the AP has finished if PcdCpuSmmBlockStartupThisAp is
+    // TRUE.
+
+    Status = gSmst->SmmStartupThisAp (
+                      InternalSmmMpEntry,
+                      Index,
+                      (VOID *)&Slots[Index]
+                      );
+
+    if (EFI_ERROR (Status)) {
+      Slot->Status   = Status;
+      Slot->Finished = TRUE;
+    }
+  }
+
+  Index = gSmst->CurrentlyExecutingCpu;
+
+  if (!Slots[Index].Data.Finished) {
+    InternalSmmMpEntry ((VOID *)&Slots[Index]);
+  }
+
+  // Wait for the completion of all started APs.
+
+  Elapsed = 0;
+
+  do {
+    NumberOfPending = 0;
+
+    for (Index = 0; Index < gSmst->NumberOfCpus; ++Index) {
+      if (!Slots[Index].Data.Finished) {
+        ++NumberOfPending;
+      }
+    }
+
+    if (NumberOfPending == 0) {
+      break;
+    }
+
+    if ((TimeoutInMicroSeconds != 0) && (Elapsed >= TimeoutInMicroSeconds)) {
+      break;
+    }
+
+    MicroSecondDelay (SMM_MP_POLL_INTERVAL);
+
+    Elapsed += SMM_MP_POLL_INTERVAL;
+  } while (TRUE);
+
+  // Ensure the statuses are read after the completion flags.
+  MemoryFence ();
+
+  Status = EFI_SUCCESS;
+
+  for (Index = 0; Index < gSmst->NumberOfCpus; ++Index) {
+    Slot   = &Slots[Index].Data;
+    Result = EFI_TIMEOUT;
+
+    if (Slot->Finished) {
+      Result = Slot->Status;
+
+      if (((CpuMask == NULL) || CpuMask[Index])
+       && EFI_ERROR (Result)
+       && !EFI_ERROR (Status)) {
+        Status = Result;
+      }
+    }
+
+    if (CpuStatus != NULL) {
+      CpuStatus[Index] = Result;
+    }
+  }
+
+  if (NumberOfPending > 0) {
+    DEBUG ((
+      DEBUG_WARN,
+      "SmmStartupAllCpus: %u APs did not finish in time\n",
+      (UINT32)NumberOfPending
+      ));
+
+    mSmmMpSlots = NULL;
+    Status      = EFI_TIMEOUT;
+  }
+
+  return Status;
+}
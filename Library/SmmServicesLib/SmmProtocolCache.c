@@ -0,0 +1,201 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+
+#include <PiSmm.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SmmServicesLib.h>
+
+// SMM_PROTOCOL_CACHE_SIZE
+#define SMM_PROTOCOL_CACHE_SIZE  16
+
+// SMM_PROTOCOL_CACHE_ENTRY
+typedef struct {
+  EFI_GUID Guid;          ///< The GUID of the cached protocol.
+  VOID     *Registration; ///< Invalidates the entry when a protocol with Guid
+                          ///< is (re)installed.
+  BOOLEAN  Valid;         ///< Whether the entry is valid.
+  VOID     *Interface;    ///< The cached interface.
+  UINT32   Hits;          ///< The number of lookups served.
+} SMM_PROTOCOL_CACHE_ENTRY;
+
+// mSmmProtocolCache
+/// The SMM notification functions receive no context, hence the cache is kept
+/// per module.
+STATIC SMM_PROTOCOL_CACHE_ENTRY mSmmProtocolCache[SMM_PROTOCOL_CACHE_SIZE];
+
+// mSmmProtocolCacheNumberOfEntries
+STATIC UINT32 mSmmProtocolCacheNumberOfEntries = 0;
+
+// mSmmProtocolCacheHits
+STATIC UINT32 mSmmProtocolCacheHits = 0;
+
+// mSmmProtocolCacheMisses
+STATIC UINT32 mSmmProtocolCacheMisses = 0;
+
+// InternalSmmProtocolCacheNotify
+/** Invalidates the cache entry of a protocol when it is installed or
+    reinstalled.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmmProtocolCacheNotify (
+  IN CONST EFI_GUID  *Protocol,
+  IN VOID            *Interface,
+  IN EFI_HANDLE      Handle
+  )
+{
+  SmmInvalidateProtocolCache (Protocol);
+
+  return EFI_SUCCESS;
+}
+
+// SmmCachedLocateProtocol
+/** Returns the first protocol instance that matches the given protocol,
+    serving repeated lookups from a per-module cache.
+
+  An entry is invalidated when a protocol with its GUID is installed or
+  reinstalled, and when it is uninstalled via
+  SmmUninstallProtocolInterface().  The SMM Foundation does not notify about
+  uninstallations, hence protocols uninstalled by other modules must be
+  invalidated with SmmInvalidateProtocolCache(), or not be looked up with
+  this function.
+
+  @param[in]  Protocol   Provides the protocol to search for.
+  @param[out] Interface  On return, a pointer to the first interface that
+                         matches Protocol.
+
+  @retval EFI_SUCCESS    A protocol instance matching Protocol was found and
+                         returned in Interface.
+  @retval EFI_NOT_FOUND  No protocol instances were found that match
+                         Protocol.
+**/
+EFI_STATUS
+SmmCachedLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  OUT VOID      **Interface
+  )
+{
+  EFI_STATUS               Status;
+
+  SMM_PROTOCOL_CACHE_ENTRY *Entry;
+  UINT32                   Index;
+
+  ASSERT (Protocol != NULL);
+  ASSERT (Interface != NULL);
+
+  Entry = NULL;
+
+  for (Index = 0; Index < mSmmProtocolCacheNumberOfEntries; ++Index) {
+    if (CompareGuid (&mSmmProtocolCache[Index].Guid, Protocol)) {
+      Entry = &mSmmProtocolCache[Index];
+      break;
+    }
+  }
+
+  if ((Entry != NULL) && Entry->Valid) {
+    ++mSmmProtocolCacheHits;
+    ++Entry->Hits;
+
+    *Interface = Entry->Interface;
+
+    return EFI_SUCCESS;
+  }
+
+  ++mSmmProtocolCacheMisses;
+
+  if ((Entry == NULL)
+   && (mSmmProtocolCacheNumberOfEntries < SMM_PROTOCOL_CACHE_SIZE)) {
+    Entry = &mSmmProtocolCache[mSmmProtocolCacheNumberOfEntries];
+
+    CopyGuid (&Entry->Guid, Protocol);
+
+    Entry->Registration = NULL;
+
+    Status = SmmRegisterProtocolNotify (
+               Protocol,
+               InternalSmmProtocolCacheNotify,
+               &Entry->Registration
+               );
+
+    if (EFI_ERROR (Status)) {
+      Entry = NULL;
+    } else {
+      ++mSmmProtocolCacheNumberOfEntries;
+    }
+  }
+
+  Status = SmmLocateProtocol (Protocol, NULL, Interface);
+
+  if (!EFI_ERROR (Status) && (Entry != NULL)) {
+    Entry->Interface = *Interface;
+    Entry->Valid     = TRUE;
+  }
+
+  return Status;
+}
+
+// SmmInvalidateProtocolCache
+/** Invalidates cached results of SmmCachedLocateProtocol().
+
+  @param[in] Protocol  The protocol to invalidate the entry of, or NULL to
+                       invalidate all entries.
+**/
+VOID
+SmmInvalidateProtocolCache (
+  IN CONST EFI_GUID  *Protocol OPTIONAL
+  )
+{
+  UINT32 Index;
+
+  for (Index = 0; Index < mSmmProtocolCacheNumberOfEntries; ++Index) {
+    if ((Protocol == NULL)
+     || CompareGuid (&mSmmProtocolCache[Index].Guid, Protocol)) {
+      mSmmProtocolCache[Index].Valid = FALSE;
+    }
+  }
+}
+
+// SmmReportProtocolCache
+/** Prints the hit statistics of the protocol cache to the debug output.
+**/
+VOID
+SmmReportProtocolCache (
+  VOID
+  )
+{
+  UINT32 Index;
+
+  DEBUG ((
+    DEBUG_INFO,
+    "%a: SMM protocol cache %u hits, %u misses\n",
+    gEfiCallerBaseName,
+    mSmmProtocolCacheHits,
+    mSmmProtocolCacheMisses
+    ));
+
+  for (Index = 0; Index < mSmmProtocolCacheNumberOfEntries; ++Index) {
+    DEBUG ((
+      DEBUG_INFO,
+      "  %g %u hits\n",
+      &mSmmProtocolCache[Index].Guid,
+      mSmmProtocolCache[Index].Hits
+      ));
+  }
+}
@@ -361,6 +361,10 @@ SmmUninstallProtocolInterface (
 
   Status = gSmst->SmmUninstallProtocolInterface (Handle, Protocol, Interface);
 
+  if (!EFI_ERROR (Status)) {
+    SmmInvalidateProtocolCache (Protocol);
+  }
+
   if ((Status != EFI_NOT_FOUND) || (Status != EFI_ACCESS_DENIED)) {
     ASSERT_EFI_ERROR (Status);
   }
@@ -0,0 +1,295 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiSmm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SmmServicesLib.h>
+#include <Library/SmmServicesTableLib.h>
+
+// SMM_SLAB_MIN_BLOCK_SIZE
+#define SMM_SLAB_MIN_BLOCK_SIZE  16
+
+// SMM_SLAB_NO_CLASS
+/// Marks a page that has not been assigned to a size class.
+#define SMM_SLAB_NO_CLASS  MAX_UINT8
+
+// SMM_SLAB_BLOCK
+/// A free block, linked into the free list of its size class.
+typedef struct SMM_SLAB_BLOCK SMM_SLAB_BLOCK;
+
+// SMM_SLAB_BLOCK
+struct SMM_SLAB_BLOCK {
+  SMM_SLAB_BLOCK *Next;  ///< The next free block of the size class.
+};
+
+// SMM_SLAB_POOL
+/// The pool is placed at the start of its own reservation.  The size class of
+/// each page of the reservation follows the structure.
+struct SMM_SLAB_POOL {
+  UINTN          Base;              ///< The address of the first page.
+  UINTN          NumberOfPages;     ///< The number of pages from Base.
+  UINTN          NextPage;          ///< The first page not yet assigned.
+  SMM_SLAB_BLOCK *FreeBlocks[SMM_SLAB_NUMBER_OF_CLASSES];
+  SMM_SLAB_USAGE Usage;             ///< The usage counters.
+};
+
+// SLAB_PAGE_CLASSES
+#define SLAB_PAGE_CLASSES(Pool)  ((UINT8 *)((Pool) + 1))
+
+// InternalGetSizeClass
+STATIC
+UINTN
+InternalGetSizeClass (
+  IN UINTN  Size
+  )
+{
+  if (Size <= SMM_SLAB_MIN_BLOCK_SIZE) {
+    return 0;
+  }
+
+  return (UINTN)(HighBitSet32 ((UINT32)(Size - 1)) - 3);
+}
+
+// InternalAssignPage
+/** Assigns the next unused page of a pool to a size class and adds its blocks
+    to the free list of the class.
+
+  @param[in, out] Pool   The pool to assign the page of.
+  @param[in]      Class  The size class to assign the page to.
+
+  @retval TRUE   A page was assigned.
+  @retval FALSE  All pages are assigned.
+**/
+STATIC
+BOOLEAN
+InternalAssignPage (
+  IN OUT SMM_SLAB_POOL  *Pool,
+  IN     UINTN          Class
+  )
+{
+  SMM_SLAB_BLOCK *Block;
+  UINTN          Page;
+  UINTN          BlockSize;
+  UINTN          Offset;
+
+  if (Pool->NextPage == Pool->NumberOfPages) {
+    return FALSE;
+  }
+
+  SLAB_PAGE_CLASSES (Pool)[Pool->NextPage] = (UINT8)Class;
+
+  Page      = (Pool->Base + EFI_PAGES_TO_SIZE (Pool->NextPage));
+  BlockSize = SMM_SLAB_CLASS_SIZE (Class);
+  Block     = (SMM_SLAB_BLOCK *)Page;
+
+  // Link the blocks in address order.
+
+  for (Offset = BlockSize; Offset < EFI_PAGE_SIZE; Offset += BlockSize) {
+    Block->Next = (SMM_SLAB_BLOCK *)((UINTN)Block + BlockSize);
+    Block       = Block->Next;
+  }
+
+  Block->Next              = Pool->FreeBlocks[Class];
+  Pool->FreeBlocks[Class]  = (SMM_SLAB_BLOCK *)Page;
+  Pool->Usage.Free[Class] += (EFI_PAGE_SIZE / BlockSize);
+
+  ++Pool->NextPage;
+  --Pool->Usage.NumberOfFreePages;
+
+  return TRUE;
+}
+
+// SmmCreateSlabPool
+/** Reserves SMRAM pages to serve small allocations from.
+
+  The pages are assigned to the size classes on demand and stay assigned, so
+  that fragmentation is bounded by the number of classes.
+
+  @param[in]  NumberOfPages  The number of pages to reserve for allocations.
+  @param[out] Pool           On output, a pointer to the pool.
+
+  @retval EFI_SUCCESS           The pool was created.
+  @retval EFI_OUT_OF_RESOURCES  The pages could not be allocated.
+**/
+EFI_STATUS
+SmmCreateSlabPool (
+  IN  UINTN          NumberOfPages,
+  OUT SMM_SLAB_POOL  **Pool
+  )
+{
+  EFI_STATUS           Status;
+
+  SMM_SLAB_POOL        *NewPool;
+  EFI_PHYSICAL_ADDRESS Address;
+  UINTN                HeaderPages;
+
+  ASSERT (NumberOfPages > 0);
+  ASSERT (Pool != NULL);
+
+  HeaderPages = EFI_SIZE_TO_PAGES (sizeof (*NewPool) + NumberOfPages);
+  Status      = SmmAllocatePages (
+                  AllocateAnyPages,
+                  EfiRuntimeServicesData,
+                  (HeaderPages + NumberOfPages),
+                  &Address
+                  );
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  NewPool = (SMM_SLAB_POOL *)(UINTN)Address;
+
+  ZeroMem ((VOID *)NewPool, sizeof (*NewPool));
+  SetMem (
+    (VOID *)SLAB_PAGE_CLASSES (NewPool),
+    NumberOfPages,
+    SMM_SLAB_NO_CLASS
+    );
+
+  NewPool->Base                    = (UINTN)(
+                                       Address + EFI_PAGES_TO_SIZE (HeaderPages)
+                                       );
+  NewPool->NumberOfPages           = NumberOfPages;
+  NewPool->Usage.NumberOfPages     = NumberOfPages;
+  NewPool->Usage.NumberOfFreePages = NumberOfPages;
+
+  *Pool = NewPool;
+
+  return EFI_SUCCESS;
+}
+
+// SmmSlabAllocate
+/** Allocates a buffer from a slab pool.
+
+  Requests larger than the largest size class, and requests of a class that
+  has no free block while no page is left, are served by SmmAllocatePool().
+
+  @param[in] Pool  The pool returned by SmmCreateSlabPool().
+  @param[in] Size  The size, in bytes, of the buffer.
+
+  @return  A pointer to the buffer, or NULL if it could not be allocated.
+           Buffers served from pages are aligned to their size class.
+**/
+VOID *
+SmmSlabAllocate (
+  IN SMM_SLAB_POOL  *Pool,
+  IN UINTN          Size
+  )
+{
+  EFI_STATUS     Status;
+
+  SMM_SLAB_BLOCK *Block;
+  VOID           *Buffer;
+  UINTN          Class;
+
+  ASSERT (Pool != NULL);
+  ASSERT (Size > 0);
+
+  if (Size <= SMM_SLAB_CLASS_SIZE (SMM_SLAB_NUMBER_OF_CLASSES - 1)) {
+    Class = InternalGetSizeClass (Size);
+
+    if ((Pool->FreeBlocks[Class] != NULL) || InternalAssignPage (Pool, Class)) {
+      Block                   = Pool->FreeBlocks[Class];
+      Pool->FreeBlocks[Class] = Block->Next;
+
+      --Pool->Usage.Free[Class];
+      ++Pool->Usage.InUse[Class];
+
+      if (Pool->Usage.InUse[Class] > Pool->Usage.PeakInUse[Class]) {
+        Pool->Usage.PeakInUse[Class] = Pool->Usage.InUse[Class];
+      }
+
+      return (VOID *)Block;
+    }
+  }
+
+  Status = SmmAllocatePool (EfiRuntimeServicesData, Size, &Buffer);
+
+  if (EFI_ERROR (Status)) {
+    return NULL;
+  }
+
+  ++Pool->Usage.NumberOfFallbacks;
+
+  return Buffer;
+}
+
+// SmmSlabFree
+/** Returns a buffer allocated by SmmSlabAllocate() to its pool.
+
+  @param[in] Pool    The pool returned by SmmCreateSlabPool().
+  @param[in] Buffer  The buffer to free.
+**/
+VOID
+SmmSlabFree (
+  IN SMM_SLAB_POOL  *Pool,
+  IN VOID           *Buffer
+  )
+{
+  SMM_SLAB_BLOCK *Block;
+  UINTN          Offset;
+  UINTN          Class;
+
+  ASSERT (Pool != NULL);
+  ASSERT (Buffer != NULL);
+
+  Offset = ((UINTN)Buffer - Pool->Base);
+
+  if (((UINTN)Buffer < Pool->Base)
+   || (Offset >= EFI_PAGES_TO_SIZE (Pool->NumberOfPages))) {
+    SmmFreePool (Buffer);
+
+    ASSERT (Pool->Usage.NumberOfFallbacks > 0);
+    --Pool->Usage.NumberOfFallbacks;
+
+    return;
+  }
+
+  Class = SLAB_PAGE_CLASSES (Pool)[Offset >> EFI_PAGE_SHIFT];
+
+  ASSERT (Class < SMM_SLAB_NUMBER_OF_CLASSES);
+  ASSERT ((Offset & (SMM_SLAB_CLASS_SIZE (Class) - 1)) == 0);
+  ASSERT (Pool->Usage.InUse[Class] > 0);
+
+  Block                   = (SMM_SLAB_BLOCK *)Buffer;
+  Block->Next             = Pool->FreeBlocks[Class];
+  Pool->FreeBlocks[Class] = Block;
+
+  --Pool->Usage.InUse[Class];
+  ++Pool->Usage.Free[Class];
+}
+
+// SmmSlabGetUsage
+/** Returns the usage counters of a slab pool.
+
+  @param[in]  Pool   The pool returned by SmmCreateSlabPool().
+  @param[out] Usage  On output, the usage counters of Pool.
+**/
+VOID
+SmmSlabGetUsage (
+  IN  CONST SMM_SLAB_POOL  *Pool,
+  OUT SMM_SLAB_USAGE       *Usage
+  )
+{
+  ASSERT (Pool != NULL);
+  ASSERT (Usage != NULL);
+
+  CopyMem ((VOID *)Usage, (VOID *)&Pool->Usage, sizeof (*Usage));
+}
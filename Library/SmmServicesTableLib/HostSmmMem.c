@@ -0,0 +1,190 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiSmm.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SmmMemLib.h>
+
+// SmmIsBufferOutsideSmmValid
+/** This function check if the buffer is valid per processor architecture and
+    not overlap with SMRAM.
+
+  The host has no SMRAM, hence any buffer within the address space is valid.
+
+  @param[in] Buffer  The buffer start address to be checked.
+  @param[in] Length  The buffer length to be checked.
+
+  @retval TRUE   This buffer is valid per processor architecture and not
+                 overlap with SMRAM.
+  @retval FALSE  This buffer is not valid per processor architecture or
+                 overlap with SMRAM.
+**/
+BOOLEAN
+EFIAPI
+SmmIsBufferOutsideSmmValid (
+  IN EFI_PHYSICAL_ADDRESS  Buffer,
+  IN UINT64                Length
+  )
+{
+  if ((Length > MAX_ADDRESS)
+   || (Buffer > MAX_ADDRESS)
+   || ((Length != 0) && (Buffer > (MAX_ADDRESS - (Length - 1))))) {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+// SmmCopyMemToSmram
+/** Copies a source buffer (non-SMRAM) to a destination buffer (SMRAM).
+
+  @param[out] DestinationBuffer  The pointer to the destination buffer of the
+                                 memory copy.
+  @param[in]  SourceBuffer       The pointer to the source buffer of the
+                                 memory copy.
+  @param[in]  Length             The number of bytes to copy from
+                                 SourceBuffer to DestinationBuffer.
+
+  @retval EFI_SECURITY_VIOLATION  The SourceBuffer is invalid per processor
+                                  architecture or overlap with SMRAM.
+  @retval EFI_SUCCESS             Memory is copied.
+**/
+EFI_STATUS
+EFIAPI
+SmmCopyMemToSmram (
+  OUT VOID        *DestinationBuffer,
+  IN  CONST VOID  *SourceBuffer,
+  IN  UINTN       Length
+  )
+{
+  if (!SmmIsBufferOutsideSmmValid (
+         (EFI_PHYSICAL_ADDRESS)(UINTN)SourceBuffer,
+         Length
+         )) {
+    return EFI_SECURITY_VIOLATION;
+  }
+
+  CopyMem (DestinationBuffer, SourceBuffer, Length);
+
+  return EFI_SUCCESS;
+}
+
+// SmmCopyMemFromSmram
+/** Copies a source buffer (SMRAM) to a destination buffer (NON-SMRAM).
+
+  @param[out] DestinationBuffer  The pointer to the destination buffer of the
+                                 memory copy.
+  @param[in]  SourceBuffer       The pointer to the source buffer of the
+                                 memory copy.
+  @param[in]  Length             The number of bytes to copy from
+                                 SourceBuffer to DestinationBuffer.
+
+  @retval EFI_SECURITY_VIOLATION  The DesinationBuffer is invalid per
+                                  processor architecture or overlap with
+                                  SMRAM.
+  @retval EFI_SUCCESS             Memory is copied.
+**/
+EFI_STATUS
+EFIAPI
+SmmCopyMemFromSmram (
+  OUT VOID        *DestinationBuffer,
+  IN  CONST VOID  *SourceBuffer,
+  IN  UINTN       Length
+  )
+{
+  if (!SmmIsBufferOutsideSmmValid (
+         (EFI_PHYSICAL_ADDRESS)(UINTN)DestinationBuffer,
+         Length
+         )) {
+    return EFI_SECURITY_VIOLATION;
+  }
+
+  CopyMem (DestinationBuffer, SourceBuffer, Length);
+
+  return EFI_SUCCESS;
+}
+
+// SmmCopyMem
+/** Copies a source buffer (NON-SMRAM) to a destination buffer (NON-SMRAM).
+
+  @param[out] DestinationBuffer  The pointer to the destination buffer of the
+                                 memory copy.
+  @param[in]  SourceBuffer       The pointer to the source buffer of the
+                                 memory copy.
+  @param[in]  Length             The number of bytes to copy from
+                                 SourceBuffer to DestinationBuffer.
+
+  @retval EFI_SECURITY_VIOLATION  The DesinationBuffer or the SourceBuffer is
+                                  invalid per processor architecture or
+                                  overlap with SMRAM.
+  @retval EFI_SUCCESS             Memory is copied.
+**/
+EFI_STATUS
+EFIAPI
+SmmCopyMem (
+  OUT VOID        *DestinationBuffer,
+  IN  CONST VOID  *SourceBuffer,
+  IN  UINTN       Length
+  )
+{
+  if (!SmmIsBufferOutsideSmmValid (
+         (EFI_PHYSICAL_ADDRESS)(UINTN)DestinationBuffer,
+         Length
+         )
+   || !SmmIsBufferOutsideSmmValid (
+         (EFI_PHYSICAL_ADDRESS)(UINTN)SourceBuffer,
+         Length
+         )) {
+    return EFI_SECURITY_VIOLATION;
+  }
+
+  CopyMem (DestinationBuffer, SourceBuffer, Length);
+
+  return EFI_SUCCESS;
+}
+
+// SmmSetMem
+/** Fills a target buffer (NON-SMRAM) with a byte value.
+
+  @param[out] Buffer  The memory to set.
+  @param[in]  Length  The number of bytes to set.
+  @param[in]  Value   The value with which to fill Length bytes of Buffer.
+
+  @retval EFI_SECURITY_VIOLATION  The Buffer is invalid per processor
+                                  architecture or overlap with SMRAM.
+  @retval EFI_SUCCESS             Memory is set.
+**/
+EFI_STATUS
+EFIAPI
+SmmSetMem (
+  OUT VOID   *Buffer,
+  IN  UINTN  Length,
+  IN  UINT8  Value
+  )
+{
+  if (!SmmIsBufferOutsideSmmValid (
+         (EFI_PHYSICAL_ADDRESS)(UINTN)Buffer,
+         Length
+         )) {
+    return EFI_SECURITY_VIOLATION;
+  }
+
+  SetMem (Buffer, Length, Value);
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,1024 @@
+/** @file
+  Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+**/
+
+#include <PiSmm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SmmServicesTableLib.h>
+
+// HOST_SMM_HANDLE_SIGNATURE
+#define HOST_SMM_HANDLE_SIGNATURE  SIGNATURE_32 ('h', 's', 'h', 'n')
+
+// HOST_SMM_NOTIFY_SIGNATURE
+#define HOST_SMM_NOTIFY_SIGNATURE  SIGNATURE_32 ('h', 's', 'n', 't')
+
+// HOST_SMI_HANDLER_SIGNATURE
+#define HOST_SMI_HANDLER_SIGNATURE  SIGNATURE_32 ('h', 's', 'm', 'i')
+
+// HOST_SMM_HANDLE
+typedef struct {
+  UINT32     Signature;  ///< HOST_SMM_HANDLE_SIGNATURE.
+  LIST_ENTRY Link;       ///< Links all handles.
+  LIST_ENTRY Protocols;  ///< The protocols installed on the handle.
+} HOST_SMM_HANDLE;
+
+// SMM_HANDLE_FROM_LINK
+#define SMM_HANDLE_FROM_LINK(Entry)  BASE_CR ((Entry), HOST_SMM_HANDLE, Link)
+
+// HOST_SMM_PROTOCOL_INTERFACE
+typedef struct {
+  LIST_ENTRY Link;        ///< Links the protocols of the handle.
+  EFI_GUID   Protocol;    ///< The GUID of the protocol.
+  VOID       *Interface;  ///< The installed interface.
+  UINT64     Key;         ///< The order the interface was installed in.
+} HOST_SMM_PROTOCOL_INTERFACE;
+
+// SMM_PROTOCOL_FROM_LINK
+#define SMM_PROTOCOL_FROM_LINK(Entry)  \
+  BASE_CR ((Entry), HOST_SMM_PROTOCOL_INTERFACE, Link)
+
+// HOST_SMM_PROTOCOL_NOTIFY
+typedef struct {
+  UINT32            Signature;  ///< HOST_SMM_NOTIFY_SIGNATURE.
+  LIST_ENTRY        Link;       ///< Links all registrations.
+  EFI_GUID          Protocol;   ///< The GUID of the protocol.
+  EFI_SMM_NOTIFY_FN Function;   ///< Called on installation.
+  UINT64            Key;        ///< The key of the last interface returned.
+} HOST_SMM_PROTOCOL_NOTIFY;
+
+// SMM_NOTIFY_FROM_LINK
+#define SMM_NOTIFY_FROM_LINK(Entry)  \
+  BASE_CR ((Entry), HOST_SMM_PROTOCOL_NOTIFY, Link)
+
+// HOST_SMI_HANDLER
+typedef struct {
+  UINT32                       Signature;    ///< HOST_SMI_HANDLER_SIGNATURE.
+  LIST_ENTRY                   Link;         ///< Links all handlers.
+  EFI_SMM_HANDLER_ENTRY_POINT2 Handler;      ///< The handler function.
+  EFI_GUID                     HandlerType;  ///< The type of the handler.
+  BOOLEAN                      IsRoot;       ///< Whether it handles root SMIs.
+} HOST_SMI_HANDLER;
+
+// SMI_HANDLER_FROM_LINK
+#define SMI_HANDLER_FROM_LINK(Entry)  BASE_CR ((Entry), HOST_SMI_HANDLER, Link)
+
+// mHandles
+STATIC LIST_ENTRY mHandles = INITIALIZE_LIST_HEAD_VARIABLE (mHandles);
+
+// mProtocolNotifies
+STATIC LIST_ENTRY mProtocolNotifies =
+  INITIALIZE_LIST_HEAD_VARIABLE (mProtocolNotifies);
+
+// mSmiHandlers
+STATIC LIST_ENTRY mSmiHandlers = INITIALIZE_LIST_HEAD_VARIABLE (mSmiHandlers);
+
+// mInterfaceKey
+STATIC UINT64 mInterfaceKey = 0;
+
+// mCpuSaveStateSize
+/// The host emulates a single processor without a save state.
+STATIC UINTN mCpuSaveStateSize[1] = { 0 };
+
+// mCpuSaveState
+STATIC VOID *mCpuSaveState[1] = { NULL };
+
+// mSmmFirmwareVendor
+STATIC CHAR16 mSmmFirmwareVendor[] = L"EfiMiscPkg Host";
+
+// Configuration Table Services
+
+// InternalSmmInstallConfigurationTable
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmmInstallConfigurationTable (
+  IN CONST EFI_SMM_SYSTEM_TABLE2  *SystemTable,
+  IN CONST EFI_GUID               *Guid,
+  IN VOID                         *Table,
+  IN UINTN                        TableSize
+  )
+{
+  EFI_CONFIGURATION_TABLE *Tables;
+  UINTN                   NumberOfTables;
+  UINTN                   Index;
+
+  if (Guid == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Tables         = gSmst->SmmConfigurationTable;
+  NumberOfTables = gSmst->NumberOfTableEntries;
+
+  for (Index = 0; Index < NumberOfTables; ++Index) {
+    if (CompareGuid (&Tables[Index].VendorGuid, Guid)) {
+      break;
+    }
+  }
+
+  if (Index < NumberOfTables) {
+    if (Table != NULL) {
+      Tables[Index].VendorTable = Table;
+    } else {
+      --NumberOfTables;
+
+      CopyMem (
+        (VOID *)&Tables[Index],
+        (VOID *)&Tables[Index + 1],
+        ((NumberOfTables - Index) * sizeof (*Tables))
+        );
+    }
+  } else {
+    if (Table == NULL) {
+      return EFI_NOT_FOUND;
+    }
+
+    Tables = ReallocatePool (
+               (NumberOfTables * sizeof (*Tables)),
+               ((NumberOfTables + 1) * sizeof (*Tables)),
+               (VOID *)Tables
+               );
+
+    if (Tables == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    CopyGuid (&Tables[NumberOfTables].VendorGuid, Guid);
+
+    Tables[NumberOfTables].VendorTable = Table;
+
+    ++NumberOfTables;
+  }
+
+  gSmst->SmmConfigurationTable = Tables;
+  gSmst->NumberOfTableEntries  = NumberOfTables;
+
+  return EFI_SUCCESS;
+}
+
+// Memory Services
+
+// InternalSmmAllocatePool
+/** Allocates pool from the host heap, which stands in for SMRAM.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmmAllocatePool (
+  IN  EFI_MEMORY_TYPE  PoolType,
+  IN  UINTN            Size,
+  OUT VOID             **Buffer
+  )
+{
+  if (Buffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *Buffer = AllocatePool (Size);
+
+  if (*Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  return EFI_SUCCESS;
+}
+
+// InternalSmmFreePool
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmmFreePool (
+  IN VOID  *Buffer
+  )
+{
+  if (Buffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  FreePool (Buffer);
+
+  return EFI_SUCCESS;
+}
+
+// InternalSmmAllocatePages
+/** Allocates pages from the host heap.  Pages at a fixed address cannot be
+    allocated.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmmAllocatePages (
+  IN     EFI_ALLOCATE_TYPE     Type,
+  IN     EFI_MEMORY_TYPE       MemoryType,
+  IN     UINTN                 Pages,
+  IN OUT EFI_PHYSICAL_ADDRESS  *Memory
+  )
+{
+  VOID *Buffer;
+
+  if ((Memory == NULL) || (Type >= MaxAllocateType)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Type == AllocateAddress) {
+    return EFI_NOT_FOUND;
+  }
+
+  Buffer = AllocatePages (Pages);
+
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if ((Type == AllocateMaxAddress)
+   && (((UINTN)Buffer + EFI_PAGES_TO_SIZE (Pages) - 1) > *Memory)) {
+    FreePages (Buffer, Pages);
+    return EFI_NOT_FOUND;
+  }
+
+  *Memory = (EFI_PHYSICAL_ADDRESS)(UINTN)Buffer;
+
+  return EFI_SUCCESS;
+}
+
+// InternalSmmFreePages
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmmFreePages (
+  IN EFI_PHYSICAL_ADDRESS  Memory,
+  IN UINTN                 Pages
+  )
+{
+  if ((Memory & EFI_PAGE_MASK) != 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  FreePages ((VOID *)(UINTN)Memory, Pages);
+
+  return EFI_SUCCESS;
+}
+
+// MP Services
+
+// InternalSmmStartupThisAp
+/** The only processor is the one executing, hence there is no AP to start.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmmStartupThisAp (
+  IN     EFI_AP_PROCEDURE  Procedure,
+  IN     UINTN             CpuNumber,
+  IN OUT VOID              *ProcArguments OPTIONAL
+  )
+{
+  return EFI_INVALID_PARAMETER;
+}
+
+// Protocol Handler Services
+
+// InternalGetHandle
+STATIC
+HOST_SMM_HANDLE *
+InternalGetHandle (
+  IN EFI_HANDLE  Handle
+  )
+{
+  HOST_SMM_HANDLE *HostHandle;
+  LIST_ENTRY      *Link;
+
+  for (
+    Link = GetFirstNode (&mHandles);
+    !IsNull (&mHandles, Link);
+    Link = GetNextNode (&mHandles, Link)
+    ) {
+    HostHandle = SMM_HANDLE_FROM_LINK (Link);
+
+    if ((EFI_HANDLE)HostHandle == Handle) {
+      ASSERT (HostHandle->Signature == HOST_SMM_HANDLE_SIGNATURE);
+      return HostHandle;
+    }
+  }
+
+  return NULL;
+}
+
+// InternalFindProtocol
+STATIC
+HOST_SMM_PROTOCOL_INTERFACE *
+InternalFindProtocol (
+  IN CONST HOST_SMM_HANDLE  *Handle,
+  IN CONST EFI_GUID         *Protocol
+  )
+{
+  HOST_SMM_PROTOCOL_INTERFACE *Interface;
+  LIST_ENTRY                  *Link;
+
+  for (
+    Link = GetFirstNode (&Handle->Protocols);
+    !IsNull (&Handle->Protocols, Link);
+    Link = GetNextNode (&Handle->Protocols, Link)
+    ) {
+    Interface = SMM_PROTOCOL_FROM_LINK (Link);
+
+    if (CompareGuid (&Interface->Protocol, Protocol)) {
+      return Interface;
+    }
+  }
+
+  return NULL;
+}
+
+// InternalNotifyProtocol
+/** Calls the functions registered for the installation of Protocol.  Unlike
+    the UEFI notifications, SMM notifications are called immediately.
+**/
+STATIC
+VOID
+InternalNotifyProtocol (
+  IN CONST EFI_GUID  *Protocol,
+  IN VOID            *Interface,
+  IN EFI_HANDLE      Handle
+  )
+{
+  HOST_SMM_PROTOCOL_NOTIFY *Notify;
+  LIST_ENTRY               *Link;
+
+  for (
+    Link = GetFirstNode (&mProtocolNotifies);
+    !IsNull (&mProtocolNotifies, Link);
+    Link = GetNextNode (&mProtocolNotifies, Link)
+    ) {
+    Notify = SMM_NOTIFY_FROM_LINK (Link);
+
+    if (CompareGuid (&Notify->Protocol, Protocol)) {
+      Notify->Function (Protocol, Interface, Handle);
+    }
+  }
+}
+
+// InternalSmmInstallProtocolInterface
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmmInstallProtocolInterface (
+  IN OUT EFI_HANDLE          *Handle,
+  IN     EFI_GUID            *Protocol,
+  IN     EFI_INTERFACE_TYPE  InterfaceType,
+  IN     VOID                *Interface
+  )
+{
+  HOST_SMM_HANDLE             *HostHandle;
+  HOST_SMM_PROTOCOL_INTERFACE *HostInterface;
+
+  if ((Handle == NULL)
+   || (Protocol == NULL)
+   || (InterfaceType != EFI_NATIVE_INTERFACE)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (*Handle != NULL) {
+    HostHandle = InternalGetHandle (*Handle);
+
+    if (HostHandle == NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    if (InternalFindProtocol (HostHandle, Protocol) != NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+  } else {
+    HostHandle = AllocateZeroPool (sizeof (*HostHandle));
+
+    if (HostHandle == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    HostHandle->Signature = HOST_SMM_HANDLE_SIGNATURE;
+
+    InitializeListHead (&HostHandle->Protocols);
+  }
+
+  HostInterface = AllocatePool (sizeof (*HostInterface));
+
+  if (HostInterface == NULL) {
+    if (*Handle == NULL) {
+      FreePool ((VOID *)HostHandle);
+    }
+
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  CopyGuid (&HostInterface->Protocol, Protocol);
+
+  HostInterface->Interface = Interface;
+  HostInterface->Key       = ++mInterfaceKey;
+
+  if (IsListEmpty (&HostHandle->Protocols)) {
+    InsertTailList (&mHandles, &HostHandle->Link);
+  }
+
+  InsertTailList (&HostHandle->Protocols, &HostInterface->Link);
+
+  *Handle = (EFI_HANDLE)HostHandle;
+
+  InternalNotifyProtocol (Protocol, Interface, *Handle);
+
+  return EFI_SUCCESS;
+}
+
+// InternalSmmUninstallProtocolInterface
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmmUninstallProtocolInterface (
+  IN EFI_HANDLE  Handle,
+  IN EFI_GUID    *Protocol,
+  IN VOID        *Interface
+  )
+{
+  HOST_SMM_HANDLE             *HostHandle;
+  HOST_SMM_PROTOCOL_INTERFACE *HostInterface;
+
+  if ((Handle == NULL) || (Protocol == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  HostHandle = InternalGetHandle (Handle);
+
+  if (HostHandle == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  HostInterface = InternalFindProtocol (HostHandle, Protocol);
+
+  if ((HostInterface == NULL) || (HostInterface->Interface != Interface)) {
+    return EFI_NOT_FOUND;
+  }
+
+  RemoveEntryList (&HostInterface->Link);
+  FreePool ((VOID *)HostInterface);
+
+  // A handle without protocols ceases to exist.
+
+  if (IsListEmpty (&HostHandle->Protocols)) {
+    RemoveEntryList (&HostHandle->Link);
+    FreePool ((VOID *)HostHandle);
+  }
+
+  return EFI_SUCCESS;
+}
+
+// InternalSmmHandleProtocol
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmmHandleProtocol (
+  IN  EFI_HANDLE  Handle,
+  IN  EFI_GUID    *Protocol,
+  OUT VOID        **Interface
+  )
+{
+  HOST_SMM_HANDLE             *HostHandle;
+  HOST_SMM_PROTOCOL_INTERFACE *HostInterface;
+
+  if ((Protocol == NULL) || (Interface == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *Interface = NULL;
+  HostHandle = InternalGetHandle (Handle);
+
+  if (HostHandle == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  HostInterface = InternalFindProtocol (HostHandle, Protocol);
+
+  if (HostInterface == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+
+  *Interface = HostInterface->Interface;
+
+  return EFI_SUCCESS;
+}
+
+// InternalGetNotify
+STATIC
+HOST_SMM_PROTOCOL_NOTIFY *
+InternalGetNotify (
+  IN VOID  *Registration
+  )
+{
+  HOST_SMM_PROTOCOL_NOTIFY *Notify;
+  LIST_ENTRY               *Link;
+
+  for (
+    Link = GetFirstNode (&mProtocolNotifies);
+    !IsNull (&mProtocolNotifies, Link);
+    Link = GetNextNode (&mProtocolNotifies, Link)
+    ) {
+    Notify = SMM_NOTIFY_FROM_LINK (Link);
+
+    if ((VOID *)Notify == Registration) {
+      ASSERT (Notify->Signature == HOST_SMM_NOTIFY_SIGNATURE);
+      return Notify;
+    }
+  }
+
+  return NULL;
+}
+
+// InternalSmmRegisterProtocolNotify
+/** Registers Function for the installation of Protocol, or, when Function is
+    NULL, cancels the registration of the same protocol Registration refers
+    to.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmmRegisterProtocolNotify (
+  IN  CONST EFI_GUID     *Protocol,
+  IN  EFI_SMM_NOTIFY_FN  Function,
+  OUT VOID               **Registration
+  )
+{
+  HOST_SMM_PROTOCOL_NOTIFY *Notify;
+
+  if ((Protocol == NULL) || (Registration == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Function == NULL) {
+    Notify = InternalGetNotify (*Registration);
+
+    if ((Notify == NULL) || !CompareGuid (&Notify->Protocol, Protocol)) {
+      return EFI_NOT_FOUND;
+    }
+
+    RemoveEntryList (&Notify->Link);
+    FreePool ((VOID *)Notify);
+
+    return EFI_SUCCESS;
+  }
+
+  Notify = AllocatePool (sizeof (*Notify));
+
+  if (Notify == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  CopyGuid (&Notify->Protocol, Protocol);
+
+  // Only interfaces installed after the registration are reported.
+  Notify->Signature = HOST_SMM_NOTIFY_SIGNATURE;
+  Notify->Function  = Function;
+  Notify->Key       = mInterfaceKey;
+
+  InsertTailList (&mProtocolNotifies, &Notify->Link);
+
+  *Registration = (VOID *)Notify;
+
+  return EFI_SUCCESS;
+}
+
+// InternalGetNextNotifiedInterface
+/** Returns the interface installed first after the last one returned for a
+    registration, and the handle it is installed on.
+**/
+STATIC
+HOST_SMM_PROTOCOL_INTERFACE *
+InternalGetNextNotifiedInterface (
+  IN  CONST HOST_SMM_PROTOCOL_NOTIFY  *Notify,
+  OUT HOST_SMM_HANDLE                 **Handle
+  )
+{
+  HOST_SMM_PROTOCOL_INTERFACE *Next;
+  HOST_SMM_PROTOCOL_INTERFACE *Interface;
+  HOST_SMM_HANDLE             *HostHandle;
+  LIST_ENTRY                  *Link;
+
+  Next = NULL;
+
+  for (
+    Link = GetFirstNode (&mHandles);
+    !IsNull (&mHandles, Link);
+    Link = GetNextNode (&mHandles, Link)
+    ) {
+    HostHandle = SMM_HANDLE_FROM_LINK (Link);
+    Interface  = InternalFindProtocol (HostHandle, &Notify->Protocol);
+
+    if ((Interface != NULL)
+     && (Interface->Key > Notify->Key)
+     && ((Next == NULL) || (Interface->Key < Next->Key))) {
+      Next    = Interface;
+      *Handle = HostHandle;
+    }
+  }
+
+  return Next;
+}
+
+// InternalSmmLocateHandle
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmmLocateHandle (
+  IN     EFI_LOCATE_SEARCH_TYPE  SearchType,
+  IN     EFI_GUID                *Protocol, OPTIONAL
+  IN     VOID                    *SearchKey, OPTIONAL
+  IN OUT UINTN                   *BufferSize,
+  OUT    EFI_HANDLE              *Buffer
+  )
+{
+  HOST_SMM_PROTOCOL_NOTIFY    *Notify;
+  HOST_SMM_PROTOCOL_INTERFACE *Interface;
+  HOST_SMM_HANDLE             *HostHandle;
+  LIST_ENTRY                  *Link;
+  UINTN                       Count;
+
+  if ((BufferSize == NULL) || ((*BufferSize > 0) && (Buffer == NULL))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  switch (SearchType) {
+    case AllHandles:
+    case ByProtocol:
+    {
+      if ((SearchType == ByProtocol) && (Protocol == NULL)) {
+        return EFI_INVALID_PARAMETER;
+      }
+
+      Count = 0;
+
+      for (
+        Link = GetFirstNode (&mHandles);
+        !IsNull (&mHandles, Link);
+        Link = GetNextNode (&mHandles, Link)
+        ) {
+        HostHandle = SMM_HANDLE_FROM_LINK (Link);
+
+        if ((SearchType == ByProtocol)
+         && (InternalFindProtocol (HostHandle, Protocol) == NULL)) {
+          continue;
+        }
+
+        if (((Count + 1) * sizeof (*Buffer)) <= *BufferSize) {
+          Buffer[Count] = (EFI_HANDLE)HostHandle;
+        }
+
+        ++Count;
+      }
+
+      break;
+    }
+
+    case ByRegisterNotify:
+    {
+      Notify = InternalGetNotify (SearchKey);
+
+      if (Notify == NULL) {
+        return EFI_INVALID_PARAMETER;
+      }
+
+      // One handle is returned per call.
+
+      Count     = 0;
+      Interface = InternalGetNextNotifiedInterface (Notify, &HostHandle);
+
+      if (Interface != NULL) {
+        Count = 1;
+
+        if (*BufferSize >= sizeof (*Buffer)) {
+          Buffer[0]   = (EFI_HANDLE)HostHandle;
+          Notify->Key = Interface->Key;
+        }
+      }
+
+      break;
+    }
+
+    default:
+    {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  if (Count == 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  if ((Count * sizeof (*Buffer)) > *BufferSize) {
+    *BufferSize = (Count * sizeof (*Buffer));
+
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  *BufferSize = (Count * sizeof (*Buffer));
+
+  return EFI_SUCCESS;
+}
+
+// InternalSmmLocateProtocol
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmmLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration, OPTIONAL
+  OUT VOID      **Interface
+  )
+{
+  HOST_SMM_PROTOCOL_NOTIFY    *Notify;
+  HOST_SMM_PROTOCOL_INTERFACE *HostInterface;
+  HOST_SMM_HANDLE             *HostHandle;
+  LIST_ENTRY                  *Link;
+
+  if ((Protocol == NULL) || (Interface == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *Interface = NULL;
+
+  if (Registration != NULL) {
+    Notify = InternalGetNotify (Registration);
+
+    if (Notify == NULL) {
+      return EFI_NOT_FOUND;
+    }
+
+    HostInterface = InternalGetNextNotifiedInterface (Notify, &HostHandle);
+
+    if (HostInterface == NULL) {
+      return EFI_NOT_FOUND;
+    }
+
+    Notify->Key = HostInterface->Key;
+    *Interface  = HostInterface->Interface;
+
+    return EFI_SUCCESS;
+  }
+
+  for (
+    Link = GetFirstNode (&mHandles);
+    !IsNull (&mHandles, Link);
+    Link = GetNextNode (&mHandles, Link)
+    ) {
+    HostInterface = InternalFindProtocol (
+                      SMM_HANDLE_FROM_LINK (Link),
+                      Protocol
+                      );
+
+    if (HostInterface != NULL) {
+      *Interface = HostInterface->Interface;
+      return EFI_SUCCESS;
+    }
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+// SMI Management Services
+
+// InternalSmiManage
+/** Calls the handlers registered for HandlerType, or the root handlers if
+    HandlerType is NULL, following the return value semantics of the PI SMM
+    Core.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmiManage (
+  IN     CONST EFI_GUID  *HandlerType,
+  IN     CONST VOID      *Context, OPTIONAL
+  IN OUT VOID            *CommBuffer, OPTIONAL
+  IN OUT UINTN           *CommBufferSize OPTIONAL
+  )
+{
+  EFI_STATUS       Status;
+
+  HOST_SMI_HANDLER *Handler;
+  LIST_ENTRY       *Link;
+  LIST_ENTRY       *NextLink;
+  BOOLEAN          SuccessReturn;
+
+  Status        = EFI_NOT_FOUND;
+  SuccessReturn = FALSE;
+
+  // A handler may unregister itself, hence the next link is retrieved first.
+
+  for (
+    Link = GetFirstNode (&mSmiHandlers);
+    !IsNull (&mSmiHandlers, Link);
+    Link = NextLink
+    ) {
+    NextLink = GetNextNode (&mSmiHandlers, Link);
+    Handler  = SMI_HANDLER_FROM_LINK (Link);
+
+    if (HandlerType == NULL) {
+      if (!Handler->IsRoot) {
+        continue;
+      }
+    } else if (Handler->IsRoot
+            || !CompareGuid (&Handler->HandlerType, HandlerType)) {
+      continue;
+    }
+
+    Status = Handler->Handler (
+                        (EFI_HANDLE)Handler,
+                        Context,
+                        CommBuffer,
+                        CommBufferSize
+                        );
+
+    switch (Status) {
+      case EFI_INTERRUPT_PENDING:
+      {
+        if (HandlerType != NULL) {
+          return EFI_INTERRUPT_PENDING;
+        }
+
+        break;
+      }
+
+      case EFI_SUCCESS:
+      {
+        if (HandlerType != NULL) {
+          return EFI_SUCCESS;
+        }
+
+        SuccessReturn = TRUE;
+
+        break;
+      }
+
+      case EFI_WARN_INTERRUPT_SOURCE_QUIESCED:
+      {
+        SuccessReturn = TRUE;
+
+        break;
+      }
+
+      case EFI_WARN_INTERRUPT_SOURCE_PENDING:
+      {
+        break;
+      }
+
+      default:
+      {
+        ASSERT (FALSE);
+
+        break;
+      }
+    }
+  }
+
+  if (SuccessReturn) {
+    Status = EFI_SUCCESS;
+  }
+
+  return Status;
+}
+
+// InternalSmiHandlerRegister
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmiHandlerRegister (
+  IN  EFI_SMM_HANDLER_ENTRY_POINT2  Handler,
+  IN  CONST EFI_GUID                *HandlerType, OPTIONAL
+  OUT EFI_HANDLE                    *DispatchHandle
+  )
+{
+  HOST_SMI_HANDLER *SmiHandler;
+
+  if ((Handler == NULL) || (DispatchHandle == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  SmiHandler = AllocateZeroPool (sizeof (*SmiHandler));
+
+  if (SmiHandler == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  SmiHandler->Signature = HOST_SMI_HANDLER_SIGNATURE;
+  SmiHandler->Handler   = Handler;
+  SmiHandler->IsRoot    = (BOOLEAN)(HandlerType == NULL);
+
+  if (HandlerType != NULL) {
+    CopyGuid (&SmiHandler->HandlerType, HandlerType);
+  }
+
+  InsertTailList (&mSmiHandlers, &SmiHandler->Link);
+
+  *DispatchHandle = (EFI_HANDLE)SmiHandler;
+
+  return EFI_SUCCESS;
+}
+
+// InternalSmiHandlerUnRegister
+STATIC
+EFI_STATUS
+EFIAPI
+InternalSmiHandlerUnRegister (
+  IN EFI_HANDLE  DispatchHandle
+  )
+{
+  HOST_SMI_HANDLER *SmiHandler;
+  LIST_ENTRY       *Link;
+
+  for (
+    Link = GetFirstNode (&mSmiHandlers);
+    !IsNull (&mSmiHandlers, Link);
+    Link = GetNextNode (&mSmiHandlers, Link)
+    ) {
+    SmiHandler = SMI_HANDLER_FROM_LINK (Link);
+
+    if ((EFI_HANDLE)SmiHandler == DispatchHandle) {
+      ASSERT (SmiHandler->Signature == HOST_SMI_HANDLER_SIGNATURE);
+
+      RemoveEntryList (&SmiHandler->Link);
+      FreePool ((VOID *)SmiHandler);
+
+      return EFI_SUCCESS;
+    }
+  }
+
+  return EFI_INVALID_PARAMETER;
+}
+
+// mHostSmst
+STATIC EFI_SMM_SYSTEM_TABLE2 mHostSmst = {
+  {
+    SMM_SMST_SIGNATURE,
+    EFI_SMM_SYSTEM_TABLE2_REVISION,
+    sizeof (EFI_SMM_SYSTEM_TABLE2),
+    0,
+    0
+  },
+  mSmmFirmwareVendor,
+  0,
+  InternalSmmInstallConfigurationTable,
+  {
+    { NULL, NULL },
+    { NULL, NULL }
+  },
+  InternalSmmAllocatePool,
+  InternalSmmFreePool,
+  InternalSmmAllocatePages,
+  InternalSmmFreePages,
+  InternalSmmStartupThisAp,
+  0,
+  1,
+  mCpuSaveStateSize,
+  mCpuSaveState,
+  0,
+  NULL,
+  InternalSmmInstallProtocolInterface,
+  InternalSmmUninstallProtocolInterface,
+  InternalSmmHandleProtocol,
+  InternalSmmRegisterProtocolNotify,
+  InternalSmmLocateHandle,
+  InternalSmmLocateProtocol,
+  InternalSmiManage,
+  InternalSmiHandlerRegister,
+  InternalSmiHandlerUnRegister
+};
+
+// gSmst
+EFI_SMM_SYSTEM_TABLE2 *gSmst = &mHostSmst;
+
+// InSmm
+/** This function allows the caller to determine if the driver is executing in
+    System Management Mode(SMM).
+
+  The host emulates SMM, hence the function always returns TRUE.
+
+  @retval TRUE  The driver is executing in System Management Mode (SMM).
+**/
+BOOLEAN
+EFIAPI
+InSmm (
+  VOID
+  )
+{
+  return TRUE;
+}
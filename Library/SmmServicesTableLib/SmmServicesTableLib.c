@@ -24,6 +24,12 @@ EFI_SMM_SYSTEM_TABLE2 *gSmst = NULL;
 // mSmmBase2
 STATIC EFI_SMM_BASE2_PROTOCOL *mSmmBase2 = NULL;
 
+// mInSmm
+/// A driver linking this library is loaded twice, once outside of SMRAM and
+/// once into SMRAM, and each copy has its own globals.  Hence, whether the
+/// image runs in SMM is determined once by the constructor.
+STATIC BOOLEAN mInSmm = FALSE;
+
 // SmmServicesTableLibConstructor
 /** The constructor function caches the pointer of SMM Services Table.
 
@@ -41,8 +47,6 @@ SmmServicesTableLibConstructor (
 {
   EFI_STATUS Status;
 
-  BOOLEAN    InSram;
-
   // Retrieve SMM Base2 Protocol, do not use gBS from UefiBootServicesTableLib
   // on purpose to prevent inclusion of gBS, gST, and gImageHandle from SMM
   // Drivers unless the SMM driver explicity declares that dependency.
@@ -56,9 +60,11 @@ SmmServicesTableLibConstructor (
   ASSERT (mSmmBase2 != NULL);
 
   if (!EFI_ERROR (Status)) {
-    InSram = InSmm ();
+    Status = mSmmBase2->InSmm (mSmmBase2, &mInSmm);
 
-    if (InSram) {
+    ASSERT_EFI_ERROR (Status);
+
+    if (mInSmm) {
       // We are in SMM, retrieve the pointer to SMM System Table
       Status = mSmmBase2->GetSmstLocation (mSmmBase2, &gSmst);
 
@@ -75,7 +81,8 @@ SmmServicesTableLibConstructor (
     System Management Mode(SMM).
 
   This function returns TRUE if the driver is executing in SMM and FALSE if the 
-  driver is not executing in SMM.
+  driver is not executing in SMM.  The result is cached by the constructor, so
+  the function may be used on SMI hot paths.
 
   @retval TRUE   The driver is executing in System Management Mode (SMM).
   @retval FALSE  The driver is not executing in System Management Mode (SMM).
@@ -86,13 +93,7 @@ InSmm (
   VOID
   )
 {
-  BOOLEAN    InSmram;
-
-  EFI_STATUS Status;
-
-  Status = mSmmBase2->InSmm (mSmmBase2, &InSmram);
+  ASSERT (mSmmBase2 != NULL);
 
-  ASSERT_EFI_ERROR (Status);
-  
-  return InSmram;
+  return mInSmm;
 }
@@ -0,0 +1,227 @@
+## @file
+# Copyright (C) 2016, CupertinoNet.  All rights reserved.<BR>
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+##
+
+"""Compiles a keyboard layout description into a MISC_USB_HID_KEYMAP.
+
+A layout description has one line per key:
+
+    <KeyCode> <Normal> [<Shift> [<AltGr> [<ShiftAltGr>]]] [caps] [num]
+
+KeyCode is the USB Keycode in hexadecimal.  Each character is either a single
+character, U+XXXX, or - for no character.  'caps' marks the key as affected by
+CapsLock, 'num' as producing characters only with NumLock on.  Lines starting
+with '#' are comments.
+
+The keymap is written either as C source defining a CONST MISC_USB_HID_KEYMAP,
+or as a binary image to be loaded at runtime and checked with
+MiscUsbHidKeymapIsValid().
+"""
+
+import argparse
+import struct
+import sys
+
+NUMBER_OF_KEY_CODES = 0xE8
+NUMBER_OF_STATES = 4
+SIGNATURE = struct.unpack('<I', b'MKMP')[0]
+STATE_NAMES = ('Normal', 'Shift', 'AltGr', 'ShiftAltGr')
+FLAGS = ('caps', 'num')
+
+
+class KeymapError(Exception):
+    pass
+
+
+def parse_character(token, location):
+    if token == '-':
+        return 0
+
+    if token.upper().startswith('U+') and len(token) > 2:
+        try:
+            value = int(token[2:], 16)
+        except ValueError:
+            raise KeymapError('%s: invalid character %r' % (location, token))
+    elif len(token) == 1:
+        value = ord(token)
+    else:
+        raise KeymapError('%s: invalid character %r' % (location, token))
+
+    if value > 0xFFFF:
+        raise KeymapError('%s: %r is not a UCS-2 character' % (location, token))
+
+    return value
+
+
+def parse_layout(lines, file_name):
+    characters = [[0] * NUMBER_OF_KEY_CODES for _ in range(NUMBER_OF_STATES)]
+    caps_lock_keys = set()
+    num_lock_keys = set()
+    defined = set()
+
+    for line_number, line in enumerate(lines, 1):
+        location = '%s:%d' % (file_name, line_number)
+        tokens = line.split()
+
+        if not tokens or tokens[0].startswith('#'):
+            continue
+
+        try:
+            key_code = int(tokens[0], 16)
+        except ValueError:
+            raise KeymapError('%s: invalid keycode %r' % (location, tokens[0]))
+
+        if key_code >= NUMBER_OF_KEY_CODES:
+            raise KeymapError('%s: keycode 0x%X out of range'
+                              % (location, key_code))
+
+        if key_code in defined:
+            raise KeymapError('%s: keycode 0x%X defined twice'
+                              % (location, key_code))
+
+        defined.add(key_code)
+
+        flags = []
+
+        while len(tokens) > 1 and tokens[-1] in FLAGS:
+            flags.append(tokens.pop())
+
+        values = tokens[1:]
+
+        if not values or len(values) > NUMBER_OF_STATES:
+            raise KeymapError('%s: expected 1 to %d characters'
+                              % (location, NUMBER_OF_STATES))
+
+        for state, token in enumerate(values):
+            characters[state][key_code] = parse_character(token, location)
+
+        # Keys without explicit shifted characters produce the same character.
+        if len(values) == 1:
+            characters[1][key_code] = characters[0][key_code]
+
+        if 'caps' in flags:
+            caps_lock_keys.add(key_code)
+
+        if 'num' in flags:
+            num_lock_keys.add(key_code)
+
+    return characters, caps_lock_keys, num_lock_keys
+
+
+def key_set_words(keys):
+    words = [0] * 4
+
+    for key in keys:
+        words[key // 64] |= 1 << (key % 64)
+
+    return words
+
+
+def write_binary(output, characters, caps_lock_keys, num_lock_keys):
+    data = struct.pack('<II', SIGNATURE, 0)
+    data += struct.pack('<4Q', *key_set_words(caps_lock_keys))
+    data += struct.pack('<4Q', *key_set_words(num_lock_keys))
+
+    for state in characters:
+        data += struct.pack('<%dH' % NUMBER_OF_KEY_CODES, *state)
+
+    output.write(data)
+
+
+def write_source(output, name, source_name, characters, caps_lock_keys,
+                 num_lock_keys):
+    lines = [
+        '/** @file',
+        '  Generated by Scripts/KeymapCompiler.py from %s.' % source_name,
+        '  Do not edit.',
+        '**/',
+        '',
+        '#include <Uefi.h>',
+        '',
+        '#include <Library/MiscUsbHidLib.h>',
+        '',
+        '// %s' % name,
+        'GLOBAL_REMOVE_IF_UNREFERENCED',
+        'CONST MISC_USB_HID_KEYMAP %s = {' % name,
+        '  MISC_USB_HID_KEYMAP_SIGNATURE,',
+        '  0,',
+    ]
+
+    for keys in (caps_lock_keys, num_lock_keys):
+        lines.append('  {')
+        lines.append('    {')
+
+        for word in key_set_words(keys):
+            lines.append('      0x%016XULL,' % word)
+
+        lines[-1] = lines[-1].rstrip(',')
+        lines.append('    }')
+        lines.append('  },')
+
+    lines.append('  {')
+
+    for state, table in enumerate(characters):
+        lines.append('    // %s' % STATE_NAMES[state])
+        lines.append('    {')
+
+        for first in range(0, NUMBER_OF_KEY_CODES, 8):
+            row = ', '.join('0x%04X' % value
+                            for value in table[first:first + 8])
+            separator = ',' if first + 8 < NUMBER_OF_KEY_CODES else ' '
+            lines.append('      %s%s  // 0x%02X' % (row, separator, first))
+
+        lines.append('    }%s' % (',' if state + 1 < len(characters) else ''))
+
+    lines.append('  }')
+    lines.append('};')
+
+    output.write('\n'.join(lines) + '\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('layout', help='the layout description to compile')
+    parser.add_argument('-o', '--output', required=True,
+                        help='the file to write the keymap to')
+    parser.add_argument('-n', '--name', default='gMiscUsbHidKeymap',
+                        help='the name of the C variable')
+    parser.add_argument('-b', '--binary', action='store_true',
+                        help='write a binary image instead of C source')
+    arguments = parser.parse_args()
+
+    with open(arguments.layout, encoding='utf-8') as layout:
+        lines = layout.readlines()
+
+    try:
+        keymap = parse_layout(lines, arguments.layout)
+    except KeymapError as error:
+        sys.stderr.write('error: %s\n' % error)
+        return 1
+
+    if arguments.binary:
+        with open(arguments.output, 'wb') as output:
+            write_binary(output, *keymap)
+    else:
+        source_name = arguments.layout.replace('\\', '/').split('/')[-1]
+
+        with open(arguments.output, 'w', newline='\n') as output:
+            write_source(output, arguments.name, source_name, *keymap)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())